@@ -1,5 +1,10 @@
 #include "dhcp_client.h"
 
+// Parámetros que el cliente pide en la opción 55 (Subnet Mask, Router, DNS)
+static const uint8_t requested_parameters[] = {
+    DHCP_OPTION_SUBNET_MASK, DHCP_OPTION_ROUTER, DHCP_OPTION_DNS_SERVER
+};
+
 // Función que inicia el cliente DHCP
 void init_dhcp_client() {
 
@@ -117,10 +122,12 @@ void handle_dhcp_protocol(dhcp_client_t* client, struct sockaddr_in* server_addr
             continue;  // Reintentar si falla
         }
 
-        // Verificar las opciones del mensaje para identificar el tipo
-        uint8_t* message_type = find_dhcp_option(offer_message.options, 53);
-        if (message_type) {
-            switch (*message_type) {
+        // Indexar las opciones una sola vez y leer el tipo de mensaje
+        dhcp_option_index_t options;
+        uint8_t message_type;
+        if (dhcp_parse_options(&options, (const uint8_t*)&offer_message, recv_len) == 0 &&
+            dhcp_get_message_type(&options, &message_type)) {
+            switch (message_type) {
                 case DHCP_OFFER:
                     printf("Oferta DHCP recibida: %s\n", inet_ntoa(recv_addr.sin_addr));
                     handle_dhcp_offer(client, server_addr, &offer_message);  // Procesar la oferta
@@ -128,7 +135,7 @@ void handle_dhcp_protocol(dhcp_client_t* client, struct sockaddr_in* server_addr
 
                 case DHCP_ACK:
                     printf("ACK recibido del servidor.\n");
-                    handle_dhcp_ack(client, &offer_message, server_addr);  // Procesar el ACK
+                    handle_dhcp_ack(client, &offer_message, &options, server_addr);  // Procesar el ACK
                     break;
 
                 case DHCP_NAK:
@@ -175,23 +182,14 @@ void send_dhcp_discover(int sockfd, struct sockaddr_in* server_addr, uint8_t* ma
     // Configurar la dirección MAC del cliente (se puede personalizar)
     memcpy(discover_packet.chaddr, mac_addr, 6);
 
-    // Opciones DHCP fijas
-    discover_packet.options[0] = 53;  // Opción 53: DHCP Message Type
-    discover_packet.options[1] = 1;   // Longitud de la opción
-    discover_packet.options[2] = DHCP_DISCOVER;  // DHCPDISCOVER
-
-    // Opción 55: Parameter Request List (Lista de parámetros solicitados)
-    discover_packet.options[3] = 55;  // Opción 55: Parameter Request List
-    discover_packet.options[4] = 3;   // Longitud de la opción
-    discover_packet.options[5] = 1;   // Solicitar Subnet Mask
-    discover_packet.options[6] = 3;   // Solicitar Router
-    discover_packet.options[7] = 6;   // Solicitar DNS
-
-    // Opción 255: Fin de las opciones
-    discover_packet.options[8] = 255;
+    // Opciones DHCP: tipo de mensaje y lista de parámetros solicitados (Subnet Mask, Router, DNS)
+    dhcp_option_writer_t writer;
+    dhcp_writer_init(&writer, discover_packet.options, sizeof(discover_packet.options));
+    dhcp_put_message_type(&writer, DHCP_DISCOVER);
+    dhcp_put_parameter_list(&writer, requested_parameters, sizeof(requested_parameters));
 
     // Calcular el tamaño del paquete real (base del paquete más las opciones)
-    ssize_t packet_size = sizeof(struct dhcp_packet) - sizeof(discover_packet.options) + 9;
+    ssize_t packet_size = sizeof(struct dhcp_packet) - sizeof(discover_packet.options) + dhcp_put_end(&writer);
 
     // Enviar el paquete DISCOVER al servidor
     ssize_t sent_bytes = sendto(sockfd, &discover_packet, packet_size, 0,
@@ -230,7 +228,8 @@ void handle_dhcp_offer(dhcp_client_t* client, struct sockaddr_in* server_addr, s
     if (validate_offered_ip(&offered_ip, &(client->subnet_mask), &(client->network_ip))) {
         // Si la validación es exitosa, enviar DHCPREQUEST
         printf("IP ofrecida válida. Enviando DHCPREQUEST para la IP: %s\n", inet_ntoa(offered_ip));
-        send_dhcp_request(client->sockfd, server_addr, &offered_ip, client->mac_addr);
+        // El REQUEST de la selección reutiliza el xid del OFFER (RFC 2131, sección 4.4.1)
+        send_dhcp_request(client->sockfd, server_addr, &offered_ip, client->mac_addr, offer_packet->xid);
     } else {
         // Si la validación falla, enviar DHCPDECLINE
         printf("IP ofrecida inválida. Enviando DHCPDECLINE para la IP: %s\n", inet_ntoa(offered_ip));
@@ -239,7 +238,7 @@ void handle_dhcp_offer(dhcp_client_t* client, struct sockaddr_in* server_addr, s
 }
 
 // Función que envía un DHCPREQUEST al servidor
-void send_dhcp_request(int sockfd, struct sockaddr_in* server_addr, struct in_addr* offered_ip, uint8_t* mac_addr) {
+void send_dhcp_request(int sockfd, struct sockaddr_in* server_addr, struct in_addr* offered_ip, uint8_t* mac_addr, uint32_t xid) {
     struct dhcp_packet request_packet;
     memset(&request_packet, 0, sizeof(struct dhcp_packet));
 
@@ -247,39 +246,22 @@ void send_dhcp_request(int sockfd, struct sockaddr_in* server_addr, struct in_ad
     request_packet.op = 1;  // 1 = solicitud
     request_packet.htype = 1;  // Tipo de hardware: Ethernet
     request_packet.hlen = 6;   // Longitud de la dirección de hardware (6 bytes para MAC)
-    request_packet.xid = htonl(random());  // Generar un ID de transacción aleatorio
+    request_packet.xid = xid;  // ID de la transacción a la que pertenece el REQUEST
     request_packet.flags = htons(0x8000);  // Solicitar respuesta de broadcast
 
     // Configurar la dirección MAC del cliente (se puede personalizar
     memcpy(request_packet.chaddr, mac_addr, 6); // Luego copia los 6 bytes de la dirección MAC
     request_packet.ciaddr = offered_ip->s_addr;
 
-    // Opciones DHCP fijas
-    request_packet.options[0] = 53;  // Opción 53: DHCP Message Type
-    request_packet.options[1] = 1;   // Longitud de la opción
-    request_packet.options[2] = DHCP_REQUEST;  // DHCPREQUEST
-
-    // Opción 50: IP solicitada
-    request_packet.options[3] = 50;  // Opción 50: Requested IP Address
-    request_packet.options[4] = 4;   // Longitud de la opción (4 bytes para dirección IP)
-    memcpy(&request_packet.options[5], &offered_ip->s_addr, 4);  // Copiar la IP solicitada
-
-    // Opción 54: Server Identifier (la IP del servidor DHCP)
-    request_packet.options[9] = 54;  // Opción 54: Server Identifier
-    request_packet.options[10] = 4;  // Longitud de la opción (4 bytes para dirección IP)
-    memcpy(&request_packet.options[11], &server_addr->sin_addr.s_addr, 4);  // Copiar la IP del servidor
-
-    // Opción 55: Parameter Request List (Lista de parámetros solicitados)
-    request_packet.options[15] = 55;  // Opción 55: Parameter Request List
-    request_packet.options[16] = 3;   // Longitud de la opción
-    request_packet.options[17] = 1;   // Solicitar Subnet Mask
-    request_packet.options[18] = 3;   // Solicitar Router
-    request_packet.options[19] = 6;   // Solicitar DNS
+    // Opciones DHCP: tipo, IP solicitada (50), servidor (54) y lista de parámetros (55)
+    dhcp_option_writer_t writer;
+    dhcp_writer_init(&writer, request_packet.options, sizeof(request_packet.options));
+    dhcp_put_message_type(&writer, DHCP_REQUEST);
+    dhcp_put_requested_ip(&writer, offered_ip->s_addr);
+    dhcp_put_server_id(&writer, server_addr->sin_addr.s_addr);
+    dhcp_put_parameter_list(&writer, requested_parameters, sizeof(requested_parameters));
 
-    // Opción 255: Fin de las opciones
-    request_packet.options[20] = 255;
-
-    ssize_t packet_size = sizeof(struct dhcp_packet) - sizeof(request_packet.options) + 21;
+    ssize_t packet_size = sizeof(struct dhcp_packet) - sizeof(request_packet.options) + dhcp_put_end(&writer);
 
     // Enviar el paquete REQUEST al servidor
     ssize_t sent_bytes = sendto(sockfd, &request_packet, packet_size, 0,
@@ -309,26 +291,15 @@ void send_dhcp_decline(int sockfd, struct in_addr* offered_ip, struct sockaddr_i
     // Configurar la dirección MAC del cliente (se puede personalizar)
     memcpy(&decline_packet.chaddr, mac_addr, 6);
 
-    // Opciones DHCP fijas
-    decline_packet.options[0] = 53;  // Opción 53: DHCP Message Type
-    decline_packet.options[1] = 1;   // Longitud de la opción
-    decline_packet.options[2] = DHCP_DECLINE;  // DHCPDECLINE
-
-    // Opción 50: IP ofrecida que estamos rechazando
-    decline_packet.options[3] = 50;  // Opción 50: Requested IP Address
-    decline_packet.options[4] = 4;   // Longitud de la opción (4 bytes para dirección IP)
-    memcpy(&decline_packet.options[5], &offered_ip->s_addr, 4);  // Copiar la IP ofrecida
-
-    // Opción 54: Server Identifier (la IP del servidor DHCP)
-    decline_packet.options[9] = 54;  // Opción 54: Server Identifier
-    decline_packet.options[10] = 4;  // Longitud de la opción (4 bytes para dirección IP)
-    memcpy(&decline_packet.options[11], &server_addr->sin_addr.s_addr, 4);  // Copiar la IP del servidor
-
-    // Opción 255: Fin de las opciones
-    decline_packet.options[15] = 255;
+    // Opciones DHCP: tipo, IP rechazada (50) y servidor (54)
+    dhcp_option_writer_t writer;
+    dhcp_writer_init(&writer, decline_packet.options, sizeof(decline_packet.options));
+    dhcp_put_message_type(&writer, DHCP_DECLINE);
+    dhcp_put_requested_ip(&writer, offered_ip->s_addr);
+    dhcp_put_server_id(&writer, server_addr->sin_addr.s_addr);
 
     // Calcular el tamaño del paquete real (base del paquete más las opciones)
-    ssize_t packet_size = sizeof(struct dhcp_packet) - sizeof(decline_packet.options) + 16;  // 16 por las opciones añadidas
+    ssize_t packet_size = sizeof(struct dhcp_packet) - sizeof(decline_packet.options) + dhcp_put_end(&writer);
 
     // Enviar el paquete DECLINE al servidor
     ssize_t sent_bytes = sendto(sockfd, &decline_packet, packet_size, 0,
@@ -362,7 +333,7 @@ void handle_dhcp_nak(dhcp_client_t* client) {
 }
 
 // Función que maneja el DHCPACK (confirmación de asignación de IP)
-void handle_dhcp_ack(dhcp_client_t* client, struct dhcp_packet* ack_packet, struct sockaddr_in* server_addr) {
+void handle_dhcp_ack(dhcp_client_t* client, struct dhcp_packet* ack_packet, const dhcp_option_index_t* options, struct sockaddr_in* server_addr) {
     printf("Procesando DHCP ACK del servidor...\n");
 
     // Extraer la IP asignada (yiaddr)
@@ -371,40 +342,32 @@ void handle_dhcp_ack(dhcp_client_t* client, struct dhcp_packet* ack_packet, stru
 
     // Extraer las opciones importantes del ACK
     // Extraer las opciones importantes del ACK (Submask, Router, DNS, Lease Time)
-    uint8_t* subnet_mask_option = find_dhcp_option(ack_packet->options, 1);  // Opción 1: Subnet Mask
-    uint8_t* router_option = find_dhcp_option(ack_packet->options, 3);       // Opción 3: Gateway (router)
-    uint8_t* dns_option = find_dhcp_option(ack_packet->options, 6);          // Opción 6: DNS
-    uint8_t* lease_time_option = find_dhcp_option(ack_packet->options, 51);  // Opción 51: Lease Time
-
-    // Procesar la máscara de subred
-    if (subnet_mask_option) {
-        memcpy(&(client->subnet_mask.s_addr), subnet_mask_option, 4);
+
+    // Procesar la máscara de subred (opción 1)
+    if (dhcp_get_subnet_mask(options, &client->subnet_mask.s_addr)) {
         printf("Máscara de subred asignada: %s\n", inet_ntoa(client->subnet_mask));
     } else {
         printf("No se recibió la opción de Máscara de subred.\n");
     }
 
-    // Procesar el Gateway (router)
+    // Procesar el Gateway (router, opción 3)
     struct in_addr router_ip;
-    if (router_option) {
-        memcpy(&(router_ip.s_addr), router_option, 4);
+    if (dhcp_get_router(options, &router_ip.s_addr)) {
         printf("Puerta de enlace (Gateway) asignada: %s\n", inet_ntoa(router_ip));
     } else {
         printf("No se recibió la opción de Puerta de enlace.\n");
     }
 
-    // Procesar los servidores DNS
+    // Procesar los servidores DNS (opción 6)
     struct in_addr dns_ip;
-    if (dns_option) {
-        memcpy(&(dns_ip.s_addr), dns_option, 4);
+    if (dhcp_get_dns_server(options, &dns_ip.s_addr)) {
         printf("Servidor DNS asignado: %s\n", inet_ntoa(dns_ip));
     } else {
         printf("No se recibió la opción de Servidor DNS.\n");
     }
 
-    // Procesar el tiempo de concesión (lease time)
-    if (lease_time_option) {
-        client->lease_time = ntohl(*(uint32_t*)lease_time_option);  // Convertir desde formato de red a host
+    // Procesar el tiempo de concesión (lease time, opción 51; el decodificador ya lo deja en orden de host)
+    if (dhcp_get_lease_time(options, &client->lease_time)) {
         printf("Tiempo de concesión (lease time): %u segundos\n", client->lease_time);
 
         // Calcular tiempos de renovación (T1) y rebind (T2)
@@ -446,12 +409,12 @@ void handle_lease_renewal(dhcp_client_t* client, struct sockaddr_in* server_addr
             broadcast_addr.sin_port = htons(67);  // Puerto del servidor DHCP (67)
             broadcast_addr.sin_addr.s_addr = htonl(INADDR_BROADCAST);  // Usar broadcast
 
-            send_dhcp_request(client->sockfd, &broadcast_addr, &(client->offered_ip), client->mac_addr);  // Rebind en broadcast
+            send_dhcp_request(client->sockfd, &broadcast_addr, &(client->offered_ip), client->mac_addr, htonl(random()));  // Rebind en broadcast
             t2_count++;
         } else if (elapsed_time >= client->renewal_time && t1_count < 1) {
             // T1 alcanzado: enviar un DHCP Request directamente al servidor (renovación)
             printf("Tiempo T1 alcanzado. Enviando DHCP Request al servidor para renovación.\n");
-            send_dhcp_request(client->sockfd, server_addr, offered_ip, client->mac_addr);  // Renovación (T1)
+            send_dhcp_request(client->sockfd, server_addr, offered_ip, client->mac_addr, htonl(random()));  // Renovación (T1)
             t1_count++;
         }
 
@@ -482,15 +445,12 @@ void send_dhcp_release(dhcp_client_t* client, struct sockaddr_in* server_addr, s
     // Configurar la dirección IP del servidor DHCP
     release_packet.ciaddr = offered_ip->s_addr;
 
-    // Opciones DHCP Fijas
-    release_packet.options[0] = 53;  // Opción 53: Tipo de mensaje DHCP
-    release_packet.options[1] = 1;   // Longitud de la opción
-    release_packet.options[2] = DHCP_RELEASE;  // DHCPRELEASE
+    // Opciones DHCP: solo el tipo de mensaje
+    dhcp_option_writer_t writer;
+    dhcp_writer_init(&writer, release_packet.options, sizeof(release_packet.options));
+    dhcp_put_message_type(&writer, DHCP_RELEASE);
 
-    // Opción de fin (código 255)
-    release_packet.options[3] = 255;   // Longitud de la opción
-
-    ssize_t packet_size = sizeof(struct dhcp_packet) - sizeof(release_packet.options) + 4;
+    ssize_t packet_size = sizeof(struct dhcp_packet) - sizeof(release_packet.options) + dhcp_put_end(&writer);
 
     // Enviar el paquete REQUEST al servidor
     ssize_t sent_bytes = sendto(client->sockfd, &release_packet, packet_size, 0,
@@ -502,32 +462,6 @@ void send_dhcp_release(dhcp_client_t* client, struct sockaddr_in* server_addr, s
     }
 }
 
-uint8_t* find_dhcp_option(uint8_t* options, uint8_t code) {
-    int i = 0;
-
-    // Recorrer las opciones hasta encontrar la opción de fin (código 255)
-    while (i < 312) {  // Longitud fija del array de opciones
-        uint8_t option_code = options[i];  // Código de la opción actual
-
-        // Si encontramos el código de fin (255), detener la búsqueda
-        if (option_code == 255) {
-            break;
-        }
-
-        // Si encontramos el código de opción deseado, devolver un puntero al valor de la opción
-        if (option_code == code) {
-            return &options[i + 2];  // Retornar el puntero al valor (i + 2 salta código y longitud)
-        }
-
-        // Si no es la opción deseada, avanzar a la siguiente (código + longitud + valor)
-        uint8_t option_length = options[i + 1];  // Longitud de la opción
-        i += 2 + option_length;  // Avanzar al siguiente código de opción
-    }
-
-    // Si no se encuentra la opción, devolver NULL
-    return NULL;
-}
-
 // Función para generar una MAC Address aleatoria
 void generate_random_mac(uint8_t* mac_addr) {
 
@@ -0,0 +1,303 @@
+#include "dhcp_lock.h"
+#include <string.h> // Para strcmp, strrchr, memset
+
+int dhcp_lock_profiling = 0;
+
+// Contadores de una clase. Los comparten todos los hilos, así que se suman con atómicos.
+typedef struct {
+    const char* name;
+    uint64_t acquisitions;
+    uint64_t contended;
+    uint64_t wait_sum_ns, wait_max_ns;
+    uint64_t hold_sum_ns, hold_max_ns;
+    uint64_t wait_counts[DHCP_LOCK_BUCKETS];
+    uint64_t hold_counts[DHCP_LOCK_BUCKETS];
+} lock_class_t;
+
+static lock_class_t classes[DHCP_LOCK_MAX_CLASSES];
+static int class_count = 0;
+static pthread_mutex_t class_lock = PTHREAD_MUTEX_INITIALIZER;  // Solo para registrar clases (sin medir)
+static dhcp_lock_site_t* sites = NULL;                          // Sitios registrados (se agregan al frente)
+
+int dhcp_lock_configure(const char* mode) {
+    dhcp_lock_profiling = 0;
+    if (mode == NULL || *mode == '\0' || strcmp(mode, "off") == 0 || strcmp(mode, "0") == 0) {
+        return 0;
+    }
+    if (strcmp(mode, "on") == 0 || strcmp(mode, "1") == 0) {
+        dhcp_lock_profiling = 1;
+        return 0;
+    }
+    fprintf(stderr, "Advertencia: DHCP_LOCK_PROFILE '%s' no reconocido (off u on), se usa off.\n", mode);
+    return -1;
+}
+
+int dhcp_mutex_init(dhcp_mutex_t* mutex, const char* name) {
+    mutex->name = name;
+    mutex->lock_class = -1;
+    mutex->hold_start = 0;
+    mutex->holder = NULL;
+    return pthread_mutex_init(&mutex->mutex, NULL);
+}
+
+int dhcp_mutex_destroy(dhcp_mutex_t* mutex) {
+    return pthread_mutex_destroy(&mutex->mutex);
+}
+
+// Índice de la clase de un nombre, registrándola si es nueva (-1 si no hay lugar)
+static int find_class(const char* name) {
+    pthread_mutex_lock(&class_lock);
+    int index = -1;
+    for (int i = 0; i < class_count; i++) {
+        if (strcmp(classes[i].name, name) == 0) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0 && class_count < DHCP_LOCK_MAX_CLASSES) {
+        index = class_count;
+        classes[index].name = name;
+        __atomic_store_n(&class_count, class_count + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&class_lock);
+    return index;
+}
+
+static int mutex_class(dhcp_mutex_t* mutex) {
+    int index = __atomic_load_n(&mutex->lock_class, __ATOMIC_RELAXED);
+    if (index < 0) {
+        index = find_class(mutex->name ? mutex->name : "sin nombre");
+        __atomic_store_n(&mutex->lock_class, index, __ATOMIC_RELAXED);
+    }
+    return index;
+}
+
+// Agregar el sitio a la lista la primera vez que toma un lock con el perfil encendido
+static void register_site(dhcp_lock_site_t* site, int lock_class) {
+    int expected = 0;
+    if (!__atomic_compare_exchange_n(&site->registered, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return;
+    }
+    site->lock_class = lock_class;
+    dhcp_lock_site_t* head = __atomic_load_n(&sites, __ATOMIC_RELAXED);
+    do {
+        site->next = head;
+    } while (!__atomic_compare_exchange_n(&sites, &head, site, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+// Mismo esquema de buckets que las trazas de latencia: exacto hasta 16 ns, luego log-lineal
+static uint32_t lock_bucket(uint64_t ns) {
+    if (ns < DHCP_LOCK_SUB_BUCKETS) {
+        return (uint32_t)ns;
+    }
+    int exponent = 63 - __builtin_clzll(ns);
+    if (exponent > DHCP_LOCK_MAX_EXPONENT) {
+        return DHCP_LOCK_BUCKETS - 1;
+    }
+    uint32_t sub = (uint32_t)(ns >> (exponent - DHCP_LOCK_SUB_BITS)) & (DHCP_LOCK_SUB_BUCKETS - 1);
+    return (uint32_t)(exponent - DHCP_LOCK_SUB_BITS + 1) * DHCP_LOCK_SUB_BUCKETS + sub;
+}
+
+static uint64_t lock_bucket_limit(uint32_t bucket) {
+    if (bucket < DHCP_LOCK_SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = (int)(bucket / DHCP_LOCK_SUB_BUCKETS) - 1;
+    uint64_t sub = bucket % DHCP_LOCK_SUB_BUCKETS;
+    return ((DHCP_LOCK_SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+static void atomic_max(uint64_t* target, uint64_t value) {
+    uint64_t current = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while (value > current &&
+           !__atomic_compare_exchange_n(target, &current, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void dhcp_mutex_lock_profiled(dhcp_mutex_t* mutex, dhcp_lock_site_t* site) {
+    int index = mutex_class(mutex);
+    if (!__atomic_load_n(&site->registered, __ATOMIC_ACQUIRE)) {
+        register_site(site, index);
+    }
+
+    uint64_t wait = 0;
+    int contended = pthread_mutex_trylock(&mutex->mutex) != 0;
+    if (contended) {
+        uint64_t start = dhcp_lock_clock();
+        pthread_mutex_lock(&mutex->mutex);
+        mutex->hold_start = dhcp_lock_clock();
+        wait = mutex->hold_start - start;
+    } else {
+        mutex->hold_start = dhcp_lock_clock();
+    }
+    mutex->holder = site;
+
+    __atomic_fetch_add(&site->acquisitions, 1, __ATOMIC_RELAXED);
+    lock_class_t* class = index >= 0 ? &classes[index] : NULL;
+    if (class) {
+        __atomic_fetch_add(&class->acquisitions, 1, __ATOMIC_RELAXED);
+    }
+    if (contended) {
+        __atomic_fetch_add(&site->contended, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&site->wait_ns, wait, __ATOMIC_RELAXED);
+        atomic_max(&site->max_wait_ns, wait);
+        if (class) {
+            __atomic_fetch_add(&class->contended, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&class->wait_counts[lock_bucket(wait)], 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&class->wait_sum_ns, wait, __ATOMIC_RELAXED);
+            atomic_max(&class->wait_max_ns, wait);
+        }
+    }
+}
+
+void dhcp_mutex_end_hold(dhcp_mutex_t* mutex) {
+    uint64_t hold = dhcp_lock_clock() - mutex->hold_start;
+    dhcp_lock_site_t* site = mutex->holder;
+    mutex->hold_start = 0;
+    mutex->holder = NULL;
+
+    if (site) {
+        __atomic_fetch_add(&site->hold_ns, hold, __ATOMIC_RELAXED);
+    }
+    int index = mutex_class(mutex);
+    if (index >= 0) {
+        lock_class_t* class = &classes[index];
+        __atomic_fetch_add(&class->hold_counts[lock_bucket(hold)], 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&class->hold_sum_ns, hold, __ATOMIC_RELAXED);
+        atomic_max(&class->hold_max_ns, hold);
+    }
+}
+
+// Resumir un histograma; los percentiles no pasan del máximo real
+static void summarize(const uint64_t* counts, uint64_t sum, uint64_t max, dhcp_lock_summary_t* summary) {
+    memset(summary, 0, sizeof(*summary));
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < DHCP_LOCK_BUCKETS; i++) {
+        total += __atomic_load_n(&counts[i], __ATOMIC_RELAXED);
+    }
+    if (total == 0) {
+        return;
+    }
+
+    double ranks[] = { 0.50, 0.99 };
+    uint64_t* values[] = { &summary->p50, &summary->p99 };
+    for (int p = 0; p < 2; p++) {
+        uint64_t rank = (uint64_t)(ranks[p] * total);
+        if (rank >= total) rank = total - 1;
+        uint64_t seen = 0;
+        *values[p] = lock_bucket_limit(DHCP_LOCK_BUCKETS - 1);
+        for (uint32_t i = 0; i < DHCP_LOCK_BUCKETS; i++) {
+            seen += __atomic_load_n(&counts[i], __ATOMIC_RELAXED);
+            if (seen > rank) {
+                *values[p] = lock_bucket_limit(i);
+                break;
+            }
+        }
+        if (*values[p] > max) *values[p] = max;
+    }
+    summary->count = total;
+    summary->mean = sum / total;
+    summary->max = max;
+}
+
+static void class_stats(lock_class_t* class, dhcp_lock_stats_t* stats) {
+    stats->name = class->name;
+    stats->acquisitions = __atomic_load_n(&class->acquisitions, __ATOMIC_RELAXED);
+    stats->contended = __atomic_load_n(&class->contended, __ATOMIC_RELAXED);
+    summarize(class->wait_counts, __atomic_load_n(&class->wait_sum_ns, __ATOMIC_RELAXED),
+              __atomic_load_n(&class->wait_max_ns, __ATOMIC_RELAXED), &stats->wait);
+    summarize(class->hold_counts, __atomic_load_n(&class->hold_sum_ns, __ATOMIC_RELAXED),
+              __atomic_load_n(&class->hold_max_ns, __ATOMIC_RELAXED), &stats->hold);
+}
+
+int dhcp_lock_stats(const char* name, dhcp_lock_stats_t* stats) {
+    int count = __atomic_load_n(&class_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(classes[i].name, name) == 0) {
+            class_stats(&classes[i], stats);
+            return 0;
+        }
+    }
+    memset(stats, 0, sizeof(*stats));
+    return -1;
+}
+
+// Imprimir una celda de texto alineada por caracteres, no por bytes (acentos)
+static void print_cell(FILE* out, const char* text, int width) {
+    for (const char* c = text; *c; c++) {
+        width += ((unsigned char)*c & 0xc0) == 0x80;
+    }
+    fprintf(out, "%-*s", width, text);
+}
+
+void dhcp_lock_dump(FILE* out) {
+    fprintf(out, "Contención de locks (us; espera solo de las tomas contendidas)\n");
+    // "máx" ocupa un byte más de lo que se ve
+    fprintf(out, "%-22s %10s %10s %7s %9s %9s %11s %9s %9s %11s\n", "lock", "tomas", "contend.", "%",
+            "esp. p50", "esp. p99", "esp. máx", "ret. p50", "ret. p99", "ret. máx");
+    int count = __atomic_load_n(&class_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; i++) {
+        dhcp_lock_stats_t stats;
+        class_stats(&classes[i], &stats);
+        if (stats.acquisitions == 0 && stats.hold.count == 0) {
+            continue;
+        }
+        print_cell(out, stats.name, 22);
+        fprintf(out, " %10llu %10llu %6.2f%% %9.2f %9.2f %10.2f %9.2f %9.2f %10.2f\n",
+                (unsigned long long)stats.acquisitions, (unsigned long long)stats.contended,
+                stats.acquisitions ? 100.0 * stats.contended / stats.acquisitions : 0.0,
+                stats.wait.p50 / 1e3, stats.wait.p99 / 1e3, stats.wait.max / 1e3,
+                stats.hold.p50 / 1e3, stats.hold.p99 / 1e3, stats.hold.max / 1e3);
+    }
+
+    // Los sitios con más espera total (selección simple: son pocos)
+    dhcp_lock_site_t* top[DHCP_LOCK_TOP_SITES];
+    int top_count = 0;
+    for (dhcp_lock_site_t* site = __atomic_load_n(&sites, __ATOMIC_ACQUIRE); site != NULL; site = site->next) {
+        uint64_t wait = __atomic_load_n(&site->wait_ns, __ATOMIC_RELAXED);
+        if (wait == 0) continue;
+        int position = top_count < DHCP_LOCK_TOP_SITES ? top_count++ : DHCP_LOCK_TOP_SITES;
+        while (position > 0 && __atomic_load_n(&top[position - 1]->wait_ns, __ATOMIC_RELAXED) < wait) {
+            if (position < DHCP_LOCK_TOP_SITES) top[position] = top[position - 1];
+            position--;
+        }
+        if (position < DHCP_LOCK_TOP_SITES) top[position] = site;
+    }
+    if (top_count == 0) {
+        fprintf(out, "Ningún sitio tuvo que esperar un lock.\n");
+        fflush(out);
+        return;
+    }
+
+    fprintf(out, "Sitios con más espera:\n");
+    for (int i = 0; i < top_count; i++) {
+        dhcp_lock_site_t* site = top[i];
+        const char* file = strrchr(site->file, '/');
+        uint64_t acquisitions = __atomic_load_n(&site->acquisitions, __ATOMIC_RELAXED);
+        uint64_t contended = __atomic_load_n(&site->contended, __ATOMIC_RELAXED);
+        fprintf(out, "  %s (%s:%d) [%s]: espera %.2f us en %llu de %llu tomas, máx %.2f us, retención %.2f us\n",
+                site->function, file ? file + 1 : site->file, site->line,
+                site->lock_class >= 0 ? classes[site->lock_class].name : "?",
+                __atomic_load_n(&site->wait_ns, __ATOMIC_RELAXED) / 1e3,
+                (unsigned long long)contended, (unsigned long long)acquisitions,
+                __atomic_load_n(&site->max_wait_ns, __ATOMIC_RELAXED) / 1e3,
+                __atomic_load_n(&site->hold_ns, __ATOMIC_RELAXED) / 1e3);
+    }
+    fflush(out);
+}
+
+void dhcp_lock_reset() {
+    int count = __atomic_load_n(&class_count, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < count; i++) {
+        const char* name = classes[i].name;
+        memset(&classes[i], 0, sizeof(classes[i]));
+        classes[i].name = name;
+    }
+    for (dhcp_lock_site_t* site = __atomic_load_n(&sites, __ATOMIC_ACQUIRE); site != NULL; site = site->next) {
+        site->acquisitions = 0;
+        site->contended = 0;
+        site->wait_ns = 0;
+        site->max_wait_ns = 0;
+        site->hold_ns = 0;
+    }
+}
@@ -0,0 +1,145 @@
+#ifndef DHCP_LOCK_H
+#define DHCP_LOCK_H
+
+// Mutex con perfil de contención opcional (DHCP_LOCK_PROFILE) para los locks del servidor.
+//
+// Cada dhcp_mutex_t tiene una clase (su nombre: todos los shards suman en "shard") y cada
+// llamada a dhcp_mutex_lock es un sitio con sus propios contadores. Con el perfil apagado
+// tomar el lock cuesta leer un entero y un salto más que pthread_mutex_lock. Encendido, se
+// prueba primero con trylock: si falla la toma cuenta como contendida y se mide la espera;
+// desde que se obtiene hasta que se suelta se mide la retención. Las esperas y retenciones
+// van a histogramas log-lineales por clase (16 sub-buckets por potencia de 2) y los sitios
+// acumulan su espera para ordenar dónde se pierde más tiempo.
+
+#include <pthread.h> // Para pthread_mutex_t, pthread_cond_t
+#include <stdint.h>  // Para uint64_t
+#include <stdio.h>   // Para FILE
+#include <time.h>    // Para clock_gettime, timespec
+
+#define DHCP_LOCK_SUB_BITS 4                                   // 16 sub-buckets por potencia de 2
+#define DHCP_LOCK_SUB_BUCKETS (1 << DHCP_LOCK_SUB_BITS)
+#define DHCP_LOCK_MAX_EXPONENT 36                              // 2^36 ns (~69 s); lo mayor cae en el último
+#define DHCP_LOCK_BUCKETS ((DHCP_LOCK_MAX_EXPONENT - DHCP_LOCK_SUB_BITS + 2) * DHCP_LOCK_SUB_BUCKETS)
+#define DHCP_LOCK_MAX_CLASSES 32                               // Nombres de lock distintos en el proceso
+#define DHCP_LOCK_TOP_SITES 10                                 // Sitios que lista el volcado
+
+// Sitio del código que toma un lock (uno estático por cada llamada a dhcp_mutex_lock)
+typedef struct dhcp_lock_site {
+    const char* file;
+    int line;
+    const char* function;
+    int lock_class;               // Clase del primer lock tomado aquí (-1 hasta registrarlo)
+    int registered;               // Ya está en la lista de sitios
+    struct dhcp_lock_site* next;  // Siguiente sitio registrado
+    uint64_t acquisitions;        // Tomas medidas
+    uint64_t contended;           // Tomas que tuvieron que esperar
+    uint64_t wait_ns;             // Espera total
+    uint64_t max_wait_ns;
+    uint64_t hold_ns;             // Retención total de las tomas hechas aquí
+} dhcp_lock_site_t;
+
+// Mutex con nombre. Los campos de la tenencia solo los toca el hilo que tiene el lock.
+typedef struct {
+    pthread_mutex_t mutex;
+    const char* name;             // Clase del lock: las estadísticas se suman por nombre
+    int lock_class;               // Índice de la clase (-1 hasta la primera toma medida)
+    uint64_t hold_start;          // Inicio de la tenencia medida (0 = tenencia sin medir)
+    dhcp_lock_site_t* holder;     // Sitio de la toma medida actual (NULL tras una espera en condición)
+} dhcp_mutex_t;
+
+#define DHCP_MUTEX_INITIALIZER(lock_name) { PTHREAD_MUTEX_INITIALIZER, lock_name, -1, 0, NULL }
+
+// Resumen de un histograma de una clase, en ns
+typedef struct {
+    uint64_t count;
+    uint64_t mean;
+    uint64_t p50, p99, max;
+} dhcp_lock_summary_t;
+
+// Estadísticas de una clase de lock
+typedef struct {
+    const char* name;
+    uint64_t acquisitions;
+    uint64_t contended;
+    dhcp_lock_summary_t wait;     // Solo las tomas contendidas
+    dhcp_lock_summary_t hold;
+} dhcp_lock_stats_t;
+
+extern int dhcp_lock_profiling;   // DHCP_LOCK_PROFILE=on
+
+// Función para leer DHCP_LOCK_PROFILE ("off" u "on"). Retorna -1 si no reconoce el valor.
+// Se puede cambiar en cualquier momento: las tenencias que empezaron sin medir no se cuentan.
+int dhcp_lock_configure(const char* mode);
+
+// Función para inicializar y destruir un mutex de la clase `name` (cadena que debe seguir viva)
+int dhcp_mutex_init(dhcp_mutex_t* mutex, const char* name);
+int dhcp_mutex_destroy(dhcp_mutex_t* mutex);
+
+// Función para tomar el lock midiendo la espera (camino con el perfil encendido)
+void dhcp_mutex_lock_profiled(dhcp_mutex_t* mutex, dhcp_lock_site_t* site);
+
+// Función para cerrar la tenencia medida del lock (antes de soltarlo o de esperar una condición)
+void dhcp_mutex_end_hold(dhcp_mutex_t* mutex);
+
+// Función para leer las estadísticas de la clase `name`. Retorna -1 si la clase no existe.
+int dhcp_lock_stats(const char* name, dhcp_lock_stats_t* stats);
+
+// Función para imprimir las clases con tomas medidas y los sitios con más espera
+void dhcp_lock_dump(FILE* out);
+
+// Función para vaciar los contadores de clases y sitios (con los hilos que toman locks detenidos)
+void dhcp_lock_reset();
+
+static inline uint64_t dhcp_lock_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline void dhcp_mutex_lock_at(dhcp_mutex_t* mutex, dhcp_lock_site_t* site) {
+    if (__builtin_expect(dhcp_lock_profiling, 0)) {
+        dhcp_mutex_lock_profiled(mutex, site);
+    } else {
+        pthread_mutex_lock(&mutex->mutex);
+    }
+}
+
+static inline void dhcp_mutex_unlock(dhcp_mutex_t* mutex) {
+    if (__builtin_expect(mutex->hold_start != 0, 0)) {
+        dhcp_mutex_end_hold(mutex);
+    }
+    pthread_mutex_unlock(&mutex->mutex);
+}
+
+// La espera en la condición no es retención; al volver empieza una tenencia nueva sin sitio
+static inline void dhcp_mutex_resume_hold(dhcp_mutex_t* mutex) {
+    if (__builtin_expect(dhcp_lock_profiling, 0)) {
+        mutex->hold_start = dhcp_lock_clock();
+    }
+}
+
+static inline int dhcp_cond_wait(pthread_cond_t* cond, dhcp_mutex_t* mutex) {
+    if (__builtin_expect(mutex->hold_start != 0, 0)) {
+        dhcp_mutex_end_hold(mutex);
+    }
+    int result = pthread_cond_wait(cond, &mutex->mutex);
+    dhcp_mutex_resume_hold(mutex);
+    return result;
+}
+
+static inline int dhcp_cond_timedwait(pthread_cond_t* cond, dhcp_mutex_t* mutex, const struct timespec* until) {
+    if (__builtin_expect(mutex->hold_start != 0, 0)) {
+        dhcp_mutex_end_hold(mutex);
+    }
+    int result = pthread_cond_timedwait(cond, &mutex->mutex, until);
+    dhcp_mutex_resume_hold(mutex);
+    return result;
+}
+
+// Tomar el lock anotando el sitio de la llamada
+#define dhcp_mutex_lock(mutex) do { \
+        static dhcp_lock_site_t dhcp_lock_site_ = { __FILE__, __LINE__, __func__, -1, 0, NULL, 0, 0, 0, 0, 0 }; \
+        dhcp_mutex_lock_at((mutex), &dhcp_lock_site_); \
+    } while (0)
+
+#endif // DHCP_LOCK_H
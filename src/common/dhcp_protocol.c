@@ -0,0 +1,105 @@
+#include "dhcp_protocol.h"
+
+// Descripción de cada código conocido, generada desde la tabla de opciones
+#define DHCP_OPTION_DEF(NAME, name, code, type, min, max, label) \
+    [code] = { label, DHCP_TYPE_##type, min, max },
+const dhcp_option_def_t dhcp_option_defs[256] = {
+    DHCP_OPTION_TABLE(DHCP_OPTION_DEF)
+};
+#undef DHCP_OPTION_DEF
+
+const char* dhcp_option_name(uint8_t code) {
+    const char* name = dhcp_option_defs[code].name;
+    return name ? name : "Opción desconocida";
+}
+
+// Recorrer un campo de opciones [start, end). Retorna -1 si una opción se sale del campo.
+static int parse_field(dhcp_option_index_t* index, const uint8_t* packet, size_t start, size_t end) {
+    size_t i = start;
+    while (i < end) {
+        uint8_t code = packet[i];
+        if (code == DHCP_OPTION_PAD) {
+            i++;
+            continue;
+        }
+        if (code == DHCP_OPTION_END) {
+            return 0;
+        }
+        if (i + 2 > end) {
+            return -1;  // Falta el byte de longitud
+        }
+        uint8_t length = packet[i + 1];
+        if (i + 2 + length > end) {
+            return -1;  // El valor se sale del campo
+        }
+
+        // Las opciones conocidas con una longitud fuera de rango se ignoran
+        const dhcp_option_def_t* def = &dhcp_option_defs[code];
+        int valid = !def->name || (length >= def->min_length && length <= def->max_length);
+        if (valid && index->offset[code] == 0) {
+            index->offset[code] = (uint16_t)(i + 2);
+            index->length[code] = length;
+        }
+        i += 2 + length;
+    }
+    return 0;  // Sin opción 255: el campo termina con el paquete
+}
+
+int dhcp_parse_options(dhcp_option_index_t* index, const uint8_t* packet, size_t length) {
+    // Solo se limpian las posiciones: la longitud de un código ausente no se lee
+    memset(index->offset, 0, sizeof(index->offset));
+    index->packet = packet;
+    index->overload = 0;
+    index->has_cookie = 0;
+    if (length < DHCP_HEADER_SIZE) {
+        return -1;
+    }
+
+    size_t start = DHCP_HEADER_SIZE;
+    uint32_t cookie;
+    if (length >= DHCP_HEADER_SIZE + 4) {
+        memcpy(&cookie, packet + DHCP_HEADER_SIZE, 4);
+        if (cookie == htonl(DHCP_MAGIC_COOKIE)) {
+            index->has_cookie = 1;
+            start += 4;
+        }
+    }
+    if (parse_field(index, packet, start, length) < 0) {
+        return -1;
+    }
+
+    // Opción 52: file y después sname también llevan opciones (RFC 2131, sección 4.1)
+    uint8_t overload;
+    if (dhcp_get_overload(index, &overload)) {
+        if ((overload & DHCP_OVERLOAD_FILE) &&
+            parse_field(index, packet, DHCP_FILE_OFFSET, DHCP_FILE_OFFSET + 128) < 0) {
+            return -1;
+        }
+        if ((overload & DHCP_OVERLOAD_SNAME) &&
+            parse_field(index, packet, DHCP_SNAME_OFFSET, DHCP_SNAME_OFFSET + 64) < 0) {
+            return -1;
+        }
+        index->overload = overload & (DHCP_OVERLOAD_FILE | DHCP_OVERLOAD_SNAME);
+    }
+    return 0;
+}
+
+int dhcp_put_option(dhcp_option_writer_t* writer, uint8_t code, const void* value, uint8_t length) {
+    // Siempre queda lugar para la opción 255
+    if (writer->length + 2 + length + 1 > writer->capacity) {
+        return -1;
+    }
+    uint8_t* out = writer->buffer + writer->length;
+    out[0] = code;
+    out[1] = length;
+    memcpy(out + 2, value, length);
+    writer->length += 2 + length;
+    return (int)(writer->length - length);
+}
+
+size_t dhcp_put_end(dhcp_option_writer_t* writer) {
+    if (writer->length < writer->capacity) {
+        writer->buffer[writer->length++] = DHCP_OPTION_END;
+    }
+    return writer->length;
+}
@@ -0,0 +1,183 @@
+#ifndef DHCP_PROTOCOL_H
+#define DHCP_PROTOCOL_H
+
+// Biblioteca de protocolo compartida por el servidor, el cliente y el relay: índice de
+// opciones de un paquete (se recorre una sola vez) y codificadores/decodificadores
+// generados a partir de una única tabla de opciones.
+
+#include <arpa/inet.h>  // Para htonl, ntohl, htons, ntohs
+#include <stdint.h>     // Para uint8_t, uint16_t, uint32_t
+#include <stddef.h>     // Para size_t
+#include <string.h>     // Para memcpy
+
+// Posiciones dentro del paquete DHCP (encabezado BOOTP de 236 bytes)
+#define DHCP_SNAME_OFFSET 44      // Campo sname (64 bytes), opciones si la 52 lo indica
+#define DHCP_FILE_OFFSET 108      // Campo file (128 bytes), opciones si la 52 lo indica
+#define DHCP_HEADER_SIZE 236      // Inicio del campo de opciones
+#define DHCP_MAGIC_COOKIE 0x63825363  // Cookie opcional al inicio de las opciones (RFC 2131)
+
+// Valores de la opción 52 (Option Overload)
+#define DHCP_OVERLOAD_FILE 1
+#define DHCP_OVERLOAD_SNAME 2
+
+// Tipos de valor de una opción (definen su codificador y decodificador)
+typedef enum {
+    DHCP_TYPE_U8 = 0,   // Un byte
+    DHCP_TYPE_U16,      // Entero de 16 bits (orden de red en el paquete, de host al leerlo)
+    DHCP_TYPE_U32,      // Entero de 32 bits (orden de red en el paquete, de host al leerlo)
+    DHCP_TYPE_IP,       // Dirección IPv4 (se entrega tal cual, en orden de red)
+    DHCP_TYPE_BYTES     // Secuencia de bytes o texto
+} dhcp_option_type_t;
+
+// Tabla única de opciones conocidas: X(NOMBRE, nombre, código, tipo, longitud mínima, máxima, descripción)
+#define DHCP_OPTION_TABLE(X) \
+    X(SUBNET_MASK,      subnet_mask,       1,  IP,    4, 4,   "Máscara de subred") \
+    X(ROUTER,           router,            3,  IP,    4, 255, "Puerta de enlace") \
+    X(DNS_SERVER,       dns_server,        6,  IP,    4, 255, "Servidor DNS") \
+    X(HOSTNAME,         hostname,          12, BYTES, 1, 255, "Nombre de host") \
+    X(DOMAIN_NAME,      domain_name,       15, BYTES, 1, 255, "Nombre de dominio") \
+    X(BROADCAST,        broadcast,         28, IP,    4, 4,   "Dirección de broadcast") \
+    X(NTP_SERVER,       ntp_server,        42, IP,    4, 255, "Servidor NTP") \
+    X(REQUESTED_IP,     requested_ip,      50, IP,    4, 4,   "IP solicitada") \
+    X(LEASE_TIME,       lease_time,        51, U32,   4, 4,   "Tiempo de concesión") \
+    X(OVERLOAD,         overload,          52, U8,    1, 1,   "Sobrecarga de opciones") \
+    X(MESSAGE_TYPE,     message_type,      53, U8,    1, 1,   "Tipo de mensaje DHCP") \
+    X(SERVER_ID,        server_id,         54, IP,    4, 4,   "Identificador del servidor") \
+    X(PARAMETER_LIST,   parameter_list,    55, BYTES, 1, 255, "Lista de parámetros solicitados") \
+    X(MESSAGE,          message,           56, BYTES, 1, 255, "Mensaje") \
+    X(MAX_MESSAGE_SIZE, max_message_size,  57, U16,   2, 2,   "Tamaño máximo de mensaje") \
+    X(RENEWAL_TIME,     renewal_time,      58, U32,   4, 4,   "Tiempo de renovación (T1)") \
+    X(REBINDING_TIME,   rebinding_time,    59, U32,   4, 4,   "Tiempo de rebind (T2)") \
+    X(CLIENT_ID,        client_id,         61, BYTES, 2, 255, "Identificador del cliente")
+
+// Códigos de opción: DHCP_OPTION_SUBNET_MASK, DHCP_OPTION_MESSAGE_TYPE, ...
+#define DHCP_OPTION_ENUM(NAME, name, code, type, min, max, label) DHCP_OPTION_##NAME = code,
+enum {
+    DHCP_OPTION_PAD = 0,
+    DHCP_OPTION_TABLE(DHCP_OPTION_ENUM)
+    DHCP_OPTION_END = 255
+};
+#undef DHCP_OPTION_ENUM
+
+// Descripción de una opción conocida
+typedef struct {
+    const char* name;        // Descripción para los logs (NULL si el código no está en la tabla)
+    uint8_t type;            // dhcp_option_type_t
+    uint8_t min_length;      // Longitudes aceptadas del valor
+    uint8_t max_length;
+} dhcp_option_def_t;
+
+extern const dhcp_option_def_t dhcp_option_defs[256];  // Indexada por código
+
+// Índice de las opciones de un paquete: posición y longitud del valor de cada código.
+// Las posiciones son relativas al inicio del paquete; 0 indica que la opción no está
+// (ningún valor puede empezar en el byte 0). Si un código se repite vale el primero.
+typedef struct {
+    const uint8_t* packet;   // Paquete indexado
+    uint16_t offset[256];    // Posición del valor de cada código (0 = ausente)
+    uint8_t length[256];     // Longitud del valor de cada código
+    uint8_t overload;        // Campos sname/file que se recorrieron como opciones
+    uint8_t has_cookie;      // Las opciones empezaban con la magic cookie
+} dhcp_option_index_t;
+
+// Función para indexar las opciones de un paquete de `length` bytes en una sola pasada.
+// Salta la magic cookie y el relleno (0), sigue la opción 52 hacia file y sname y descarta
+// las opciones conocidas con longitud inválida. Retorna -1 si el paquete es más corto que
+// el encabezado o una opción se sale de su campo.
+int dhcp_parse_options(dhcp_option_index_t* index, const uint8_t* packet, size_t length);
+
+// Función para obtener el valor de una opción en O(1) (NULL si no está)
+static inline const uint8_t* dhcp_option_get(const dhcp_option_index_t* index, uint8_t code, uint8_t* length) {
+    uint16_t offset = index->offset[code];
+    if (offset == 0) return NULL;
+    if (length) *length = index->length[code];
+    return index->packet + offset;
+}
+
+// Función para obtener la descripción de un código de opción
+const char* dhcp_option_name(uint8_t code);
+
+// Escritor de opciones sobre un buffer (siempre reserva un byte para la opción 255)
+typedef struct {
+    uint8_t* buffer;
+    size_t capacity;
+    size_t length;
+} dhcp_option_writer_t;
+
+static inline void dhcp_writer_init(dhcp_option_writer_t* writer, uint8_t* buffer, size_t capacity) {
+    writer->buffer = buffer;
+    writer->capacity = capacity;
+    writer->length = 0;
+}
+
+// Función para agregar una opción. Retorna la posición de su valor en el buffer
+// (para parchearlo después) o -1 si no hay lugar.
+int dhcp_put_option(dhcp_option_writer_t* writer, uint8_t code, const void* value, uint8_t length);
+
+// Función para cerrar las opciones con el código 255. Retorna la longitud total.
+size_t dhcp_put_end(dhcp_option_writer_t* writer);
+
+// Codificadores y decodificadores generados desde la tabla:
+//   int dhcp_get_<nombre>(const dhcp_option_index_t*, valor*)    retorna 1 si la opción está
+//   int dhcp_put_<nombre>(dhcp_option_writer_t*, valor)          retorna la posición o -1
+// Las opciones de bytes usan (const uint8_t** valor, uint8_t* longitud) y (valor, longitud).
+#define DHCP_ACCESSORS_U8(name, code) \
+    static inline int dhcp_get_##name(const dhcp_option_index_t* index, uint8_t* value) { \
+        const uint8_t* data = dhcp_option_get(index, code, NULL); \
+        if (!data) return 0; \
+        *value = data[0]; \
+        return 1; \
+    } \
+    static inline int dhcp_put_##name(dhcp_option_writer_t* writer, uint8_t value) { \
+        return dhcp_put_option(writer, code, &value, 1); \
+    }
+#define DHCP_ACCESSORS_U16(name, code) \
+    static inline int dhcp_get_##name(const dhcp_option_index_t* index, uint16_t* value) { \
+        const uint8_t* data = dhcp_option_get(index, code, NULL); \
+        if (!data) return 0; \
+        uint16_t raw; \
+        memcpy(&raw, data, 2); \
+        *value = ntohs(raw); \
+        return 1; \
+    } \
+    static inline int dhcp_put_##name(dhcp_option_writer_t* writer, uint16_t value) { \
+        uint16_t raw = htons(value); \
+        return dhcp_put_option(writer, code, &raw, 2); \
+    }
+#define DHCP_ACCESSORS_U32(name, code) \
+    static inline int dhcp_get_##name(const dhcp_option_index_t* index, uint32_t* value) { \
+        const uint8_t* data = dhcp_option_get(index, code, NULL); \
+        if (!data) return 0; \
+        uint32_t raw; \
+        memcpy(&raw, data, 4); \
+        *value = ntohl(raw); \
+        return 1; \
+    } \
+    static inline int dhcp_put_##name(dhcp_option_writer_t* writer, uint32_t value) { \
+        uint32_t raw = htonl(value); \
+        return dhcp_put_option(writer, code, &raw, 4); \
+    }
+#define DHCP_ACCESSORS_IP(name, code) \
+    static inline int dhcp_get_##name(const dhcp_option_index_t* index, uint32_t* value) { \
+        const uint8_t* data = dhcp_option_get(index, code, NULL); \
+        if (!data) return 0; \
+        memcpy(value, data, 4); \
+        return 1; \
+    } \
+    static inline int dhcp_put_##name(dhcp_option_writer_t* writer, uint32_t value) { \
+        return dhcp_put_option(writer, code, &value, 4); \
+    }
+#define DHCP_ACCESSORS_BYTES(name, code) \
+    static inline int dhcp_get_##name(const dhcp_option_index_t* index, const uint8_t** value, uint8_t* length) { \
+        *value = dhcp_option_get(index, code, length); \
+        return *value != NULL; \
+    } \
+    static inline int dhcp_put_##name(dhcp_option_writer_t* writer, const void* value, uint8_t length) { \
+        return dhcp_put_option(writer, code, value, length); \
+    }
+
+#define DHCP_OPTION_ACCESSORS(NAME, name, code, type, min, max, label) DHCP_ACCESSORS_##type(name, code)
+DHCP_OPTION_TABLE(DHCP_OPTION_ACCESSORS)
+#undef DHCP_OPTION_ACCESSORS
+
+#endif // DHCP_PROTOCOL_H
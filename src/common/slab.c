@@ -0,0 +1,271 @@
+#include "slab.h"
+#include <stdlib.h> // Para malloc, free
+#include <string.h> // Para memset
+
+// Magazines de un hilo para una caché
+typedef struct {
+    slab_magazine_t* loaded;    // Magazine del que se reserva y al que se libera
+    slab_magazine_t* previous;  // Segundo magazine: absorbe el vaivén en el borde sin ir al depósito
+    int64_t live_delta;         // Cambio de `live` todavía no volcado a la caché
+} slab_thread_cache_t;
+
+static slab_cache_t* registry[SLAB_MAX_CACHES];      // Cachés registradas (NULL = libre)
+static dhcp_mutex_t registry_lock = DHCP_MUTEX_INITIALIZER("slab registry_lock");
+static pthread_key_t thread_key;                     // Devuelve los magazines al salir el hilo
+static pthread_once_t thread_key_once = PTHREAD_ONCE_INIT;
+static __thread slab_thread_cache_t thread_caches[SLAB_MAX_CACHES];
+static __thread int thread_registered = 0;
+
+// Volcar a la caché el cambio de `live` acumulado por el hilo (con el lock tomado)
+static void flush_live(slab_cache_t* cache, slab_thread_cache_t* local) {
+    cache->live += local->live_delta;
+    local->live_delta = 0;
+    if (cache->live > cache->peak) {
+        cache->peak = cache->live;
+    }
+}
+
+// Dejar un magazine en la lista que le corresponde del depósito (con el lock tomado)
+static void deposit_magazine(slab_cache_t* cache, slab_magazine_t* magazine) {
+    if (!magazine) return;
+    if (magazine->count > 0) {
+        magazine->next = cache->full;
+        cache->full = magazine;
+    } else {
+        magazine->next = cache->empty;
+        cache->empty = magazine;
+    }
+}
+
+// Al terminar un hilo, sus magazines vuelven al depósito de cada caché
+static void release_thread_caches(void* arg) {
+    slab_thread_cache_t* locals = (slab_thread_cache_t*)arg;
+    dhcp_mutex_lock(&registry_lock);
+    for (int id = 0; id < SLAB_MAX_CACHES; id++) {
+        slab_cache_t* cache = registry[id];
+        slab_thread_cache_t* local = &locals[id];
+        if (cache && (local->loaded || local->previous || local->live_delta)) {
+            dhcp_mutex_lock(&cache->lock);
+            flush_live(cache, local);
+            deposit_magazine(cache, local->loaded);
+            deposit_magazine(cache, local->previous);
+            dhcp_mutex_unlock(&cache->lock);
+        }
+        memset(local, 0, sizeof(*local));
+    }
+    dhcp_mutex_unlock(&registry_lock);
+}
+
+static void create_thread_key() {
+    pthread_key_create(&thread_key, release_thread_caches);
+}
+
+static slab_thread_cache_t* thread_cache(slab_cache_t* cache) {
+    if (!thread_registered) {
+        pthread_once(&thread_key_once, create_thread_key);
+        pthread_setspecific(thread_key, thread_caches);
+        thread_registered = 1;
+    }
+    return &thread_caches[cache->id];
+}
+
+int slab_cache_init(slab_cache_t* cache, const char* name, size_t object_size) {
+    memset(cache, 0, sizeof(*cache));
+    cache->name = name;
+    // Cada objeto guarda al menos un puntero y queda alineado a 16 bytes
+    if (object_size < sizeof(void*)) object_size = sizeof(void*);
+    cache->object_size = (object_size + 15) & ~(size_t)15;
+    cache->id = -1;
+    dhcp_mutex_init(&cache->lock, name);
+
+    dhcp_mutex_lock(&registry_lock);
+    for (int id = 0; id < SLAB_MAX_CACHES; id++) {
+        if (!registry[id]) {
+            registry[id] = cache;
+            cache->id = id;
+            break;
+        }
+    }
+    dhcp_mutex_unlock(&registry_lock);
+
+    if (cache->id < 0) {
+        dhcp_mutex_destroy(&cache->lock);
+        return -1;
+    }
+    return 0;
+}
+
+static void free_magazines(slab_magazine_t* magazine) {
+    while (magazine) {
+        slab_magazine_t* next = magazine->next;
+        free(magazine);
+        magazine = next;
+    }
+}
+
+void slab_cache_destroy(slab_cache_t* cache) {
+    if (cache->id < 0) return;
+
+    dhcp_mutex_lock(&registry_lock);
+    registry[cache->id] = NULL;
+    dhcp_mutex_unlock(&registry_lock);
+
+    // Los magazines del hilo que destruye la caché también se liberan
+    slab_thread_cache_t* local = &thread_caches[cache->id];
+    free(local->loaded);
+    free(local->previous);
+    memset(local, 0, sizeof(*local));
+
+    free_magazines(cache->full);
+    free_magazines(cache->empty);
+    while (cache->chunks) {
+        slab_chunk_t* next = cache->chunks->next;
+        free(cache->chunks);
+        cache->chunks = next;
+    }
+    dhcp_mutex_destroy(&cache->lock);
+    cache->id = -1;
+}
+
+// Obtener un magazine vacío del depósito o pedir uno nuevo (con el lock tomado)
+static slab_magazine_t* take_empty_magazine(slab_cache_t* cache) {
+    slab_magazine_t* magazine = cache->empty;
+    if (magazine) {
+        cache->empty = magazine->next;
+        return magazine;
+    }
+    magazine = (slab_magazine_t*)malloc(sizeof(slab_magazine_t));
+    if (magazine) {
+        magazine->count = 0;
+        cache->bytes += sizeof(slab_magazine_t);
+    }
+    return magazine;
+}
+
+// Llenar un magazine vacío con objetos nuevos del último bloque (con el lock tomado)
+static int carve_objects(slab_cache_t* cache, slab_magazine_t* magazine) {
+    while (magazine->count < SLAB_MAGAZINE_SIZE) {
+        if (cache->carve_next == cache->carve_end) {
+            size_t header = (sizeof(slab_chunk_t) + 15) & ~(size_t)15;
+            size_t size = header + SLAB_CHUNK_OBJECTS * cache->object_size;
+            slab_chunk_t* chunk = (slab_chunk_t*)malloc(size);
+            if (!chunk) break;
+            chunk->next = cache->chunks;
+            cache->chunks = chunk;
+            cache->bytes += size;
+            cache->carve_next = (char*)chunk + header;
+            cache->carve_end = (char*)chunk + size;
+        }
+        magazine->objects[magazine->count++] = cache->carve_next;
+        cache->carve_next += cache->object_size;
+    }
+    return magazine->count;
+}
+
+// Recargar el magazine del hilo cuando se vació
+static void* alloc_slow(slab_cache_t* cache, slab_thread_cache_t* local) {
+    // El segundo magazine tiene objetos: alcanza con intercambiarlos
+    if (local->previous && local->previous->count > 0) {
+        slab_magazine_t* swap = local->loaded;
+        local->loaded = local->previous;
+        local->previous = swap;
+    } else {
+        dhcp_mutex_lock(&cache->lock);
+        flush_live(cache, local);
+        slab_magazine_t* full = cache->full;
+        if (full) {
+            // Cambiar el magazine vacío por uno lleno del depósito
+            cache->full = full->next;
+            deposit_magazine(cache, local->previous);
+            local->previous = local->loaded;
+            local->loaded = full;
+        } else {
+            // El depósito no tiene objetos libres: sacarlos de un bloque
+            if (!local->loaded) {
+                local->loaded = take_empty_magazine(cache);
+            }
+            if (!local->loaded || carve_objects(cache, local->loaded) == 0) {
+                dhcp_mutex_unlock(&cache->lock);
+                return NULL;
+            }
+        }
+        dhcp_mutex_unlock(&cache->lock);
+    }
+
+    local->live_delta++;
+    return local->loaded->objects[--local->loaded->count];
+}
+
+void* slab_alloc(slab_cache_t* cache) {
+    slab_thread_cache_t* local = thread_cache(cache);
+    slab_magazine_t* magazine = local->loaded;
+    if (magazine && magazine->count > 0) {
+        local->live_delta++;
+        return magazine->objects[--magazine->count];
+    }
+    return alloc_slow(cache, local);
+}
+
+// Hacer lugar en el magazine del hilo cuando se llenó
+static void free_slow(slab_cache_t* cache, slab_thread_cache_t* local, void* object) {
+    // El segundo magazine está vacío: alcanza con intercambiarlos
+    if (local->previous && local->previous->count == 0) {
+        slab_magazine_t* swap = local->loaded;
+        local->loaded = local->previous;
+        local->previous = swap;
+    } else {
+        dhcp_mutex_lock(&cache->lock);
+        flush_live(cache, local);
+        slab_magazine_t* empty = take_empty_magazine(cache);
+        if (!empty) {
+            dhcp_mutex_unlock(&cache->lock);
+            fprintf(stderr, "Error: Sin memoria para un magazine de %s, se pierde un objeto.\n", cache->name);
+            return;
+        }
+        // Dejar el segundo magazine (lleno) en el depósito y pasar a uno vacío
+        deposit_magazine(cache, local->previous);
+        local->previous = local->loaded;
+        local->loaded = empty;
+        dhcp_mutex_unlock(&cache->lock);
+    }
+
+    local->live_delta--;
+    local->loaded->objects[local->loaded->count++] = object;
+}
+
+void slab_free(slab_cache_t* cache, void* object) {
+    if (!object) return;
+    slab_thread_cache_t* local = thread_cache(cache);
+    slab_magazine_t* magazine = local->loaded;
+    if (magazine && magazine->count < SLAB_MAGAZINE_SIZE) {
+        local->live_delta--;
+        magazine->objects[magazine->count++] = object;
+        return;
+    }
+    free_slow(cache, local, object);
+}
+
+void slab_cache_stats(slab_cache_t* cache, slab_stats_t* stats) {
+    dhcp_mutex_lock(&cache->lock);
+    // Incluir lo que acumuló el hilo que consulta
+    flush_live(cache, thread_cache(cache));
+    stats->name = cache->name;
+    stats->object_size = cache->object_size;
+    stats->live = cache->live;
+    stats->peak = cache->peak;
+    stats->bytes = cache->bytes;
+    dhcp_mutex_unlock(&cache->lock);
+}
+
+void slab_print_stats(FILE* out) {
+    dhcp_mutex_lock(&registry_lock);
+    for (int id = 0; id < SLAB_MAX_CACHES; id++) {
+        if (!registry[id]) continue;
+        slab_stats_t stats;
+        slab_cache_stats(registry[id], &stats);
+        fprintf(out, "Slab %s (%zu bytes): %lld en uso, pico %lld, %llu bytes reservados\n",
+                stats.name, stats.object_size, (long long)stats.live, (long long)stats.peak,
+                (unsigned long long)stats.bytes);
+    }
+    dhcp_mutex_unlock(&registry_lock);
+}
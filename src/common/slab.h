@@ -0,0 +1,83 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+// Asignador de objetos de tamaño fijo del relay (vive en src/common por si otro componente
+// lo necesita). El servidor no lo usa: no le quedan objetos de larga vida reservados de a uno,
+// porque los leases están en el arreglo plano de lease_store, las transacciones en la tabla
+// abierta preasignada de cada worker y los paquetes en el anillo de buffers.
+// Cada tipo de objeto tiene su caché (una clase de tamaño). Los objetos salen de bloques
+// grandes pedidos al sistema y cada hilo guarda los libres en magazines propios, así que
+// reservar y liberar no toma ningún lock mientras el magazine del hilo tenga objetos o
+// lugar. Los magazines llenos y vacíos se intercambian de a uno con un depósito global.
+
+#include "dhcp_lock.h" // Para dhcp_mutex_t (perfil de contención opcional)
+#include <stddef.h>  // Para size_t
+#include <stdint.h>  // Para uint64_t
+#include <stdio.h>   // Para FILE
+
+#define SLAB_MAGAZINE_SIZE 64     // Objetos por magazine (lo que se mueve en cada recarga)
+#define SLAB_CHUNK_OBJECTS 1024   // Objetos que se piden al sistema de una vez
+#define SLAB_MAX_CACHES 16        // Cachés registradas a la vez en el proceso
+
+// Pila de objetos libres que se pasa entera entre un hilo y el depósito
+typedef struct slab_magazine {
+    struct slab_magazine* next;   // Siguiente en la lista del depósito
+    int count;                    // Objetos en la pila
+    void* objects[SLAB_MAGAZINE_SIZE];
+} slab_magazine_t;
+
+// Bloque de objetos pedido al sistema
+typedef struct slab_chunk {
+    struct slab_chunk* next;
+} slab_chunk_t;
+
+// Caché de un tipo de objeto
+typedef struct {
+    const char* name;             // Nombre del tipo (para las estadísticas)
+    size_t object_size;           // Tamaño de cada objeto, redondeado a 16 bytes
+    int id;                       // Posición en el registro de cachés (-1 si no está)
+
+    dhcp_mutex_t lock;            // Protege todo lo que sigue
+    slab_magazine_t* full;        // Magazines llenos devueltos por los hilos
+    slab_magazine_t* empty;       // Magazines vacíos para reutilizar
+    slab_chunk_t* chunks;         // Bloques pedidos al sistema
+    char* carve_next;             // Próximo objeto sin usar del último bloque
+    char* carve_end;              // Fin del último bloque
+
+    // Contadores: los hilos acumulan sus cambios y los vuelcan al intercambiar
+    // magazines, así que `live` puede atrasarse hasta un par de magazines por hilo
+    int64_t live;                 // Objetos entregados y no liberados
+    int64_t peak;                 // Máximo de `live`
+    uint64_t bytes;               // Bytes pedidos al sistema (bloques y magazines)
+} slab_cache_t;
+
+// Estadísticas de una caché
+typedef struct {
+    const char* name;
+    size_t object_size;
+    int64_t live;
+    int64_t peak;
+    uint64_t bytes;
+} slab_stats_t;
+
+// Función para preparar la caché de un tipo de `object_size` bytes; retorna -1 si no
+// quedan lugares en el registro
+int slab_cache_init(slab_cache_t* cache, const char* name, size_t object_size);
+
+// Función para liberar toda la memoria de una caché. Solo se llama cuando ningún otro
+// hilo la usa; los objetos que sigan entregados dejan de ser válidos.
+void slab_cache_destroy(slab_cache_t* cache);
+
+// Función para reservar un objeto (NULL si el sistema no tiene memoria)
+void* slab_alloc(slab_cache_t* cache);
+
+// Función para devolver un objeto reservado con slab_alloc en la misma caché
+void slab_free(slab_cache_t* cache, void* object);
+
+// Función para leer las estadísticas de una caché
+void slab_cache_stats(slab_cache_t* cache, slab_stats_t* stats);
+
+// Función para imprimir las estadísticas de todas las cachés registradas
+void slab_print_stats(FILE* out);
+
+#endif // SLAB_H
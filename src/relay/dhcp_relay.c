@@ -3,6 +3,7 @@
 const int relay_port = 68;
 const int server_port = 67;
 dhcp_transaction_t* hash_table[HASH_TABLE_SIZE] = { NULL };
+slab_cache_t transaction_cache;
 
 void init_dhcp_relay() {
     struct sockaddr_in relay_addr, server_addr;
@@ -13,6 +14,12 @@ void init_dhcp_relay() {
         exit(EXIT_FAILURE);
     }
 
+    // Las transacciones se reservan y liberan por cada solicitud: salen de su propia caché
+    if (slab_cache_init(&transaction_cache, "transacciones del relay", sizeof(dhcp_transaction_t)) < 0) {
+        fprintf(stderr, "Error: No se pudo crear la caché de transacciones.\n");
+        exit(EXIT_FAILURE);
+    }
+
     // Crear el socket para el relay
     int relay_sock = socket(AF_INET, SOCK_DGRAM, 0);
     if (relay_sock < 0) {
@@ -79,6 +86,7 @@ void dhcp_relay_loop(int relay_sock, struct sockaddr_in* server_addr) {
             continue;
         } else if (activity == 0) {
             printf("Timeout: No se recibió ningún mensaje del cliente en el tiempo establecido.\n");
+            slab_print_stats(stdout);
             continue;
         }
 
@@ -90,6 +98,15 @@ void dhcp_relay_loop(int relay_sock, struct sockaddr_in* server_addr) {
                 continue;
             }
 
+            // Descartar lo que no sea un paquete DHCP bien formado antes de reenviarlo
+            dhcp_option_index_t options;
+            uint8_t message_type;
+            if (dhcp_parse_options(&options, (const uint8_t*)buffer, recv_len) < 0 ||
+                !dhcp_get_message_type(&options, &message_type)) {
+                fprintf(stderr, "Paquete DHCP mal formado de %s, se descarta.\n", inet_ntoa(client_addr.sin_addr));
+                continue;
+            }
+
             // Determinar si es una solicitud del cliente o una respuesta del servidor
             uint32_t xid;
             memcpy(&xid, buffer + 4, sizeof(xid));  // XID está en el offset 4 del paquete DHCP
@@ -100,7 +117,7 @@ void dhcp_relay_loop(int relay_sock, struct sockaddr_in* server_addr) {
             if(transaction == NULL) {
                 uint8_t* mac_addr = (uint8_t*)(buffer + 28); // Dirección MAC del cliente en el offset 28
                 insert_transaction(xid, &client_addr, mac_addr);
-                printf("Solicitud DHCP recibida del cliente.\n");
+                printf("Solicitud DHCP recibida del cliente (tipo %u).\n", message_type);
 
                 // Reenviar la solicitud al servidor DHCP
                 ssize_t server_sent_len = sendto(relay_sock, buffer, recv_len, 0, (struct sockaddr*)server_addr, sizeof(*server_addr));
@@ -110,7 +127,7 @@ void dhcp_relay_loop(int relay_sock, struct sockaddr_in* server_addr) {
                 }
                 printf("Solicitud DHCP reenviada al servidor.\n");
             } else {
-                printf("Paquete DHCP recibido desde el SERVIDOR: %s\n", inet_ntoa(server_addr->sin_addr));
+                printf("Paquete DHCP recibido desde el SERVIDOR: %s (tipo %u)\n", inet_ntoa(server_addr->sin_addr), message_type);
                 
                 // Reenviar la respuesta al cliente
                 ssize_t client_sent_len = sendto(relay_sock, buffer, recv_len, 0, (struct sockaddr*)&transaction->client_addr, client_len);
@@ -136,7 +153,11 @@ unsigned int hash_xid(uint32_t xid) {
 void insert_transaction(uint32_t xid, struct sockaddr_in* client_addr, uint8_t* mac_addr) {
     unsigned int hash_index = hash_xid(xid);
 
-    dhcp_transaction_t* new_transaction = (dhcp_transaction_t*)malloc(sizeof(dhcp_transaction_t));
+    dhcp_transaction_t* new_transaction = (dhcp_transaction_t*)slab_alloc(&transaction_cache);
+    if (new_transaction == NULL) {
+        perror("Error al asignar memoria para la transacción");
+        return;
+    }
     new_transaction->xid = xid;
     new_transaction->client_addr = *client_addr;
     memcpy(new_transaction->mac_addr, mac_addr, 6);
@@ -181,5 +202,5 @@ void remove_transaction(uint32_t xid) {
         previous->next = current->next;
     }
 
-    free(current);  // Liberar la memoria
+    slab_free(&transaction_cache, current);  // Devolver la entrada a su caché
 }
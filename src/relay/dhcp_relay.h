@@ -11,6 +11,8 @@
 #include <errno.h>
 #include <stdint.h>
 #include <sys/select.h>
+#include "dhcp_protocol.h"  // Validación de paquetes compartida (src/common)
+#include "slab.h"           // Asignador de objetos de tamaño fijo (src/common)
 
 // Tamaño de la tabla hash
 #define HASH_TABLE_SIZE 256
@@ -26,6 +28,9 @@ typedef struct dhcp_transaction {
 // Tabla hash de transacciones para almacenar las solicitudes de clientes
 extern dhcp_transaction_t* hash_table[HASH_TABLE_SIZE];
 
+// Caché de la que salen las entradas de la tabla
+extern slab_cache_t transaction_cache;
+
 // Funciones para la tabla hash
 unsigned int hash_xid(uint32_t xid);  // Función hash basada en el xid
 void insert_transaction(uint32_t xid, struct sockaddr_in* client_addr, uint8_t* mac_addr);  // Insertar transacción
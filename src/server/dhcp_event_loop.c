@@ -0,0 +1,202 @@
+#include "dhcp_server.h"
+#include <sys/epoll.h>     // Para epoll_create1, epoll_wait
+#include <sys/timerfd.h>   // Para timerfd_create, timerfd_settime
+#include <sys/signalfd.h>  // Para signalfd
+#include <sys/eventfd.h>   // Para eventfd
+
+// Descriptores del bucle de eventos (-1 mientras el bucle no existe)
+static int epoll_fd = -1;
+static int lease_timer_fd = -1;    // timerfd armado al próximo vencimiento de lease
+static int signal_fd = -1;         // SIGINT, SIGTERM y SIGUSR2 (resumen de latencias y de locks)
+static int wake_fd = -1;           // Despertares administrativos (eventfd)
+
+static uint64_t armed_deadline = UINT64_MAX;  // Vencimiento (ms) al que está armado el timerfd
+static unsigned int wake_reasons = 0;         // Motivos pendientes (DHCP_WAKE_*)
+static long timer_slack_ns = 0;               // Resolución de timer_clock_ms
+
+static void arm_lease_timer();
+
+// Conjunto de señales que atiende el bucle
+static void server_signal_set(sigset_t* signals) {
+    sigemptyset(signals);
+    sigaddset(signals, SIGINT);
+    sigaddset(signals, SIGTERM);
+    sigaddset(signals, SIGUSR2);
+}
+
+void block_server_signals() {
+    // Los hilos heredan la máscara: ninguno recibe las señales de forma asíncrona
+    sigset_t signals;
+    server_signal_set(&signals);
+    if (pthread_sigmask(SIG_BLOCK, &signals, NULL) != 0) {
+        perror("Error al bloquear las señales del servidor");
+    }
+}
+
+// Registrar un descriptor para lectura en el epoll del bucle
+static int watch_fd(int fd) {
+    struct epoll_event event = { .events = EPOLLIN, .data.fd = fd };
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        perror("Error al registrar un descriptor en epoll");
+        return -1;
+    }
+    return 0;
+}
+
+int event_loop_init(int sockfd) {
+    sigset_t signals;
+    server_signal_set(&signals);
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    lease_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd < 0 || lease_timer_fd < 0 || signal_fd < 0 || wake_fd < 0) {
+        perror("Error al crear los descriptores del bucle de eventos");
+        event_loop_free();
+        return -1;
+    }
+
+    if (watch_fd(lease_timer_fd) < 0 || watch_fd(signal_fd) < 0 || watch_fd(wake_fd) < 0 ||
+        (sockfd >= 0 && watch_fd(sockfd) < 0) || (handoff_fd >= 0 && watch_fd(handoff_fd) < 0)) {
+        event_loop_free();
+        return -1;
+    }
+    arm_lease_timer();
+
+    // timer_clock_ms usa el reloj de baja resolución: el timerfd se arma con ese margen
+    // para que al dispararse la rueda ya vea el lease como vencido
+    struct timespec resolution;
+    if (clock_getres(CLOCK_MONOTONIC_COARSE, &resolution) == 0) {
+        timer_slack_ns = resolution.tv_sec * 1000000000L + resolution.tv_nsec;
+    }
+    return 0;
+}
+
+void event_loop_free() {
+    if (epoll_fd >= 0) close(epoll_fd);
+    if (lease_timer_fd >= 0) close(lease_timer_fd);
+    if (signal_fd >= 0) close(signal_fd);
+    if (wake_fd >= 0) close(wake_fd);
+    epoll_fd = lease_timer_fd = signal_fd = wake_fd = -1;
+    __atomic_store_n(&armed_deadline, UINT64_MAX, __ATOMIC_RELAXED);
+}
+
+void event_loop_wakeup(unsigned int reason) {
+    if (wake_fd < 0) return;
+    __atomic_fetch_or(&wake_reasons, reason, __ATOMIC_RELEASE);
+    uint64_t one = 1;
+    if (write(wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+        perror("Error al despertar el bucle de eventos");
+    }
+}
+
+void event_loop_note_deadline(uint64_t expires_ms) {
+    // Solo hace falta rearmar si el nuevo vencimiento es anterior al armado
+    if (wake_fd >= 0 && expires_ms < __atomic_load_n(&armed_deadline, __ATOMIC_ACQUIRE)) {
+        event_loop_wakeup(DHCP_WAKE_TIMERS);
+    }
+}
+
+// Armar el timerfd al vencimiento más próximo de todos los shards (o desarmarlo si no hay)
+static void arm_lease_timer() {
+    // Mientras se recorren los shards cualquier lease nuevo pide rearmar
+    __atomic_store_n(&armed_deadline, UINT64_MAX, __ATOMIC_RELEASE);
+    uint64_t next = next_lease_deadline();
+    __atomic_store_n(&armed_deadline, next, __ATOMIC_RELEASE);
+
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (next != UINT64_MAX) {
+        uint64_t ns = next * 1000000ULL + (uint64_t)timer_slack_ns;
+        spec.it_value.tv_sec = ns / 1000000000ULL;
+        spec.it_value.tv_nsec = ns % 1000000000ULL;
+    }
+    if (timerfd_settime(lease_timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) < 0) {
+        perror("Error al armar el timer de vencimiento de leases");
+    }
+}
+
+// Vaciar el contador de un timerfd o eventfd
+static void drain_counter(int fd) {
+    uint64_t value;
+    if (read(fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+        perror("Error al leer el contador del bucle de eventos");
+    }
+}
+
+int event_loop_fd() {
+    return epoll_fd;
+}
+
+int event_loop_dispatch(int sockfd, dhcp_msg_batch_t* batch, int timeout_ms) {
+    struct epoll_event events[EVENT_LOOP_MAX_EVENTS];
+    int ready = epoll_wait(epoll_fd, events, EVENT_LOOP_MAX_EVENTS, timeout_ms);
+    if (ready < 0) {
+        if (errno == EINTR) return 0;
+        perror("Error en epoll_wait");
+        return -1;
+    }
+
+    int running = 1;
+    for (int i = 0; i < ready; i++) {
+        int fd = events[i].data.fd;
+
+        if (fd == sockfd) {
+            // Un lote por evento: el epoll es por nivel y vuelve a avisar si quedan datagramas
+            // Los datagramas llegan directo a slots del anillo y a los workers solo viajan descriptores
+            if (receive_dhcp_packets(sockfd, batch, MSG_DONTWAIT | MSG_WAITFORONE) < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    perror("Error al recibir datos del cliente");
+                }
+            }
+        } else if (fd == lease_timer_fd) {
+            drain_counter(lease_timer_fd);
+            for (int j = 0; j < num_ip_shards; j++) {
+                check_expired_leases(&ip_shards[j]);
+            }
+            arm_lease_timer();
+        } else if (fd == wake_fd) {
+            drain_counter(wake_fd);
+            unsigned int reasons = __atomic_exchange_n(&wake_reasons, 0, __ATOMIC_ACQUIRE);
+            if (reasons & DHCP_WAKE_TIMERS) {
+                arm_lease_timer();
+            }
+            if (reasons & DHCP_WAKE_STOP) {
+                running = 0;
+            }
+        } else if (fd == handoff_fd) {
+            // Si el proceso nuevo toma el servicio, serve_handoff no retorna
+            serve_handoff();
+        } else if (fd == signal_fd) {
+            struct signalfd_siginfo info;
+            if (read(signal_fd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {
+                // El cierre corre en el hilo del bucle, no dentro de un manejador asíncrono
+                handle_signal((int)info.ssi_signo);
+            }
+        }
+    }
+    return running ? 0 : -1;
+}
+
+void handle_dhcp_protocol(int sockfd) {
+    dhcp_msg_batch_t batch;
+    if (sockfd >= 0 && dhcp_batch_init(&batch, io_batch_size) < 0) {
+        perror("Error al asignar memoria para el lote de recepción");
+        cleanup();
+        exit(EXIT_FAILURE);
+    }
+    if (event_loop_init(sockfd) < 0) {
+        cleanup();
+        exit(EXIT_FAILURE);
+    }
+
+    // Sin paquetes ni vencimientos el hilo duerme en epoll_wait (sin timeout)
+    while (event_loop_dispatch(sockfd, &batch, -1) == 0) {
+    }
+
+    if (sockfd >= 0) {
+        dhcp_batch_free(&batch);
+    }
+    event_loop_free();
+}
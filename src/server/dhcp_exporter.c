@@ -0,0 +1,103 @@
+// Exportador de Prometheus: sirve el segmento de estadísticas del servidor en formato de texto.
+// Uso: ./dhcp_exporter [puerto] [dirección]   (por defecto 9767 en 127.0.0.1)
+// DHCP_STATS_SHM elige el segmento (el mismo nombre que usa el servidor).
+// Cada scrape vuelve a abrir el segmento, así que sigue al servidor tras un reinicio o un relevo.
+
+#include "dhcp_stats.h"
+#include <arpa/inet.h>  // Para inet_pton, htons
+#include <signal.h>     // Para signal
+#include <stdio.h>      // Para printf, perror
+#include <stdlib.h>     // Para getenv, strtol
+#include <string.h>     // Para memset, strncmp
+#include <sys/socket.h> // Para socket, bind, accept
+#include <sys/time.h>   // Para timeval
+#include <unistd.h>     // Para close, write
+
+#define EXPORTER_DEFAULT_PORT 9767
+#define EXPORTER_BUFFER_SIZE 16384
+
+// Escribir todo el buffer (la conexión es bloqueante)
+static void write_all(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t written = write(fd, data, length);
+        if (written <= 0) return;
+        data += written;
+        length -= (size_t)written;
+    }
+}
+
+static void serve_client(int conn, const char* stats_name) {
+    // Alcanza con la línea de pedido; el resto del encabezado se ignora
+    char request[1024];
+    ssize_t received = recv(conn, request, sizeof(request) - 1, 0);
+    if (received <= 0) {
+        return;
+    }
+    request[received] = '\0';
+
+    char header[256];
+    if (strncmp(request, "GET /metrics ", 13) != 0 && strncmp(request, "GET / ", 6) != 0) {
+        const char* not_found = "HTTP/1.0 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+        write_all(conn, not_found, strlen(not_found));
+        return;
+    }
+
+    dhcp_stats_snapshot_t snapshot;
+    if (dhcp_stats_read(stats_name, &snapshot) < 0) {
+        const char* unavailable = "HTTP/1.0 503 Service Unavailable\r\nContent-Type: text/plain\r\n"
+                                  "Connection: close\r\n\r\nSin segmento de estadísticas del servidor DHCP\n";
+        write_all(conn, unavailable, strlen(unavailable));
+        return;
+    }
+
+    static char body[EXPORTER_BUFFER_SIZE];
+    int length = dhcp_stats_format_prometheus(&snapshot, body, sizeof(body));
+    if (length >= (int)sizeof(body)) {
+        length = (int)sizeof(body) - 1;
+    }
+    int header_length = snprintf(header, sizeof(header),
+                                 "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                 "Content-Length: %d\r\nConnection: close\r\n\r\n", length);
+    write_all(conn, header, header_length);
+    write_all(conn, body, length);
+}
+
+int main(int argc, char* argv[]) {
+    int port = argc > 1 ? (int)strtol(argv[1], NULL, 10) : EXPORTER_DEFAULT_PORT;
+    const char* address = argc > 2 ? argv[2] : "127.0.0.1";
+    const char* stats_name = getenv("DHCP_STATS_SHM");
+    signal(SIGPIPE, SIG_IGN);
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (port <= 0 || port > 65535 || inet_pton(AF_INET, address, &addr.sin_addr) != 1) {
+        fprintf(stderr, "Error: Dirección de escucha inválida %s:%d.\n", address, port);
+        return 1;
+    }
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listen_fd, 16) < 0) {
+        perror("Error al escuchar en el puerto del exportador");
+        return 1;
+    }
+    printf("Exportador de estadísticas DHCP en http://%s:%d/metrics\n", address, port);
+    fflush(stdout);
+
+    // Un scrape a la vez: cada uno solo copia el segmento y lo formatea
+    while (1) {
+        int conn = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+        if (conn < 0) {
+            continue;
+        }
+        struct timeval timeout = { .tv_sec = 2, .tv_usec = 0 };
+        setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        serve_client(conn, stats_name);
+        close(conn);
+    }
+    return 0;
+}
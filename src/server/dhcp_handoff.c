@@ -0,0 +1,170 @@
+#include "dhcp_handoff.h"
+#include <errno.h>      // Para errno
+#include <stdio.h>      // Para perror, fprintf
+#include <string.h>     // Para memcpy, memset, strlen
+#include <sys/socket.h> // Para socket, sendmsg, recvmsg, SCM_RIGHTS
+#include <sys/stat.h>   // Para chmod
+#include <sys/time.h>   // Para timeval
+#include <sys/un.h>     // Para sockaddr_un
+#include <unistd.h>     // Para close, unlink
+
+#define HANDOFF_REQUEST 'R'
+#define HANDOFF_ACCEPTED 'Y'
+#define HANDOFF_REJECTED 'N'
+#define HANDOFF_TIMEOUT_S 30   // Espera máxima de cada lado (el anterior vacía sus colas)
+
+// Preparar la dirección del socket Unix (-1 si la ruta no entra)
+static int handoff_address(const char* path, struct sockaddr_un* addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        fprintf(stderr, "Error: La ruta de relevo %s es demasiado larga.\n", path);
+        return -1;
+    }
+    memcpy(addr->sun_path, path, strlen(path) + 1);
+    return 0;
+}
+
+static void set_timeout(int fd, int seconds) {
+    struct timeval timeout = { .tv_sec = seconds, .tv_usec = 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+}
+
+int handoff_listen(const char* path) {
+    struct sockaddr_un addr;
+    if (handoff_address(path, &addr) < 0) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        perror("Error al crear el socket de relevo");
+        return -1;
+    }
+
+    // El archivo de un servidor anterior ya no sirve: su proceso dejó de escuchar
+    unlink(path);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 1) < 0) {
+        perror("Error al escuchar en el socket de relevo");
+        close(fd);
+        return -1;
+    }
+    // Quien se conecta se lleva el puerto 67 y los leases: solo el mismo usuario
+    chmod(path, 0600);
+    return fd;
+}
+
+int handoff_request(const char* path, int* conn, handoff_header_t* header, int* fds) {
+    struct sockaddr_un addr;
+    if (handoff_address(path, &addr) < 0) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        perror("Error al crear el socket de relevo");
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        int missing = errno == ENOENT || errno == ECONNREFUSED;
+        if (!missing) perror("Error al conectar con el servidor anterior");
+        close(fd);
+        return missing ? 0 : -1;
+    }
+
+    char request = HANDOFF_REQUEST;
+    set_timeout(fd, HANDOFF_TIMEOUT_S);
+    if (send(fd, &request, 1, 0) != 1) {
+        perror("Error al pedir el relevo");
+        close(fd);
+        return -1;
+    }
+
+    // Encabezado en los datos y descriptores en el mensaje de control
+    union {
+        char buffer[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_FDS)];
+        struct cmsghdr align;
+    } control;
+    struct iovec iov = { .iov_base = header, .iov_len = sizeof(*header) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+    ssize_t received = recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    int count = 0;
+    if (received == (ssize_t)sizeof(*header) && cmsg && cmsg->cmsg_level == SOL_SOCKET &&
+        cmsg->cmsg_type == SCM_RIGHTS) {
+        count = (int)((cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int));
+        memcpy(fds, CMSG_DATA(cmsg), count * sizeof(int));
+    }
+    if (received != (ssize_t)sizeof(*header) || (msg.msg_flags & MSG_CTRUNC) ||
+        header->magic != HANDOFF_MAGIC || header->version != HANDOFF_VERSION ||
+        header->socket_count < 1 || header->shard_count < 1 ||
+        count != header->socket_count + header->shard_count) {
+        fprintf(stderr, "Error: El servidor anterior no entregó un relevo válido.\n");
+        for (int i = 0; i < count; i++) close(fds[i]);
+        handoff_confirm(fd, 0);
+        return -1;
+    }
+    *conn = fd;
+    return 1;
+}
+
+int handoff_confirm(int conn, int ok) {
+    char answer = ok ? HANDOFF_ACCEPTED : HANDOFF_REJECTED;
+    int sent = send(conn, &answer, 1, MSG_NOSIGNAL) == 1;
+    close(conn);
+    return sent ? 0 : -1;
+}
+
+int handoff_accept(int listen_fd) {
+    int conn = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (conn < 0) {
+        return -1;
+    }
+    char request = 0;
+    set_timeout(conn, 1);
+    if (recv(conn, &request, 1, 0) != 1 || request != HANDOFF_REQUEST) {
+        close(conn);
+        return -1;
+    }
+    return conn;
+}
+
+int handoff_send(int conn, const handoff_header_t* header, const int* fds, int count) {
+    if (count < 1 || count > HANDOFF_MAX_FDS) {
+        return -1;
+    }
+    union {
+        char buffer[CMSG_SPACE(sizeof(int) * HANDOFF_MAX_FDS)];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct iovec iov = { .iov_base = (void*)header, .iov_len = sizeof(*header) };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * count);
+
+    if (sendmsg(conn, &msg, MSG_NOSIGNAL) != (ssize_t)sizeof(*header)) {
+        perror("Error al entregar los descriptores al proceso nuevo");
+        return -1;
+    }
+
+    // El proceso nuevo confirma cuando ya proyectó los leases
+    char answer = 0;
+    set_timeout(conn, HANDOFF_TIMEOUT_S);
+    if (recv(conn, &answer, 1, 0) != 1 || answer != HANDOFF_ACCEPTED) {
+        fprintf(stderr, "Error: El proceso nuevo no confirmó el relevo.\n");
+        return -1;
+    }
+    return 0;
+}
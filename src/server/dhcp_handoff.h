@@ -0,0 +1,52 @@
+#ifndef DHCP_HANDOFF_H
+#define DHCP_HANDOFF_H
+
+// Entrega del servidor en marcha a un proceso nuevo (actualización sin cortar el servicio).
+//
+// El servidor en marcha escucha en un socket Unix (DHCP_HANDOFF_SOCKET). El proceso nuevo
+// se conecta y pide el relevo; el anterior deja de leer sus sockets, termina los paquetes
+// que ya recibió, cierra su journal y envía con SCM_RIGHTS los sockets del puerto 67 y los
+// memfd con las asignaciones de cada shard, más un encabezado con la configuración. El
+// nuevo proyecta esos memfd tal cual (sin serializar nada), confirma y el anterior termina.
+// Lo que llega al puerto mientras tanto espera en la cola del socket, que no se cierra.
+
+#include <stdint.h> // Para uint32_t
+
+#define HANDOFF_MAGIC 0x48414e44   // "HAND"
+#define HANDOFF_VERSION 1
+#define HANDOFF_MAX_FDS 250        // Descriptores por mensaje (el kernel admite 253)
+
+// Configuración que acompaña a los descriptores
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    int32_t io_mode;           // dhcp_io_mode_t del proceso que entrega
+    int32_t socket_count;      // Sockets del puerto 67 (primeros descriptores)
+    int32_t shard_count;       // memfd de los shards (descriptores siguientes)
+    uint32_t start_ip;         // Pool completo
+    uint32_t end_ip;
+    int32_t client_id_counter; // Para que los IDs de cliente de los logs no se repitan
+    int32_t steer_by_chaddr;   // Reparto del grupo SO_REUSEPORT
+    uint32_t reserved[7];
+} handoff_header_t;
+
+// Función para crear el socket Unix en el que el servidor espera un relevo.
+// Reemplaza el archivo de un servidor anterior. Retorna el descriptor o -1.
+int handoff_listen(const char* path);
+
+// Función para pedir el relevo al servidor que escucha en `path`. Retorna 1 y deja en
+// `fds` (hasta HANDOFF_MAX_FDS) los descriptores recibidos, 0 si no hay servidor
+// escuchando y -1 si la entrega falló. `conn` queda abierto para confirmar.
+int handoff_request(const char* path, int* conn, handoff_header_t* header, int* fds);
+
+// Función para confirmar (ok = 1) o rechazar la entrega y cerrar la conexión
+int handoff_confirm(int conn, int ok);
+
+// Función para aceptar un pedido de relevo en el socket que escucha (-1 si no hay pedido)
+int handoff_accept(int listen_fd);
+
+// Función para enviar la configuración y los descriptores y esperar la confirmación.
+// Retorna 0 si el proceso nuevo tomó el servicio.
+int handoff_send(int conn, const handoff_header_t* header, const int* fds, int count);
+
+#endif // DHCP_HANDOFF_H
@@ -0,0 +1,217 @@
+#include "dhcp_io.h"
+#include "lease_journal.h" // Para lease_journal_wait
+#include "dhcp_trace.h"    // Para las etapas SEND y FLUSH
+#include <stdio.h>  // Para printf, perror
+#include <stdlib.h> // Para calloc, free, strtol
+#include <string.h> // Para memcpy, memset
+
+dhcp_io_stats_t io_stats;                 // Contadores globales de E/S
+int io_batch_size = DHCP_DEFAULT_BATCH;   // Tamaño de lote configurado
+
+// Lote de respuestas del hilo actual (NULL = enviar cada respuesta con sendto)
+static __thread dhcp_msg_batch_t* active_tx_batch = NULL;
+
+static inline void count_io(unsigned long* counter, unsigned long value) {
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+int parse_batch_size(const char* value) {
+    if (!value) {
+        return DHCP_DEFAULT_BATCH;
+    }
+    long size = strtol(value, NULL, 10);
+    if (size < 1 || size > DHCP_MAX_BATCH) {
+        fprintf(stderr, "Advertencia: DHCP_BATCH_SIZE '%s' fuera de rango (1-%d), se usa %d.\n",
+                value, DHCP_MAX_BATCH, DHCP_DEFAULT_BATCH);
+        return DHCP_DEFAULT_BATCH;
+    }
+    return (int)size;
+}
+
+int dhcp_batch_init(dhcp_msg_batch_t* batch, int capacity) {
+    memset(batch, 0, sizeof(*batch));
+    if (capacity < 1) capacity = 1;
+    if (capacity > DHCP_MAX_BATCH) capacity = DHCP_MAX_BATCH;
+
+    batch->msgs = (struct mmsghdr*)calloc(capacity, sizeof(struct mmsghdr));
+    batch->iov = (struct iovec*)calloc(capacity, sizeof(struct iovec));
+    batch->addrs = (struct sockaddr_in*)calloc(capacity, sizeof(struct sockaddr_in));
+    batch->buffers = calloc(capacity, DHCP_IO_BUFFER_SIZE);
+    batch->control = calloc(capacity, DHCP_IO_CONTROL_SIZE);
+    if (!batch->msgs || !batch->iov || !batch->addrs || !batch->buffers || !batch->control) {
+        dhcp_batch_free(batch);
+        return -1;
+    }
+
+    batch->capacity = capacity;
+    batch->sockfd = -1;
+    return 0;
+}
+
+void dhcp_batch_free(dhcp_msg_batch_t* batch) {
+    free(batch->msgs);
+    free(batch->iov);
+    free(batch->addrs);
+    free(batch->buffers);
+    free(batch->control);
+    memset(batch, 0, sizeof(*batch));
+}
+
+// Preparar el encabezado del mensaje `i` apuntando a `buffer` y a su dirección
+static void prepare_msg(dhcp_msg_batch_t* batch, int i, void* buffer, size_t length) {
+    batch->iov[i].iov_base = buffer;
+    batch->iov[i].iov_len = length;
+    memset(&batch->msgs[i].msg_hdr, 0, sizeof(struct msghdr));
+    batch->msgs[i].msg_hdr.msg_name = &batch->addrs[i];
+    batch->msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+    batch->msgs[i].msg_hdr.msg_iov = &batch->iov[i];
+    batch->msgs[i].msg_hdr.msg_iovlen = 1;
+    batch->msgs[i].msg_len = 0;
+    // Las respuestas no llevan control; las lecturas, solo si se pidió la marca del kernel
+    if (dhcp_trace_kernel_timestamps && batch->control) {
+        batch->msgs[i].msg_hdr.msg_control = batch->control[i];
+        batch->msgs[i].msg_hdr.msg_controllen = DHCP_IO_CONTROL_SIZE;
+    }
+}
+
+int receive_dhcp_into(int sockfd, dhcp_msg_batch_t* batch, uint8_t* const* buffers, int count, int flags) {
+    batch->count = 0;
+    if (count > batch->capacity) count = batch->capacity;
+
+    // Con lotes de 1 se conserva el camino clásico de una llamada por paquete
+    if (count == 1 && !dhcp_trace_kernel_timestamps) {
+        socklen_t addr_len = sizeof(struct sockaddr_in);
+        ssize_t received = recvfrom(sockfd, buffers[0], DHCP_IO_BUFFER_SIZE, flags & ~MSG_WAITFORONE,
+                                    (struct sockaddr*)&batch->addrs[0], &addr_len);
+        if (received < 0) {
+            return -1;
+        }
+        count_io(&io_stats.rx_syscalls, 1);
+        count_io(&io_stats.rx_packets, 1);
+        batch->msgs[0].msg_len = (unsigned int)received;
+        batch->count = 1;
+        return 1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        prepare_msg(batch, i, buffers[i], DHCP_IO_BUFFER_SIZE);
+    }
+
+    int received = count == 1 ? (int)recvmsg(sockfd, &batch->msgs[0].msg_hdr, flags & ~MSG_WAITFORONE)
+                              : recvmmsg(sockfd, batch->msgs, count, flags, NULL);
+    if (received < 0) {
+        return -1;
+    }
+    if (count == 1) {
+        batch->msgs[0].msg_len = (unsigned int)received;
+        received = 1;
+    }
+    count_io(&io_stats.rx_syscalls, 1);
+    count_io(&io_stats.rx_packets, received);
+    batch->count = received;
+    return received;
+}
+
+int receive_dhcp_batch(int sockfd, dhcp_msg_batch_t* batch, int flags) {
+    uint8_t* buffers[DHCP_MAX_BATCH];
+    for (int i = 0; i < batch->capacity; i++) {
+        buffers[i] = batch->buffers[i];
+    }
+    return receive_dhcp_into(sockfd, batch, buffers, batch->capacity, flags);
+}
+
+uint32_t dhcp_batch_kernel_delay(const dhcp_msg_batch_t* batch, int i, uint64_t realtime_ns) {
+    return dhcp_trace_kernel_timestamps ? dhcp_trace_kernel_delay(&batch->msgs[i].msg_hdr, realtime_ns) : 0;
+}
+
+void dhcp_tx_attach(dhcp_msg_batch_t* batch, int sockfd) {
+    if (batch) {
+        batch->sockfd = sockfd;
+        batch->count = 0;
+    }
+    active_tx_batch = batch;
+}
+
+int dhcp_tx_flush(dhcp_msg_batch_t* batch) {
+    int sent_total = 0;
+    uint64_t traced = batch->count > 0 ? dhcp_trace_start() : 0;
+
+    // Ninguna respuesta sale antes de que sus leases estén en disco
+    if (batch->count > 0) {
+        lease_journal_wait_for(batch->journal_seq);
+    }
+
+    while (sent_total < batch->count) {
+        int sent = sendmmsg(batch->sockfd, batch->msgs + sent_total, batch->count - sent_total, 0);
+        count_io(&io_stats.tx_syscalls, 1);
+        if (sent < 0) {
+            // Descartar el mensaje que falló y seguir con el resto del lote
+            perror("Error al enviar el lote de respuestas DHCP");
+            sent_total++;
+            continue;
+        }
+        count_io(&io_stats.tx_packets, sent);
+        sent_total += sent;
+    }
+
+    batch->count = 0;
+    if (traced) {
+        dhcp_trace_record(DHCP_TRACE_FLUSH, DHCP_TRACE_BATCH, dhcp_trace_clock() - traced);
+    }
+    return sent_total;
+}
+
+ssize_t send_dhcp_reply(int sockfd, struct sockaddr_in* client_addr, const void* packet, size_t length) {
+    dhcp_msg_batch_t* batch = active_tx_batch;
+    uint64_t traced = dhcp_trace_start();
+    if (length > DHCP_IO_BUFFER_SIZE) {
+        length = DHCP_IO_BUFFER_SIZE;
+    }
+
+    if (!batch || batch->capacity == 1 || batch->sockfd != sockfd) {
+        lease_journal_wait();
+        ssize_t sent = sendto(sockfd, packet, length, 0, (struct sockaddr*)client_addr, sizeof(*client_addr));
+        count_io(&io_stats.tx_syscalls, 1);
+        if (sent >= 0) {
+            count_io(&io_stats.tx_packets, 1);
+        }
+        dhcp_trace_end(DHCP_TRACE_SEND, traced);
+        return sent;
+    }
+
+    // Encolar la respuesta; se envía con el resto del lote en dhcp_tx_flush
+    if (batch->count == batch->capacity) {
+        dhcp_tx_flush(batch);
+    }
+    int i = batch->count++;
+    batch->journal_seq = lease_journal_thread_seq();
+    memcpy(batch->buffers[i], packet, length);
+    batch->addrs[i] = *client_addr;
+    prepare_msg(batch, i, batch->buffers[i], length);
+    batch->msgs[i].msg_hdr.msg_control = NULL;
+    batch->msgs[i].msg_hdr.msg_controllen = 0;
+    dhcp_trace_end(DHCP_TRACE_SEND, traced);
+    return (ssize_t)length;
+}
+
+void print_io_stats(double elapsed_seconds) {
+    unsigned long rx_packets = __atomic_load_n(&io_stats.rx_packets, __ATOMIC_RELAXED);
+    unsigned long rx_syscalls = __atomic_load_n(&io_stats.rx_syscalls, __ATOMIC_RELAXED);
+    unsigned long tx_packets = __atomic_load_n(&io_stats.tx_packets, __ATOMIC_RELAXED);
+    unsigned long tx_syscalls = __atomic_load_n(&io_stats.tx_syscalls, __ATOMIC_RELAXED);
+    unsigned long ring_enters = __atomic_load_n(&io_stats.ring_enters, __ATOMIC_RELAXED);
+    unsigned long rx_copies = __atomic_load_n(&io_stats.rx_copies, __ATOMIC_RELAXED);
+
+    printf("E/S (lote de %d): %lu paquetes recibidos en %lu syscalls (%.3f syscalls/paquete), "
+           "%lu respuestas en %lu syscalls (%.3f syscalls/paquete)",
+           io_batch_size, rx_packets, rx_syscalls, rx_packets ? (double)rx_syscalls / rx_packets : 0.0,
+           tx_packets, tx_syscalls, tx_packets ? (double)tx_syscalls / tx_packets : 0.0);
+    if (ring_enters > 0) {
+        printf(", %lu io_uring_enter (%.3f por paquete)", ring_enters, rx_packets ? (double)ring_enters / rx_packets : 0.0);
+    }
+    printf(", %.3f copias/paquete recibido", rx_packets ? (double)rx_copies / rx_packets : 0.0);
+    if (elapsed_seconds > 0) {
+        printf(", %.0f paquetes/s", rx_packets / elapsed_seconds);
+    }
+    printf("\n");
+}
@@ -0,0 +1,78 @@
+#ifndef DHCP_IO_H
+#define DHCP_IO_H
+
+// recvmmsg, sendmmsg y MSG_WAITFORONE requieren _GNU_SOURCE (definido en el Makefile)
+#include <sys/socket.h> // Para recvmmsg, sendmmsg
+#include <sys/uio.h>    // Para iovec
+#include <netinet/in.h> // Para sockaddr_in
+#include <stdint.h>     // Para uint8_t, uint64_t
+#include <stddef.h>     // Para size_t
+#include <sys/types.h>  // Para ssize_t
+
+#define DHCP_IO_BUFFER_SIZE 548   // Tamaño máximo de un datagrama DHCP (igual que BUFFER_SIZE)
+#define DHCP_DEFAULT_BATCH 32     // Datagramas por recvmmsg/sendmmsg si no se indica otro valor
+#define DHCP_MAX_BATCH 1024       // Límite del kernel para recvmmsg/sendmmsg (UIO_MAXIOV)
+#define DHCP_IO_CONTROL_SIZE 64   // Datos de control por mensaje (SCM_TIMESTAMPNS con DHCP_TRACE=kernel)
+
+// Lote de datagramas para recvmmsg/sendmmsg. Cada mensaje tiene su propio buffer
+// y su propia dirección, así un lote recibido puede procesarse sin copiarlo.
+typedef struct {
+    int capacity;                  // Mensajes que caben en el lote
+    int count;                     // Mensajes cargados en el lote
+    int sockfd;                    // Socket por el que se vacía el lote de respuestas
+    uint64_t journal_seq;          // Último registro del journal que las respuestas deben esperar
+    struct mmsghdr* msgs;          // Encabezados para el kernel
+    struct iovec* iov;             // Un iovec por mensaje
+    struct sockaddr_in* addrs;     // Dirección de origen/destino de cada mensaje
+    uint8_t (*buffers)[DHCP_IO_BUFFER_SIZE];  // Contenido de cada mensaje
+    uint8_t (*control)[DHCP_IO_CONTROL_SIZE]; // Marca de tiempo del kernel de cada mensaje recibido
+} dhcp_msg_batch_t;
+
+// Contadores de E/S del servidor (se actualizan de forma atómica)
+typedef struct {
+    unsigned long rx_packets;      // Datagramas recibidos
+    unsigned long rx_syscalls;     // Llamadas a recvfrom/recvmmsg
+    unsigned long tx_packets;      // Datagramas enviados
+    unsigned long tx_syscalls;     // Llamadas a sendto/sendmmsg
+    unsigned long ring_enters;     // Llamadas a io_uring_enter (recepción y envío juntos)
+    unsigned long rx_copies;       // Datagramas recibidos que se copiaron antes de procesarlos
+} dhcp_io_stats_t;
+
+extern dhcp_io_stats_t io_stats;   // Contadores globales de E/S
+extern int io_batch_size;          // Tamaño de lote configurado (DHCP_BATCH_SIZE)
+
+// Función para leer el tamaño de lote de una cadena (NULL o inválido usa DHCP_DEFAULT_BATCH)
+int parse_batch_size(const char* value);
+
+// Función para reservar un lote de `capacity` mensajes
+int dhcp_batch_init(dhcp_msg_batch_t* batch, int capacity);
+
+// Función para liberar la memoria de un lote
+void dhcp_batch_free(dhcp_msg_batch_t* batch);
+
+// Función para recibir hasta `capacity` datagramas con una sola llamada al sistema.
+// Retorna cuántos se recibieron o -1 si falló (errno indica la causa).
+int receive_dhcp_batch(int sockfd, dhcp_msg_batch_t* batch, int flags);
+
+// Función para recibir hasta `count` datagramas directamente en `buffers` (de
+// DHCP_IO_BUFFER_SIZE bytes cada uno); el lote solo aporta encabezados y direcciones.
+// Retorna cuántos se recibieron o -1 si falló.
+int receive_dhcp_into(int sockfd, dhcp_msg_batch_t* batch, uint8_t* const* buffers, int count, int flags);
+
+// Función para leer cuánto esperó en el kernel el mensaje `i` del último lote recibido
+// (0 si no se pidió SO_TIMESTAMPNS). `realtime_ns` es CLOCK_REALTIME al volver de la lectura.
+uint32_t dhcp_batch_kernel_delay(const dhcp_msg_batch_t* batch, int i, uint64_t realtime_ns);
+
+// Función para que las respuestas del hilo actual se acumulen en `batch` (NULL las envía una a una)
+void dhcp_tx_attach(dhcp_msg_batch_t* batch, int sockfd);
+
+// Función para enviar las respuestas acumuladas con un solo sendmmsg (retorna las enviadas)
+int dhcp_tx_flush(dhcp_msg_batch_t* batch);
+
+// Función para enviar una respuesta DHCP; si el hilo tiene un lote asociado se encola en él
+ssize_t send_dhcp_reply(int sockfd, struct sockaddr_in* client_addr, const void* packet, size_t length);
+
+// Función para imprimir los contadores de E/S (paquetes por segundo y syscalls por paquete)
+void print_io_stats(double elapsed_seconds);
+
+#endif // DHCP_IO_H
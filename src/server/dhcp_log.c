@@ -0,0 +1,449 @@
+#include "dhcp_log.h"
+#include "dhcp_lock.h"
+#include <pthread.h>  // Para hilos, pthread_key_t
+#include <stdarg.h>   // Para va_list
+#include <stdlib.h>   // Para calloc, free
+#include <string.h>   // Para memcpy, strlen, strcmp
+#include <time.h>     // Para clock_gettime
+
+// Tipos de argumento que se guardan en un registro
+enum {
+    LOG_ARG_INT = 0,   // int (incluye char y short promovidos)
+    LOG_ARG_LONG,      // long, long long, size_t, intmax_t, ptrdiff_t
+    LOG_ARG_DOUBLE,    // double
+    LOG_ARG_STRING,    // const char*, copiada al registro
+    LOG_ARG_POINTER    // void*
+};
+
+// Anillo de un hilo: él escribe y el hilo de log lee (un productor, un consumidor)
+typedef struct {
+    dhcp_log_record_t records[DHCP_LOG_RING_SIZE];
+    uint32_t head __attribute__((aligned(64)));  // Próximo a leer (hilo de log)
+    uint32_t tail __attribute__((aligned(64)));  // Próximo a escribir (dueño)
+    int closed;                                  // El hilo dueño terminó
+} dhcp_log_ring_t;
+
+int dhcp_log_level = DHCP_LOG_INFO;
+unsigned long dhcp_log_dropped = 0;
+
+static dhcp_log_ring_t* rings[DHCP_LOG_MAX_THREADS];  // Anillos registrados (NULL = libre)
+static dhcp_mutex_t rings_mutex = DHCP_MUTEX_INITIALIZER("rings_mutex");
+static pthread_key_t ring_key;                       // Marca el anillo como cerrado al salir el hilo
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static __thread dhcp_log_ring_t* thread_ring = NULL;
+
+static int logger_running = 0;
+static int logger_stopping = 0;
+static pthread_t logger_thread;
+static dhcp_mutex_t logger_mutex = DHCP_MUTEX_INITIALIZER("logger_mutex");
+static pthread_cond_t logger_cond;
+
+static uint64_t log_clock_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+int parse_log_level(const char* name) {
+    if (!name) return DHCP_LOG_INFO;
+    if (strcmp(name, "off") == 0) return DHCP_LOG_OFF;
+    if (strcmp(name, "error") == 0) return DHCP_LOG_ERROR;
+    if (strcmp(name, "warn") == 0) return DHCP_LOG_WARN;
+    if (strcmp(name, "info") == 0) return DHCP_LOG_INFO;
+    if (strcmp(name, "debug") == 0) return DHCP_LOG_DEBUG;
+    fprintf(stderr, "Advertencia: Nivel de log '%s' desconocido, se usa info.\n", name);
+    return DHCP_LOG_INFO;
+}
+
+// Leer del formato el tipo de cada argumento (conversiones de printf)
+static void parse_format(const char* format, uint8_t* types, uint8_t* count) {
+    *count = 0;
+    for (const char* p = format; *p; p++) {
+        if (*p != '%') continue;
+        p++;
+        if (*p == '%') continue;
+
+        // Banderas, ancho y precisión ('*' consume un int)
+        while (*p && strchr("-+ #0", *p)) p++;
+        for (; *p && (*p == '*' || (*p >= '0' && *p <= '9') || *p == '.'); p++) {
+            if (*p == '*' && *count < DHCP_LOG_MAX_ARGS) types[(*count)++] = LOG_ARG_INT;
+        }
+
+        int is_long = 0;
+        while (*p && strchr("hlLqjzt", *p)) {
+            if (*p != 'h') is_long = 1;
+            p++;
+        }
+        if (!*p || *count == DHCP_LOG_MAX_ARGS) break;
+
+        switch (*p) {
+            case 's': types[(*count)++] = LOG_ARG_STRING; break;
+            case 'p': types[(*count)++] = LOG_ARG_POINTER; break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                types[(*count)++] = LOG_ARG_DOUBLE; break;
+            default:
+                types[(*count)++] = is_long ? LOG_ARG_LONG : LOG_ARG_INT; break;
+        }
+    }
+}
+
+// Copiar los argumentos al registro según los tipos del punto de log
+static void capture_args(dhcp_log_record_t* record, const uint8_t* types, int count, va_list ap) {
+    size_t used = 0;
+    for (int i = 0; i < count; i++) {
+        switch (types[i]) {
+            case LOG_ARG_INT: record->args[i] = (uint64_t)(int64_t)va_arg(ap, int); break;
+            case LOG_ARG_LONG: record->args[i] = (uint64_t)va_arg(ap, long long); break;
+            case LOG_ARG_POINTER: record->args[i] = (uint64_t)(uintptr_t)va_arg(ap, void*); break;
+            case LOG_ARG_DOUBLE: {
+                double value = va_arg(ap, double);
+                memcpy(&record->args[i], &value, sizeof(value));
+                break;
+            }
+            case LOG_ARG_STRING: {
+                const char* value = va_arg(ap, const char*);
+                if (!value) value = "(null)";
+                if (used >= DHCP_LOG_STRING_SPACE) {
+                    record->args[i] = DHCP_LOG_STRING_SPACE - 1;  // Sin lugar: el '\0' de la anterior
+                    break;
+                }
+                // Las cadenas que no entran se recortan
+                size_t length = strlen(value);
+                if (length > DHCP_LOG_STRING_SPACE - used - 1) {
+                    length = DHCP_LOG_STRING_SPACE - used - 1;
+                }
+                record->args[i] = used;
+                memcpy(record->strings + used, value, length);
+                record->strings[used + length] = '\0';
+                used += length + 1;
+                break;
+            }
+        }
+    }
+}
+
+// Conversiones más usadas en los mensajes del servidor (%s, %d, %u, %x, %02x) sin pasar
+// por snprintf. Retorna 0 si la conversión no es de ese tipo.
+static int format_simple(const char* spec, uint8_t type, const dhcp_log_record_t* record, uint64_t value,
+                         char* out, size_t room, int* written) {
+    int zero_width = 0;
+    const char* p = spec + 1;
+    if (p[0] == '0' && p[1] >= '1' && p[1] <= '9' && p[2] && !p[3]) {
+        zero_width = p[1] - '0';
+        p += 2;
+    } else if (p[1]) {
+        return 0;  // Otras banderas, anchos o modificadores: snprintf
+    }
+
+    if (*p == 's' && type == LOG_ARG_STRING && !zero_width) {
+        const char* text = record->strings + value;
+        size_t length = strlen(text);
+        if (length > room - 1) length = room - 1;
+        memcpy(out, text, length);
+        *written = (int)length;
+        return 1;
+    }
+    if (type != LOG_ARG_INT || (*p != 'd' && *p != 'u' && *p != 'x') || room < 16) {
+        return 0;
+    }
+
+    unsigned int base = *p == 'x' ? 16 : 10;
+    unsigned int number = (unsigned int)value;
+    int negative = *p == 'd' && (int)number < 0;
+    if (negative) number = 0u - number;
+
+    char digits[12];
+    int count = 0;
+    do {
+        digits[count++] = "0123456789abcdef"[number % base];
+        number /= base;
+    } while (number);
+    while (count < zero_width) digits[count++] = '0';
+
+    int n = 0;
+    if (negative) out[n++] = '-';
+    while (count > 0) out[n++] = digits[--count];
+    *written = n;
+    return 1;
+}
+
+// Formatear un registro en `out`; cada conversión se pasa a snprintf con su tipo original
+static size_t format_record(const dhcp_log_record_t* record, const uint8_t* types, char* out, size_t size) {
+    const char* format = record->site->format;
+    size_t length = 0;
+    int arg = 0;
+
+    for (const char* p = format; *p && length + 1 < size; ) {
+        if (*p != '%') {
+            out[length++] = *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            out[length++] = '%';
+            p += 2;
+            continue;
+        }
+
+        // Aislar la conversión (p. ej. "%02x") para pasarla sola a snprintf
+        const char* start = p++;
+        while (*p && !strchr("diouxXcspfFeEgGaAn", *p)) p++;
+        if (!*p) break;
+        p++;
+        char spec[32];
+        size_t spec_length = (size_t)(p - start) < sizeof(spec) - 1 ? (size_t)(p - start) : sizeof(spec) - 1;
+        memcpy(spec, start, spec_length);
+        spec[spec_length] = '\0';
+
+        int written = 0;
+        size_t room = size - length;
+        if (arg < DHCP_LOG_MAX_ARGS &&
+            format_simple(spec, types[arg], record, record->args[arg], out + length, room, &written)) {
+            arg++;  // Conversión común resuelta sin snprintf
+        } else if (strchr(spec, '*') || arg >= DHCP_LOG_MAX_ARGS) {
+            written = snprintf(out + length, room, "%s", spec);  // Sin soporte: se copia tal cual
+        } else {
+            uint64_t value = record->args[arg];
+            switch (types[arg]) {
+                case LOG_ARG_INT: written = snprintf(out + length, room, spec, (int)(int64_t)value); break;
+                case LOG_ARG_LONG: written = snprintf(out + length, room, spec, (long long)value); break;
+                case LOG_ARG_POINTER: written = snprintf(out + length, room, spec, (void*)(uintptr_t)value); break;
+                case LOG_ARG_STRING: written = snprintf(out + length, room, spec, record->strings + value); break;
+                case LOG_ARG_DOUBLE: {
+                    double number;
+                    memcpy(&number, &value, sizeof(number));
+                    written = snprintf(out + length, room, spec, number);
+                    break;
+                }
+            }
+            arg++;
+        }
+        if (written > 0) {
+            length += (size_t)written < room ? (size_t)written : room - 1;
+        }
+    }
+    out[length] = '\0';
+    return length;
+}
+
+// Los errores y advertencias van a stderr, como los fprintf que reemplazan
+static void emit_record(const dhcp_log_record_t* record, const uint8_t* types) {
+    uint8_t parsed_types[DHCP_LOG_MAX_ARGS];
+    if (!types && __atomic_load_n(&record->site->parsed, __ATOMIC_ACQUIRE) == 2) {
+        types = record->site->arg_types;
+    } else if (!types) {
+        // El punto de log todavía no guardó sus tipos: leerlos del formato
+        uint8_t count;
+        parse_format(record->site->format, parsed_types, &count);
+        types = parsed_types;
+    }
+    char line[1024];
+    size_t length = format_record(record, types, line, sizeof(line));
+    fwrite(line, 1, length, record->site->level <= DHCP_LOG_WARN ? stderr : stdout);
+}
+
+static void close_thread_ring(void* ring) {
+    __atomic_store_n(&((dhcp_log_ring_t*)ring)->closed, 1, __ATOMIC_RELEASE);
+}
+
+static void create_ring_key() {
+    pthread_key_create(&ring_key, close_thread_ring);
+}
+
+// Anillo del hilo actual (se registra en su primer mensaje); NULL si no quedan lugares
+static dhcp_log_ring_t* get_thread_ring() {
+    if (thread_ring) return thread_ring;
+
+    pthread_once(&ring_key_once, create_ring_key);
+    dhcp_log_ring_t* ring = (dhcp_log_ring_t*)calloc(1, sizeof(dhcp_log_ring_t));
+    if (!ring) return NULL;
+
+    dhcp_mutex_lock(&rings_mutex);
+    for (int i = 0; i < DHCP_LOG_MAX_THREADS; i++) {
+        if (!rings[i]) {
+            __atomic_store_n(&rings[i], ring, __ATOMIC_RELEASE);
+            thread_ring = ring;
+            break;
+        }
+    }
+    dhcp_mutex_unlock(&rings_mutex);
+
+    if (!thread_ring) {
+        free(ring);
+        return NULL;
+    }
+    pthread_setspecific(ring_key, ring);
+    return thread_ring;
+}
+
+void dhcp_log_write(dhcp_log_site_t* site, ...) {
+    // Los tipos se leen del formato una vez por punto de log
+    uint8_t local_types[DHCP_LOG_MAX_ARGS];
+    uint8_t count;
+    const uint8_t* types = site->arg_types;
+    if (__atomic_load_n(&site->parsed, __ATOMIC_ACQUIRE) == 2) {
+        count = site->arg_count;
+    } else {
+        parse_format(site->format, local_types, &count);
+        types = local_types;
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&site->parsed, &expected, 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            memcpy(site->arg_types, local_types, sizeof(local_types));
+            site->arg_count = count;
+            __atomic_store_n(&site->parsed, 2, __ATOMIC_RELEASE);
+        }
+    }
+
+    va_list ap;
+    va_start(ap, site);
+    dhcp_log_ring_t* ring = __atomic_load_n(&logger_running, __ATOMIC_ACQUIRE) ? get_thread_ring() : NULL;
+    if (!ring) {
+        // Sin hilo de log: formatear y escribir ahora
+        dhcp_log_record_t record;
+        record.site = site;
+        capture_args(&record, types, count, ap);
+        va_end(ap);
+        emit_record(&record, types);
+        return;
+    }
+
+    uint32_t tail = ring->tail;
+    uint32_t used = tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (used == DHCP_LOG_RING_SIZE) {
+        va_end(ap);
+        __atomic_fetch_add(&dhcp_log_dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    dhcp_log_record_t* record = &ring->records[tail & (DHCP_LOG_RING_SIZE - 1)];
+    record->site = site;
+    record->timestamp_ns = log_clock_ns();
+    capture_args(record, types, count, ap);
+    va_end(ap);
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+    // Despertar antes de tiempo al hilo de log si el anillo va por la mitad o es un error
+    if (used + 1 == DHCP_LOG_RING_SIZE / 2 || site->level == DHCP_LOG_ERROR) {
+        dhcp_mutex_lock(&logger_mutex);
+        pthread_cond_signal(&logger_cond);
+        dhcp_mutex_unlock(&logger_mutex);
+    }
+}
+
+// Escribir todo lo pendiente de todos los anillos en orden de tiempo. Retorna cuántos registros.
+// Cada anillo ya está ordenado (lo escribe un solo hilo), así que basta con mezclarlos
+// tomando siempre el registro más antiguo entre sus cabezas, sin ordenar ni reservar memoria.
+static int drain_rings() {
+    dhcp_log_ring_t* taken[DHCP_LOG_MAX_THREADS];
+    uint32_t taken_next[DHCP_LOG_MAX_THREADS];
+    uint32_t taken_tail[DHCP_LOG_MAX_THREADS];
+    int ring_count = 0;
+    int count = 0;
+
+    for (int i = 0; i < DHCP_LOG_MAX_THREADS; i++) {
+        dhcp_log_ring_t* ring = __atomic_load_n(&rings[i], __ATOMIC_ACQUIRE);
+        if (!ring) continue;
+        int closed = __atomic_load_n(&ring->closed, __ATOMIC_ACQUIRE);
+        uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (tail == ring->head) {
+            // El anillo de un hilo que terminó y ya se vació vuelve a quedar libre
+            if (closed) {
+                dhcp_mutex_lock(&rings_mutex);
+                rings[i] = NULL;
+                dhcp_mutex_unlock(&rings_mutex);
+                free(ring);
+            }
+            continue;
+        }
+        taken[ring_count] = ring;
+        taken_next[ring_count] = ring->head;
+        taken_tail[ring_count++] = tail;
+    }
+    if (ring_count == 0) return 0;
+
+    while (1) {
+        int oldest = -1;
+        uint64_t oldest_ns = UINT64_MAX;
+        for (int i = 0; i < ring_count; i++) {
+            if (taken_next[i] == taken_tail[i]) continue;
+            uint64_t ns = taken[i]->records[taken_next[i] & (DHCP_LOG_RING_SIZE - 1)].timestamp_ns;
+            if (oldest < 0 || ns < oldest_ns) {
+                oldest = i;
+                oldest_ns = ns;
+            }
+        }
+        if (oldest < 0) break;
+        emit_record(&taken[oldest]->records[taken_next[oldest]++ & (DHCP_LOG_RING_SIZE - 1)], NULL);
+        count++;
+    }
+    fflush(stdout);
+    fflush(stderr);
+
+    // Recién ahora los hilos pueden reutilizar esos registros
+    for (int i = 0; i < ring_count; i++) {
+        __atomic_store_n(&taken[i]->head, taken_tail[i], __ATOMIC_RELEASE);
+    }
+    return count;
+}
+
+static void* logger_loop(void* arg) {
+    (void)arg;
+    unsigned long reported = 0;
+
+    dhcp_mutex_lock(&logger_mutex);
+    while (1) {
+        dhcp_mutex_unlock(&logger_mutex);
+        drain_rings();
+
+        unsigned long dropped = __atomic_load_n(&dhcp_log_dropped, __ATOMIC_RELAXED);
+        if (dropped != reported) {
+            fprintf(stderr, "Advertencia: Se descartaron %lu mensajes de log (anillo lleno).\n", dropped - reported);
+            reported = dropped;
+        }
+
+        dhcp_mutex_lock(&logger_mutex);
+        if (logger_stopping) break;
+
+        struct timespec until;
+        clock_gettime(CLOCK_MONOTONIC, &until);
+        until.tv_nsec += DHCP_LOG_FLUSH_MS * 1000000L;
+        until.tv_sec += until.tv_nsec / 1000000000L;
+        until.tv_nsec %= 1000000000L;
+        dhcp_cond_timedwait(&logger_cond, &logger_mutex, &until);
+    }
+    dhcp_mutex_unlock(&logger_mutex);
+
+    // Lo que quedó después del último vaciado
+    drain_rings();
+    return NULL;
+}
+
+int dhcp_log_start() {
+    if (logger_running) return 0;
+
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&logger_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    logger_stopping = 0;
+    if (pthread_create(&logger_thread, NULL, logger_loop, NULL) != 0) {
+        perror("Error al crear el hilo de log");
+        pthread_cond_destroy(&logger_cond);
+        return -1;
+    }
+    __atomic_store_n(&logger_running, 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void dhcp_log_stop() {
+    if (!logger_running) return;
+
+    // Los mensajes nuevos se escriben en el momento; el hilo vacía lo que quedó
+    __atomic_store_n(&logger_running, 0, __ATOMIC_RELEASE);
+    dhcp_mutex_lock(&logger_mutex);
+    logger_stopping = 1;
+    pthread_cond_signal(&logger_cond);
+    dhcp_mutex_unlock(&logger_mutex);
+    pthread_join(logger_thread, NULL);
+    pthread_cond_destroy(&logger_cond);
+}
@@ -0,0 +1,82 @@
+#ifndef DHCP_LOG_H
+#define DHCP_LOG_H
+
+#include <stdint.h> // Para uint8_t, uint32_t, uint64_t
+#include <stdio.h>  // Para printf (solo para verificar formatos en compilación)
+
+// Niveles de log (DHCP_LOG_LEVEL en tiempo de ejecución)
+#define DHCP_LOG_OFF   0
+#define DHCP_LOG_ERROR 1
+#define DHCP_LOG_WARN  2
+#define DHCP_LOG_INFO  3
+#define DHCP_LOG_DEBUG 4
+
+// Nivel máximo que se compila; los mensajes por encima no generan código.
+// Se cambia con -DDHCP_LOG_COMPILE_LEVEL=DHCP_LOG_INFO en el Makefile.
+#ifndef DHCP_LOG_COMPILE_LEVEL
+#define DHCP_LOG_COMPILE_LEVEL DHCP_LOG_DEBUG
+#endif
+
+#define DHCP_LOG_MAX_ARGS 12        // Argumentos por mensaje
+#define DHCP_LOG_STRING_SPACE 80    // Bytes para copiar los argumentos %s de un mensaje
+#define DHCP_LOG_RING_SIZE 1024     // Registros por hilo (potencia de 2)
+#define DHCP_LOG_MAX_THREADS 64     // Hilos con anillo propio a la vez
+#define DHCP_LOG_FLUSH_MS 100       // Espera máxima del hilo de log entre vaciados
+
+// Direcciones y MACs como enteros: se formatean en el hilo de log, no en el que atiende
+#define DHCP_IP_FMT "%u.%u.%u.%u"
+#define DHCP_IP_ARGS(ip) (unsigned)(((ip) >> 24) & 0xff), (unsigned)(((ip) >> 16) & 0xff), \
+                         (unsigned)(((ip) >> 8) & 0xff), (unsigned)((ip) & 0xff)
+#define DHCP_MAC_FMT "%02x:%02x:%02x:%02x:%02x:%02x"
+#define DHCP_MAC_ARGS(mac) (mac)[0], (mac)[1], (mac)[2], (mac)[3], (mac)[4], (mac)[5]
+
+// Punto de log: cada llamada tiene uno estático, y su dirección es el identificador del
+// formato en los registros. Los tipos de los argumentos se deducen del formato una sola vez.
+typedef struct {
+    int level;                          // DHCP_LOG_*
+    const char* format;                 // Formato estilo printf
+    int parsed;                         // Ya se leyeron los tipos del formato
+    uint8_t arg_count;                  // Argumentos que consume el formato
+    uint8_t arg_types[DHCP_LOG_MAX_ARGS];
+} dhcp_log_site_t;
+
+// Registro binario que viaja por el anillo de un hilo
+typedef struct {
+    const dhcp_log_site_t* site;          // Formato y nivel
+    uint64_t timestamp_ns;                // CLOCK_MONOTONIC al registrar (ordena entre hilos)
+    uint64_t args[DHCP_LOG_MAX_ARGS];     // Enteros, doubles (bits) o posición en `strings`
+    char strings[DHCP_LOG_STRING_SPACE];  // Copias de los argumentos %s
+} dhcp_log_record_t;
+
+extern int dhcp_log_level;               // Nivel activo (DHCP_LOG_LEVEL, por defecto info)
+extern unsigned long dhcp_log_dropped;   // Mensajes descartados por anillo lleno
+
+// Función para registrar un mensaje (usar las macros de abajo)
+void dhcp_log_write(dhcp_log_site_t* site, ...);
+
+// Registrar un mensaje si su nivel está compilado y activo. Los argumentos no se
+// evalúan si el nivel está desactivado; el printf muerto solo verifica el formato.
+#define dhcp_log(level, fmt, ...) do { \
+    if ((level) <= DHCP_LOG_COMPILE_LEVEL && (level) <= dhcp_log_level) { \
+        static dhcp_log_site_t dhcp_log_site_ = { (level), fmt, 0, 0, {0} }; \
+        dhcp_log_write(&dhcp_log_site_, ##__VA_ARGS__); \
+    } \
+    if (0) printf(fmt, ##__VA_ARGS__); \
+} while (0)
+
+#define dhcp_log_error(fmt, ...) dhcp_log(DHCP_LOG_ERROR, fmt, ##__VA_ARGS__)
+#define dhcp_log_warn(fmt, ...)  dhcp_log(DHCP_LOG_WARN, fmt, ##__VA_ARGS__)
+#define dhcp_log_info(fmt, ...)  dhcp_log(DHCP_LOG_INFO, fmt, ##__VA_ARGS__)
+#define dhcp_log_debug(fmt, ...) dhcp_log(DHCP_LOG_DEBUG, fmt, ##__VA_ARGS__)
+
+// Función para convertir el nombre de un nivel ("off", "error", "warn", "info", "debug")
+int parse_log_level(const char* name);
+
+// Función para iniciar el hilo de log. Hasta entonces (y después de dhcp_log_stop) los
+// mensajes se escriben en el momento desde el hilo que los genera.
+int dhcp_log_start();
+
+// Función para vaciar los anillos y detener el hilo de log
+void dhcp_log_stop();
+
+#endif // DHCP_LOG_H
@@ -0,0 +1,152 @@
+#include "dhcp_options.h"
+#include <string.h>     // Para memcpy, memcmp, strlen
+
+// Plantilla cacheada para una lista de parámetros (opción 55) concreta
+typedef struct {
+    uint32_t generation;              // Configuración con la que se armó (0 = vacía)
+    uint8_t list_length;              // Longitud de la lista
+    uint8_t list[DHCP_PRL_MAX];       // Códigos pedidos por el cliente, en su orden
+    dhcp_option_template_t template;  // Opciones codificadas para esa lista
+} dhcp_prl_entry_t;
+
+// Cada opción que conoce el servidor, codificada una sola vez (código, longitud y valor)
+static uint8_t encoded[DHCP_OPTIONS_SIZE];
+static uint16_t encoded_offset[256];  // Posición de cada código en `encoded`
+static uint8_t encoded_length[256];   // Bytes de cada código (0 = el servidor no la envía)
+
+static dhcp_option_template_t default_template;  // Clientes que no envían la opción 55
+static uint32_t broadcast_mask;                   // Máscara para derivar la opción 28
+static uint32_t options_generation = 0;           // Aumenta con cada dhcp_options_compile
+
+// Caché de plantillas por hilo: sin locks en el camino de cada paquete
+static __thread dhcp_prl_entry_t prl_cache[DHCP_PRL_CACHE_SIZE];
+
+// Opciones enviadas a quien no pide ninguna, después de 53, 54 y 51
+static const uint8_t default_list[] = {
+    DHCP_OPTION_SUBNET_MASK, DHCP_OPTION_ROUTER, DHCP_OPTION_DNS_SERVER, DHCP_OPTION_HOSTNAME,
+    DHCP_OPTION_DOMAIN_NAME, DHCP_OPTION_BROADCAST, DHCP_OPTION_NTP_SERVER
+};
+
+// Agregar una opción al bloque codificado y recordar dónde quedó
+static void encode_option(dhcp_option_writer_t* writer, uint8_t code, const void* value, uint8_t length) {
+    int offset = dhcp_put_option(writer, code, value, length);
+    if (offset < 0) {
+        return;
+    }
+    encoded_offset[code] = (uint16_t)(offset - 2);
+    encoded_length[code] = 2 + length;
+}
+
+// Copiar una opción ya codificada a la plantilla (una sola vez por código)
+static void append_option(dhcp_option_template_t* template, uint8_t* seen, uint8_t code) {
+    uint8_t length = encoded_length[code];
+    if (length == 0 || (seen[code >> 3] & (1 << (code & 7)))) {
+        return;
+    }
+    // Siempre queda lugar para la opción 255
+    if (template->length + length + 1 > DHCP_OPTIONS_SIZE) {
+        return;
+    }
+    seen[code >> 3] |= 1 << (code & 7);
+    memcpy(&template->bytes[template->length], &encoded[encoded_offset[code]], length);
+    if (code == DHCP_OPTION_LEASE_TIME) template->lease_offset = template->length + 2;
+    if (code == DHCP_OPTION_BROADCAST) template->broadcast_offset = template->length + 2;
+    template->length += length;
+}
+
+// Armar la plantilla de una lista de parámetros: tipo, servidor y concesión siempre
+// van primero (RFC 2131), después lo pedido en el orden del cliente
+static void build_template(dhcp_option_template_t* template, const uint8_t* list, int count) {
+    uint8_t seen[32] = {0};
+    template->length = 0;
+    template->lease_offset = -1;
+    template->broadcast_offset = -1;
+
+    append_option(template, seen, DHCP_OPTION_MESSAGE_TYPE);
+    append_option(template, seen, DHCP_OPTION_SERVER_ID);
+    append_option(template, seen, DHCP_OPTION_LEASE_TIME);
+    for (int i = 0; i < count; i++) {
+        append_option(template, seen, list[i]);
+    }
+    template->bytes[template->length++] = DHCP_OPTION_END;
+}
+
+void dhcp_options_compile(const dhcp_options_config_t* config) {
+    dhcp_option_writer_t writer;
+    dhcp_writer_init(&writer, encoded, sizeof(encoded));
+    memset(encoded_length, 0, sizeof(encoded_length));
+
+    // Los valores se codifican igual que lo hacía send_dhcp_options
+    uint8_t message_type = 0;  // Se parchea en cada respuesta
+    uint32_t net_server_ip = htonl(config->server_ip);
+    uint32_t net_lease_time = 0;  // Se parchea en cada respuesta
+    uint32_t net_subnet_mask = htonl(config->subnet_mask);
+    uint32_t net_gateway_ip = htonl(config->gateway_ip);
+    uint32_t net_dns_server_ip = htonl(config->dns_server_ip);
+    uint32_t net_broadcast = 0;   // Depende de la IP del cliente
+
+    encode_option(&writer, DHCP_OPTION_MESSAGE_TYPE, &message_type, 1);
+    encode_option(&writer, DHCP_OPTION_SERVER_ID, &net_server_ip, 4);
+    encode_option(&writer, DHCP_OPTION_LEASE_TIME, &net_lease_time, 4);
+    encode_option(&writer, DHCP_OPTION_SUBNET_MASK, &net_subnet_mask, 4);
+    encode_option(&writer, DHCP_OPTION_ROUTER, &net_gateway_ip, 4);
+    encode_option(&writer, DHCP_OPTION_DNS_SERVER, &net_dns_server_ip, 4);
+    if (config->hostname) {
+        encode_option(&writer, DHCP_OPTION_HOSTNAME, config->hostname, (uint8_t)strlen(config->hostname));
+    }
+    if (config->domain_name) {
+        encode_option(&writer, DHCP_OPTION_DOMAIN_NAME, config->domain_name, (uint8_t)strlen(config->domain_name));
+    }
+    encode_option(&writer, DHCP_OPTION_BROADCAST, &net_broadcast, 4);
+    encode_option(&writer, DHCP_OPTION_NTP_SERVER, &config->ntp_server_ip, 4);
+
+    broadcast_mask = config->subnet_mask;
+    build_template(&default_template, default_list, sizeof(default_list));
+
+    // Las entradas de las cachés con otra generación se rearman en su próximo uso
+    __atomic_add_fetch(&options_generation, 1, __ATOMIC_RELEASE);
+}
+
+// Hash FNV-1a de la lista de parámetros (índice en la caché del hilo)
+static uint32_t hash_parameter_list(const uint8_t* list, uint8_t length) {
+    uint32_t hash = 2166136261u;
+    for (uint8_t i = 0; i < length; i++) {
+        hash = (hash ^ list[i]) * 16777619u;
+    }
+    return hash;
+}
+
+size_t dhcp_options_encode(uint8_t* options, const uint8_t* list, uint8_t list_length, int message_type,
+                           uint32_t assigned_ip, uint32_t lease_time) {
+    const dhcp_option_template_t* template = &default_template;
+    dhcp_option_template_t uncached;
+
+    if (list && list_length <= DHCP_PRL_MAX) {
+        uint32_t generation = __atomic_load_n(&options_generation, __ATOMIC_ACQUIRE);
+        dhcp_prl_entry_t* entry = &prl_cache[hash_parameter_list(list, list_length) & (DHCP_PRL_CACHE_SIZE - 1)];
+        if (entry->generation != generation || entry->list_length != list_length ||
+            memcmp(entry->list, list, list_length) != 0) {
+            build_template(&entry->template, list, list_length);
+            memcpy(entry->list, list, list_length);
+            entry->list_length = list_length;
+            entry->generation = generation;
+        }
+        template = &entry->template;
+    } else if (list) {
+        build_template(&uncached, list, list_length);
+        template = &uncached;
+    }
+
+    // Copiar la plantilla y parchear los campos propios de esta respuesta
+    memcpy(options, template->bytes, template->length);
+    options[2] = (uint8_t)message_type;
+    if (template->lease_offset >= 0) {
+        uint32_t net_lease_time = htonl(lease_time);
+        memcpy(&options[template->lease_offset], &net_lease_time, 4);
+    }
+    if (template->broadcast_offset >= 0) {
+        uint32_t net_broadcast = htonl((assigned_ip & broadcast_mask) | ~broadcast_mask);
+        memcpy(&options[template->broadcast_offset], &net_broadcast, 4);
+    }
+    return template->length;
+}
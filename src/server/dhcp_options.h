@@ -0,0 +1,43 @@
+#ifndef DHCP_OPTIONS_H
+#define DHCP_OPTIONS_H
+
+#include <stdint.h> // Para uint8_t, uint16_t, uint32_t
+#include <stddef.h> // Para size_t
+#include "dhcp_protocol.h" // Códigos de opción y escritor de opciones
+
+#define DHCP_OPTIONS_SIZE 312     // Tamaño del campo de opciones de struct dhcp_packet
+#define DHCP_PRL_CACHE_SIZE 32    // Listas de parámetros (opción 55) cacheadas por hilo (potencia de 2)
+#define DHCP_PRL_MAX 64           // Listas más largas se codifican sin pasar por la caché
+
+// Configuración con la que se codifican las opciones de OFFER y ACK.
+// Las direcciones se guardan tal como las tiene el servidor (mismo orden de bytes).
+typedef struct {
+    uint32_t server_ip;           // Opción 54
+    uint32_t subnet_mask;         // Opción 1 (y base de la 28)
+    uint32_t gateway_ip;          // Opción 3
+    uint32_t dns_server_ip;       // Opción 6
+    uint32_t ntp_server_ip;       // Opción 42 (ya en orden de red)
+    const char* hostname;         // Opción 12
+    const char* domain_name;      // Opción 15
+} dhcp_options_config_t;
+
+// Bloque de opciones ya codificado. Por cliente solo cambian el tipo de mensaje,
+// el tiempo de concesión y la dirección de broadcast, que se parchean en su posición.
+typedef struct {
+    uint8_t bytes[DHCP_OPTIONS_SIZE];  // Opciones terminadas en 255
+    uint16_t length;                   // Bytes usados (incluye el 255)
+    int16_t lease_offset;              // Posición del valor de la opción 51 (-1 si no está)
+    int16_t broadcast_offset;          // Posición del valor de la opción 28 (-1 si no está)
+} dhcp_option_template_t;
+
+// Función para codificar una vez las opciones de la configuración. Invalida las
+// plantillas cacheadas por los hilos; debe llamarse antes de atender paquetes.
+void dhcp_options_compile(const dhcp_options_config_t* config);
+
+// Función para escribir en `options` el bloque de un OFFER o ACK para `assigned_ip`
+// (orden de host). Respeta la lista de parámetros (opción 55) del cliente si la envió;
+// con `list` NULL se envían todas las opciones. Retorna los bytes escritos.
+size_t dhcp_options_encode(uint8_t* options, const uint8_t* list, uint8_t list_length, int message_type,
+                           uint32_t assigned_ip, uint32_t lease_time);
+
+#endif // DHCP_OPTIONS_H
@@ -0,0 +1,342 @@
+#include "dhcp_server.h"
+#include <sched.h>            // Para cpu_set_t, CPU_SET
+#include <linux/filter.h>     // Para sock_filter, sock_fprog
+#include <signal.h>           // Para sigaction, pthread_kill
+
+// Hilos del modo SO_REUSEPORT: cada uno tiene su socket, su tabla de transacciones
+// y su lote de respuestas, y atiende sus paquetes de punta a punta sin pasarlos a otro hilo
+static dhcp_worker_t* reuseport_workers = NULL;
+static int num_reuseport_workers = 0;
+static uint32_t reuseport_groups = 0;       // Sockets del grupo (módulo del programa BPF)
+static int reuseport_steer_by_chaddr = 0;   // Solo se atienden las MACs propias (filtro de copias broadcast)
+static int reuseport_quiesced = 0;          // Hilos detenidos para un relevo, sockets abiertos
+
+dhcp_io_mode_t parse_io_mode(const char* name) {
+    if (!name || strcmp(name, "workers") == 0) {
+        return DHCP_IO_WORKERS;
+    }
+    if (strcmp(name, "reuseport") == 0) {
+        return DHCP_IO_REUSEPORT;
+    }
+    if (strcmp(name, "uring") == 0) {
+        return DHCP_IO_URING;
+    }
+    fprintf(stderr, "Advertencia: Modo de E/S '%s' desconocido, se usa 'workers'.\n", name);
+    return DHCP_IO_WORKERS;
+}
+
+uint32_t steering_hash_mac(const uint8_t* mac) {
+    // Debe coincidir instrucción por instrucción con el programa BPF de attach_chaddr_steering
+    uint32_t high = (uint32_t)mac[0] << 24 | (uint32_t)mac[1] << 16 | (uint32_t)mac[2] << 8 | mac[3];
+    uint32_t low = (uint32_t)mac[4] << 8 | mac[5];
+    uint32_t hash = (high * 0x9e3779b1u + low) * 0x85ebca6bu;
+    return hash ^ (hash >> 16);
+}
+
+int attach_chaddr_steering(int sockfd, int groups) {
+    // El programa ve el datagrama desde el payload UDP: chaddr empieza en el byte 28.
+    // Retorna el índice del socket dentro del grupo (orden de bind).
+    struct sock_filter code[] = {
+        BPF_STMT(BPF_LD | BPF_W | BPF_ABS, 28),               // A = chaddr[0..3]
+        BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, 0x9e3779b1),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),                      // X = A
+        BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 32),               // A = chaddr[4..5]
+        BPF_STMT(BPF_ALU | BPF_ADD | BPF_X, 0),
+        BPF_STMT(BPF_ALU | BPF_MUL | BPF_K, 0x85ebca6b),
+        BPF_STMT(BPF_MISC | BPF_TAX, 0),
+        BPF_STMT(BPF_ALU | BPF_RSH | BPF_K, 16),
+        BPF_STMT(BPF_ALU | BPF_XOR | BPF_X, 0),               // A = hash ^ (hash >> 16)
+        BPF_STMT(BPF_ALU | BPF_MOD | BPF_K, (uint32_t)groups),
+        BPF_STMT(BPF_RET | BPF_A, 0),
+    };
+    struct sock_fprog program = { .len = sizeof(code) / sizeof(code[0]), .filter = code };
+
+    if (setsockopt(sockfd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) < 0) {
+        perror("Error al instalar el programa BPF de reparto por MAC");
+        return -1;
+    }
+    return 0;
+}
+
+// Crear un socket del grupo SO_REUSEPORT y hacer bind en el puerto indicado
+static int create_reuseport_socket(uint16_t port) {
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0) {
+        perror("Error al crear el socket SO_REUSEPORT");
+        return -1;
+    }
+
+    int enable = 1;
+    if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0 ||
+        setsockopt(sockfd, SOL_SOCKET, SO_BROADCAST, &enable, sizeof(enable)) < 0) {
+        perror("Error al configurar el socket SO_REUSEPORT");
+        close(sockfd);
+        return -1;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = INADDR_ANY;  // Escuchar en cualquier interfaz
+    if (bind(sockfd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        perror("Error al hacer bind en el socket SO_REUSEPORT");
+        close(sockfd);
+        return -1;
+    }
+    return sockfd;
+}
+
+// Detener y esperar los hilos [0, started)
+static void halt_reuseport_threads(int started) {
+    // Despertar a cada hilo bloqueado en recvmmsg cerrando la lectura de su socket
+    for (int i = 0; i < started; i++) {
+        __atomic_store_n(&reuseport_workers[i].running, 0, __ATOMIC_RELEASE);
+        shutdown(reuseport_workers[i].sockfd, SHUT_RD);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(reuseport_workers[i].thread_id, NULL);
+    }
+}
+
+// Liberar los recursos de los hilos [0, count) ya detenidos
+static void free_reuseport_workers(int count) {
+    for (int i = 0; i < count; i++) {
+        dhcp_worker_t* worker = &reuseport_workers[i];
+        if (worker->sockfd >= 0) close(worker->sockfd);
+        txn_table_free(&worker->transactions);
+        dhcp_batch_free(&worker->tx);
+    }
+    free(reuseport_workers);
+    reuseport_workers = NULL;
+    num_reuseport_workers = 0;
+}
+
+// Reservar los hilos y preparar la tabla y el lote de cada uno; sockfd queda en -1
+static int alloc_reuseport_workers(int count) {
+    reuseport_workers = (dhcp_worker_t*)calloc(count, sizeof(dhcp_worker_t));
+    if (!reuseport_workers) {
+        perror("Error al asignar memoria para los hilos SO_REUSEPORT");
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        dhcp_worker_t* worker = &reuseport_workers[i];
+        worker->id = i;
+        worker->sockfd = -1;
+        if (txn_table_init(&worker->transactions, transaction_capacity(count)) < 0 ||
+            dhcp_batch_init(&worker->tx, io_batch_size) < 0) {
+            perror("Error al asignar memoria para los hilos SO_REUSEPORT");
+            free_reuseport_workers(count);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Lanzar un hilo por socket, cada uno fijo a un núcleo
+static int launch_reuseport_threads(int count) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+
+    for (int i = 0; i < count; i++) {
+        dhcp_worker_t* worker = &reuseport_workers[i];
+        worker->running = 1;
+        if (pthread_create(&worker->thread_id, NULL, reuseport_loop, worker) != 0) {
+            perror("Error al crear el hilo SO_REUSEPORT");
+            halt_reuseport_threads(i);
+            return -1;
+        }
+
+        // Fijar cada hilo a un núcleo para que su socket, su shard y su caché no migren
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(i % cores, &cpus);
+        if (pthread_setaffinity_np(worker->thread_id, sizeof(cpus), &cpus) != 0) {
+            fprintf(stderr, "Advertencia: No se pudo fijar el hilo %d al núcleo %ld.\n", i, i % cores);
+        }
+    }
+    reuseport_quiesced = 0;
+    return 0;
+}
+
+int start_reuseport_workers(int count, uint16_t port, int steer_by_chaddr) {
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+    if (count <= 0) count = (int)cores;
+
+    if (alloc_reuseport_workers(count) < 0) {
+        return -1;
+    }
+    reuseport_steer_by_chaddr = steer_by_chaddr;
+
+    // Abrir todos los sockets antes de crear los hilos: el índice en el grupo es el orden de bind
+    for (int i = 0; i < count; i++) {
+        dhcp_worker_t* worker = &reuseport_workers[i];
+        worker->sockfd = create_reuseport_socket(port);
+        if (worker->sockfd < 0) {
+            free_reuseport_workers(count);
+            return -1;
+        }
+
+        // Con puerto 0 el primer socket elige uno libre y el resto del grupo lo reutiliza
+        if (port == 0) {
+            struct sockaddr_in addr;
+            socklen_t len = sizeof(addr);
+            getsockname(worker->sockfd, (struct sockaddr*)&addr, &len);
+            port = ntohs(addr.sin_port);
+        }
+    }
+
+    // El programa BPF se comparte en todo el grupo; basta con instalarlo en un socket
+    if (steer_by_chaddr && count > 1 && attach_chaddr_steering(reuseport_workers[0].sockfd, count) < 0) {
+        free_reuseport_workers(count);
+        return -1;
+    }
+
+    reuseport_groups = (uint32_t)count;
+    if (launch_reuseport_threads(count) < 0) {
+        free_reuseport_workers(count);
+        return -1;
+    }
+
+    num_reuseport_workers = count;
+    printf("Modo SO_REUSEPORT: %d sockets en el puerto %u, reparto %s\n",
+           count, port, steer_by_chaddr ? "por MAC (BPF)" : "del kernel");
+    return 0;
+}
+
+int adopt_reuseport_workers(const int* sockets, int count, int steer_by_chaddr) {
+    if (alloc_reuseport_workers(count) < 0) {
+        return -1;
+    }
+    // Los sockets conservan su orden en el grupo y el programa BPF que ya tenían
+    for (int i = 0; i < count; i++) {
+        reuseport_workers[i].sockfd = sockets[i];
+    }
+    reuseport_steer_by_chaddr = steer_by_chaddr;
+    reuseport_groups = (uint32_t)count;
+    if (launch_reuseport_threads(count) < 0) {
+        free_reuseport_workers(count);
+        return -1;
+    }
+    num_reuseport_workers = count;
+    printf("Modo SO_REUSEPORT: %d sockets recibidos del servidor anterior, reparto %s\n",
+           count, steer_by_chaddr ? "por MAC (BPF)" : "del kernel");
+    return 0;
+}
+
+static void interrupt_handler(int signal) {
+    (void)signal;  // Solo interrumpe recvmmsg
+}
+
+int quiesce_reuseport_workers(int* sockets, int max, int* steer_by_chaddr) {
+    if (!reuseport_workers || reuseport_quiesced || num_reuseport_workers > max) return -1;
+
+    // SIGUSR1 sin SA_RESTART saca a cada hilo de recvmmsg con EINTR. No se usa shutdown:
+    // afectaría al socket y no solo a este proceso, y el socket sigue en servicio.
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = interrupt_handler;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGUSR1, &action, NULL);
+
+    for (int i = 0; i < num_reuseport_workers; i++) {
+        __atomic_store_n(&reuseport_workers[i].running, 0, __ATOMIC_RELEASE);
+    }
+    for (int i = 0; i < num_reuseport_workers; i++) {
+        // La señal puede llegar justo antes de que el hilo se bloquee: se repite hasta que sale
+        while (pthread_tryjoin_np(reuseport_workers[i].thread_id, NULL) == EBUSY) {
+            pthread_kill(reuseport_workers[i].thread_id, SIGUSR1);
+            usleep(1000);
+        }
+        sockets[i] = reuseport_workers[i].sockfd;
+    }
+    reuseport_quiesced = 1;
+    *steer_by_chaddr = reuseport_steer_by_chaddr;
+    return num_reuseport_workers;
+}
+
+int resume_reuseport_workers() {
+    if (!reuseport_workers || !reuseport_quiesced) return -1;
+    return launch_reuseport_threads(num_reuseport_workers);
+}
+
+void join_reuseport_workers() {
+    for (int i = 0; i < num_reuseport_workers; i++) {
+        pthread_join(reuseport_workers[i].thread_id, NULL);
+    }
+}
+
+void stop_reuseport_workers() {
+    if (!reuseport_workers) return;
+
+    if (!reuseport_quiesced) {
+        halt_reuseport_threads(num_reuseport_workers);
+    }
+    free_reuseport_workers(num_reuseport_workers);
+}
+
+void* reuseport_loop(void* arg) {
+    dhcp_worker_t* worker = (dhcp_worker_t*)arg;
+    dhcp_msg_batch_t rx;
+    if (dhcp_batch_init(&rx, io_batch_size) < 0) {
+        perror("Error al asignar memoria para el lote de recepción");
+        return NULL;
+    }
+
+    // Las respuestas salen por el mismo socket por el que llegó la solicitud
+    dhcp_tx_attach(&worker->tx, worker->sockfd);
+    dhcp_trace_enable_timestamps(worker->sockfd);
+
+    while (__atomic_load_n(&worker->running, __ATOMIC_ACQUIRE)) {
+        // Lo recibido se atiende aunque se haya pedido detener: en un relevo el socket sigue
+        // en servicio y lo que este hilo ya sacó de su cola no le llegaría a nadie más
+        int received = receive_dhcp_batch(worker->sockfd, &rx, MSG_WAITFORONE);
+        if (received < 0) {
+            if (errno != EINTR) {
+                perror("Error al recibir datos del cliente");
+            }
+            continue;
+        }
+
+        // Con la traza activa se anota cuándo se leyó el lote (la espera del lote es la etapa QUEUE)
+        uint64_t rx_ns = dhcp_trace_start();
+        uint64_t realtime = 0;
+        if (rx_ns && dhcp_trace_kernel_timestamps) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            realtime = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+        }
+
+        for (int i = 0; i < received; i++) {
+            struct dhcp_packet* request = (struct dhcp_packet*)rx.buffers[i];
+            size_t length = rx.msgs[i].msg_len;
+
+            // Solo el encabezado: las opciones las indexa el hilo que atiende la MAC
+            if (!validate_dhcp_packet(request, length, NULL)) {
+                dhcp_log_warn("Error: Paquete DHCP inválido de " DHCP_IP_FMT ".\n", DHCP_IP_ARGS(ntohl(rx.addrs[i].sin_addr.s_addr)));
+                dhcp_stat_inc(DHCP_STAT_RX_INVALID);
+                continue;
+            }
+
+            // Los broadcast llegan a todos los sockets del grupo: solo responde el dueño de la MAC
+            if (reuseport_steer_by_chaddr &&
+                steering_hash_mac(request->chaddr) % reuseport_groups != (uint32_t)worker->id) {
+                worker->dropped++;  // Copia ajena descartada
+                dhcp_stat_inc(DHCP_STAT_DROP_NOT_OWNER);
+                continue;
+            }
+
+            if (rx_ns) {
+                dhcp_trace_received(rx_ns, realtime ? dhcp_batch_kernel_delay(&rx, i, realtime) : 0);
+            }
+            process_dhcp_packet(worker, &rx.addrs[i], request, length);
+            worker->processed++;
+        }
+        dhcp_tx_flush(&worker->tx);
+    }
+
+    dhcp_tx_attach(NULL, -1);
+    dhcp_batch_free(&rx);
+    return NULL;
+}
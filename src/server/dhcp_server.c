@@ -3,37 +3,102 @@
 // Definicion de Variables globales
 int server_socket;                 // Socket del servidor
 int default_lease_time = 30;       // Tiempo de concesión predeterminado en segundos
-ip_assignment_node_t* ip_assignment_root = NULL; // Raíz del árbol de asignaciones de IPs
 int client_id_counter = 1;         // Contador global para IDs de cliente
 ip_range_t global_ip_range;        // Rango global de IPs
+ip_range_t* ip_shards = NULL;      // Shards del pool, cada uno con su propio lock
+int num_ip_shards = 0;             // Número de shards del pool
+uint32_t ip_shard_span = 0;        // Direcciones por shard (el último recibe el resto)
+uint32_t address_cache_size = ADDR_CACHE_DEFAULT;  // Reservas por worker (DHCP_ADDR_CACHE)
+uint32_t lease_ghost_limit = LEASE_GHOSTS_DEFAULT;  // Leases terminados por shard (DHCP_LEASE_GHOSTS)
+int sticky_leases = 1;             // Devolver su IP a las MACs conocidas (DHCP_STICKY_LEASES)
+uint32_t offer_ttl_ms = OFFER_TTL_DEFAULT_MS;  // Vida de una oferta sin REQUEST (DHCP_OFFER_TTL_MS)
+uint32_t decline_quarantine_s = DECLINE_QUARANTINE_DEFAULT_S;  // Cuarentena de una IP rechazada (DHCP_DECLINE_QUARANTINE_S)
 uint32_t subnet_mask;
 uint32_t gateway_ip;
 uint32_t dns_server_ip;
 uint32_t server_ip;
 const char* dhcp_server_ip = "172.19.2.228";  // IP del servidor DHCP
-static uint32_t last_assigned_ip = 0;
+time_t server_start_time;          // Momento de arranque del servidor
+int handoff_fd = -1;               // Socket Unix en el que se espera un relevo (DHCP_HANDOFF_SOCKET)
+static dhcp_io_mode_t server_io_mode = DHCP_IO_WORKERS;  // Modo de recepción en uso
+static int handed_off = 0;         // El servicio ya pasó a un proceso nuevo
 
-const char* colors[] = {
-    "\033[31m", // Rojo
-    "\033[32m", // Verde
-    "\033[33m", // Amarillo
-    "\033[34m", // Azul
-    "\033[35m", // Magenta
-    "\033[36m", // Cian
-};
+// Mutexes para proteger el acceso a las variables globales
+dhcp_mutex_t client_id_mutex = DHCP_MUTEX_INITIALIZER("client_id_mutex");
+
+// Codificar las opciones con la configuración actual (una sola vez, antes del primer paquete)
+static pthread_once_t options_once = PTHREAD_ONCE_INIT;
+static void compile_server_options() {
+    dhcp_options_config_t config = {
+        .server_ip = server_ip,
+        .subnet_mask = subnet_mask,
+        .gateway_ip = gateway_ip,
+        .dns_server_ip = dns_server_ip,
+        .ntp_server_ip = inet_addr("192.168.1.2"),
+        .hostname = "DHCPClient",
+        .domain_name = "example.com",
+    };
+    dhcp_options_compile(&config);
+}
 
-const char* reset_color = "\033[0m";  // Restablecer el color de la consola
+// Funciones para el servidor DHCP
+// Crear el socket UDP del servidor en el puerto 67 (-1 si falla)
+static int open_server_socket() {
+    struct sockaddr_in server_addr, relay_addr;
 
-// Mutexes para proteger el acceso a las variables globales
-pthread_mutex_t ip_assignment_mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t client_id_mutex = PTHREAD_MUTEX_INITIALIZER;
+    // Crear el socket UDP del servidor
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0) {
+        perror("Error al crear el socket del servidor");
+        return -1;
+    }
+    printf("Socket del servidor creado exitosamente.\n");
 
-// Definicion de la tabla de hash para los hilos de los clientes
-client_thread_info_t* client_threads[HASH_TABLE_SIZE] = {NULL}; // Inicializar la tabla en NULL
+    // Configurar el socket para recibir paquetes de broadcast
+    int broadcast_enable = 1;
+    if (setsockopt(sockfd, SOL_SOCKET, SO_BROADCAST, &broadcast_enable, sizeof(broadcast_enable)) < 0) {
+        perror("Error al configurar el socket del servidor para broadcast");
+        close(sockfd);
+        return -1;
+    }
+
+    // Configurar la dirección del servidor
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(DHCP_SERVER_PORT);
+    server_addr.sin_addr.s_addr = INADDR_ANY;  // Escuchar en cualquier interfaz
+    
+    // Bind del socket del servidor
+    if (bind(sockfd, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        perror("Error al hacer bind en el socket del servidor");
+        close(sockfd);
+        return -1;
+    }
+    
+    //  Configurar la dirección del relay
+    memset(&relay_addr, 0, sizeof(relay_addr));
+    relay_addr.sin_family = AF_INET;
+    relay_addr.sin_addr.s_addr = INADDR_ANY;  // Escuchar en cualquier interfaz
+    relay_addr.sin_port = 68;  // Puerto del relay (67 o 68)
+    return sockfd;
+}
+
+// Crear el segmento de estadísticas (DHCP_STATS_SHM) con el pool ya listo y antes de lanzar
+// los hilos. En un relevo se crea después de tomar el servicio: si el relevo falla, el nombre
+// sigue siendo del servidor anterior.
+static void open_stats_segment() {
+    if (dhcp_stats_open(getenv("DHCP_STATS_SHM")) < 0) {
+        fprintf(stderr, "Advertencia: Sin segmento de estadísticas, los contadores no se publican.\n");
+        return;
+    }
+    uint64_t used = 0;
+    for (int i = 0; i < num_ip_shards; i++) {
+        used += ip_shards[i].leases.count;
+    }
+    dhcp_stats_set_pool((uint64_t)global_ip_range.end_ip - global_ip_range.start_ip + 1, used);
+}
 
-// Funciones para el servidor DHCP
 void init_dhcp_server(ip_range_t* range) {  // Inicializar el servidor DHCP
-    struct sockaddr_in server_addr, relay_addr;
 
     /// Inicializar las variables IP desde variables de entorno
     const char *subnet_mask_env = getenv("SUBNET_MASK");
@@ -62,379 +127,413 @@ void init_dhcp_server(ip_range_t* range) {  // Inicializar el servidor DHCP
     }
     
     global_ip_range = *range;
-    pthread_mutex_init(&ip_assignment_mutex, NULL);
-    pthread_mutex_init(&client_id_mutex, NULL);
+    dhcp_mutex_init(&client_id_mutex, "client_id_mutex");
 
-    // Crear el socket UDP del servidor
-    server_socket = socket(AF_INET, SOCK_DGRAM, 0);
-    if (server_socket < 0) {
-        perror("Error al crear el socket del servidor");
-        cleanup();
-        exit(EXIT_FAILURE);
+    // Plantillas de opciones con la configuración recién leída
+    pthread_once(&options_once, compile_server_options);
+
+    // Tamaño de los lotes de recvmmsg/sendmmsg (DHCP_BATCH_SIZE, 1 = una llamada por paquete)
+    io_batch_size = parse_batch_size(getenv("DHCP_BATCH_SIZE"));
+    server_start_time = time(NULL);
+
+    // Perfil de contención de los locks (DHCP_LOCK_PROFILE=on), antes de que arranquen los hilos
+    dhcp_lock_configure(getenv("DHCP_LOCK_PROFILE"));
+
+    // Nivel de log (DHCP_LOG_LEVEL); el formateo y la escritura los hace un hilo aparte
+    dhcp_log_level = parse_log_level(getenv("DHCP_LOG_LEVEL"));
+    if (dhcp_log_start() < 0) {
+        fprintf(stderr, "Advertencia: Sin hilo de log, los mensajes se escriben en el momento.\n");
     }
-    printf("Socket del servidor creado exitosamente.\n");
 
-    // Configurar el socket para recibir paquetes de broadcast
-    int broadcast_enable = 1;
-    if (setsockopt(server_socket, SOL_SOCKET, SO_BROADCAST, &broadcast_enable, sizeof(broadcast_enable)) < 0) {
-        perror("Error al configurar el socket del servidor para broadcast");
-        cleanup();
-        exit(EXIT_FAILURE);
+    // Latencia por etapa (DHCP_TRACE=on, o kernel para medir también la cola del socket)
+    dhcp_trace_configure(getenv("DHCP_TRACE"));
+
+    // Modo de recepción (DHCP_IO_MODE): pool de workers, un socket SO_REUSEPORT por núcleo o io_uring
+    dhcp_io_mode_t io_mode = parse_io_mode(getenv("DHCP_IO_MODE"));
+    server_io_mode = io_mode;
+    if (io_mode == DHCP_IO_REUSEPORT) {
+        run_reuseport_server();
+        return;
     }
 
-    // Configurar la dirección del servidor
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(DHCP_SERVER_PORT);
-    server_addr.sin_addr.s_addr = INADDR_ANY;  // Escuchar en cualquier interfaz
-    
-    // Bind del socket del servidor
-    if (bind(server_socket, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
-        perror("Error al hacer bind en el socket del servidor");
+    // Relevo: tomar el socket y los leases de un servidor en marcha (DHCP_HANDOFF_SOCKET)
+    int taken = 0;
+    if (io_mode == DHCP_IO_WORKERS) {
+        taken = take_over_server(&server_socket, 1, NULL);
+    } else if (getenv("DHCP_HANDOFF_SOCKET")) {
+        fprintf(stderr, "Advertencia: El relevo no está disponible con DHCP_IO_MODE=uring.\n");
+    }
+    if (taken < 0) {
         cleanup();
         exit(EXIT_FAILURE);
     }
-    
-    //  Configurar la dirección del relay
-    memset(&relay_addr, 0, sizeof(relay_addr));
-    relay_addr.sin_family = AF_INET;
-    relay_addr.sin_addr.s_addr = INADDR_ANY;  // Escuchar en cualquier interfaz
-    relay_addr.sin_port = 68;  // Puerto del relay (67 o 68)
 
-    // Configurar timeout en el socket
-    struct timeval timeout;
-    timeout.tv_sec = 120;  // Tiempo de espera de 5 segundos
-    timeout.tv_usec = 0;
+    // Sin relevo: socket propio y leases restaurados del disco (con un solo socket de
+    // entrada el pool completo es un único shard)
+    if (taken == 0) {
+        server_socket = open_server_socket();
+        if (server_socket < 0 || split_ip_pool(&global_ip_range, 1) < 0 || open_lease_journal() < 0) {
+            cleanup();
+            exit(EXIT_FAILURE);
+        }
+    }
+    open_stats_segment();
+
+    // Backend io_uring (DHCP_URING_SQPOLL=1 activa SQPOLL); sin soporte del kernel se usa el de sockets
+    if (io_mode == DHCP_IO_URING) {
+        const char *sqpoll_env = getenv("DHCP_URING_SQPOLL");
+        if (run_uring_server(server_socket, sqpoll_env && atoi(sqpoll_env) > 0) == 0) {
+            return;
+        }
+        fprintf(stderr, "Advertencia: io_uring no disponible, se usa el bucle de sockets.\n");
+        server_io_mode = DHCP_IO_WORKERS;
+    }
 
-    if (setsockopt(server_socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
-        perror("Error al establecer el tiempo de espera para el socket del servidor");
+    // Direcciones que cada worker reserva de a lote del pool compartido (DHCP_ADDR_CACHE, 0 = ninguna)
+    const char *cache_env = getenv("DHCP_ADDR_CACHE");
+    if (cache_env) {
+        address_cache_size = (uint32_t)strtoul(cache_env, NULL, 10);
+    }
+
+    // Iniciar el pool fijo de workers (DHCP_WORKERS, por defecto un worker por núcleo)
+    const char *workers_env = getenv("DHCP_WORKERS");
+    int worker_count = workers_env ? atoi(workers_env) : 0;
+    if (start_worker_pool(server_socket, worker_count) < 0) {
+        fprintf(stderr, "Error: No se pudo iniciar el pool de workers.\n");
         cleanup();
         exit(EXIT_FAILURE);
     }
 
-    printf("Servidor DHCP iniciado en el puerto %d\n", DHCP_SERVER_PORT);
+    printf("Servidor DHCP iniciado en el puerto %d con %d workers (lotes de %d paquetes)\n",
+           DHCP_SERVER_PORT, num_workers, io_batch_size);
+    start_handoff_listener();
 
-    // A partir de aquí, el servidor podría empezar a escuchar las solicitudes de los clientes.
+    // Bucle de eventos: socket, vencimiento de leases (timerfd), señales y despertares
     handle_dhcp_protocol(server_socket);
 }
 
-void handle_dhcp_protocol(int sockfd) {
-    struct sockaddr_in client_addr;
-    uint8_t buffer[BUFFER_SIZE];  // Buffer para recibir los datos
-    socklen_t addr_len = sizeof(client_addr);
-    struct dhcp_packet* request;
-
-    while (1) {
-        check_expired_leases(ip_assignment_root);
-
-        // Esperar y recibir una solicitud DHCP
-        ssize_t message = recvfrom(sockfd, buffer, BUFFER_SIZE, 0, 
-                                          (struct sockaddr*)&client_addr, &addr_len);
-        if (message < 0) {
-            perror("Error al recibir datos del cliente");
-            sleep(1);  // Evitar un ciclo rápido de errores
-            continue;
-        }
+void run_reuseport_server() {
+    server_socket = -1;  // En este modo cada hilo tiene su propio socket
 
-        // Crear una estructura DHCP para el paquete recibido
-        request = (struct dhcp_packet *)buffer;
+    // Un hilo, un socket y un shard del pool por núcleo (DHCP_WORKERS cambia la cantidad)
+    const char *workers_env = getenv("DHCP_WORKERS");
+    int thread_count = workers_env ? atoi(workers_env) : 0;
+    if (thread_count <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = cores > 0 ? (int)cores : 1;
+    }
 
-        // Copiar los datos del buffer a la estructura DHCP (ajustar según lo necesario)
-        memcpy(request, buffer, message);
+    // Reparto entre sockets (DHCP_STEERING): "chaddr" (BPF por MAC) o "kernel" (hash de 4-tupla)
+    const char *steering_env = getenv("DHCP_STEERING");
+    int steer_by_chaddr = !steering_env || strcmp(steering_env, "kernel") != 0;
 
-        // Validar el paquete DHCP recibido
-        if (!validate_dhcp_packet(request)) {
-            fprintf(stderr, "Error: Paquete DHCP inválido de %s.\n", inet_ntoa(client_addr.sin_addr));
-            continue;
+    // Relevo: los sockets del grupo (con su programa BPF) y los shards vienen del servidor
+    // en marcha, así que la cantidad de hilos la fija el relevo
+    int sockets[HANDOFF_MAX_FDS / 2];
+    int taken = take_over_server(sockets, HANDOFF_MAX_FDS / 2, &steer_by_chaddr);
+    if (taken < 0) {
+        cleanup();
+        exit(EXIT_FAILURE);
+    }
+    if (taken > 0) {
+        thread_count = taken;
+        open_stats_segment();
+        if (adopt_reuseport_workers(sockets, taken, steer_by_chaddr) < 0) {
+            fprintf(stderr, "Error: No se pudieron iniciar los hilos SO_REUSEPORT.\n");
+            cleanup();
+            exit(EXIT_FAILURE);
         }
-
-        // Verificar si ya existe un hilo manejando este cliente (chaddr)
-        client_thread_info_t* existing_thread = find_client_thread(request->chaddr);
-
-        if (existing_thread != NULL) {
-            printf("Reenviando solicitud DHCP al hilo existente para el cliente %02x:%02x:%02x:%02x:%02x:%02x\n",
-                   request->chaddr[0], request->chaddr[1], request->chaddr[2],
-                   request->chaddr[3], request->chaddr[4], request->chaddr[5]);
-
-            // Configurar la estructura del mensaje DHCP antes de enviarlo
-            dhcp_message_t msg;
-            msg.mtype = 1;  // Puedes usar cualquier identificador válido para el tipo de mensaje
-            memcpy(msg.buffer, request, message);  // Copiar los datos DHCP al buffer
-            printf("Se copia bien los datos DHCP al buffer\n");
-            msg.length = sizeof(msg.buffer);  // Establecer el tamaño real del mensaje recibido
-
-            // Enviar el mensaje a la cola del hilo correspondiente
-            if (msgsnd(existing_thread->client_info->message_queue_id, (void * ) &msg, msg.length, 0) == -1) {
-                perror("Error al enviar mensaje a la cola del hilo del cliente");
-                // Agregar mensaje de error para seguimiento
-                fprintf(stderr, "Error al enviar el mensaje de cliente MAC: %02x:%02x:%02x:%02x:%02x:%02x\n",
-                    request->chaddr[0], request->chaddr[1], request->chaddr[2],
-                    request->chaddr[3], request->chaddr[4], request->chaddr[5]);
-                continue;
-            }
-            printf("Enviado correctamente a la cola del hilo del cliente\n");
-            continue;
+    } else {
+        if (split_ip_pool(&global_ip_range, thread_count) < 0) {
+            fprintf(stderr, "Error: No se pudo preparar el pool de IPs por núcleo.\n");
+            cleanup();
+            exit(EXIT_FAILURE);
         }
-
-        // Validar si es un paquete DISCOVER (opción 53, tipo de mensaje DHCP)
-        uint8_t* message_type = find_dhcp_option(request->options, 53);
-        if (!message_type) {
-            fprintf(stderr, "Error: No se encontró la opción de tipo de mensaje DHCP.\n");
-            continue;
+        if (open_lease_journal() < 0) {
+            cleanup();
+            exit(EXIT_FAILURE);
         }
+        open_stats_segment();
 
-        if (message_type && *message_type == DHCP_DISCOVER) {
-            printf("Solicitud DHCP DISCOVER recibida de %s\n", inet_ntoa(client_addr.sin_addr));
-
-            // Crear una estructura client_info_t para el nuevo hilo
-            client_info_t* client_info = (client_info_t*)malloc(sizeof(client_info_t));
-            if (!client_info) {
-                perror("Error al asignar memoria para el cliente");
-                continue;
-            }
-            client_info->client_socket = sockfd;
-            client_info->client_addr = client_addr;
-            pthread_mutex_lock(&client_id_mutex);
-            client_info->client_id = client_id_counter++;
-            pthread_mutex_unlock(&client_id_mutex);
-            client_info->color = colors[client_info->client_id % 6];
-            client_info->message_queue_id = msgget(IPC_PRIVATE, IPC_CREAT | 0666);  // Crear cola de mensajes privada
-            if (client_info->message_queue_id == -1) {
-                perror("Error al crear la cola de mensajes");
-                free(client_info);
-                continue;
-            }
-
-            memcpy(&client_info->initial_request, request, sizeof(struct dhcp_packet));  // Copiar el paquete inicial
-
-            // Crear un hilo para manejar el cliente
-            pthread_t thread_id;
-            if (pthread_create(&thread_id, NULL, client_handler, (void*)client_info) != 0) {
-                perror("Error al crear el hilo para el cliente");
-                free(client_info);
-                continue;
-            }
-
-            // Agregar el hilo a la lista de hilos de clientes
-            add_client_thread(request->chaddr, thread_id, client_info);
-            // Detach del hilo para que se libere automáticamente cuando termine
-            pthread_detach(thread_id);
-        } else {
-            fprintf(stderr, "Error: Paquete DHCP no reconocido.\n");
+        if (start_reuseport_workers(thread_count, DHCP_SERVER_PORT, steer_by_chaddr) < 0) {
+            fprintf(stderr, "Error: No se pudieron iniciar los hilos SO_REUSEPORT.\n");
+            cleanup();
+            exit(EXIT_FAILURE);
         }
     }
-}
 
-void* client_handler(void* client_info) {
-    client_info_t* info = (client_info_t*)client_info;
-    struct sockaddr_in client_addr = info->client_addr;
-    int sockfd = info->client_socket;
-    struct dhcp_packet request;
-    dhcp_message_t msg;
-    long msgtyp = 0;
+    printf("Servidor DHCP iniciado en el puerto %d con %d hilos SO_REUSEPORT (lotes de %d paquetes)\n",
+           DHCP_SERVER_PORT, thread_count, io_batch_size);
+    start_handoff_listener();
 
-    // Imprimir el ID del hilo con el color asignado
-    printf("%sID del hilo: %p asignado al cliente %d\n%s", info->color, (void*)pthread_self(), info->client_id, reset_color);
+    // Los hilos atienden los paquetes; el bucle de eventos solo vence leases y atiende señales
+    handle_dhcp_protocol(-1);
+    stop_reuseport_workers();
+}
 
-    // Manejo inicial: procesar el DHCP DISCOVER recibido
-    printf("Procesando DHCP DISCOVER inicial del cliente.\n");
-    handle_dhcp_discover(sockfd, &client_addr, &info->initial_request);  // Procesar DISCOVER
+void process_received_packet(dhcp_packet_desc_t* desc) {
+    // El paquete se valida en su slot, sin copiarlo
+    struct dhcp_packet* request = (struct dhcp_packet *)desc->data;
 
-    int ack_sent = 0;  // Bandera para verificar si se ha enviado un ACK
-    int done = 0;      // Bandera para finalizar el ciclo del cliente
-    
-    while (done < 1) {
-        // Recibir un mensaje de la cola (bloquea hasta recibir una solicitud)
-        if (msgrcv(info->message_queue_id, (void *) &msg, sizeof(msg.buffer), msgtyp, MSG_NOERROR | IPC_NOWAIT) == -1) {
-            continue;
-        }
-        // Verificar que el tamaño del mensaje sea válido
-        if (sizeof(msg.buffer) > BUFFER_SIZE) {
-            fprintf(stderr, "Error: Tamaño del mensaje excede el tamaño del paquete DHCP (%u bytes).\n", BUFFER_SIZE);
-            continue;
-        }
-
-        // Copiar el contenido del mensaje en el paquete DHCP
-        memcpy(&request, msg.buffer, sizeof(msg.buffer));
-        // Validar el tipo de solicitud DHCP (opción 53) y procesar según el tipo
-        uint8_t* message_type = find_dhcp_option(request.options, 53);
-        if (message_type) {
-            switch (*message_type) {
-                case DHCP_DISCOVER:
-                    printf("Solicitud DHCP DISCOVER recibida nuevamente.\n");
-                    handle_dhcp_discover(sockfd, &client_addr, &request);
-                    break;
-
-                case DHCP_REQUEST:
-                    if (ack_sent) {
-                        // El cliente está solicitando renovar su lease
-                        printf("Solicitud DHCP REQUEST de renovación recibida. Renovando lease.\n");
-                        uint32_t requested_ip = ntohl(request.ciaddr);  // IP solicitada
-                        ip_assignment_node_t* assignment = find_ip_assignment(ip_assignment_root, requested_ip);
-                        if (assignment != NULL && memcmp(assignment->mac, request.chaddr, 6) == 0) {
-                            printf("Renovando el lease para la IP %s\n", int_to_ip(requested_ip));
-                            assignment->lease_start = time(NULL);  // Reiniciar lease time
-                        } else {
-                            printf("Error: No se pudo renovar el lease para la IP %s\n", int_to_ip(requested_ip));
-                        }
-                    } else {
-                        printf("Solicitud DHCP REQUEST recibida.\n");
-                        handle_dhcp_request(sockfd, &client_addr, &request);
-                        ack_sent = 1;  // Se ha enviado un ACK inicial
-                    }
-                    break;
-
-                case DHCP_DECLINE:
-                    printf("Solicitud DHCP DECLINE recibida. Cerrando conexión.\n");
-                    handle_dhcp_decline(sockfd, &client_addr, &request);
-                    done = 1;  // Terminar el ciclo
-                    break;
-
-                case DHCP_RELEASE:
-                    printf("Solicitud DHCP RELEASE recibida. Cerrando conexión.\n");
-                    handle_dhcp_release(sockfd, &client_addr, &request);
-                    done = 1;  // Terminar el ciclo
-                    break;
-
-                default:
-                    printf("Solicitud DHCP no reconocida.\n");
-                    break;
-            }
-        } else {
-            printf("Solicitud DHCP sin tipo válido.\n");
-        }
+    // Validar el encabezado (las opciones las indexa el worker que atiende la MAC)
+    if (!validate_dhcp_packet(request, desc->length, NULL)) {
+        dhcp_log_warn("Error: Paquete DHCP inválido de " DHCP_IP_FMT ".\n", DHCP_IP_ARGS(ntohl(desc->client_addr.sin_addr.s_addr)));
+        dhcp_stat_inc(DHCP_STAT_RX_INVALID);
+        packet_ring_release(&worker_packet_ring, desc->slot);
+        return;
     }
 
-    // Eliminar la cola de mensajes del cliente y liberar la memoria
-    msgctl(info->message_queue_id, IPC_RMID, NULL);
-    printf("%sCliente %d desconectado. Cerrando hilo...\n%s", info->color, info->client_id, reset_color);
-    free(client_info);  // Liberar la memoria del cliente
-    pthread_exit(NULL);  // Terminar el hilo correctamente
-    return NULL;  // Terminar el hilo correctamente
+    // Encolar el descriptor en el worker que atiende la MAC del cliente
+    if (enqueue_dhcp_packet(desc) < 0) {
+        dhcp_log_warn("Error: Cola del worker llena, se descarta el paquete del cliente " DHCP_MAC_FMT "\n",
+                      DHCP_MAC_ARGS(request->chaddr));
+        packet_ring_release(&worker_packet_ring, desc->slot);
+    }
 }
 
 // Valida un paquete DHCP
-int validate_dhcp_packet(struct dhcp_packet* packet) {
-    if (!packet) {
-        fprintf(stderr, "Error: Paquete DHCP nulo.\n");
+int validate_dhcp_packet(struct dhcp_packet* packet, size_t length, dhcp_option_index_t* options) {
+    if (!packet || length < DHCP_HEADER_SIZE) {
+        dhcp_log_warn("Error: Paquete DHCP nulo o más corto que el encabezado.\n");
         return 0;
     }
     
     // Validar el tipo de hardware y la longitud de la dirección de hardware (para Ethernet y MAC de 6 bytes)
     if (packet->hlen != 6 || packet->htype != 1) {
-        fprintf(stderr, "Error: Paquete DHCP inválido (Tipo de hardware o longitud de dirección incorrectos).\n");
+        dhcp_log_warn("Error: Paquete DHCP inválido (Tipo de hardware o longitud de dirección incorrectos).\n");
+        return 0;
+    }
+
+    if (!options) {
+        return 1;  // Solo se pidió validar el encabezado
+    }
+
+    // Indexar las opciones sin salir de los `length` bytes recibidos
+    if (dhcp_parse_options(options, (const uint8_t*)packet, length) < 0) {
+        dhcp_log_warn("Error: Opciones DHCP mal formadas. XID: %u\n", packet->xid);
         return 0;
     }
 
     // Validar que el paquete tenga un tipo de mensaje DHCP válido (opción 53)
-    uint8_t* message_type = find_dhcp_option(packet->options, 53);  // Buscar directamente la opción 53 en el array fijo de opciones
-    if (!message_type) {
-        fprintf(stderr, "Error: Paquete DHCP sin tipo de mensaje. XID: %u, MAC: %02x:%02x:%02x:%02x:%02x:%02x\n",
-                packet->xid,
-                packet->chaddr[0], packet->chaddr[1], packet->chaddr[2],
-                packet->chaddr[3], packet->chaddr[4], packet->chaddr[5]);
+    uint8_t message_type;
+    if (!dhcp_get_message_type(options, &message_type)) {
+        dhcp_log_warn("Error: Paquete DHCP sin tipo de mensaje. XID: %u, MAC: " DHCP_MAC_FMT "\n",
+                      packet->xid, DHCP_MAC_ARGS(packet->chaddr));
         return 0;
     }
 
     return 1;  // Paquete válido
 }
 
-void handle_dhcp_discover(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request) {
+uint32_t handle_dhcp_discover(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request, const dhcp_option_index_t* options) {
     // Validar que el paquete sea un DISCOVER, por seguridad
-    uint8_t* message_type = find_dhcp_option(request->options, 53);
-    if (!message_type || *message_type != DHCP_DISCOVER) {
-        printf("Error: El paquete no es un DISCOVER.\n");
-        return;
+    uint8_t message_type;
+    if (!dhcp_get_message_type(options, &message_type) || message_type != DHCP_DISCOVER) {
+        dhcp_log_warn("Error: El paquete no es un DISCOVER.\n");
+        return 0;
+    }
+    // Asignar una dirección IP al cliente desde el shard de su MAC
+    uint64_t traced = dhcp_trace_start();
+    ip_range_t* home = shard_for_mac(request->chaddr);
+    uint32_t assigned_ip = assign_ip_address(home, request, options);
+
+    // Si el shard propio se quedó sin direcciones, tomar una de otro shard
+    for (int i = 0; assigned_ip == 0 && i < num_ip_shards; i++) {
+        if (&ip_shards[i] != home) {
+            assigned_ip = assign_ip_address(&ip_shards[i], request, options);
+        }
     }
-    // Asignar una dirección IP al cliente
-    uint32_t assigned_ip = assign_ip_address(&global_ip_range, request);  // Usa el rango global de IPs
+    dhcp_trace_end(DHCP_TRACE_ALLOC, traced);
     if (assigned_ip == 0) {
         // No se pudo asignar una IP, imprime la dirección MAC del cliente
-        printf("No se pudo asignar una dirección IP para el cliente con MAC: %02x:%02x:%02x:%02x:%02x:%02x\n",
-               request->chaddr[0], request->chaddr[1], request->chaddr[2],
-               request->chaddr[3], request->chaddr[4], request->chaddr[5]);
+        dhcp_log_warn("No se pudo asignar una dirección IP para el cliente con MAC: " DHCP_MAC_FMT "\n",
+                      DHCP_MAC_ARGS(request->chaddr));
+        dhcp_stat_inc(DHCP_STAT_NAK_POOL_EXHAUSTED);
         send_dhcp_nak(sockfd, client_addr, request);
-        return;
+        return 0;
     }
 
     // Enviar la oferta DHCP OFFER al cliente
-    send_dhcp_offer(sockfd, client_addr, request, assigned_ip);
+    send_dhcp_offer(sockfd, client_addr, request, options, assigned_ip);
+    return assigned_ip;
 }
 
-void handle_dhcp_request(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request) {
+int handle_dhcp_request(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request, const dhcp_option_index_t* options) {
     // Obtener la IP solicitada desde la opción 50 o ciaddr
-    uint8_t* requested_ip_option = find_dhcp_option(request->options, 50);
     uint32_t requested_ip = 0;
-    if (requested_ip_option) {
-        requested_ip = ntohl(*(uint32_t*)requested_ip_option);  // Convertir a formato de host
+    if (dhcp_get_requested_ip(options, &requested_ip)) {
+        requested_ip = ntohl(requested_ip);  // Convertir a formato de host
     } else if (request->ciaddr != 0) {
         requested_ip = ntohl(request->ciaddr);  // Usar ciaddr si no se encuentra la opción 50 y ciaddr no es 0
     } else {
-        printf("Error: No se especificó ninguna IP solicitada.\n");
+        dhcp_log_info("Error: No se especificó ninguna IP solicitada.\n");
+        dhcp_stat_inc(DHCP_STAT_NAK_NO_ADDRESS);
         send_dhcp_nak(sockfd, client_addr, request);
-        return;
+        return 0;
+    }
+
+    // Un cliente que pide otra IP que la ofrecida eligió otra oferta: la suya vuelve al pool
+    ip_range_t* shard = shard_for_ip(requested_ip);
+    ip_range_t* home = shard_for_mac(request->chaddr);
+    if (offer_ttl_ms > 0 && home != shard) {
+        dhcp_mutex_lock(&home->lock);
+        withdraw_offer(home, request->chaddr, requested_ip);
+        dhcp_mutex_unlock(&home->lock);
     }
 
     // Verificar si la IP solicitada está dentro del rango
     if (requested_ip < global_ip_range.start_ip || requested_ip > global_ip_range.end_ip) {
-        printf("La IP solicitada %s por el cliente con MAC %02x:%02x:%02x:%02x:%02x:%02x está fuera del rango.\n",
-               int_to_ip(requested_ip),
-               request->chaddr[0], request->chaddr[1], request->chaddr[2],
-               request->chaddr[3], request->chaddr[4], request->chaddr[5]);
+        dhcp_log_info("La IP solicitada " DHCP_IP_FMT " por el cliente con MAC " DHCP_MAC_FMT " está fuera del rango.\n",
+                      DHCP_IP_ARGS(requested_ip), DHCP_MAC_ARGS(request->chaddr));
+        dhcp_stat_inc(DHCP_STAT_NAK_OUT_OF_RANGE);
         send_dhcp_nak(sockfd, client_addr, request);  // Enviar NAK si la IP está fuera del rango
-        return;
+        return 0;
     }
 
-    // Buscar la IP en el árbol de asignaciones para ver si está disponible
-    ip_assignment_node_t* assignment = find_ip_assignment(ip_assignment_root, requested_ip);
+    // Buscar la IP en el almacén del shard que la contiene para ver si está disponible
+    uint64_t traced = dhcp_trace_start();
+    dhcp_mutex_lock(&shard->lock);
+    if (offer_ttl_ms > 0 && home == shard) {
+        withdraw_offer(shard, request->chaddr, requested_ip);
+    }
+    ip_assignment_t* assignment = find_ip_assignment(shard, requested_ip);
     if (assignment != NULL && memcmp(assignment->mac, request->chaddr, 6) == 0) {
-        // El cliente está solicitando su propia IP, enviar ACK
-        printf("El cliente está solicitando su propia IP %s. Enviando ACK.\n", int_to_ip(requested_ip));
-        send_dhcp_ack(sockfd, client_addr, request, requested_ip);
-        return;
+        // El cliente está solicitando su propia IP (selección o renovación), renovar y enviar ACK
+        int renewed = renew_ip_assignment(shard, assignment);  // Reiniciar lease time
+        dhcp_mutex_unlock(&shard->lock);
+        dhcp_trace_end(DHCP_TRACE_ALLOC, traced);
+        if (renewed < 0) {
+            dhcp_log_warn("Error al registrar la renovación de la IP " DHCP_IP_FMT ". Enviando NAK.\n", DHCP_IP_ARGS(requested_ip));
+            dhcp_stat_inc(DHCP_STAT_NAK_STORE_ERROR);
+            send_dhcp_nak(sockfd, client_addr, request);
+            return 0;
+        }
+        dhcp_log_debug("El cliente está solicitando su propia IP " DHCP_IP_FMT ". Enviando ACK.\n", DHCP_IP_ARGS(requested_ip));
+        send_dhcp_ack(sockfd, client_addr, request, options, requested_ip);
+        return 1;
+    }
+
+    // Una IP ofrecida solo la confirma la MAC a la que se ofreció (el REQUEST consume la oferta)
+    uint32_t index = requested_ip - shard->start_ip;
+    int offered = assignment == NULL && offer_table_is_offered(&shard->offers, index);
+    if (offered && !offer_table_take(&shard->offers, request->chaddr, index)) {
+        dhcp_mutex_unlock(&shard->lock);
+        dhcp_trace_end(DHCP_TRACE_ALLOC, traced);
+        dhcp_log_info("La IP solicitada " DHCP_IP_FMT " está ofrecida a otro cliente. Enviando NAK.\n", DHCP_IP_ARGS(requested_ip));
+        dhcp_stat_inc(DHCP_STAT_NAK_IN_USE);
+        send_dhcp_nak(sockfd, client_addr, request);
+        return 0;
+    }
+
+    // Una IP en cuarentena la está usando otro equipo (alguien la rechazó con DECLINE)
+    if (assignment == NULL && address_quarantined(shard, index)) {
+        dhcp_mutex_unlock(&shard->lock);
+        dhcp_trace_end(DHCP_TRACE_ALLOC, traced);
+        dhcp_log_info("La IP solicitada " DHCP_IP_FMT " está en cuarentena por un DECLINE. Enviando NAK.\n", DHCP_IP_ARGS(requested_ip));
+        dhcp_stat_inc(DHCP_STAT_NAK_IN_USE);
+        send_dhcp_nak(sockfd, client_addr, request);
+        return 0;
     }
 
     if (assignment == NULL) {
-        // La IP no está asignada a nadie, enviamos DHCP ACK
-        printf("La IP solicitada %s está disponible. Enviando ACK.\n", int_to_ip(requested_ip));
-        send_dhcp_ack(sockfd, client_addr, request, requested_ip);
-        ip_assignment_root = insert_ip_assignment(ip_assignment_root, requested_ip, request->chaddr, default_lease_time);
-        if (!ip_assignment_root) {
-            printf("Error al asignar la IP %s al cliente. Enviando NAK.\n", int_to_ip(requested_ip));
+        // La IP no está asignada a nadie (o era la oferta del cliente), registrarla y enviar DHCP ACK
+        assignment = insert_ip_assignment(shard, requested_ip, request->chaddr, default_lease_time);
+        if (!assignment && offered) {
+            // La oferta del cliente ya se consumió: la dirección vuelve al pool. Sin oferta el bit
+            // no se toca (puede estar libre o reservado en la caché de otro worker)
+            ip_bitmap_set_free(&shard->free_map, index);
+        }
+        dhcp_mutex_unlock(&shard->lock);
+        dhcp_trace_end(DHCP_TRACE_ALLOC, traced);
+        if (!assignment) {
+            dhcp_log_warn("Error al asignar la IP " DHCP_IP_FMT " al cliente. Enviando NAK.\n", DHCP_IP_ARGS(requested_ip));
+            dhcp_stat_inc(DHCP_STAT_NAK_STORE_ERROR);
             send_dhcp_nak(sockfd, client_addr, request);
+            return 0;
         }
-    } else {
-        // La IP ya está asignada a alguien más
-        printf("La IP solicitada %s ya está asignada a otro cliente. Enviando NAK.\n", int_to_ip(requested_ip));
-        send_dhcp_nak(sockfd, client_addr, request);  // Enviar NAK
+        dhcp_log_debug("La IP solicitada " DHCP_IP_FMT " está disponible. Enviando ACK.\n", DHCP_IP_ARGS(requested_ip));
+        send_dhcp_ack(sockfd, client_addr, request, options, requested_ip);
+        return 1;
+    }
+
+    // La IP ya está asignada a alguien más
+    dhcp_mutex_unlock(&shard->lock);
+    dhcp_trace_end(DHCP_TRACE_ALLOC, traced);
+    dhcp_log_info("La IP solicitada " DHCP_IP_FMT " ya está asignada a otro cliente. Enviando NAK.\n", DHCP_IP_ARGS(requested_ip));
+    dhcp_stat_inc(DHCP_STAT_NAK_IN_USE);
+    send_dhcp_nak(sockfd, client_addr, request);  // Enviar NAK
+    return 0;
+}
+
+// Apartar una dirección rechazada por DECLINE durante DHCP_DECLINE_QUARANTINE_S: queda ocupada
+// en el bitmap, así que ninguna política ni reserva la elige, y su timer (libre, porque la IP ya
+// no tiene lease) la devuelve al pool. Otro DECLINE durante la cuarentena la extiende. No hace
+// nada si la IP tiene lease u oferta de otra MAC. Retorna 1 si quedó en cuarentena (con el lock
+// del rango tomado).
+static int quarantine_address(ip_range_t* range, uint32_t index) {
+    if (decline_quarantine_s == 0 || find_ip_assignment(range, range->start_ip + index) != NULL ||
+        offer_table_is_offered(&range->offers, index)) {
+        return 0;
     }
+    if (!address_quarantined(range, index)) {
+        range->quarantined[index >> 6] |= 1ULL << (index & 63);
+        range->quarantined_count++;
+        dhcp_stat_inc(DHCP_STAT_QUARANTINE_STARTED);
+    }
+    ip_bitmap_set_used(&range->free_map, index);
+    uint64_t expires = timer_clock_ms() + (uint64_t)decline_quarantine_s * 1000;
+    timer_wheel_schedule(&range->lease_timers, index, expires);
+    event_loop_note_deadline(expires);
+    return 1;
 }
 
 void handle_dhcp_decline(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request) {
     // Obtener la IP que el cliente está rechazando (yiaddr en el paquete DHCP)
     uint32_t declined_ip = ntohl(request->yiaddr);
 
-    printf("Solicitud DHCP DECLINE recibida para la IP: %s del cliente con MAC %02x:%02x:%02x:%02x:%02x:%02x\n",
-           int_to_ip(declined_ip),
-           request->chaddr[0], request->chaddr[1], request->chaddr[2],
-           request->chaddr[3], request->chaddr[4], request->chaddr[5]);
+    dhcp_log_info("Solicitud DHCP DECLINE recibida para la IP: " DHCP_IP_FMT " del cliente con MAC " DHCP_MAC_FMT "\n",
+                  DHCP_IP_ARGS(declined_ip), DHCP_MAC_ARGS(request->chaddr));
 
-    // Verificar si la IP rechazada está asignada a alguien en el árbol de asignaciones
-    ip_assignment_node_t* assignment = find_ip_assignment(ip_assignment_root, declined_ip);
+    // Verificar si la IP rechazada está asignada a alguien en el almacén de asignaciones
+    ip_range_t* shard = shard_for_ip(declined_ip);
+    if (shard == NULL) {
+        dhcp_log_info("La IP " DHCP_IP_FMT " no pertenece al pool del servidor.\n", DHCP_IP_ARGS(declined_ip));
+        return;
+    }
+    uint64_t traced = dhcp_trace_start();
+    dhcp_mutex_lock(&shard->lock);
+    ip_assignment_t* assignment = find_ip_assignment(shard, declined_ip);
 
     if (assignment != NULL) {
         // La IP está asignada, imprimir información sobre la asignación
-        printf("La IP %s está asignada al cliente con MAC %02x:%02x:%02x:%02x:%02x:%02x. Será liberada.\n",
-               int_to_ip(declined_ip),
-               assignment->mac[0], assignment->mac[1], assignment->mac[2],
-               assignment->mac[3], assignment->mac[4], assignment->mac[5]);
-
-        // Eliminar la asignación de la IP del árbol
-        ip_assignment_root = delete_ip_assignment(ip_assignment_root, declined_ip);
-        printf("La IP %s ha sido liberada tras un DECLINE.\n", int_to_ip(declined_ip));
+        dhcp_log_info("La IP " DHCP_IP_FMT " está asignada al cliente con MAC " DHCP_MAC_FMT ". Será liberada.\n",
+                      DHCP_IP_ARGS(declined_ip), DHCP_MAC_ARGS(assignment->mac));
+
+        // Eliminar la asignación de la IP del almacén; otro equipo la usa, así que no vuelve al
+        // pool hasta que termine su cuarentena
+        delete_ip_assignment(shard, declined_ip, LEASE_JOURNAL_DECLINE);
+        int quarantined = quarantine_address(shard, declined_ip - shard->start_ip);
+        dhcp_mutex_unlock(&shard->lock);
+        dhcp_trace_end(DHCP_TRACE_ALLOC, traced);
+        if (quarantined) {
+            dhcp_log_info("La IP " DHCP_IP_FMT " queda en cuarentena %u s tras un DECLINE.\n",
+                          DHCP_IP_ARGS(declined_ip), decline_quarantine_s);
+        } else {
+            dhcp_log_info("La IP " DHCP_IP_FMT " ha sido liberada tras un DECLINE.\n", DHCP_IP_ARGS(declined_ip));
+        }
     } else {
-        // Si no está asignada, solo lo registramos
-        printf("La IP %s no estaba asignada, pero fue rechazada.\n", int_to_ip(declined_ip));
+        // Aunque no esté asignada, el conflicto existe: se aparta igual. Si era la oferta del
+        // cliente que la rechaza (detectó el conflicto antes del REQUEST), la oferta termina aquí.
+        uint32_t index = declined_ip - shard->start_ip;
+        int offered = offer_table_take(&shard->offers, request->chaddr, index);
+        int quarantined = quarantine_address(shard, index);
+        if (offered && !quarantined) {
+            ip_bitmap_set_free(&shard->free_map, index);
+        }
+        dhcp_mutex_unlock(&shard->lock);
+        dhcp_trace_end(DHCP_TRACE_ALLOC, traced);
+        dhcp_log_info("La IP " DHCP_IP_FMT " no estaba asignada, pero fue rechazada%s.\n", DHCP_IP_ARGS(declined_ip),
+                      quarantined ? " (queda en cuarentena)" : "");
     }
 }
 
@@ -442,35 +541,43 @@ void handle_dhcp_release(int sockfd, struct sockaddr_in* client_addr, struct dhc
     // Obtener la IP que el cliente está liberando (ciaddr en el paquete DHCP)
     uint32_t released_ip = ntohl(request->ciaddr);
 
-    printf("Solicitud DHCP RELEASE recibida para la IP: %s del cliente con MAC %02x:%02x:%02x:%02x:%02x:%02x\n",
-           int_to_ip(released_ip),
-           request->chaddr[0], request->chaddr[1], request->chaddr[2],
-           request->chaddr[3], request->chaddr[4], request->chaddr[5]);
+    dhcp_log_info("Solicitud DHCP RELEASE recibida para la IP: " DHCP_IP_FMT " del cliente con MAC " DHCP_MAC_FMT "\n",
+                  DHCP_IP_ARGS(released_ip), DHCP_MAC_ARGS(request->chaddr));
 
-    // Verificar si la IP liberada está asignada a alguien en el árbol de asignaciones
-    ip_assignment_node_t* assignment = find_ip_assignment(ip_assignment_root, released_ip);
+    // Verificar si la IP liberada está asignada a alguien en el almacén de asignaciones
+    ip_range_t* shard = shard_for_ip(released_ip);
+    if (shard == NULL) {
+        dhcp_log_info("La IP " DHCP_IP_FMT " no pertenece al pool del servidor.\n", DHCP_IP_ARGS(released_ip));
+        return;
+    }
+    uint64_t traced = dhcp_trace_start();
+    dhcp_mutex_lock(&shard->lock);
+    ip_assignment_t* assignment = find_ip_assignment(shard, released_ip);
 
     if (assignment != NULL) {
         // Imprimir información sobre el cliente que tenía asignada la IP
-        printf("La IP %s está asignada al cliente con MAC %02x:%02x:%02x:%02x:%02x:%02x. Será liberada.\n",
-               int_to_ip(released_ip),
-               assignment->mac[0], assignment->mac[1], assignment->mac[2],
-               assignment->mac[3], assignment->mac[4], assignment->mac[5]);
-
-        // Eliminar la asignación de la IP del árbol
-        ip_assignment_root = delete_ip_assignment(ip_assignment_root, released_ip);
-        printf("La IP %s ha sido liberada por el cliente.\n", int_to_ip(released_ip));
+        dhcp_log_debug("La IP " DHCP_IP_FMT " está asignada al cliente con MAC " DHCP_MAC_FMT ". Será liberada.\n",
+                       DHCP_IP_ARGS(released_ip), DHCP_MAC_ARGS(assignment->mac));
+
+        // Eliminar la asignación de la IP del almacén
+        delete_ip_assignment(shard, released_ip, LEASE_JOURNAL_RELEASE);
+        dhcp_mutex_unlock(&shard->lock);
+        dhcp_trace_end(DHCP_TRACE_ALLOC, traced);
+        dhcp_log_debug("La IP " DHCP_IP_FMT " ha sido liberada por el cliente.\n", DHCP_IP_ARGS(released_ip));
     } else {
+        dhcp_mutex_unlock(&shard->lock);
+        dhcp_trace_end(DHCP_TRACE_ALLOC, traced);
         // Si no está asignada, solo lo registramos
-        printf("La IP %s no estaba asignada, pero fue liberada por el cliente.\n", int_to_ip(released_ip));
+        dhcp_log_info("La IP " DHCP_IP_FMT " no estaba asignada, pero fue liberada por el cliente.\n", DHCP_IP_ARGS(released_ip));
     }
 }
 
-void send_dhcp_offer(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request, uint32_t assigned_ip) {
+void send_dhcp_offer(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request, const dhcp_option_index_t* options, uint32_t assigned_ip) {
     struct dhcp_packet offer;
+    uint64_t traced = dhcp_trace_start();
 
-    // Limpiar la estructura del paquete DHCP OFFER
-    memset(&offer, 0, sizeof(offer));
+    // Limpiar el encabezado (las opciones las escribe completas la plantilla)
+    memset(&offer, 0, offsetof(struct dhcp_packet, options));
 
     // Configurar los campos principales del paquete DHCP
     offer.op = 2;  // 2 = BOOTREPLY (respuesta del servidor)
@@ -485,26 +592,29 @@ void send_dhcp_offer(int sockfd, struct sockaddr_in* client_addr, struct dhcp_pa
     offer.siaddr = htonl(server_ip);  // IP del servidor DHCP (esto lo debes definir previamente)
 
     // Agregar las opciones DHCP
-    send_dhcp_options(&offer, DHCP_OFFER, assigned_ip);
+    size_t options_length = send_dhcp_options(&offer, options, DHCP_OFFER, assigned_ip);
 
-    // Calcular el tamaño del paquete DHCP: base del paquete más las opciones
-    ssize_t packet_size = sizeof(struct dhcp_packet) - sizeof(offer.options) + 312;  // Ajustar si las opciones varían
+    // Calcular el tamaño del paquete DHCP: base del paquete más las opciones realmente usadas
+    ssize_t packet_size = offsetof(struct dhcp_packet, options) + options_length;
 
     // Enviar el paquete OFFER al cliente
-    ssize_t sent_bytes = sendto(sockfd, &offer, packet_size, 0, 
-                                (struct sockaddr*)client_addr, sizeof(*client_addr));
+    dhcp_trace_end(DHCP_TRACE_ENCODE, traced);
+    ssize_t sent_bytes = send_dhcp_reply(sockfd, client_addr, &offer, packet_size);
     if (sent_bytes < 0) {
-        perror("Error al enviar DHCP OFFER");
+        dhcp_log_error("Error al enviar DHCP OFFER: %s\n", strerror(errno));
     } else {
-        printf("DHCP OFFER enviado a %s con la IP: %s\n", inet_ntoa(client_addr->sin_addr), int_to_ip(assigned_ip));
+        dhcp_stat_inc(DHCP_STAT_TX_OFFER);
+        dhcp_log_debug("DHCP OFFER enviado a " DHCP_IP_FMT " con la IP: " DHCP_IP_FMT "\n",
+                       DHCP_IP_ARGS(ntohl(client_addr->sin_addr.s_addr)), DHCP_IP_ARGS(assigned_ip));
     }
 }
 
-void send_dhcp_ack(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request, uint32_t requested_ip) {
+void send_dhcp_ack(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request, const dhcp_option_index_t* options, uint32_t requested_ip) {
     struct dhcp_packet ack;
+    uint64_t traced = dhcp_trace_start();
 
-    // Limpiar la estructura
-    memset(&ack, 0, sizeof(struct dhcp_packet));
+    // Limpiar el encabezado (las opciones las escribe completas la plantilla)
+    memset(&ack, 0, offsetof(struct dhcp_packet, options));
 
     // Configurar los campos principales del paquete DHCP
     ack.op = 2;  // 2 = BOOTREPLY (respuesta del servidor)
@@ -519,23 +629,26 @@ void send_dhcp_ack(int sockfd, struct sockaddr_in* client_addr, struct dhcp_pack
     ack.siaddr = htonl(server_ip);     // IP del servidor DHCP (esto lo debes definir previamente)
 
     // Agregar las opciones DHCP
-    send_dhcp_options(&ack, DHCP_ACK, requested_ip);
+    size_t options_length = send_dhcp_options(&ack, options, DHCP_ACK, requested_ip);
 
-    // Calcular el tamaño del paquete DHCP, incluyendo las opciones
-    ssize_t packet_size = sizeof(struct dhcp_packet);  // 16 bytes de opciones agregadas
+    // Calcular el tamaño del paquete DHCP: base del paquete más las opciones realmente usadas
+    ssize_t packet_size = offsetof(struct dhcp_packet, options) + options_length;
 
     // Enviar el paquete ACK al cliente
-    ssize_t sent_bytes = sendto(sockfd, &ack, packet_size, 0, 
-                                (struct sockaddr*)client_addr, sizeof(*client_addr));
+    dhcp_trace_end(DHCP_TRACE_ENCODE, traced);
+    ssize_t sent_bytes = send_dhcp_reply(sockfd, client_addr, &ack, packet_size);
     if (sent_bytes < 0) {
-        perror("Error al enviar DHCP ACK");
+        dhcp_log_error("Error al enviar DHCP ACK: %s\n", strerror(errno));
     } else {
-        printf("DHCP ACK enviado a %s confirmando la IP: %s\n", inet_ntoa(client_addr->sin_addr), int_to_ip(requested_ip));
+        dhcp_stat_inc(DHCP_STAT_TX_ACK);
+        dhcp_log_debug("DHCP ACK enviado a " DHCP_IP_FMT " confirmando la IP: " DHCP_IP_FMT "\n",
+                       DHCP_IP_ARGS(ntohl(client_addr->sin_addr.s_addr)), DHCP_IP_ARGS(requested_ip));
     }
 }
 
 void send_dhcp_nak(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request) {
     struct dhcp_packet nak;
+    uint64_t traced = dhcp_trace_start();
 
     // Limpiar la estructura
     memset(&nak, 0, sizeof(struct dhcp_packet));
@@ -565,12 +678,13 @@ void send_dhcp_nak(int sockfd, struct sockaddr_in* client_addr, struct dhcp_pack
     ssize_t packet_size = sizeof(struct dhcp_packet) - sizeof(nak.options) + 10;
 
     // Enviar el paquete NAK al cliente
-    ssize_t sent_bytes = sendto(sockfd, &nak, packet_size, 0, 
-                                (struct sockaddr*)client_addr, sizeof(*client_addr));
+    dhcp_trace_end(DHCP_TRACE_ENCODE, traced);
+    ssize_t sent_bytes = send_dhcp_reply(sockfd, client_addr, &nak, packet_size);
     if (sent_bytes < 0) {
-        perror("Error al enviar DHCP NAK");
+        dhcp_log_error("Error al enviar DHCP NAK: %s\n", strerror(errno));
     } else {
-        printf("DHCP NAK enviado a %s\n", inet_ntoa(client_addr->sin_addr));
+        dhcp_stat_inc(DHCP_STAT_TX_NAK);
+        dhcp_log_info("DHCP NAK enviado a " DHCP_IP_FMT "\n", DHCP_IP_ARGS(ntohl(client_addr->sin_addr.s_addr)));
     }
 }
 
@@ -593,473 +707,1118 @@ void initialize_ip_pool(ip_range_t* range, const char* start_ip, const char* end
         exit(EXIT_FAILURE);  // Alternativamente, devolver un código de error 
     }
 
-    // Limitar el rango de IPs a MAX_IPS si excede el tamaño máximo
-    uint32_t total_ips_in_range = range->end_ip - range->start_ip + 1;
-    if (total_ips_in_range > MAX_IPS) {
-        range->end_ip = range->start_ip + MAX_IPS - 1;
+    // Crear el bitmap, el almacén de asignaciones y los timers del rango completo
+    if (init_ip_range(range, range->start_ip, range->end_ip, pool_id) < 0) {
+        exit(EXIT_FAILURE);
     }
 
     // Mensaje de depuración 
     printf("Rango de IPs inicializado: %s - %s (%u - %u)\n", start_ip, end_ip, range->start_ip, range->end_ip); 
 }
 
-uint32_t ip_to_int(const char* ip_str) { 
-    struct in_addr ip_addr;
+int init_ip_range(ip_range_t* range, uint32_t start_ip, uint32_t end_ip, int pool_id) {
+    range->start_ip = start_ip;
+    range->end_ip = end_ip;
+    range->pool_id = pool_id;
+    range->policy = IP_ALLOC_ROUND_ROBIN;
+    range->hash_key = 0;
+    range->cursor = 0;
+
+    // Crear el bitmap de direcciones libres
+    uint32_t total_ips_in_range = end_ip - start_ip + 1;
+    if (ip_bitmap_init(&range->free_map, total_ips_in_range) < 0) {
+        fprintf(stderr, "Error: No se pudo reservar el bitmap para %u direcciones.\n", total_ips_in_range);
+        return -1;
+    }
 
-    // Intentar convertir la IP de cadena a formato binario
-    if (inet_aton(ip_str, &ip_addr) == 0) {
-        fprintf(stderr, "Error: La dirección IP '%s' no es válida.\n", ip_str);
-        return (uint32_t)-1;  // Retornar un valor de error si la conversión falla
+    // Crear el almacén de asignaciones: un registro por IP, indexado por (ip - start_ip)
+    if (lease_store_init(&range->leases, start_ip, total_ips_in_range) < 0) {
+        fprintf(stderr, "Error: No se pudo reservar el almacén de asignaciones para %u direcciones.\n", total_ips_in_range);
+        ip_bitmap_free(&range->free_map);
+        return -1;
     }
 
-    // Convertir de orden de red a orden de host
-    return ntohl(ip_addr.s_addr);
-}
+    // Un timer de vencimiento por IP, con el mismo índice que el almacén
+    if (timer_wheel_init(&range->lease_timers, total_ips_in_range, timer_clock_ms()) < 0) {
+        fprintf(stderr, "Error: No se pudo reservar la rueda de timers para %u direcciones.\n", total_ips_in_range);
+        lease_store_free(&range->leases);
+        ip_bitmap_free(&range->free_map);
+        return -1;
+    }
 
-char* int_to_ip(uint32_t ip_int) {
-    struct in_addr ip_addr;
-    ip_addr.s_addr = htonl(ip_int);  // Convertir a formato de red
+    // Índice por MAC; no tiene sentido recordar más leases terminados que IPs tiene el rango
+    uint32_t ghosts = lease_ghost_limit < total_ips_in_range ? lease_ghost_limit : total_ips_in_range;
+    if (mac_index_init(&range->clients, ghosts) < 0) {
+        fprintf(stderr, "Error: No se pudo reservar el índice de MACs para %u leases terminados.\n", ghosts);
+        timer_wheel_free(&range->lease_timers);
+        lease_store_free(&range->leases);
+        ip_bitmap_free(&range->free_map);
+        return -1;
+    }
 
-    // Convertir la dirección IP a una cadena
-    char* ip_str = inet_ntoa(ip_addr);
+    // Ofertas pendientes (un bit por dirección; el anillo crece con las ofertas en vuelo)
+    if (offer_table_init(&range->offers, total_ips_in_range) < 0) {
+        fprintf(stderr, "Error: No se pudo reservar la tabla de ofertas para %u direcciones.\n", total_ips_in_range);
+        mac_index_free(&range->clients);
+        timer_wheel_free(&range->lease_timers);
+        lease_store_free(&range->leases);
+        ip_bitmap_free(&range->free_map);
+        return -1;
+    }
 
-    // Retornar una copia de la cadena para evitar sobrescritura de inet_ntoa
-    return strdup(ip_str);  // Duplicar la cadena para tener memoria propia
+    // Cuarentena de las direcciones rechazadas (su vencimiento usa el timer del lease, que no tienen)
+    range->quarantined = (uint64_t*)calloc(((uint64_t)total_ips_in_range + 63) / 64, sizeof(uint64_t));
+    range->quarantined_count = 0;
+    if (range->quarantined == NULL) {
+        fprintf(stderr, "Error: No se pudo reservar la cuarentena para %u direcciones.\n", total_ips_in_range);
+        offer_table_free(&range->offers);
+        mac_index_free(&range->clients);
+        timer_wheel_free(&range->lease_timers);
+        lease_store_free(&range->leases);
+        ip_bitmap_free(&range->free_map);
+        return -1;
+    }
+
+    dhcp_mutex_init(&range->lock, "shard->lock");
+    return 0;
 }
 
-uint32_t assign_ip_address(ip_range_t* range, struct dhcp_packet* request) {    
-    pthread_mutex_lock(&ip_assignment_mutex);  // Bloquear el acceso al árbol de asignaciones
+void free_ip_range(ip_range_t* range) {
+    lease_store_free(&range->leases);
+    timer_wheel_free(&range->lease_timers);
+    mac_index_free(&range->clients);
+    offer_table_free(&range->offers);
+    free(range->quarantined);
+    range->quarantined = NULL;
+    range->quarantined_count = 0;
+    ip_bitmap_free(&range->free_map);
+    dhcp_mutex_destroy(&range->lock);
+}
 
-    // Iniciar desde la última IP asignada o desde el inicio del rango
-    if (last_assigned_ip < range->start_ip || last_assigned_ip > range->end_ip) {
-        last_assigned_ip = range->start_ip;  // Establecer dentro del rango de IPs
+int split_ip_pool(ip_range_t* range, int count) {
+    uint32_t total = range->end_ip - range->start_ip + 1;
+    if (count > 1 && (uint32_t)count > total) {
+        count = (int)total;  // Al menos una dirección por shard
     }
 
-    uint32_t potential_ip = last_assigned_ip;
-    int attempts = 0;
-    int max_attempts = range->end_ip - range->start_ip + 1;
+    // Con un solo shard el rango completo es su propio shard
+    if (count <= 1) {
+        ip_shards = range;
+        num_ip_shards = 1;
+        ip_shard_span = total;
+        return 0;
+    }
 
-    // Intentar encontrar la siguiente IP disponible en el rango
-    do {
-        if (!find_ip_assignment(ip_assignment_root, potential_ip)) {
-            // La IP no está asignada, podemos usarla
-            ip_assignment_root = insert_ip_assignment(ip_assignment_root, potential_ip, request->chaddr, default_lease_time);
-            last_assigned_ip = potential_ip + 1;  // Actualizar `last_assigned_ip` para el próximo cliente
-            if (last_assigned_ip > range->end_ip) {
-                last_assigned_ip = range->start_ip;  // Reiniciar el ciclo de IPs en el rango
-            }
+    ip_range_t* shards = (ip_range_t*)calloc(count, sizeof(ip_range_t));
+    if (!shards) {
+        perror("Error al asignar memoria para los shards del pool");
+        return -1;
+    }
 
-            printf("Dirección IP asignada a cliente con MAC %02x:%02x:%02x:%02x:%02x:%02x: %s\n",
-                   request->chaddr[0], request->chaddr[1], request->chaddr[2],
-                   request->chaddr[3], request->chaddr[4], request->chaddr[5],
-                   int_to_ip(potential_ip));
-            pthread_mutex_unlock(&ip_assignment_mutex);  // Desbloquear antes de retornar
-            return potential_ip;
+    // Repartir el rango en tramos contiguos; el último shard recibe el resto
+    uint32_t span = total / count;
+    for (int i = 0; i < count; i++) {
+        uint32_t start = range->start_ip + (uint32_t)i * span;
+        uint32_t end = (i == count - 1) ? range->end_ip : start + span - 1;
+        if (init_ip_range(&shards[i], start, end, range->pool_id) < 0) {
+            while (--i >= 0) free_ip_range(&shards[i]);
+            free(shards);
+            return -1;
         }
+        shards[i].policy = range->policy;
+        shards[i].hash_key = range->hash_key;
+    }
 
-        // Avanzar a la siguiente IP
-        potential_ip++;
-        if (potential_ip > range->end_ip) {
-            potential_ip = range->start_ip;  // Reiniciar desde el inicio del rango
+    // El rango completo queda solo como descriptor; sus estructuras ya no se usan
+    free_ip_range(range);
+    ip_shards = shards;
+    num_ip_shards = count;
+    ip_shard_span = span;
+    printf("Pool dividido en %d shards de %u direcciones\n", count, span);
+    return 0;
+}
+
+// Aplicar un registro del snapshot o del journal al shard de su IP (al arrancar)
+static void apply_lease_record(const lease_journal_record_t* record, void* ctx) {
+    uint32_t now = *(const uint32_t*)ctx;
+    ip_range_t* shard = shard_for_ip(record->ip);
+    if (shard == NULL) {
+        return;  // El pool cambió desde que se guardó
+    }
+    uint32_t index = record->ip - shard->start_ip;
+
+    // Cualquier registro reemplaza lo que hubiera para la IP; el lease anterior queda como
+    // fantasma de su MAC, salvo que la IP se haya rechazado
+    ip_assignment_t* previous = lease_store_find(&shard->leases, record->ip);
+    if (previous != NULL) {
+        if (record->type == LEASE_JOURNAL_DECLINE) {
+            mac_index_remove(&shard->clients, previous->mac, index);
+        } else {
+            mac_index_retire(&shard->clients, previous->mac, index);
         }
+        lease_store_delete(&shard->leases, record->ip);
+        ip_bitmap_set_free(&shard->free_map, index);
+        timer_wheel_cancel(&shard->lease_timers, index);
+    }
+    if (record->type != LEASE_JOURNAL_GRANT && record->type != LEASE_JOURNAL_RENEW) {
+        return;
+    }
+    uint32_t ends = record->lease_start + record->lease_time;
+    if (ends <= now) {
+        mac_index_retire(&shard->clients, record->mac, index);  // Venció mientras el servidor estaba detenido
+        return;
+    }
+    lease_store_insert(&shard->leases, record->ip, record->mac, record->lease_time, record->lease_start);
+    mac_index_set(&shard->clients, record->mac, index);
+    ip_bitmap_set_used(&shard->free_map, index);
+    timer_wheel_schedule(&shard->lease_timers, index, timer_clock_ms() + (uint64_t)(ends - now) * 1000);
+}
 
-        attempts++;
-    } while (attempts < max_attempts);  // Intentar hasta cubrir todo el rango
+// Recorrer los leases activos para el snapshot, soltando el lock de cada shard cada
+// tanto para no frenar a los workers
+static void collect_leases(void* ctx) {
+    (void)ctx;
+    for (int i = 0; i < num_ip_shards; i++) {
+        ip_range_t* shard = &ip_shards[i];
+        uint32_t written_end;
+        for (uint32_t base = lease_store_next_written(&shard->leases, 0, &written_end);
+             base < shard->leases.size; base = lease_store_next_written(&shard->leases, base, &written_end)) {
+            uint32_t end = base + 4096 < written_end ? base + 4096 : written_end;
+            dhcp_mutex_lock(&shard->lock);
+            for (uint32_t index = base; index < end; index++) {
+                const ip_assignment_t* assignment = &shard->leases.leases[index];
+                if (assignment->state == LEASE_ACTIVE) {
+                    lease_snapshot_add(shard->start_ip + index, assignment->mac,
+                                       assignment->lease_start, assignment->lease_time);
+                }
+            }
+            dhcp_mutex_unlock(&shard->lock);
+            base = end;
+        }
+    }
+}
 
-    pthread_mutex_unlock(&ip_assignment_mutex);  // Liberar el mutex si no se encuentra IP
+// Abrir el journal de DHCP_LEASE_DIR; con `restore` = 0 las asignaciones ya están en memoria
+// (llegaron en un relevo) y del disco solo se toma la secuencia para seguir escribiendo
+static int start_lease_journal(int restore) {
+    const char* dir = getenv("DHCP_LEASE_DIR");
+    if (dir == NULL || *dir == '\0') {
+        return 0;
+    }
+    const char* commit_env = getenv("DHCP_LEASE_COMMIT_US");
+    const char* sync_env = getenv("DHCP_LEASE_SYNC");
+    const char* snapshot_env = getenv("DHCP_LEASE_SNAPSHOT_S");
+    static uint32_t now;
+    now = (uint32_t)time(NULL);
+
+    lease_journal_config_t config;
+    config.dir = dir;
+    config.commit_us = commit_env ? (uint32_t)strtoul(commit_env, NULL, 10) : LEASE_JOURNAL_COMMIT_US;
+    config.wait_for_commit = !(sync_env && strcmp(sync_env, "async") == 0);
+    config.snapshot_s = snapshot_env ? (uint32_t)strtoul(snapshot_env, NULL, 10) : 0;
+    config.apply = restore ? apply_lease_record : NULL;
+    config.collect = collect_leases;
+    config.ctx = &now;
+    if (lease_journal_open(&config) < 0) {
+        fprintf(stderr, "Error: No se pudieron restaurar los leases de %s.\n", dir);
+        return -1;
+    }
+    if (!restore) {
+        return 0;
+    }
 
-    // Si llegamos aquí, no hay IPs disponibles
-    fprintf(stderr, "Error: No hay más direcciones IP disponibles en el rango.\n");
+    lease_journal_stats_t stats;
+    lease_journal_get_stats(&stats);
+    printf("Leases restaurados de %s: %llu del snapshot y %llu registros del journal en %.3f s\n", dir,
+           (unsigned long long)stats.restored_snapshot, (unsigned long long)stats.restored_journal,
+           stats.restore_seconds);
     return 0;
 }
 
-ip_assignment_node_t* insert_ip_assignment(ip_assignment_node_t* root, uint32_t ip, uint8_t* mac, int lease_time) {
-    ip_assignment_node_t* new_node = (ip_assignment_node_t*)malloc(sizeof(ip_assignment_node_t));
-    if (new_node == NULL) {
-        fprintf(stderr, "Error: No se pudo asignar memoria para el nuevo nodo de IP.\n");
-        return root;
-    }
-
-    new_node->ip = ip;
-    memcpy(new_node->mac, mac, 6);  // Copiar la dirección MAC
-    new_node->lease_start = time(NULL);  // Tiempo de concesión actual
-    new_node->lease_time = lease_time;
-    new_node->left = new_node->right = NULL;
+int open_lease_journal() {
+    return start_lease_journal(1);
+}
 
-    // Insertar el nuevo nodo en el árbol de asignaciones
-    if (root == NULL) {
-        return new_node;
+// Reconstruir el bitmap de libres, los timers, el índice de MACs, las ofertas y la cuarentena de
+// un shard cuyo almacén llegó en un relevo (solo el almacén viaja entre procesos; los índices se
+// derivan de él, y los fantasmas del proceso anterior se pierden)
+static void rebuild_shard_indexes(ip_range_t* shard) {
+    uint32_t now = (uint32_t)time(NULL);
+    uint64_t now_ms = timer_clock_ms();
+    uint32_t end;
+    for (uint32_t index = lease_store_next_written(&shard->leases, 0, &end); index < shard->leases.size;
+         index = lease_store_next_written(&shard->leases, end, &end)) {
+        for (; index < end; index++) {
+            const ip_assignment_t* assignment = &shard->leases.leases[index];
+            if (assignment->state == LEASE_OFFERED) {
+                // Oferta pendiente del proceso anterior: vuelve a la tabla de ofertas y sale del almacén
+                offer_table_add(&shard->offers, assignment->mac, index, now_ms + assignment->lease_time);
+                ip_bitmap_set_used(&shard->free_map, index);
+                lease_store_delete(&shard->leases, shard->start_ip + index);
+                continue;
+            }
+            if (assignment->state == LEASE_QUARANTINED) {
+                // IP rechazada en el proceso anterior: sigue en cuarentena el tiempo que le quedaba
+                shard->quarantined[index >> 6] |= 1ULL << (index & 63);
+                shard->quarantined_count++;
+                dhcp_stat_inc(DHCP_STAT_QUARANTINE_STARTED);
+                ip_bitmap_set_used(&shard->free_map, index);
+                timer_wheel_schedule(&shard->lease_timers, index, now_ms + assignment->lease_time);
+                lease_store_delete(&shard->leases, shard->start_ip + index);
+                continue;
+            }
+            if (assignment->state != LEASE_ACTIVE) {
+                continue;
+            }
+            uint32_t ends = assignment->lease_start + assignment->lease_time;
+            ip_bitmap_set_used(&shard->free_map, index);
+            mac_index_set(&shard->clients, assignment->mac, index);
+            timer_wheel_schedule(&shard->lease_timers, index,
+                                 now_ms + (ends > now ? (uint64_t)(ends - now) * 1000 : 0));
+        }
     }
+}
 
-    if (ip < root->ip) {
-        root->left = insert_ip_assignment(root->left, ip, mac, lease_time);
-    } else if (ip > root->ip) {
-        root->right = insert_ip_assignment(root->right, ip, mac, lease_time);
-    } else {
-        fprintf(stderr, "Advertencia: La IP %u ya está asignada.\n", ip);
+// Dejar en el almacén de un shard las direcciones ocupadas sin lease que el proceso nuevo no
+// debe entregar: las ofertas pendientes como registros LEASE_OFFERED y las IPs en cuarentena
+// como LEASE_QUARANTINED (`stash` = 0 los vuelve a sacar si el relevo falló)
+static void stash_unleased_addresses(ip_range_t* shard, int stash) {
+    const offer_table_t* offers = &shard->offers;
+    uint64_t now_ms = timer_clock_ms();
+    static const uint8_t no_mac[6] = { 0 };
+    dhcp_mutex_lock(&shard->lock);
+    for (uint32_t position = offers->head; position != offers->tail; position++) {
+        const pending_offer_t* offer = offer_table_entry(offers, position);
+        if (!offer->live) {
+            continue;
+        }
+        uint32_t ip = shard->start_ip + offer->index;
+        if (!stash) {
+            lease_store_delete(&shard->leases, ip);
+            continue;
+        }
+        ip_assignment_t* record = lease_store_insert(&shard->leases, ip, offer->mac, 0, 0);
+        if (record != NULL) {
+            int32_t remaining = (int32_t)(offer->expires - (uint32_t)now_ms);
+            record->state = LEASE_OFFERED;
+            record->lease_time = remaining > 0 ? (uint32_t)remaining : 0;
+        }
     }
 
-    return root;
+    // Las palabras vacías del bitmap de cuarentena se saltan de a 64 direcciones
+    uint32_t words = (shard->leases.size + 63) / 64;
+    for (uint32_t word = 0; word < words && shard->quarantined_count > 0; word++) {
+        for (uint64_t bits = shard->quarantined[word]; bits; bits &= bits - 1) {
+            uint32_t index = word * 64 + (uint32_t)__builtin_ctzll(bits);
+            uint32_t ip = shard->start_ip + index;
+            if (!stash) {
+                lease_store_delete(&shard->leases, ip);
+                continue;
+            }
+            ip_assignment_t* record = lease_store_insert(&shard->leases, ip, no_mac, 0, 0);
+            if (record != NULL) {
+                uint64_t expires = shard->lease_timers.nodes[index].expires;
+                record->state = LEASE_QUARANTINED;
+                record->lease_time = expires > now_ms ? (uint32_t)(expires - now_ms) : 0;
+            }
+        }
+    }
+    dhcp_mutex_unlock(&shard->lock);
 }
 
-ip_assignment_node_t* delete_ip_assignment(ip_assignment_node_t* root, uint32_t ip) {
-    pthread_mutex_lock(&ip_assignment_mutex);  // Bloquear acceso al árbol de asignaciones
+int take_over_server(int* sockets, int max_sockets, int* steer_by_chaddr) {
+    const char* path = getenv("DHCP_HANDOFF_SOCKET");
+    if (path == NULL || *path == '\0') {
+        return 0;
+    }
 
-    if (root == NULL) {
-        pthread_mutex_unlock(&ip_assignment_mutex);
-        return NULL;
+    int conn;
+    handoff_header_t header;
+    int fds[HANDOFF_MAX_FDS];
+    int result = handoff_request(path, &conn, &header, fds);
+    if (result <= 0) {
+        return result;  // Sin servidor en marcha (0) o entrega fallida (-1)
+    }
+    int count = header.socket_count + header.shard_count;
+
+    // El servidor anterior tiene que atender el mismo pool con el mismo modo
+    int expected = server_io_mode == DHCP_IO_WORKERS ?
+                   header.socket_count == 1 && header.shard_count == 1 :
+                   header.shard_count <= header.socket_count;
+    if (header.io_mode != (int32_t)server_io_mode || !expected || header.socket_count > max_sockets ||
+        header.start_ip != global_ip_range.start_ip || header.end_ip != global_ip_range.end_ip) {
+        fprintf(stderr, "Error: El servidor anterior usa otro modo de E/S u otro pool; no se toma el relevo.\n");
+        goto reject;
     }
 
-    // Recorrer el árbol para encontrar la IP
-    if (ip < root->ip) {
-        root->left = delete_ip_assignment(root->left, ip);
-    } else if (ip > root->ip) {
-        root->right = delete_ip_assignment(root->right, ip);
-    } else {
-        // Nodo encontrado, eliminar
-        if (root->left == NULL) {
-            ip_assignment_node_t* temp = root->right;
-            free(root);
-            pthread_mutex_unlock(&ip_assignment_mutex);  // Desbloquear antes de retornar
-            return temp;
-        } else if (root->right == NULL) {
-            ip_assignment_node_t* temp = root->left;
-            free(root);
-            pthread_mutex_unlock(&ip_assignment_mutex);  // Desbloquear antes de retornar
-            return temp;
+    // Mismo reparto en shards que el anterior; cada shard proyecta el memfd que le corresponde
+    if (split_ip_pool(&global_ip_range, header.shard_count) < 0 || num_ip_shards != header.shard_count) {
+        goto reject;
+    }
+    uint32_t leases = 0;
+    for (int i = 0; i < num_ip_shards; i++) {
+        ip_range_t* shard = &ip_shards[i];
+        int fd = fds[header.socket_count + i];
+        lease_store_free(&shard->leases);
+        if (lease_store_attach(&shard->leases, fd, shard->start_ip, shard->end_ip - shard->start_ip + 1) < 0) {
+            fprintf(stderr, "Error: El almacén recibido para el shard %d no corresponde al pool.\n", i);
+            // Los memfd ya tomados por los shards se cierran con ellos
+            for (int j = header.socket_count + i; j < count; j++) close(fds[j]);
+            for (int j = 0; j < header.socket_count; j++) close(fds[j]);
+            handoff_confirm(conn, 0);
+            return -1;
         }
+        rebuild_shard_indexes(shard);
+        leases += shard->leases.count;
+    }
+    client_id_counter = header.client_id_counter;
 
-        // Nodo con dos hijos: encontrar el sucesor más pequeño (mínimo en el subárbol derecho)
-        ip_assignment_node_t* temp = find_min(root->right);
-        root->ip = temp->ip;
-        memcpy(root->mac, temp->mac, 6);
-        root->lease_start = temp->lease_start;
-        root->lease_time = temp->lease_time;
-        root->right = delete_ip_assignment(root->right, temp->ip);
+    // El anterior cerró su journal con un snapshot de este mismo estado
+    if (start_lease_journal(0) < 0) {
+        for (int j = 0; j < header.socket_count; j++) close(fds[j]);
+        handoff_confirm(conn, 0);
+        return -1;
     }
 
-    pthread_mutex_unlock(&ip_assignment_mutex);  // Desbloquear el acceso
-    return root;
+    memcpy(sockets, fds, sizeof(int) * header.socket_count);
+    if (steer_by_chaddr) {
+        *steer_by_chaddr = header.steer_by_chaddr;
+    }
+    if (handoff_confirm(conn, 1) < 0) {
+        fprintf(stderr, "Error: El servidor anterior no recibió la confirmación del relevo.\n");
+        lease_journal_close();
+        for (int j = 0; j < header.socket_count; j++) close(fds[j]);
+        return -1;
+    }
+    printf("Relevo tomado de %s: %d sockets y %d shards con %u leases\n",
+           path, header.socket_count, num_ip_shards, leases);
+    return header.socket_count;
+
+reject:
+    for (int j = 0; j < count; j++) close(fds[j]);
+    handoff_confirm(conn, 0);
+    return -1;
 }
 
-ip_assignment_node_t* find_min(ip_assignment_node_t* node) {
-    if (node == NULL) {
-        return NULL;  // Árbol vacío o subárbol vacío
+void start_handoff_listener() {
+    const char* path = getenv("DHCP_HANDOFF_SOCKET");
+    if (path == NULL || *path == '\0' || server_io_mode == DHCP_IO_URING) {
+        return;
+    }
+    for (int i = 0; i < num_ip_shards; i++) {
+        if (ip_shards[i].leases.fd < 0) {
+            fprintf(stderr, "Advertencia: Los leases no están en memoria compartible; el relevo queda desactivado.\n");
+            return;
+        }
     }
+    handoff_fd = handoff_listen(path);
+    if (handoff_fd >= 0) {
+        printf("Esperando pedidos de relevo en %s\n", path);
+    }
+}
 
-    // Iterar hacia la izquierda hasta encontrar el nodo más pequeño
-    while (node->left != NULL) {
-        node = node->left;
+void serve_handoff() {
+    int conn = handoff_accept(handoff_fd);
+    if (conn < 0) {
+        return;
+    }
+    printf("Relevo pedido por un proceso nuevo: deteniendo la recepción...\n");
+
+    // Dejar de recibir y terminar lo ya recibido; lo que llega mientras tanto espera en la
+    // cola del socket. En modo workers este hilo es el que recibe, así que basta con vaciar
+    // las colas de los workers.
+    int fds[HANDOFF_MAX_FDS];
+    int steer_by_chaddr = 0;
+    int socket_count = 1;
+    if (server_io_mode == DHCP_IO_REUSEPORT) {
+        socket_count = quiesce_reuseport_workers(fds, HANDOFF_MAX_FDS / 2, &steer_by_chaddr);
+    } else {
+        drain_worker_pool();
+        fds[0] = server_socket;
+    }
+    if (socket_count < 0 || socket_count + num_ip_shards > HANDOFF_MAX_FDS) {
+        fprintf(stderr, "Error: Demasiados sockets o shards para un relevo.\n");
+        handoff_confirm(conn, 0);
+        if (server_io_mode == DHCP_IO_REUSEPORT) resume_reuseport_workers();
+        return;
+    }
+    for (int i = 0; i < num_ip_shards; i++) {
+        fds[socket_count + i] = ip_shards[i].leases.fd;
+    }
+
+    // El journal se cierra con un snapshot: el proceso nuevo sigue desde su secuencia
+    int journal = lease_journal_enabled;
+    if (journal) {
+        lease_journal_close();
+    }
+
+    // Las ofertas pendientes y la cuarentena viajan en el almacén, fuera del snapshot
+    for (int i = 0; i < num_ip_shards; i++) {
+        stash_unleased_addresses(&ip_shards[i], 1);
+    }
+
+    handoff_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.magic = HANDOFF_MAGIC;
+    header.version = HANDOFF_VERSION;
+    header.io_mode = (int32_t)server_io_mode;
+    header.socket_count = socket_count;
+    header.shard_count = num_ip_shards;
+    header.start_ip = global_ip_range.start_ip;
+    header.end_ip = global_ip_range.end_ip;
+    header.client_id_counter = client_id_counter;
+    header.steer_by_chaddr = steer_by_chaddr;
+    if (handoff_send(conn, &header, fds, socket_count + num_ip_shards) == 0) {
+        close(conn);
+        printf("Relevo completado: el proceso nuevo atiende el puerto %d.\n", DHCP_SERVER_PORT);
+        handed_off = 1;
+        shutdown_server();
+    }
+    close(conn);
+
+    // El proceso nuevo no tomó el servicio: seguir atendiendo con el mismo estado
+    fprintf(stderr, "Advertencia: Relevo fallido, el servidor sigue atendiendo.\n");
+    for (int i = 0; i < num_ip_shards; i++) {
+        stash_unleased_addresses(&ip_shards[i], 0);
+    }
+    if (journal && start_lease_journal(0) < 0) {
+        fprintf(stderr, "Advertencia: Sin journal, los leases nuevos no se guardan.\n");
+    }
+    if (server_io_mode == DHCP_IO_REUSEPORT) {
+        resume_reuseport_workers();
     }
-    return node;
 }
 
-ip_assignment_node_t* find_ip_assignment(ip_assignment_node_t* root, uint32_t ip) {
-    pthread_mutex_unlock(&ip_assignment_mutex);  // Desbloquear antes de retornar
-    pthread_mutex_lock(&ip_assignment_mutex);  // Bloquear acceso al árbol de asignaciones
-    
-    while (root != NULL) {
-        if (ip == root->ip) {
-            pthread_mutex_unlock(&ip_assignment_mutex);  // Desbloquear antes de retornar
-            return root;
-        } else if (ip < root->ip) {
-            root = root->left;
-        } else {
-            root = root->right;
-        }
+ip_range_t* shard_for_ip(uint32_t ip) {
+    if (ip < global_ip_range.start_ip || ip > global_ip_range.end_ip) {
+        return NULL;
     }
+    uint32_t index = (ip - global_ip_range.start_ip) / ip_shard_span;
+    return &ip_shards[index < (uint32_t)num_ip_shards ? index : (uint32_t)num_ip_shards - 1];
+}
 
-    pthread_mutex_unlock(&ip_assignment_mutex);  // Desbloquear si no se encuentra la IP
-    return NULL;
+ip_range_t* shard_for_mac(const uint8_t* mac) {
+    // Misma función que el programa BPF de reuseport: la MAC cae en el shard de su núcleo
+    return &ip_shards[num_ip_shards > 1 ? steering_hash_mac(mac) % num_ip_shards : 0];
 }
 
-void free_ip_assignment_tree(ip_assignment_node_t* root) {
-    if (root == NULL) return;
-    free_ip_assignment_tree(root->left);
-    free_ip_assignment_tree(root->right);
-    free(root);
+uint32_t transaction_capacity(int threads) {
+    uint32_t pool = global_ip_range.end_ip >= global_ip_range.start_ip ?
+                    global_ip_range.end_ip - global_ip_range.start_ip + 1 : 1;
+    uint32_t per_thread = pool / (threads > 0 ? threads : 1) + 1;
+    if (per_thread > TXN_TABLE_PREALLOC_MAX) {
+        per_thread = TXN_TABLE_PREALLOC_MAX;
+    }
+    // Margen para que la tabla no pase del factor de carga de 3/4
+    return per_thread + per_thread / 3 + 1;
 }
 
-ip_assignment_node_t* check_expired_leases(ip_assignment_node_t* root) {
-    if (root == NULL) return NULL;
-    time_t current_time = time(NULL);
+uint32_t ip_to_int(const char* ip_str) { 
+    struct in_addr ip_addr;
 
-    // Primero recorrer el subárbol izquierdo y derecho
-    root->left = check_expired_leases(root->left);
-    root->right = check_expired_leases(root->right);
+    // Intentar convertir la IP de cadena a formato binario
+    if (inet_aton(ip_str, &ip_addr) == 0) {
+        fprintf(stderr, "Error: La dirección IP '%s' no es válida.\n", ip_str);
+        return (uint32_t)-1;  // Retornar un valor de error si la conversión falla
+    }
 
-    // Luego verificar si el lease ha expirado
-    if (current_time - root->lease_start > root->lease_time) {
-        printf("El lease para la IP %s ha expirado.\n", int_to_ip(root->ip));
-        root = delete_ip_assignment(root, root->ip);  // Eliminar el nodo del árbol
+    // Convertir de orden de red a orden de host
+    return ntohl(ip_addr.s_addr);
+}
+
+char* int_to_ip(uint32_t ip_int, char* buffer) {
+    struct in_addr ip_addr;
+    ip_addr.s_addr = htonl(ip_int);  // Convertir a formato de red
+
+    // Escribir en el buffer del llamador (inet_ntoa usa uno estático compartido)
+    return (char*)inet_ntop(AF_INET, &ip_addr, buffer, INET_ADDRSTRLEN);
+}
+
+// Una dirección ocupada en el bitmap sin lease puede estar ofrecida a otra MAC, en cuarentena o
+// reservada por un worker (con el lock del rango tomado)
+static int address_taken(ip_range_t* range, uint32_t index) {
+    return find_ip_assignment(range, range->start_ip + index) != NULL ||
+           offer_table_is_offered(&range->offers, index) || address_quarantined(range, index);
+}
+
+// Entregar una dirección a la MAC de un DISCOVER: con DHCP_OFFER_TTL_MS queda como oferta
+// pendiente hasta el REQUEST; sin ella se registra el lease completo. Retorna la IP, o 0 si no
+// se pudo registrar (con el lock del rango tomado).
+static uint32_t offer_address(ip_range_t* range, uint32_t index, uint8_t* mac) {
+    uint32_t ip = range->start_ip + index;
+    if (offer_ttl_ms == 0) {
+        return insert_ip_assignment(range, ip, mac, default_lease_time) != NULL ? ip : 0;
+    }
+    uint64_t expires = timer_clock_ms() + offer_ttl_ms;
+    if (offer_table_add(&range->offers, mac, index, expires) < 0) {
+        dhcp_log_warn("Advertencia: Sin memoria para registrar la oferta de la IP %u.\n", ip);
+        return 0;
     }
+    ip_bitmap_set_used(&range->free_map, index);
+    event_loop_note_deadline(expires);
+    return ip;
+}
 
-    return root;  // Retornar la nueva raíz después de posibles eliminaciones
+void withdraw_offer(ip_range_t* range, const uint8_t* mac, uint32_t requested_ip) {
+    uint32_t index = offer_table_find(&range->offers, mac);
+    if (index == OFFER_NONE || range->start_ip + index == requested_ip) {
+        return;
+    }
+    offer_table_take(&range->offers, mac, index);
+    ip_bitmap_set_free(&range->free_map, index);
+    dhcp_stat_inc(DHCP_STAT_OFFERS_WITHDRAWN);
 }
 
-void send_dhcp_options(struct dhcp_packet* packet, int message_type, uint32_t assigned_ip) {
-    // Reiniciar opciones
-    memset(packet->options, 0, sizeof(packet->options));
-
-    // Opción 53: Tipo de mensaje DHCP
-    packet->options[0] = 53;   // Código de la opción
-    packet->options[1] = 1;    // Longitud de la opción
-    packet->options[2] = message_type;  // Tipo de mensaje DHCP
-
-    // Opción 54: Identificador del servidor DHCP
-    packet->options[3] = 54;   // Código de la opción
-    packet->options[4] = 4;    // Longitud de la opción
-    uint32_t net_server_ip = htonl(server_ip);
-    memcpy(&packet->options[5], &net_server_ip, 4);
-
-    // Opción 51: Tiempo de concesión
-    packet->options[9] = 51;  // Código de la opción
-    packet->options[10] = 4;  // Longitud de la opción
-    uint32_t net_lease_time = htonl(default_lease_time);
-    memcpy(&packet->options[11], &net_lease_time, 4);
-
-    // Opción 1: Máscara de subred
-    packet->options[15] = 1;   // Código de la opción
-    packet->options[16] = 4;   // Longitud de la opción
-    uint32_t net_subnet_mask = htonl(subnet_mask);
-    memcpy(&packet->options[17], &net_subnet_mask, 4);
-
-    // Opción 3: Puerta de enlace (Gateway)
-    packet->options[21] = 3;   // Código de la opción
-    packet->options[22] = 4;   // Longitud de la opción
-    uint32_t net_gateway_ip = htonl(gateway_ip);
-    memcpy(&packet->options[23], &net_gateway_ip, 4);
-
-    // Opción 6: Servidor DNS
-    packet->options[27] = 6;   // Código de la opción
-    packet->options[28] = 4;   // Longitud de la opción
-    uint32_t net_dns_server_ip = htonl(dns_server_ip);
-    memcpy(&packet->options[29], &net_dns_server_ip, 4);
-
-    // Opción 12: Nombre de host
-    const char* hostname = "DHCPClient";
-    packet->options[33] = 12;  // Código de la opción
-    packet->options[34] = strlen(hostname);  // Longitud de la opción
-    memcpy(&packet->options[35], hostname, strlen(hostname));
-
-    // Opción 15: Nombre de dominio
-    const char* domain_name = "example.com";
-    packet->options[35 + strlen(hostname)] = 15;  // Código de la opción
-    packet->options[36 + strlen(hostname)] = strlen(domain_name);  // Longitud de la opción
-    memcpy(&packet->options[37 + strlen(hostname)], domain_name, strlen(domain_name));
-
-    // Opción 55: Lista de parámetros solicitados
-    uint8_t parameter_request_list[] = {1, 3, 6, 12, 15, 28, 42, 51, 54, 119};
-    int param_request_offset = 37 + strlen(hostname) + strlen(domain_name);
-    packet->options[param_request_offset] = 55;  // Código de la opción
-    packet->options[param_request_offset + 1] = sizeof(parameter_request_list);  // Longitud
-    memcpy(&packet->options[param_request_offset + 2], parameter_request_list, sizeof(parameter_request_list));
-
-    // Opción 28: Dirección de broadcast
-    uint32_t broadcast_addr = (assigned_ip & subnet_mask) | ~subnet_mask;
-    broadcast_addr = htonl(broadcast_addr);
-    int broadcast_offset = param_request_offset + 2 + sizeof(parameter_request_list);
-    packet->options[broadcast_offset] = 28;  // Código de la opción
-    packet->options[broadcast_offset + 1] = 4;  // Longitud
-    memcpy(&packet->options[broadcast_offset + 2], &broadcast_addr, 4);
-
-    // Opción 42: Servidor NTP
-    uint32_t ntp_server = inet_addr("192.168.1.2");
-    packet->options[broadcast_offset + 6] = 42;  // Código de la opción
-    packet->options[broadcast_offset + 7] = 4;  // Longitud
-    memcpy(&packet->options[broadcast_offset + 8], &ntp_server, 4);
-
-    // Opción 255: Fin de las opciones
-    packet->options[broadcast_offset + 12] = 255;  // Código de fin de opciones
+// Dirección de una MAC que vuelve a pedir IP (con el lock del rango tomado): la de su oferta pendiente (un DISCOVER
+// retransmitido no gasta otra dirección), la de su lease activo, que se vuelve a ofrecer, o
+// la de su último lease terminado si nadie la tomó desde entonces. Las dos últimas solo con
+// DHCP_STICKY_LEASES. Retorna 0 si la MAC no tiene ninguna.
+static uint32_t returning_client_address(ip_range_t* range, uint8_t* mac) {
+    uint32_t offered = offer_table_find(&range->offers, mac);
+    if (offered != OFFER_NONE) {
+        return offer_address(range, offered, mac);
+    }
+    if (!sticky_leases) {
+        return 0;
+    }
+
+    int ghost;
+    uint32_t index = mac_index_find(&range->clients, mac, &ghost);
+    if (index == MAC_INDEX_NONE) {
+        return 0;
+    }
+    uint32_t ip = range->start_ip + index;
+    if (!ghost) {
+        dhcp_stat_inc(DHCP_STAT_RETURN_ACTIVE);
+        return ip;
+    }
+
+    // Una reserva de otro worker no es un lease: el worker la descarta al ver el registro
+    if (address_taken(range, index) || offer_address(range, index, mac) == 0) {
+        mac_index_forget(&range->clients, mac);  // Otro cliente ya tiene la IP
+        return 0;
+    }
+    dhcp_stat_inc(DHCP_STAT_RETURN_GHOST);
+    return ip;
 }
 
-void handle_signal(int signal) {
-    if (signal == SIGINT || signal == SIGTERM) {
-        printf("\nSeñal %d recibida. Cerrando el servidor DHCP...\n", signal);
+// Direcciones libres reservadas por un hilo, al estilo de las cachés por hilo de tcmalloc:
+// se toman del bitmap de a lotes con un solo recorrido y quedan marcadas como ocupadas, así
+// que ningún otro hilo las elige. Al asignar una ya no hay que buscar ni mover el cursor del
+// shard con el lock tomado: solo registrar el lease. Una reserva puede quedar vieja (un
+// REQUEST la pidió por su cuenta, o se liberó y la tomó otro hilo); el almacén lo detecta
+// al registrarla y se pasa a la siguiente.
+typedef struct {
+    ip_range_t* shard;       // Shard de las reservas (NULL si no hay)
+    uint32_t capacity;       // Tamaño del lote (0 = el hilo asigna directo del shard)
+    uint32_t next;           // Próxima reserva a entregar
+    uint32_t count;          // Reservas en `indices` (las entregadas están antes de `next`)
+    uint32_t indices[ADDR_CACHE_MAX];
+} address_cache_t;
+
+static __thread address_cache_t address_cache;
+static uint32_t address_cache_threads = 0;  // Hilos con reservas (para el umbral de pool bajo)
+
+// Con menos libres que esto el pool está bajo: no se reserva más y se devuelve lo reservado
+static uint32_t address_cache_low_water(const address_cache_t* cache) {
+    return cache->capacity * 2 * __atomic_load_n(&address_cache_threads, __ATOMIC_RELAXED);
+}
 
-        // Cerrar el socket del servidor
-        if (server_socket > 0) {
-            if (close(server_socket) < 0) {
-                perror("Error al cerrar el socket del servidor");
-            } else {
-                printf("Socket del servidor cerrado correctamente.\n");
-            }
+// Devolver al bitmap las reservas sin asignar (con el lock del shard tomado)
+static void return_reserved_addresses(address_cache_t* cache) {
+    ip_range_t* shard = cache->shard;
+    for (uint32_t i = cache->next; i < cache->count; i++) {
+        uint32_t index = cache->indices[i];
+        if (!address_taken(shard, index)) {
+            ip_bitmap_set_free(&shard->free_map, index);
         }
+    }
+    cache->next = cache->count = 0;
+    cache->shard = NULL;
+}
 
-        // Liberar la memoria del árbol de asignaciones de IPs
-        if (ip_assignment_root != NULL) {
-            free_ip_assignment_tree(ip_assignment_root);
-            printf("Memoria liberada para el árbol de asignaciones de IPs.\n");
+// Reservar un lote siguiendo el cursor round-robin (con el lock del shard tomado)
+static void refill_address_cache(address_cache_t* cache, ip_range_t* range) {
+    cache->shard = range;
+    cache->next = cache->count = 0;
+    while (cache->count < cache->capacity) {
+        uint32_t index = ip_bitmap_find_free(&range->free_map, range->cursor);
+        if (index == IP_BITMAP_NONE) {
+            break;
         }
+        ip_bitmap_set_used(&range->free_map, index);
+        cache->indices[cache->count++] = index;
+        range->cursor = index + 1;
+    }
+}
 
-        // Destruir los mutex (si se están utilizando)
-        if (pthread_mutex_destroy(&ip_assignment_mutex) != 0) {
-            perror("Error al destruir el mutex");
-        } else {
-            printf("Mutex destruidos.\n");
+void address_cache_attach(uint32_t capacity) {
+    address_cache_t* cache = &address_cache;
+    if (capacity > ADDR_CACHE_MAX) {
+        capacity = ADDR_CACHE_MAX;
+    }
+    if (cache->capacity == 0 && capacity > 0) {
+        __atomic_fetch_add(&address_cache_threads, 1, __ATOMIC_RELAXED);
+    } else if (cache->capacity > 0 && capacity == 0) {
+        address_cache_release();
+        __atomic_fetch_sub(&address_cache_threads, 1, __ATOMIC_RELAXED);
+    }
+    cache->capacity = capacity;
+}
+
+void address_cache_release() {
+    address_cache_t* cache = &address_cache;
+    ip_range_t* shard = cache->shard;
+    if (shard == NULL) {
+        return;
+    }
+    dhcp_mutex_lock(&shard->lock);
+    return_reserved_addresses(cache);
+    dhcp_mutex_unlock(&shard->lock);
+}
+
+uint32_t address_cache_count() {
+    return address_cache.count - address_cache.next;
+}
+
+// Asignar desde las reservas del hilo, reponiéndolas de a lote. Retorna 0 si no quedó ninguna
+// (pool bajo o agotado): el llamador asigna directo del shard.
+static uint32_t assign_reserved_address(ip_range_t* range, struct dhcp_packet* request) {
+    address_cache_t* cache = &address_cache;
+
+    dhcp_mutex_lock(&range->lock);
+    uint32_t assigned_ip = returning_client_address(range, request->chaddr);
+    while (assigned_ip == 0) {
+        if (cache->next == cache->count) {
+            if (range->free_map.free_count <= address_cache_low_water(cache)) {
+                break;
+            }
+            refill_address_cache(cache, range);
+            if (cache->count == 0) {
+                break;
+            }
         }
+        uint32_t index = cache->indices[cache->next++];
+        if (!address_taken(range, index)) {
+            assigned_ip = offer_address(range, index, request->chaddr);
+        }
+    }
 
-        // Imprimir mensaje de cierre final
-        printf("Servidor DHCP cerrado correctamente.\n");
+    // Con el pool bajo, las reservas vuelven al bitmap para los demás hilos
+    if (cache->next < cache->count && range->free_map.free_count < address_cache_low_water(cache)) {
+        return_reserved_addresses(cache);
+    }
+    dhcp_mutex_unlock(&range->lock);
 
-        // Salir del programa
-        exit(0);
+    if (assigned_ip != 0) {
+        dhcp_log_debug("Dirección IP asignada a cliente con MAC " DHCP_MAC_FMT ": " DHCP_IP_FMT "\n",
+                       DHCP_MAC_ARGS(request->chaddr), DHCP_IP_ARGS(assigned_ip));
     }
+    return assigned_ip;
 }
 
-uint8_t* find_dhcp_option(uint8_t* options, uint8_t code) {
-    int i = 0;
+// Mezcla de 64 bits (finalizador de MurmurHash3)
+static inline uint64_t mix_bits(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
 
-    // Recorrer las opciones hasta encontrar la opción de fin (código 255)
-    while (i < 312) {  // Longitud fija del array de opciones
-        uint8_t option_code = options[i];  // Código de la opción actual
+// Posición dentro del rango para un hash (multiplicación en lugar de módulo)
+static inline uint32_t hash_position(uint64_t hash, uint32_t size) {
+    return (uint32_t)(((hash >> 32) * size) >> 32);
+}
 
-        // Si encontramos el código de fin (255), detener la búsqueda
-        if (option_code == 255) {
-            printf("End of options reached.\n");
-            break;
+uint64_t allocation_hash(const ip_range_t* range, const struct dhcp_packet* request, const dhcp_option_index_t* options) {
+    const uint8_t* id = request->chaddr;
+    uint8_t length = 6;
+    const uint8_t* client_id;
+    uint8_t client_id_length;
+    if (options && dhcp_get_client_id(options, &client_id, &client_id_length)) {
+        id = client_id;
+        length = client_id_length;
+    }
+
+    // De a 8 bytes, con la clave al principio y al final: sin la clave no se puede predecir la IP
+    uint64_t hash = range->hash_key ^ ((uint64_t)length * 0x9e3779b97f4a7c15ULL);
+    for (uint32_t i = 0; i < length; i += 8) {
+        uint64_t chunk = 0;
+        memcpy(&chunk, id + i, length - i < 8 ? length - i : 8);
+        hash = mix_bits(hash ^ chunk);
+    }
+    return mix_bits(hash ^ range->hash_key);
+}
+
+uint32_t find_hashed_free(const ip_range_t* range, uint64_t hash, uint32_t* probes) {
+    uint32_t size = range->free_map.size;
+    for (uint32_t probe = 0; probe < HASH_ALLOC_PROBES; probe++) {
+        // Cada intento es una posición independiente: no se forman racimos de ocupadas
+        uint64_t candidate = probe ? mix_bits(hash + probe * 0x9e3779b97f4a7c15ULL) : hash;
+        uint32_t index = hash_position(candidate, size);
+        if (ip_bitmap_is_free(&range->free_map, index)) {
+            *probes = probe + 1;
+            return index;
         }
+    }
 
-        // Si encontramos el código de opción deseado, devolver un puntero al valor de la opción
-        if (option_code == code) {
-            return &options[i + 2];  // Retornar el puntero al valor (i + 2 salta código y longitud)
+    // Pool casi lleno: la primera libre desde la preferida (sigue siendo determinista)
+    *probes = HASH_ALLOC_PROBES + 1;
+    return ip_bitmap_find_free(&range->free_map, hash_position(hash, size));
+}
+
+uint32_t assign_ip_address(ip_range_t* range, struct dhcp_packet* request, const dhcp_option_index_t* options) {
+    // Con reservas del hilo (solo round-robin: "lowest" necesita ver todo el bitmap y "hash"
+    // elige según el cliente)
+    address_cache_t* cache = &address_cache;
+    if (cache->capacity > 0 && range->policy == IP_ALLOC_ROUND_ROBIN) {
+        if (cache->shard != NULL && cache->shard != range) {
+            address_cache_release();  // Las reservas son de otro shard
+        }
+        uint32_t assigned_ip = assign_reserved_address(range, request);
+        if (assigned_ip != 0) {
+            return assigned_ip;
         }
+    }
+
+    // El hash del cliente se calcula antes de tomar el lock
+    uint64_t hash = range->policy == IP_ALLOC_HASH ? allocation_hash(range, request, options) : 0;
+    dhcp_mutex_lock(&range->lock);  // Bloquear el acceso al almacén del shard
+
+    // Un cliente que vuelve (por ejemplo tras reiniciarse) recibe la IP que ya tenía
+    uint32_t returning_ip = returning_client_address(range, request->chaddr);
+    if (returning_ip != 0) {
+        dhcp_mutex_unlock(&range->lock);
+        dhcp_log_debug("Cliente con MAC " DHCP_MAC_FMT " recibe de nuevo la IP " DHCP_IP_FMT "\n",
+                       DHCP_MAC_ARGS(request->chaddr), DHCP_IP_ARGS(returning_ip));
+        return returning_ip;
+    }
+
+    // Buscar la siguiente IP libre en el bitmap según la política del pool
+    uint32_t index;
+    if (range->policy == IP_ALLOC_HASH) {
+        uint32_t probes;
+        index = find_hashed_free(range, hash, &probes);
+    } else {
+        uint32_t from = range->policy == IP_ALLOC_ROUND_ROBIN ? range->cursor : 0;
+        index = ip_bitmap_find_free(&range->free_map, from);
+    }
+    if (index == IP_BITMAP_NONE) {
+        dhcp_mutex_unlock(&range->lock);  // Liberar el mutex si no se encuentra IP
+
+        // Si llegamos aquí, no hay IPs disponibles
+        dhcp_log_warn("Error: No hay más direcciones IP disponibles en el rango %u - %u.\n", range->start_ip, range->end_ip);
+        return 0;
+    }
+
+    uint32_t potential_ip = offer_address(range, index, request->chaddr);
+    range->cursor = index + 1;  // La política round-robin sigue desde la próxima IP
+    dhcp_mutex_unlock(&range->lock);  // Desbloquear antes de retornar
 
-        // Si no es la opción deseada, avanzar a la siguiente (código + longitud + valor)
-        uint8_t option_length = options[i + 1];  // Longitud de la opción
-        i += 2 + option_length;  // Avanzar al siguiente código de opción
+    if (potential_ip != 0) {
+        dhcp_log_debug("Dirección IP asignada a cliente con MAC " DHCP_MAC_FMT ": " DHCP_IP_FMT "\n",
+                       DHCP_MAC_ARGS(request->chaddr), DHCP_IP_ARGS(potential_ip));
+    }
+    return potential_ip;
+}
+
+ip_alloc_policy_t parse_alloc_policy(const char* name) {
+    if (name && strcmp(name, "lowest") == 0) {
+        return IP_ALLOC_LOWEST;
+    }
+    if (name && strcmp(name, "hash") == 0) {
+        return IP_ALLOC_HASH;
+    }
+    if (name && strcmp(name, "round_robin") != 0) {
+        fprintf(stderr, "Advertencia: Política de asignación '%s' desconocida, se usa round_robin.\n", name);
     }
+    return IP_ALLOC_ROUND_ROBIN;
+}
 
-    // Si no se encuentra la opción, devolver NULL
-    printf("Option %d not found.\n", code);
-    return NULL;
+uint64_t parse_hash_key(const char* text) {
+    if (text == NULL) {
+        return 0;
+    }
+    // FNV-1a de 64 bits sobre el texto
+    uint64_t key = 0xcbf29ce484222325ULL;
+    for (; *text; text++) {
+        key = (key ^ (uint8_t)*text) * 0x100000001b3ULL;
+    }
+    return key;
 }
 
-int get_lease_remaining(ip_assignment_node_t* assignment) {
+// Las funciones de asignación deben llamarse con el lock del rango tomado
+ip_assignment_t* insert_ip_assignment(ip_range_t* range, uint32_t ip, uint8_t* mac, int lease_time) {
+    ip_assignment_t* assignment = lease_store_insert(&range->leases, ip, mac, lease_time, (uint32_t)time(NULL));
     if (assignment == NULL) {
-        return -1; // Retorna -1 si no hay asignación válida
+        dhcp_log_warn("Advertencia: La IP %u ya está asignada o está fuera del pool.\n", ip);
+        return NULL;
     }
 
-    // Validar que los tiempos sean sensatos (lease_time no negativo y lease_start válido)
-    if (assignment->lease_time <= 0 || assignment->lease_start <= 0) {
-        return -1; // Valores inválidos
+    // Sin registro en el journal el lease no existe: no se confirma algo que se perdería al reiniciar
+    if (lease_journal_append(LEASE_JOURNAL_GRANT, ip, mac, assignment->lease_start, assignment->lease_time) < 0) {
+        lease_store_delete(&range->leases, ip);
+        return NULL;
     }
 
-    time_t current_time = time(NULL); // Obtener el tiempo actual
-    int elapsed_time = current_time - assignment->lease_start; // Tiempo transcurrido desde el inicio del lease
+    // Mantener el bitmap de libres, el índice de MACs y el timer de vencimiento sincronizados con el almacén
+    ip_bitmap_set_used(&range->free_map, ip - range->start_ip);
+    if (mac_index_set(&range->clients, mac, ip - range->start_ip) < 0) {
+        dhcp_log_warn("Advertencia: Sin memoria para indexar la MAC de la IP %u.\n", ip);
+    }
+    dhcp_stat_inc(DHCP_STAT_LEASES_GRANTED);
+    uint64_t expires = timer_clock_ms() + (uint64_t)lease_time * 1000;
+    timer_wheel_schedule(&range->lease_timers, ip - range->start_ip, expires);
 
-    int remaining_time = assignment->lease_time - elapsed_time; // Calcular el tiempo restante
+    // Si vence antes que lo armado, el bucle de eventos rearma su timerfd
+    event_loop_note_deadline(expires);
+    return assignment;
+}
 
-    // Si el tiempo restante es negativo, significa que el lease ha expirado
-    return remaining_time > 0 ? remaining_time : 0; // Si es negativo, devolver 0
+int delete_ip_assignment(ip_range_t* range, uint32_t ip, int reason) {
+    ip_assignment_t* assignment = lease_store_find(&range->leases, ip);
+    if (assignment == NULL) {
+        return 0;
+    }
+    lease_journal_append(reason, ip, assignment->mac, 0, 0);
+    dhcp_stat_inc(reason == LEASE_JOURNAL_DECLINE ? DHCP_STAT_LEASES_DECLINED :
+                  reason == LEASE_JOURNAL_EXPIRE ? DHCP_STAT_LEASES_EXPIRED : DHCP_STAT_LEASES_RELEASED);
+
+    // Una IP rechazada no se le vuelve a ofrecer a la misma MAC
+    if (reason == LEASE_JOURNAL_DECLINE) {
+        mac_index_remove(&range->clients, assignment->mac, ip - range->start_ip);
+    } else {
+        mac_index_retire(&range->clients, assignment->mac, ip - range->start_ip);
+    }
+    lease_store_delete(&range->leases, ip);
+    ip_bitmap_set_free(&range->free_map, ip - range->start_ip);
+    timer_wheel_cancel(&range->lease_timers, ip - range->start_ip);
+    return 1;
 }
 
-void print_tree(ip_assignment_node_t* root) {
-    if (root == NULL) {
-        return;  // Si el nodo es NULL, no hacemos nada
+int renew_ip_assignment(ip_range_t* range, ip_assignment_t* assignment) {
+    uint32_t ip = lease_store_ip(&range->leases, assignment);
+    uint32_t lease_start = (uint32_t)time(NULL);
+    if (lease_journal_append(LEASE_JOURNAL_RENEW, ip, assignment->mac, lease_start, assignment->lease_time) < 0) {
+        return -1;
     }
+    assignment->lease_start = lease_start;
+    timer_wheel_schedule(&range->lease_timers, ip - range->start_ip,
+                         timer_clock_ms() + (uint64_t)assignment->lease_time * 1000);
+    return 0;
+}
 
-    // Recorrer el subárbol izquierdo
-    print_tree(root->left);
+ip_assignment_t* find_ip_assignment(ip_range_t* range, uint32_t ip) {
+    return lease_store_find(&range->leases, ip);
+}
 
-    // Obtener la representación de la IP
-    char* ip_str = int_to_ip(root->ip);
+uint32_t check_expired_leases(ip_range_t* range) {
+    if (range->leases.leases == NULL) return 0;
+    uint64_t now = timer_clock_ms();
+    uint32_t expired = 0;
+
+    // Un solo bloqueo por lote: la rueda entrega únicamente los leases vencidos
+    dhcp_mutex_lock(&range->lock);
+    uint32_t index;
+    uint32_t lifted = 0;
+    while ((index = timer_wheel_expire_next(&range->lease_timers, now)) != TIMER_NONE) {
+        uint32_t expired_ip = range->start_ip + index;
+        if (address_quarantined(range, index)) {
+            // Terminó la cuarentena de una IP rechazada: vuelve al pool
+            range->quarantined[index >> 6] &= ~(1ULL << (index & 63));
+            range->quarantined_count--;
+            ip_bitmap_set_free(&range->free_map, index);
+            lifted++;
+            continue;
+        }
+        lease_journal_append(LEASE_JOURNAL_EXPIRE, expired_ip, range->leases.leases[index].mac, 0, 0);
+        mac_index_retire(&range->clients, range->leases.leases[index].mac, index);
+        lease_store_delete(&range->leases, expired_ip);
+        ip_bitmap_set_free(&range->free_map, index);
+        expired++;
 
-    // Imprimir la información del nodo actual
-    printf("IP: %s, MAC: %02x:%02x:%02x:%02x:%02x:%02x, Lease Time: %d, Remaining: %d\n",
-           ip_str,
-           root->mac[0], root->mac[1], root->mac[2],
-           root->mac[3], root->mac[4], root->mac[5],
-           root->lease_time, get_lease_remaining(root));
+        dhcp_log_info("El lease para la IP " DHCP_IP_FMT " ha expirado.\n", DHCP_IP_ARGS(expired_ip));
+    }
 
-    // Liberar la memoria de la cadena IP (si `int_to_ip` asigna dinámicamente)
-    free(ip_str);
+    // Las ofertas vencidas salen de la cabeza del anillo y sus direcciones vuelven al bitmap
+    uint32_t offers = 0;
+    while ((index = offer_table_expire_next(&range->offers, now)) != OFFER_NONE) {
+        ip_bitmap_set_free(&range->free_map, index);
+        offers++;
+    }
+    dhcp_mutex_unlock(&range->lock);
 
-    // Recorrer el subárbol derecho
-    print_tree(root->right);
+    if (expired > 0) {
+        dhcp_stat_add(DHCP_STAT_LEASES_EXPIRED, expired);
+    }
+    if (lifted > 0) {
+        dhcp_stat_add(DHCP_STAT_QUARANTINE_ENDED, lifted);
+        dhcp_log_debug("%u direcciones salieron de la cuarentena en el rango %u - %u.\n", lifted, range->start_ip, range->end_ip);
+    }
+    if (offers > 0) {
+        dhcp_stat_add(DHCP_STAT_OFFERS_EXPIRED, offers);
+        dhcp_log_debug("%u ofertas vencieron sin REQUEST en el rango %u - %u.\n", offers, range->start_ip, range->end_ip);
+    }
+    return expired;
 }
 
-// Función para limpiar recursos y salir del programa
-void cleanup() {
-    if (server_socket != -1) close(server_socket);
-    pthread_mutex_destroy(&ip_assignment_mutex);
-    pthread_mutex_destroy(&client_id_mutex);
+uint64_t next_lease_deadline() {
+    uint64_t next = UINT64_MAX;
+    uint64_t offers = 0;
+    for (int i = 0; i < num_ip_shards; i++) {
+        dhcp_mutex_lock(&ip_shards[i].lock);
+        uint64_t deadline = timer_wheel_next_deadline(&ip_shards[i].lease_timers);
+        uint64_t offer_deadline = offer_table_next_deadline(&ip_shards[i].offers, timer_clock_ms());
+        offers += ip_shards[i].offers.live;
+        dhcp_mutex_unlock(&ip_shards[i].lock);
+        if (deadline < next) next = deadline;
+        if (offer_deadline < next) next = offer_deadline;
+    }
+
+    // Las ofertas pendientes se publican desde aquí, que ya toma el lock de cada shard (solo
+    // las cuenta el hilo del bucle de eventos, así el gauge no se suma entre hilos)
+    dhcp_stat_set(DHCP_STAT_OFFERS_PENDING, offers);
+    return next;
 }
 
-// Buscar si ya existe un cliente con el mismo XID o chaddr
-client_thread_info_t* find_client_thread(uint8_t* chaddr) {
-// Recorrer toda la tabla hash para buscar el cliente basado en la dirección MAC
-    for (int i = 0; i < HASH_TABLE_SIZE; i++) {
-        client_thread_info_t* current = client_threads[i];
-        while (current != NULL) {
-            // Comparamos solo la MAC address
-            if (memcmp(current->chaddr, chaddr, 6) == 0) {
-                return current;  // Cliente encontrado
-            }
-            current = current->next;
+size_t send_dhcp_options(struct dhcp_packet* packet, const dhcp_option_index_t* options, int message_type, uint32_t assigned_ip) {
+    pthread_once(&options_once, compile_server_options);
+
+    // Copiar la plantilla de la lista de parámetros del cliente y parchear tipo, concesión y broadcast
+    const uint8_t* list = NULL;
+    uint8_t list_length = 0;
+    dhcp_get_parameter_list(options, &list, &list_length);
+    return dhcp_options_encode(packet->options, list, list_length, message_type, assigned_ip, default_lease_time);
+}
+
+void handle_signal(int signal) {
+    if (signal == SIGUSR2) {
+        // Resumen de latencias (y de contención de locks) a pedido, sin detener el servidor
+        dhcp_trace_dump(stdout);
+        if (dhcp_lock_profiling) {
+            dhcp_lock_dump(stdout);
         }
+    } else if (signal == SIGINT || signal == SIGTERM) {
+        printf("\nSeñal %d recibida. Cerrando el servidor DHCP...\n", signal);
+        shutdown_server();
     }
-    return NULL;  // No se encontró cliente con esa MAC
 }
 
-// Añadir un cliente nuevo a la tabla hash
-void add_client_thread(uint8_t* chaddr, pthread_t thread_id, client_info_t* client_info) {
-    // Calcular el índice hash usando la dirección MAC del cliente
-    unsigned int hash = hash_mac(chaddr);
+void shutdown_server() {
+    // Detener los hilos antes de liberar lo que usan (la señal llega por signalfd,
+    // así que aquí se puede esperar a que terminen)
+    stop_worker_pool();
+    stop_reuseport_workers();
 
-    // Crear una nueva entrada para el cliente
-    client_thread_info_t* new_entry = (client_thread_info_t*)malloc(sizeof(client_thread_info_t));
-    if (new_entry == NULL) {
-        perror("Error al asignar memoria para la nueva entrada de cliente");
-        return;
+    // Llevar a disco los cambios pendientes y dejar un snapshot para el próximo arranque
+    if (lease_journal_enabled) {
+        lease_journal_close();
+        lease_journal_print_stats(stdout);
     }
 
-    memcpy(new_entry->chaddr, chaddr, 6);  // Copiar la dirección MAC
-    new_entry->thread_id = thread_id;
-    new_entry->client_info = client_info;
+    // Escribir los mensajes pendientes; desde aquí se escriben en el momento
+    dhcp_log_stop();
 
-    // Insertar al principio de la lista enlazada en la posición hash calculada
-    new_entry->next = client_threads[hash];
-    client_threads[hash] = new_entry;
-}
+    // Dejar de esperar relevos (el archivo no se borra: puede ser ya del proceso nuevo)
+    if (handoff_fd >= 0) {
+        close(handoff_fd);
+        handoff_fd = -1;
+    }
 
-// Eliminar un cliente de la tabla hash
-void remove_client_thread(uint8_t* chaddr) {
-    for (int i = 0; i < HASH_TABLE_SIZE; ++i) {
-        client_thread_info_t* current = client_threads[i];
-        client_thread_info_t* prev = NULL;
-
-        // Recorrer la lista enlazada buscando por dirección MAC
-        while (current != NULL) {
-            if (memcmp(current->chaddr, chaddr, 6) == 0) {
-                // Encontramos el cliente, eliminamos el nodo
-                if (prev == NULL) {
-                    // El cliente está al principio de la lista
-                    client_threads[i] = current->next;
-                } else {
-                    // El cliente está en el medio o al final de la lista
-                    prev->next = current->next;
-                }
-                free(current);
-                printf("Cliente con MAC %02x:%02x:%02x:%02x:%02x:%02x eliminado correctamente.\n",
-                       chaddr[0], chaddr[1], chaddr[2], chaddr[3], chaddr[4], chaddr[5]);
-                return;
-            }
-            prev = current;
-            current = current->next;
+    // Las estadísticas dejan de publicarse (tras un relevo el nombre ya es del proceso nuevo)
+    if (!handed_off) {
+        dhcp_stats_remove();
+    }
+
+    // Cerrar el socket del servidor
+    if (server_socket > 0) {
+        if (close(server_socket) < 0) {
+            perror("Error al cerrar el socket del servidor");
+        } else {
+            printf("Socket del servidor cerrado correctamente.\n");
         }
     }
 
-    // Si llegamos aquí, el cliente no se encontró
-    printf("Cliente con MAC %02x:%02x:%02x:%02x:%02x:%02x no encontrado para eliminación.\n",
-           chaddr[0], chaddr[1], chaddr[2], chaddr[3], chaddr[4], chaddr[5]);
-    exit(1);
+    // Mostrar los contadores de E/S antes de salir
+    print_io_stats(difftime(time(NULL), server_start_time));
+    if (dhcp_trace_enabled) {
+        dhcp_trace_dump(stdout);
+    }
+    if (dhcp_lock_profiling) {
+        dhcp_lock_dump(stdout);
+    }
+
+    // Liberar la memoria de los shards del pool (almacén, bitmap, timers y locks)
+    for (int i = 0; i < num_ip_shards; i++) {
+        free_ip_range(&ip_shards[i]);
+    }
+    if (num_ip_shards > 0) {
+        printf("Memoria liberada para el almacén de asignaciones de IPs.\n");
+    }
+
+    // Destruir los mutex (si se están utilizando)
+    if (dhcp_mutex_destroy(&client_id_mutex) != 0) {
+        perror("Error al destruir el mutex");
+    } else {
+        printf("Mutex destruidos.\n");
+    }
+
+    // Imprimir mensaje de cierre final
+    printf("Servidor DHCP cerrado correctamente.\n");
+
+    // Salir del programa
+    exit(0);
+}
+
+int get_lease_remaining(ip_assignment_t* assignment) {
+    if (assignment == NULL) {
+        return -1; // Retorna -1 si no hay asignación válida
+    }
+
+    // Validar que los tiempos sean sensatos (lease_time no negativo y lease_start válido)
+    if (assignment->lease_time == 0 || assignment->lease_start == 0) {
+        return -1; // Valores inválidos
+    }
+
+    time_t current_time = time(NULL); // Obtener el tiempo actual
+    int elapsed_time = current_time - assignment->lease_start; // Tiempo transcurrido desde el inicio del lease
+
+    int remaining_time = assignment->lease_time - elapsed_time; // Calcular el tiempo restante
+
+    // Si el tiempo restante es negativo, significa que el lease ha expirado
+    return remaining_time > 0 ? remaining_time : 0; // Si es negativo, devolver 0
 }
 
-unsigned int hash_mac(const uint8_t* mac) {
-    unsigned int hash = 0;
-    for (int i = 0; i < 6; ++i) {
-        hash = (hash * 31) + mac[i];  // Mezclar cada byte de la MAC en el hash
+void print_leases(ip_range_t* range) {
+    // Recorrer el almacén en orden de IP, saltando los tramos nunca escritos y los registros libres
+    uint32_t end;
+    for (uint32_t index = lease_store_next_written(&range->leases, 0, &end); index < range->leases.size;
+         index = lease_store_next_written(&range->leases, end, &end)) {
+        for (; index < end; index++) {
+            ip_assignment_t* assignment = &range->leases.leases[index];
+            if (assignment->state != LEASE_ACTIVE) {
+                continue;
+            }
+
+            // Obtener la representación de la IP
+            char ip_str[INET_ADDRSTRLEN];
+            int_to_ip(range->start_ip + index, ip_str);
+
+            // Imprimir la información de la asignación actual
+            printf("IP: %s, MAC: %02x:%02x:%02x:%02x:%02x:%02x, Lease Time: %u, Remaining: %d\n",
+                   ip_str,
+                   assignment->mac[0], assignment->mac[1], assignment->mac[2],
+                   assignment->mac[3], assignment->mac[4], assignment->mac[5],
+                   assignment->lease_time, get_lease_remaining(assignment));
+        }
     }
-    return hash % HASH_TABLE_SIZE;  // Asegurar que el hash esté dentro del rango de la tabla
+}
+
+// Función para limpiar recursos y salir del programa
+void cleanup() {
+    dhcp_log_stop();
+    if (server_socket != -1) close(server_socket);
+    dhcp_mutex_destroy(&client_id_mutex);
 }
@@ -14,15 +14,48 @@
 #include <stdlib.h> // Para malloc, free
 #include <signal.h> // Para signal
 #include <stdint.h> // Para uint8_t, uint16_t, uint32_t
+#include <stddef.h> // Para offsetof
 #include <sys/time.h> // Para timeval
-#include <sys/ipc.h>    // Para ftok
-#include <sys/msg.h>    // Para msgget, msgsnd, msgrcv
+#include "dhcp_txn_table.h" // Tabla de transacciones en vuelo
+#include "ip_bitmap.h"      // Bitmap jerárquico de direcciones libres
+#include "lease_store.h"    // Almacén plano de asignaciones de IPs
+#include "mac_index.h"      // Índice MAC -> lease con fantasmas de los leases terminados
+#include "offer_table.h"    // Ofertas pendientes, separadas de los leases
+#include "timer_wheel.h"    // Rueda jerárquica de timers para los vencimientos
+#include "dhcp_io.h"        // Recepción y envío en lotes (recvmmsg/sendmmsg)
+#include "packet_ring.h"    // Anillo de buffers y colas de descriptores hacia los workers
+#include "dhcp_protocol.h"  // Índice de opciones y codificadores compartidos (src/common)
+#include "dhcp_options.h"   // Plantillas precompiladas de opciones de OFFER y ACK
+#include "dhcp_log.h"       // Log asíncrono con niveles (registros binarios por hilo)
+#include "lease_journal.h"  // Journal y snapshots de las asignaciones
+#include "dhcp_handoff.h"   // Relevo del servicio a un proceso nuevo (socket Unix + SCM_RIGHTS)
+#include "dhcp_stats.h"     // Contadores por hilo en memoria compartida
+#include "dhcp_lock.h"      // Mutex con perfil de contención opcional (src/common)
+#include "dhcp_trace.h"     // Latencia por etapa (histogramas y probes USDT)
 
 // Definiciones del servidor
 #define DHCP_SERVER_PORT 67
 #define BUFFER_SIZE 548
-#define MAX_IPS 3
-#define HASH_TABLE_SIZE 256
+#define WORKER_QUEUE_SIZE 1024  // Capacidad de la cola de cada worker (paquetes)
+#define WORKER_HELD_BATCHES 16  // Lotes de respuestas retenidos esperando el commit de sus leases
+#define TXN_EXPIRE_BATCH 64     // Transacciones vencidas que un worker reclama por paquete como máximo
+#define ADDR_CACHE_DEFAULT 32   // Direcciones reservadas por worker si no se define DHCP_ADDR_CACHE
+#define ADDR_CACHE_MAX 256      // Máximo de direcciones reservadas por worker
+#define ADDR_CACHE_IDLE_S 1     // Segundos sin paquetes tras los que un worker devuelve sus reservas
+#define HASH_ALLOC_PROBES 8     // Posiciones que prueba la política hash antes de buscar en el bitmap
+#define LEASE_GHOSTS_DEFAULT 65536  // Leases terminados que recuerda cada shard si no se define DHCP_LEASE_GHOSTS
+#define OFFER_TTL_DEFAULT_MS 2000   // Vida de una oferta sin REQUEST si no se define DHCP_OFFER_TTL_MS
+#define DECLINE_QUARANTINE_DEFAULT_S 600  // Cuarentena de una IP rechazada si no se define DHCP_DECLINE_QUARANTINE_S
+#define EVENT_LOOP_MAX_EVENTS 16       // Eventos que el bucle toma por epoll_wait
+#define URING_ENTRIES 256              // Entradas de la SQ del backend io_uring
+#define URING_BUFFERS 512              // Buffers provistos para la recepción (potencia de 2)
+#define URING_BUFFER_SIZE 640          // Encabezado de recvmsg + dirección + datagrama (548)
+#define URING_BUFFER_GROUP 1           // Identificador del grupo de buffers provistos
+#define URING_SQPOLL_IDLE_MS 1000      // Inactividad antes de que el hilo SQPOLL del kernel duerma
+
+// Motivos para despertar el bucle de eventos (event_loop_wakeup)
+#define DHCP_WAKE_TIMERS 0x1  // Rearmar el timerfd (hay un vencimiento más próximo)
+#define DHCP_WAKE_STOP   0x2  // Salir del bucle
 
 // Estructuras de datos
 typedef enum {
@@ -54,54 +87,69 @@ struct dhcp_packet {
     uint8_t options[312]; // Opciones DHCP (53 para tipo de mensaje)
 } __attribute__((packed));
 
-// Estructura para manejar la información de un cliente
-typedef struct {
-    int client_socket;
-    struct sockaddr_in client_addr;
-    const char* color;
-    int client_id;  // Identificador del cliente
-    int message_queue_id;
-    struct dhcp_packet initial_request;  // Nuevo campo para el paquete inicial DISCOVER
-} client_info_t;
-
-// Estructura para almacenar los hilos activos
-typedef struct client_thread_info {
-    uint8_t chaddr[6];       // Dirección MAC del cliente
-    pthread_t thread_id;     // ID del hilo que maneja al cliente
-    client_info_t* client_info; // Información del cliente asociada al hilo
-    struct client_thread_info* next;  // Lista enlazada para manejar colisiones
-} client_thread_info_t;
-
-extern client_thread_info_t* client_threads[HASH_TABLE_SIZE];
+// Estructura de un worker del pool fijo de hilos
+typedef struct dhcp_worker {
+    int id;                          // Índice del worker en el pool
+    int sockfd;                      // Socket por el que se envían las respuestas
+    pthread_t thread_id;             // Hilo del worker
+    dhcp_mutex_t queue_mutex;        // Mutex para dormir y despertar al worker (no protege la cola)
+    pthread_cond_t queue_cond;       // Señala que hay trabajo o que hay que salir
+    pthread_cond_t idle_cond;        // Señala que la cola quedó vacía
+    packet_queue_t queue;            // Descriptores pendientes (sin locks, un productor)
+    int sleeping;                    // El worker espera en queue_cond (el productor debe despertarlo)
+    int awaiting_commit;             // Además espera el commit de sus lotes retenidos
+    int busy;                        // El worker está procesando un paquete
+    int running;                     // El worker debe seguir ejecutándose
+    unsigned long processed;         // Paquetes procesados
+    unsigned long dropped;           // Paquetes descartados por cola llena
+    txn_table_t transactions;        // Transacciones en vuelo de las MACs de este worker
+    dhcp_packet_desc_t* batch;       // Descriptores tomados de la cola en una sola pasada
+    dhcp_msg_batch_t tx;             // Respuestas pendientes de enviar con sendmmsg
+    dhcp_msg_batch_t held[WORKER_HELD_BATCHES];  // Lotes anteriores esperando el commit de sus leases (solo con journal)
+    int held_first;                  // Lote retenido más viejo
+    int held_count;                  // Lotes retenidos
+} dhcp_worker_t;
+
+// Políticas para elegir la siguiente IP libre de un pool
+typedef enum {
+    IP_ALLOC_ROUND_ROBIN = 0,  // Continuar desde la última IP asignada (comportamiento original)
+    IP_ALLOC_LOWEST,           // Elegir siempre la IP libre más baja del pool
+    IP_ALLOC_HASH              // IP preferida según un hash con clave del client-id o la MAC
+} ip_alloc_policy_t;
 
 // Definimos el rango de IPs con un identificador de pool
 typedef struct {
     uint32_t start_ip;  // Dirección IP de inicio (entero de 32 bits)
     uint32_t end_ip;    // Dirección IP de fin (entero de 32 bits)
     int pool_id;        // Identificador del pool de IPs
+    ip_alloc_policy_t policy;  // Política de asignación del pool
+    uint64_t hash_key;  // Clave del hash de la política hash (IP_ALLOC_HASH_KEY)
+    uint32_t cursor;    // Índice desde el que busca la política round-robin
+    ip_bitmap_t free_map;      // Direcciones libres del pool
+    lease_store_t leases;      // Asignaciones del pool, una por IP
+    timer_wheel_t lease_timers;  // Vencimiento de cada lease o cuarentena (ms), indexado por ip - start_ip
+    mac_index_t clients;       // Lease activo o terminado de cada MAC del rango
+    offer_table_t offers;      // Direcciones ofrecidas que esperan el REQUEST (ocupadas en el bitmap, sin lease)
+    uint64_t* quarantined;     // Un bit por dirección rechazada con DECLINE (ocupada en el bitmap hasta su timer)
+    uint32_t quarantined_count;  // Direcciones en cuarentena
+    dhcp_mutex_t lock;         // Protege el bitmap, el almacén, los timers, el índice de MACs, las ofertas y la cuarentena del rango
 } ip_range_t;
 
-// Estructura para registrar las asignaciones de IP (nodo del árbol)
-typedef struct ip_assignment_node {
-    uint32_t ip;        // Dirección IP asignada (entero de 32 bits)
-    uint8_t mac[6];     // Dirección MAC del cliente
-    time_t lease_start; // Momento en que comenzó la concesión
-    int lease_time;     // Tiempo de concesión para esta IP (en segundos)
-    struct ip_assignment_node* left;  // Nodo izquierdo (IP menor)
-    struct ip_assignment_node* right; // Nodo derecho (IP mayor)
-} ip_assignment_node_t;
-
-// Estructura para el mensaje de la cola de mensajes
-typedef struct dhcp_message {
-    long mtype;               // Tipo de mensaje (obligatorio para las colas de mensajes)
-    uint8_t buffer[BUFFER_SIZE];  // El contenido del mensaje (paquete DHCP)
-    size_t length;            // Longitud del mensaje
-} dhcp_message_t;
+// Función para saber si una dirección del rango está en cuarentena (con el lock del rango tomado)
+static inline int address_quarantined(const ip_range_t* range, uint32_t index) {
+    return (range->quarantined[index >> 6] >> (index & 63)) & 1;
+}
+
+// Modos de recepción de paquetes del servidor (DHCP_IO_MODE)
+typedef enum {
+    DHCP_IO_WORKERS = 0,  // Un socket leído por el hilo principal que reparte a los workers
+    DHCP_IO_REUSEPORT,    // Un socket SO_REUSEPORT por núcleo, cada hilo procesa de punta a punta
+    DHCP_IO_URING         // Un anillo io_uring con recepción multishot y envíos en lote
+} dhcp_io_mode_t;
 
 // Variables globales
 extern int server_socket;          // Socket del servidor
 extern int default_lease_time;     // Tiempo de concesión predeterminado (en segundos)
-extern ip_assignment_node_t* ip_assignment_root;  // Raíz del árbol de asignaciones de IPs
 extern int client_id_counter;      // Contador global para generar IDs únicos de cliente
 extern ip_range_t global_ip_range; // Rango de IPs global
 extern uint32_t subnet_mask;
@@ -109,10 +157,22 @@ extern uint32_t gateway_ip;
 extern uint32_t dns_server_ip;
 extern uint32_t server_ip;
 extern const char* dhcp_server_ip;
+extern dhcp_worker_t* workers;     // Pool fijo de workers
+extern int num_workers;            // Número de workers del pool
+extern packet_ring_t worker_packet_ring;  // Buffers de los paquetes recibidos para los workers
+extern int handoff_fd;             // Socket Unix de relevo (-1 si no se esperan relevos)
+extern time_t server_start_time;   // Momento de arranque (para las tasas de los contadores)
+extern ip_range_t* ip_shards;      // Shards contiguos del pool, cada uno con su propio lock
+extern int num_ip_shards;          // Número de shards del pool
+extern uint32_t ip_shard_span;     // Direcciones por shard (el último puede tener menos)
+extern uint32_t address_cache_size;  // Direcciones que reserva cada worker (DHCP_ADDR_CACHE, 0 = sin reservas)
+extern uint32_t lease_ghost_limit;   // Leases terminados que recuerda cada shard (DHCP_LEASE_GHOSTS)
+extern int sticky_leases;            // DISCOVER de una MAC conocida recibe su IP de antes (DHCP_STICKY_LEASES)
+extern uint32_t offer_ttl_ms;        // Vida de una oferta sin REQUEST (DHCP_OFFER_TTL_MS, 0 = lease desde el OFFER)
+extern uint32_t decline_quarantine_s;  // Segundos sin asignar una IP rechazada (DHCP_DECLINE_QUARANTINE_S, 0 = sin cuarentena)
 
 // Mutexes para proteger el acceso a las variables globales
-extern pthread_mutex_t ip_assignment_mutex;  // Mutex para proteger el acceso a la tabla de asignaciones de IPs
-extern pthread_mutex_t client_id_mutex;  // Mutex para proteger el acceso al contador de IDs de cliente
+extern dhcp_mutex_t client_id_mutex;  // Mutex para proteger el acceso al contador de IDs de cliente
 
 // Prototipos de funciones
 
@@ -122,22 +182,115 @@ void init_dhcp_server(ip_range_t* range);
 // Función para configurar el rango de IPs
 void initialize_ip_pool(ip_range_t* range, const char* start_ip, const char* end_ip, int pool_id);
 
-// Función principal para manejar el protocolo DHCP
+// Función principal: bucle de eventos (epoll) sobre el socket (-1 si no hay), el timerfd
+// de vencimiento de leases, el signalfd de SIGINT/SIGTERM y el eventfd de despertares
 void handle_dhcp_protocol(int sockfd);
 
-// Función para crear un hilo que maneje a un cliente
-void* client_handler(void* client_info);
+// Función para bloquear SIGINT/SIGTERM en todos los hilos (se reciben por signalfd)
+void block_server_signals();
+
+// Función para crear los descriptores del bucle de eventos
+int event_loop_init(int sockfd);
+
+// Función para cerrar los descriptores del bucle de eventos
+void event_loop_free();
+
+// Función para obtener el descriptor epoll del bucle (para vigilarlo desde otro backend)
+int event_loop_fd();
+
+// Función para atender los eventos listos esperando como máximo `timeout_ms` (-1 sin límite).
+// Retorna -1 cuando se pidió salir del bucle (DHCP_WAKE_STOP) y 0 en otro caso.
+int event_loop_dispatch(int sockfd, dhcp_msg_batch_t* batch, int timeout_ms);
+
+// Función para despertar el bucle de eventos con los motivos DHCP_WAKE_* indicados
+void event_loop_wakeup(unsigned int reason);
+
+// Función para avisar al bucle de un vencimiento nuevo (ms); rearma el timer si es anterior
+void event_loop_note_deadline(uint64_t expires_ms);
+
+// Función para atender el protocolo con un socket SO_REUSEPORT por núcleo (DHCP_IO_MODE=reuseport)
+void run_reuseport_server();
+
+// Función para recibir un lote directamente en slots del anillo de los workers y
+// encolar sus descriptores (sin copiar los datagramas). Retorna los recibidos o -1.
+int receive_dhcp_packets(int sockfd, dhcp_msg_batch_t* batch, int flags);
+
+// Función para validar un paquete recibido y encolar su descriptor en el worker de su MAC
+// (si se descarta, se suelta su slot)
+void process_received_packet(dhcp_packet_desc_t* desc);
+
+// Función para iniciar el pool fijo de workers (count <= 0 usa el número de núcleos)
+int start_worker_pool(int sockfd, int count);
+
+// Función para detener el pool de workers y liberar sus transacciones
+void stop_worker_pool();
+
+// Función para esperar a que todos los workers vacíen sus colas (las respuestas retenidas
+// hasta el commit de sus leases salen cuando ese commit termina)
+void drain_worker_pool();
+
+// Función para encolar el descriptor de un paquete en el worker asignado a su MAC.
+// El worker suelta el slot al terminar; retorna -1 si su cola está llena.
+int enqueue_dhcp_packet(const dhcp_packet_desc_t* desc);
+
+// Función para copiar a un slot del anillo un paquete recibido por otra vía y encolarlo
+// (cuenta en io_stats.rx_copies). Solo puede llamarla el hilo que recibe.
+int dispatch_dhcp_packet(struct sockaddr_in* client_addr, const uint8_t* buffer, size_t length);
+
+// Función principal de cada worker del pool
+void* worker_loop(void* arg);
+
+// Función para indexar las opciones de un paquete y procesarlo según la máquina de estados de la transacción
+void process_dhcp_packet(dhcp_worker_t* worker, struct sockaddr_in* client_addr, struct dhcp_packet* request, size_t length);
+
+//================================================
+
+// Función para convertir el nombre de un modo de E/S ("workers", "reuseport", "uring")
+dhcp_io_mode_t parse_io_mode(const char* name);
+
+// Función para calcular el hash de una MAC (el mismo que aplica el programa BPF de steering)
+uint32_t steering_hash_mac(const uint8_t* mac);
+
+// Función para que el kernel reparta los paquetes del grupo SO_REUSEPORT según la MAC (chaddr)
+int attach_chaddr_steering(int sockfd, int groups);
+
+// Función para abrir `count` sockets SO_REUSEPORT en `port` con un hilo fijo a un núcleo por socket
+int start_reuseport_workers(int count, uint16_t port, int steer_by_chaddr);
+
+// Función para atender con hilos SO_REUSEPORT los `count` sockets recibidos en un relevo
+int adopt_reuseport_workers(const int* sockets, int count, int steer_by_chaddr);
+
+// Función para detener los hilos SO_REUSEPORT dejando sus sockets abiertos (para un relevo).
+// Copia los sockets en `sockets` y retorna cuántos son (-1 si no hay hilos o no entran).
+int quiesce_reuseport_workers(int* sockets, int max, int* steer_by_chaddr);
+
+// Función para volver a lanzar los hilos detenidos con quiesce_reuseport_workers
+int resume_reuseport_workers();
+
+// Función para esperar a que terminen los hilos SO_REUSEPORT
+void join_reuseport_workers();
+
+// Función para detener los hilos SO_REUSEPORT y cerrar sus sockets
+void stop_reuseport_workers();
+
+// Función principal de cada hilo SO_REUSEPORT (recibir, procesar y responder)
+void* reuseport_loop(void* arg);
+
+// Función para atender el protocolo con io_uring (recepción multishot con buffers provistos y
+// respuestas como SENDMSG en lote). Retorna -1 sin atender nada si el kernel no soporta io_uring.
+int run_uring_server(int sockfd, int sqpoll);
 
 //================================================
 
-// Función para validar un paquete DHCP
-int validate_dhcp_packet(struct dhcp_packet* packet);
+// Función para validar un paquete DHCP de `length` bytes e indexar sus opciones en `options`
+// (NULL valida solo el encabezado)
+int validate_dhcp_packet(struct dhcp_packet* packet, size_t length, dhcp_option_index_t* options);
 
-// Función para manejar solicitudes DHCP DISCOVER
-void handle_dhcp_discover(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request);
+// Función para manejar solicitudes DHCP DISCOVER (retorna la IP ofrecida o 0)
+uint32_t handle_dhcp_discover(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request, const dhcp_option_index_t* options);
 
-// Función para manejar solicitudes DHCP REQUEST
-void handle_dhcp_request(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request);
+// Función para manejar solicitudes DHCP REQUEST (retorna 1 si se envió ACK)
+int handle_dhcp_request(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request, const dhcp_option_index_t* options);
 
 // Función para manejar solicitudes DHCP DECLINE (cuando el cliente rechaza una IP)
 void handle_dhcp_decline(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request);
@@ -148,72 +301,133 @@ void handle_dhcp_release(int sockfd, struct sockaddr_in* client_addr, struct dhc
 // Función para manejar las señales del servidor
 void handle_signal(int signal);
 
-//================================================
+// Función para detener los hilos, guardar los leases, liberar todo y terminar el proceso
+void shutdown_server();
 
-// Función para enviar opciones DHCP en el paquete
-void send_dhcp_options(struct dhcp_packet* packet, int message_type, uint32_t assigned_ip);
+// Función para tomar los sockets y los leases del servidor que escucha en DHCP_HANDOFF_SOCKET
+// (pool dividido en shards, journal abierto). Copia hasta `max_sockets` sockets en `sockets` y
+// retorna cuántos son, 0 si no hay un servidor en marcha y -1 si el relevo falló.
+int take_over_server(int* sockets, int max_sockets, int* steer_by_chaddr);
+
+// Función para empezar a esperar pedidos de relevo en DHCP_HANDOFF_SOCKET (modos workers y reuseport)
+void start_handoff_listener();
+
+// Función para atender un pedido de relevo: si el proceso nuevo toma el servicio, este termina
+void serve_handoff();
+
+//================================================
 
-// Función para buscar una opción DHCP en el paquete
-uint8_t* find_dhcp_option(uint8_t* options, uint8_t code);
+// Función para escribir las opciones de un OFFER o ACK según la lista de parámetros (opción 55)
+// del cliente. Retorna la longitud real de las opciones escritas.
+size_t send_dhcp_options(struct dhcp_packet* packet, const dhcp_option_index_t* options, int message_type, uint32_t assigned_ip);
 
 // Función para enviar un paquete DHCP OFFER en respuesta a DISCOVER
-void send_dhcp_offer(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request, uint32_t assigned_ip);
+void send_dhcp_offer(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request, const dhcp_option_index_t* options, uint32_t assigned_ip);
 
 // Función para enviar un paquete DHCP ACK en respuesta a un REQUEST
-void send_dhcp_ack(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request, uint32_t assigned_ip);
+void send_dhcp_ack(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request, const dhcp_option_index_t* options, uint32_t assigned_ip);
 
 // Función para enviar un paquete DHCP NAK (cuando el servidor no puede asignar una IP)
 void send_dhcp_nak(int sockfd, struct sockaddr_in* client_addr, struct dhcp_packet* request);
 
 //================================================
 
-// Función para verificar si el lease de una IP ha expirado (para liberar IPs ocupadas)
-ip_assignment_node_t* check_expired_leases(ip_assignment_node_t* root);
+// Función para liberar en un lote los leases vencidos (retorna cuántos se liberaron)
+uint32_t check_expired_leases(ip_range_t* range);
+
+// Función para obtener el próximo vencimiento de lease (ms) de todos los shards (UINT64_MAX si no hay).
+// También publica el gauge de ofertas pendientes.
+uint64_t next_lease_deadline();
+
+// Función para asignar una dirección IP a un cliente (`options` puede ser NULL: la política hash
+// usa entonces la MAC aunque el cliente haya enviado client-id)
+uint32_t assign_ip_address(ip_range_t* range, struct dhcp_packet* request, const dhcp_option_index_t* options);
+
+// Función para calcular el hash con la clave del rango del client-id (opción 61) o, si no
+// está, de la MAC del cliente. No necesita el lock.
+uint64_t allocation_hash(const ip_range_t* range, const struct dhcp_packet* request, const dhcp_option_index_t* options);
+
+// Función para elegir la IP libre de un hash: prueba la posición preferida y hasta
+// HASH_ALLOC_PROBES - 1 más; si todas están ocupadas toma la primera libre desde la preferida.
+// Deja en `probes` las posiciones probadas (HASH_ALLOC_PROBES + 1 si se buscó en el bitmap).
+// Retorna el índice en el rango o IP_BITMAP_NONE. Requiere el lock del rango.
+uint32_t find_hashed_free(const ip_range_t* range, uint64_t hash, uint32_t* probes);
+
+// Función para que el hilo actual reserve direcciones de a lotes de `capacity` (0 = asignar
+// directo del shard). Solo se reserva con la política round-robin.
+void address_cache_attach(uint32_t capacity);
+
+// Función para devolver al shard las direcciones reservadas por el hilo actual que no se asignaron
+void address_cache_release();
+
+// Función para saber cuántas direcciones tiene reservadas el hilo actual
+uint32_t address_cache_count();
 
-// Función para asignar una dirección IP a un cliente
-uint32_t assign_ip_address(ip_range_t* range, struct dhcp_packet* request);
+// Función para convertir el nombre de una política de asignación ("round_robin", "lowest", "hash")
+ip_alloc_policy_t parse_alloc_policy(const char* name);
 
-// Función para buscar una dirección IP en el árbol de asignaciones
-ip_assignment_node_t* find_ip_assignment(ip_assignment_node_t* root, uint32_t ip);
+// Función para convertir IP_ALLOC_HASH_KEY (cualquier texto) en la clave del hash (0 si es NULL)
+uint64_t parse_hash_key(const char* text);
 
-// Función para insertar una nueva asignación en el árbol de IPs
-ip_assignment_node_t* insert_ip_assignment(ip_assignment_node_t* root, uint32_t ip, uint8_t* mac, int lease_time);
+// Función para preparar un rango (bitmap, almacén, timers y lock); retorna -1 si falla
+int init_ip_range(ip_range_t* range, uint32_t start_ip, uint32_t end_ip, int pool_id);
 
-// Función para eliminar una asignación del árbol de IPs (cuando se libera una IP)
-ip_assignment_node_t* delete_ip_assignment(ip_assignment_node_t* root, uint32_t ip);
+// Función para liberar la memoria de un rango
+void free_ip_range(ip_range_t* range);
 
-// Función para liberar la memoria de un árbol de asignaciones
-void free_ip_assignment_tree(ip_assignment_node_t* root);  // Libera todo el árbol de asignaciones
+// Función para dividir el pool en `count` shards contiguos, cada uno con su propio lock
+int split_ip_pool(ip_range_t* range, int count);
+
+// Función para restaurar las asignaciones guardadas en DHCP_LEASE_DIR y abrir su journal
+// (con el pool ya dividido en shards). Sin DHCP_LEASE_DIR no hace nada.
+int open_lease_journal();
+
+// Función para obtener el shard que contiene una IP (NULL si está fuera del pool)
+ip_range_t* shard_for_ip(uint32_t ip);
+
+// Función para obtener el shard preferido de una MAC
+ip_range_t* shard_for_mac(const uint8_t* mac);
+
+// Función para calcular las ranuras de transacciones que reserva de antemano cada uno de
+// `threads` hilos: una por IP del pool que le toca, hasta TXN_TABLE_PREALLOC_MAX
+uint32_t transaction_capacity(int threads);
+
+// Las cuatro funciones siguientes requieren tener tomado el lock del rango
+
+// Función para buscar una dirección IP en el almacén de asignaciones
+ip_assignment_t* find_ip_assignment(ip_range_t* range, uint32_t ip);
+
+// Función para registrar una nueva asignación y marcar la IP como ocupada (NULL si ya existe,
+// está fuera del pool o el journal no pudo registrarla)
+ip_assignment_t* insert_ip_assignment(ip_range_t* range, uint32_t ip, uint8_t* mac, int lease_time);
+
+// Función para eliminar una asignación y devolver la IP al bitmap de libres (retorna 1 si existía).
+// `reason` es el tipo de registro del journal (LEASE_JOURNAL_RELEASE, _DECLINE o _EXPIRE).
+int delete_ip_assignment(ip_range_t* range, uint32_t ip, int reason);
+
+// Función para reiniciar la concesión de una asignación existente (renovación). Retorna -1 sin
+// tocarla si el journal no pudo registrar la renovación.
+int renew_ip_assignment(ip_range_t* range, ip_assignment_t* assignment);
+
+// Función para liberar la oferta pendiente de una MAC que pidió otra IP (eligió la oferta de
+// otro servidor). Requiere el lock del rango.
+void withdraw_offer(ip_range_t* range, const uint8_t* mac, uint32_t requested_ip);
 
 // Función para convertir una cadena IP a entero
 uint32_t ip_to_int(const char* ip_str); // Convierte una IP en cadena a entero
 
-// Función para convertir un entero a cadena IP
-char* int_to_ip(uint32_t ip_int); // Convierte un entero de 32 bits a cadena IP
+// Función para convertir un entero a cadena IP en `buffer` (al menos INET_ADDRSTRLEN bytes)
+char* int_to_ip(uint32_t ip_int, char* buffer); // Retorna `buffer`, sin reservar memoria
 
 // Función para obtener el tiempo restante de un lease
-int get_lease_remaining(ip_assignment_node_t* assignment);
+int get_lease_remaining(ip_assignment_t* assignment);
 
-// Función para imprimir el árbol de asignaciones
-void print_tree(ip_assignment_node_t* root);
-
-// Función para encontrar el nodo con la IP mínima en un árbol
-ip_assignment_node_t* find_min(ip_assignment_node_t* node);
+// Función para imprimir las asignaciones activas de un pool
+void print_leases(ip_range_t* range);
 
 // Función para manejar las señales del servidor
 void cleanup();
 
 //================================================================
 
-// Función para buscar un cliente en la lista de clientes
-client_thread_info_t* find_client_thread(uint8_t* chaddr);
-
-// Función para agregar un cliente a la lista de clientes
-void add_client_thread(uint8_t* chaddr, pthread_t thread_id, client_info_t* client_info);
-
-// Función para eliminar un cliente de la lista de clientes
-void remove_client_thread(uint8_t* chaddr);
-
-unsigned int hash_mac(const uint8_t* mac);
-
 #endif // DHCP_SERVER_H
@@ -0,0 +1,221 @@
+#include "dhcp_stats.h"
+#include <fcntl.h>      // Para O_CREAT, O_RDWR
+#include <stdio.h>      // Para perror, fprintf, snprintf
+#include <string.h>     // Para memset, memcpy, strcmp
+#include <sys/mman.h>   // Para shm_open, mmap
+#include <sys/stat.h>   // Para fstat
+#include <sys/syscall.h> // Para SYS_gettid
+#include <time.h>       // Para time
+#include <unistd.h>     // Para ftruncate, close, getpid
+
+const dhcp_stat_info_t dhcp_stat_info[DHCP_STAT_COUNT] = {
+    [DHCP_STAT_RX_DISCOVER] = { "dhcp_packets_received_total", "type=\"discover\"", "Paquetes recibidos por tipo de mensaje", 0 },
+    [DHCP_STAT_RX_REQUEST] = { "dhcp_packets_received_total", "type=\"request\"", NULL, 0 },
+    [DHCP_STAT_RX_DECLINE] = { "dhcp_packets_received_total", "type=\"decline\"", NULL, 0 },
+    [DHCP_STAT_RX_RELEASE] = { "dhcp_packets_received_total", "type=\"release\"", NULL, 0 },
+    [DHCP_STAT_RX_OTHER] = { "dhcp_packets_received_total", "type=\"other\"", NULL, 0 },
+    [DHCP_STAT_RX_INVALID] = { "dhcp_packets_received_total", "type=\"invalid\"", NULL, 0 },
+    [DHCP_STAT_TX_OFFER] = { "dhcp_replies_sent_total", "type=\"offer\"", "Respuestas enviadas por tipo de mensaje", 0 },
+    [DHCP_STAT_TX_ACK] = { "dhcp_replies_sent_total", "type=\"ack\"", NULL, 0 },
+    [DHCP_STAT_TX_NAK] = { "dhcp_replies_sent_total", "type=\"nak\"", NULL, 0 },
+    [DHCP_STAT_NAK_POOL_EXHAUSTED] = { "dhcp_naks_total", "reason=\"pool_exhausted\"", "NAK enviados por motivo", 0 },
+    [DHCP_STAT_NAK_NO_ADDRESS] = { "dhcp_naks_total", "reason=\"no_requested_ip\"", NULL, 0 },
+    [DHCP_STAT_NAK_OUT_OF_RANGE] = { "dhcp_naks_total", "reason=\"out_of_range\"", NULL, 0 },
+    [DHCP_STAT_NAK_IN_USE] = { "dhcp_naks_total", "reason=\"in_use\"", NULL, 0 },
+    [DHCP_STAT_NAK_STORE_ERROR] = { "dhcp_naks_total", "reason=\"store_error\"", NULL, 0 },
+    [DHCP_STAT_LEASES_GRANTED] = { "dhcp_leases_granted_total", "", "Leases nuevos", 0 },
+    [DHCP_STAT_LEASES_RENEWED] = { "dhcp_leases_renewed_total", "", "REQUEST de renovación o de reinicio respondidos con ACK", 0 },
+    [DHCP_STAT_LEASES_RELEASED] = { "dhcp_leases_ended_total", "reason=\"release\"", "Leases terminados por motivo", 0 },
+    [DHCP_STAT_LEASES_DECLINED] = { "dhcp_leases_ended_total", "reason=\"decline\"", NULL, 0 },
+    [DHCP_STAT_LEASES_EXPIRED] = { "dhcp_leases_ended_total", "reason=\"expire\"", NULL, 0 },
+    [DHCP_STAT_RETURN_ACTIVE] = { "dhcp_returning_clients_total", "lease=\"active\"", "DISCOVER de MACs conocidas respondidos con su IP de antes", 0 },
+    [DHCP_STAT_RETURN_GHOST] = { "dhcp_returning_clients_total", "lease=\"ended\"", NULL, 0 },
+    [DHCP_STAT_OFFERS_EXPIRED] = { "dhcp_offers_ended_total", "reason=\"expire\"", "Ofertas que terminaron sin lease por motivo", 0 },
+    [DHCP_STAT_OFFERS_WITHDRAWN] = { "dhcp_offers_ended_total", "reason=\"other_address\"", NULL, 0 },
+    [DHCP_STAT_QUARANTINE_STARTED] = { "dhcp_address_quarantine_total", "event=\"start\"", "Direcciones rechazadas con DECLINE que entraron o salieron de la cuarentena", 0 },
+    [DHCP_STAT_QUARANTINE_ENDED] = { "dhcp_address_quarantine_total", "event=\"end\"", NULL, 0 },
+    [DHCP_STAT_DROP_QUEUE_FULL] = { "dhcp_packets_dropped_total", "reason=\"queue_full\"", "Paquetes descartados por motivo", 0 },
+    [DHCP_STAT_DROP_NOT_OWNER] = { "dhcp_packets_dropped_total", "reason=\"not_owner\"", NULL, 0 },
+    [DHCP_STAT_OFFERS_PENDING] = { "dhcp_offers_pending", "", "OFFER enviados que esperan el REQUEST del cliente", 1 },
+    [DHCP_STAT_QUEUE_DEPTH] = { "dhcp_worker_queue_depth", "", "Paquetes en las colas de los workers", 1 },
+};
+
+__thread dhcp_stats_slot_t* dhcp_stats_slot = NULL;
+
+static dhcp_stats_header_t* segment = NULL;   // NULL sin segmento compartido
+static dhcp_stats_slot_t* segment_slots = NULL;
+static char segment_name[256];
+static __thread dhcp_stats_slot_t private_slot;  // Ranura de los hilos que no entran en el segmento
+
+static size_t segment_bytes() {
+    return sizeof(dhcp_stats_header_t) + (size_t)DHCP_STATS_MAX_SLOTS * sizeof(dhcp_stats_slot_t);
+}
+
+int dhcp_stats_open(const char* name) {
+    if (name == NULL || *name == '\0') {
+        name = DHCP_STATS_DEFAULT_NAME;
+    }
+    if (strcmp(name, "off") == 0) {
+        return 0;
+    }
+    if (strlen(name) >= sizeof(segment_name)) {
+        fprintf(stderr, "Error: El nombre de estadísticas %s es demasiado largo.\n", name);
+        return -1;
+    }
+
+    // Un segmento nuevo: el de un proceso anterior (o el que aún usa durante un relevo) queda
+    // con él hasta que termina
+    shm_unlink(name);
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0644);
+    if (fd < 0 || ftruncate(fd, segment_bytes()) < 0) {
+        perror("Error al crear el segmento de estadísticas");
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, segment_bytes(), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Error al proyectar el segmento de estadísticas");
+        shm_unlink(name);
+        return -1;
+    }
+
+    segment = (dhcp_stats_header_t*)map;
+    segment_slots = (dhcp_stats_slot_t*)(segment + 1);
+    segment->stat_count = DHCP_STAT_COUNT;
+    segment->slot_size = sizeof(dhcp_stats_slot_t);
+    segment->max_slots = DHCP_STATS_MAX_SLOTS;
+    segment->pid = getpid();
+    segment->start_time = (uint64_t)time(NULL);
+    segment->version = DHCP_STATS_VERSION;
+    __atomic_store_n(&segment->magic, DHCP_STATS_MAGIC, __ATOMIC_RELEASE);
+    memcpy(segment_name, name, strlen(name) + 1);
+    return 0;
+}
+
+void dhcp_stats_set_pool(uint64_t size, uint64_t used) {
+    if (segment) {
+        segment->pool_size = size;
+        segment->pool_base = used;
+    }
+}
+
+void dhcp_stats_remove() {
+    if (segment) {
+        shm_unlink(segment_name);
+    }
+}
+
+dhcp_stats_slot_t* dhcp_stats_attach() {
+    dhcp_stats_slot_t* slot = &private_slot;
+    if (segment) {
+        uint32_t index = __atomic_fetch_add(&segment->slots_used, 1, __ATOMIC_RELAXED);
+        if (index < DHCP_STATS_MAX_SLOTS) {
+            slot = &segment_slots[index];
+        }
+    }
+    slot->tid = (uint32_t)syscall(SYS_gettid);
+    dhcp_stats_slot = slot;
+    return slot;
+}
+
+int dhcp_stats_read(const char* name, dhcp_stats_snapshot_t* snapshot) {
+    if (name == NULL || *name == '\0') {
+        name = DHCP_STATS_DEFAULT_NAME;
+    }
+    int fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(dhcp_stats_header_t)) {
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    const dhcp_stats_header_t* header = (const dhcp_stats_header_t*)map;
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != DHCP_STATS_MAGIC ||
+        header->version != DHCP_STATS_VERSION || header->stat_count != DHCP_STAT_COUNT ||
+        header->slot_size != sizeof(dhcp_stats_slot_t) ||
+        (size_t)st.st_size < sizeof(*header) + (size_t)header->max_slots * header->slot_size) {
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    memset(snapshot, 0, sizeof(*snapshot));
+    snapshot->header = *header;
+    uint32_t used = __atomic_load_n(&header->slots_used, __ATOMIC_ACQUIRE);
+    if (used > header->max_slots) used = header->max_slots;
+    const dhcp_stats_slot_t* slots = (const dhcp_stats_slot_t*)(header + 1);
+    for (uint32_t i = 0; i < used; i++) {
+        // Copiar la ranura entre dos lecturas iguales (y pares) de su seqlock. Si el hilo
+        // murió a mitad de una escritura, la ranura queda impar: se usa la última copia.
+        uint64_t values[DHCP_STAT_COUNT];
+        for (int attempt = 0; attempt < 1000; attempt++) {
+            uint32_t before = __atomic_load_n(&slots[i].seq, __ATOMIC_ACQUIRE);
+            for (int v = 0; v < DHCP_STAT_COUNT; v++) {
+                values[v] = __atomic_load_n(&slots[i].values[v], __ATOMIC_RELAXED);
+            }
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            if (!(before & 1) && before == __atomic_load_n(&slots[i].seq, __ATOMIC_RELAXED)) {
+                break;
+            }
+        }
+
+        for (int v = 0; v < DHCP_STAT_COUNT; v++) {
+            snapshot->values[v] += values[v];
+        }
+    }
+    munmap(map, st.st_size);
+
+    // Ocupación: lo que había al publicar más lo asignado menos lo que terminó
+    int64_t pool_used = (int64_t)snapshot->header.pool_base + (int64_t)snapshot->values[DHCP_STAT_LEASES_GRANTED] -
+                        (int64_t)snapshot->values[DHCP_STAT_LEASES_RELEASED] -
+                        (int64_t)snapshot->values[DHCP_STAT_LEASES_DECLINED] -
+                        (int64_t)snapshot->values[DHCP_STAT_LEASES_EXPIRED];
+    snapshot->pool_used = pool_used > 0 ? (uint64_t)pool_used : 0;
+    int64_t quarantined = (int64_t)snapshot->values[DHCP_STAT_QUARANTINE_STARTED] -
+                          (int64_t)snapshot->values[DHCP_STAT_QUARANTINE_ENDED];
+    snapshot->pool_quarantined = quarantined > 0 ? (uint64_t)quarantined : 0;
+    return 0;
+}
+
+int dhcp_stats_format_prometheus(const dhcp_stats_snapshot_t* snapshot, char* buffer, int size) {
+    int length = 0;
+#define APPEND(...) do { \
+        int written = snprintf(buffer + (length < size ? length : size), \
+                               length < size ? (size_t)(size - length) : 0, __VA_ARGS__); \
+        if (written > 0) length += written; \
+    } while (0)
+
+    // Los valores con el mismo nombre van seguidos: HELP y TYPE una vez por nombre
+    for (int v = 0; v < DHCP_STAT_COUNT; v++) {
+        const dhcp_stat_info_t* info = &dhcp_stat_info[v];
+        if (info->help) {
+            APPEND("# HELP %s %s\n# TYPE %s %s\n", info->name, info->help, info->name, info->gauge ? "gauge" : "counter");
+        }
+        if (*info->labels) {
+            APPEND("%s{%s} %llu\n", info->name, info->labels, (unsigned long long)snapshot->values[v]);
+        } else {
+            APPEND("%s %llu\n", info->name, (unsigned long long)snapshot->values[v]);
+        }
+    }
+
+    uint64_t pool_size = snapshot->header.pool_size;
+    uint64_t pool_used = snapshot->pool_used < pool_size ? snapshot->pool_used : pool_size;
+    uint64_t pool_quarantined = snapshot->pool_quarantined < pool_size - pool_used ? snapshot->pool_quarantined : pool_size - pool_used;
+    APPEND("# HELP dhcp_pool_addresses Direcciones del pool por estado\n# TYPE dhcp_pool_addresses gauge\n");
+    APPEND("dhcp_pool_addresses{state=\"total\"} %llu\n", (unsigned long long)pool_size);
+    APPEND("dhcp_pool_addresses{state=\"used\"} %llu\n", (unsigned long long)pool_used);
+    APPEND("dhcp_pool_addresses{state=\"quarantined\"} %llu\n", (unsigned long long)pool_quarantined);
+    APPEND("dhcp_pool_addresses{state=\"free\"} %llu\n", (unsigned long long)(pool_size - pool_used - pool_quarantined));
+    APPEND("# HELP dhcp_server_start_time_seconds Arranque del servidor (epoch)\n# TYPE dhcp_server_start_time_seconds gauge\n");
+    APPEND("dhcp_server_start_time_seconds %llu\n", (unsigned long long)snapshot->header.start_time);
+#undef APPEND
+    return length;
+}
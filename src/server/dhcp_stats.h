@@ -0,0 +1,156 @@
+#ifndef DHCP_STATS_H
+#define DHCP_STATS_H
+
+// Estadísticas del servidor en memoria compartida (shm_open, DHCP_STATS_SHM).
+//
+// El segmento tiene un encabezado versionado y una ranura por hilo. Cada hilo escribe solo
+// en su ranura, protegida por un seqlock: publicar un contador son unos pocos stores, sin
+// locks ni syscalls, y los lectores (dhcp_exporter, dhcptop) reintentan si leyeron a mitad
+// de una escritura. Ningún lector puede detener al servidor.
+
+#include <stdint.h> // Para uint32_t, uint64_t
+
+#define DHCP_STATS_MAGIC 0x44535441          // "DSTA"
+#define DHCP_STATS_VERSION 1
+#define DHCP_STATS_MAX_SLOTS 256             // Hilos que publican como máximo
+#define DHCP_STATS_DEFAULT_NAME "/dhcp_server_stats"
+
+// Valores publicados. Los contadores solo crecen; los gauges de cada hilo son su valor
+// actual y el lector los suma.
+typedef enum {
+    // Paquetes recibidos por tipo
+    DHCP_STAT_RX_DISCOVER,
+    DHCP_STAT_RX_REQUEST,
+    DHCP_STAT_RX_DECLINE,
+    DHCP_STAT_RX_RELEASE,
+    DHCP_STAT_RX_OTHER,
+    DHCP_STAT_RX_INVALID,
+    // Respuestas enviadas por tipo
+    DHCP_STAT_TX_OFFER,
+    DHCP_STAT_TX_ACK,
+    DHCP_STAT_TX_NAK,
+    // NAK por motivo
+    DHCP_STAT_NAK_POOL_EXHAUSTED,   // DISCOVER sin direcciones libres
+    DHCP_STAT_NAK_NO_ADDRESS,       // REQUEST sin opción 50 ni ciaddr
+    DHCP_STAT_NAK_OUT_OF_RANGE,     // IP pedida fuera del pool
+    DHCP_STAT_NAK_IN_USE,           // IP pedida asignada a otra MAC
+    DHCP_STAT_NAK_STORE_ERROR,      // No se pudo registrar la asignación
+    // Leases
+    DHCP_STAT_LEASES_GRANTED,
+    DHCP_STAT_LEASES_RENEWED,
+    DHCP_STAT_LEASES_RELEASED,
+    DHCP_STAT_LEASES_DECLINED,
+    DHCP_STAT_LEASES_EXPIRED,
+    // DISCOVER de MACs conocidas respondidos con su IP de antes
+    DHCP_STAT_RETURN_ACTIVE,        // La MAC tenía un lease activo (se ofrece la misma IP)
+    DHCP_STAT_RETURN_GHOST,         // La MAC tenía un lease terminado y su IP seguía libre
+    // Ofertas que terminaron sin lease
+    DHCP_STAT_OFFERS_EXPIRED,       // Vencieron sin REQUEST
+    DHCP_STAT_OFFERS_WITHDRAWN,     // El cliente pidió otra IP (eligió otra oferta)
+    // Cuarentena de direcciones rechazadas con DECLINE
+    DHCP_STAT_QUARANTINE_STARTED,   // Direcciones que entraron en cuarentena
+    DHCP_STAT_QUARANTINE_ENDED,     // Direcciones que volvieron al pool al terminar su cuarentena
+    // Paquetes descartados
+    DHCP_STAT_DROP_QUEUE_FULL,      // Cola del worker llena
+    DHCP_STAT_DROP_NOT_OWNER,       // Copia de un broadcast para la MAC de otro hilo (reuseport)
+    // Gauges por hilo
+    DHCP_STAT_OFFERS_PENDING,       // Ofertas vigentes en las tablas de los shards
+    DHCP_STAT_QUEUE_DEPTH,          // Paquetes en la cola del worker al tomar el último lote
+    DHCP_STAT_COUNT
+} dhcp_stat_t;
+
+// Descripción de cada valor para los lectores (nombre Prometheus, etiquetas y ayuda)
+typedef struct {
+    const char* name;
+    const char* labels;   // "" si no tiene
+    const char* help;
+    int gauge;
+} dhcp_stat_info_t;
+
+extern const dhcp_stat_info_t dhcp_stat_info[DHCP_STAT_COUNT];
+
+// Ranura de un hilo (una línea de caché por cada 8 valores, sin compartir con otros hilos)
+typedef struct {
+    uint32_t seq;                      // Impar mientras el hilo escribe
+    uint32_t tid;                      // Hilo dueño (para los lectores)
+    uint64_t values[DHCP_STAT_COUNT];
+} __attribute__((aligned(64))) dhcp_stats_slot_t;
+
+// Encabezado del segmento; lo escribe el servidor antes de lanzar los hilos
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t stat_count;       // DHCP_STAT_COUNT del servidor
+    uint32_t slot_size;        // sizeof(dhcp_stats_slot_t)
+    uint32_t max_slots;
+    uint32_t slots_used;       // Ranuras tomadas (se incrementa de forma atómica)
+    int32_t pid;               // Proceso que publica
+    uint32_t reserved;
+    uint64_t start_time;       // time() del arranque del servidor
+    uint64_t pool_size;        // Direcciones del pool
+    uint64_t pool_base;        // Leases que ya estaban al publicar (restaurados o recibidos en un relevo)
+} __attribute__((aligned(64))) dhcp_stats_header_t;
+
+// Ranura del hilo actual (NULL hasta su primera publicación)
+extern __thread dhcp_stats_slot_t* dhcp_stats_slot;
+
+// Función para crear el segmento `name` (NULL = DHCP_STATS_DEFAULT_NAME, "off" = sin segmento).
+// Sin segmento los hilos publican en ranuras privadas y nadie las lee. Retorna -1 si falla.
+int dhcp_stats_open(const char* name);
+
+// Función para fijar el tamaño del pool y los leases que ya existen (antes de lanzar los hilos)
+void dhcp_stats_set_pool(uint64_t size, uint64_t used);
+
+// Función para quitar el nombre del segmento (al cerrar el servidor sin relevo)
+void dhcp_stats_remove();
+
+// Función para tomar una ranura para el hilo actual (se usa desde dhcp_stat_add)
+dhcp_stats_slot_t* dhcp_stats_attach();
+
+// Función para sumar `value` a un valor del hilo actual
+static inline void dhcp_stat_add(dhcp_stat_t stat, uint64_t value) {
+    dhcp_stats_slot_t* slot = dhcp_stats_slot ? dhcp_stats_slot : dhcp_stats_attach();
+    uint32_t seq = slot->seq;
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&slot->values[stat], slot->values[stat] + value, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+static inline void dhcp_stat_inc(dhcp_stat_t stat) {
+    dhcp_stat_add(stat, 1);
+}
+
+// Función para fijar un gauge del hilo actual
+static inline void dhcp_stat_set(dhcp_stat_t stat, uint64_t value) {
+    dhcp_stats_slot_t* slot = dhcp_stats_slot ? dhcp_stats_slot : dhcp_stats_attach();
+    if (slot->values[stat] == value) {
+        return;
+    }
+    uint32_t seq = slot->seq;
+    __atomic_store_n(&slot->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&slot->values[stat], value, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+//================================================
+// Lectura (dhcp_exporter, dhcptop)
+
+// Suma de todas las ranuras más el encabezado
+typedef struct {
+    dhcp_stats_header_t header;
+    uint64_t values[DHCP_STAT_COUNT];
+    uint64_t pool_used;        // pool_base + asignados - liberados - rechazados - vencidos
+    uint64_t pool_quarantined; // Entradas en cuarentena - salidas
+} dhcp_stats_snapshot_t;
+
+// Función para leer el segmento `name` (NULL = DHCP_STATS_DEFAULT_NAME). Cada ranura se copia
+// entera entre dos lecturas iguales de su seqlock. Retorna -1 si no existe o es de otra versión.
+int dhcp_stats_read(const char* name, dhcp_stats_snapshot_t* snapshot);
+
+// Función para escribir una lectura en formato de texto de Prometheus. Retorna los bytes escritos
+// (como snprintf: si no entra, los que harían falta).
+int dhcp_stats_format_prometheus(const dhcp_stats_snapshot_t* snapshot, char* buffer, int size);
+
+#endif // DHCP_STATS_H
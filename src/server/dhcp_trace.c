@@ -0,0 +1,278 @@
+#include "dhcp_trace.h"
+#include <stdlib.h>  // Para calloc
+#include <string.h>  // Para strcmp, memset, memcpy
+
+int dhcp_trace_enabled = 0;
+int dhcp_trace_kernel_timestamps = 0;
+__thread dhcp_trace_packet_t dhcp_trace_packet;
+
+// Semáforos de los probes: van en .probes, donde los busca bpftrace (mismo esquema que <sys/sdt.h>)
+volatile unsigned short dhcp_stage_semaphore __attribute__((section(".probes"), used)) = 0;
+volatile unsigned short dhcp_packet_semaphore __attribute__((section(".probes"), used)) = 0;
+
+// Probe USDT con cuatro argumentos de 64 bits: un nop y una nota .note.stapsdt (versión 3, el
+// formato de SystemTap) con su dirección, el semáforo y dónde leer cada argumento. No hace
+// falta <sys/sdt.h>. En otras arquitecturas el probe no existe y solo quedan los histogramas.
+#if DHCP_TRACE_COMPILED && defined(__x86_64__)
+#define DHCP_PROBE4(name, a1, a2, a3, a4) \
+    __asm__ __volatile__( \
+        "990: nop\n" \
+        ".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+        ".balign 4\n" \
+        ".4byte 992f-991f, 994f-993f, 3\n" \
+        "991: .asciz \"stapsdt\"\n" \
+        "992: .balign 4\n" \
+        "993: .8byte 990b\n" \
+        ".8byte _.stapsdt.base\n" \
+        ".8byte dhcp_" #name "_semaphore\n" \
+        ".asciz \"dhcp\"\n" \
+        ".asciz \"" #name "\"\n" \
+        ".asciz \"8@%0 8@%1 8@%2 8@%3\"\n" \
+        "994: .balign 4\n" \
+        ".popsection\n" \
+        ".ifndef _.stapsdt.base\n" \
+        ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n" \
+        ".weak _.stapsdt.base\n" \
+        ".hidden _.stapsdt.base\n" \
+        "_.stapsdt.base: .space 1\n" \
+        ".size _.stapsdt.base, 1\n" \
+        ".popsection\n" \
+        ".endif\n" \
+        :: "nor"((uint64_t)(a1)), "nor"((uint64_t)(a2)), "nor"((uint64_t)(a3)), "nor"((uint64_t)(a4)))
+#else
+#define DHCP_PROBE4(name, a1, a2, a3, a4) do { (void)(a1); (void)(a2); (void)(a3); (void)(a4); } while (0)
+#endif
+
+static const char* stage_names[DHCP_TRACE_STAGE_COUNT] = {
+    "kernel", "cola", "parseo", "transacción", "dirección", "respuesta", "envío", "lote", "total"
+};
+static const char* type_names[DHCP_TRACE_TYPE_COUNT] = {
+    "DISCOVER", "REQUEST", "DECLINE", "RELEASE", "otros", "lotes"
+};
+
+// Histogramas de un hilo. Solo el dueño escribe; los stores atómicos evitan lecturas partidas.
+typedef struct {
+    uint32_t counts[DHCP_TRACE_TYPE_COUNT][DHCP_TRACE_STAGE_COUNT][DHCP_TRACE_BUCKETS];
+    uint64_t sum_ns[DHCP_TRACE_TYPE_COUNT][DHCP_TRACE_STAGE_COUNT];
+    uint64_t max_ns[DHCP_TRACE_TYPE_COUNT][DHCP_TRACE_STAGE_COUNT];
+} dhcp_trace_thread_t;
+
+static dhcp_trace_thread_t* trace_threads[DHCP_TRACE_MAX_THREADS];
+static uint32_t trace_thread_count = 0;
+static __thread dhcp_trace_thread_t* trace_thread = NULL;
+static __thread int trace_thread_failed = 0;
+
+int dhcp_trace_configure(const char* mode) {
+    dhcp_trace_enabled = 0;
+    dhcp_trace_kernel_timestamps = 0;
+    if (mode == NULL || *mode == '\0' || strcmp(mode, "off") == 0 || strcmp(mode, "0") == 0) {
+        return 0;
+    }
+    if (strcmp(mode, "on") == 0 || strcmp(mode, "1") == 0) {
+        dhcp_trace_enabled = DHCP_TRACE_COMPILED;
+    } else if (strcmp(mode, "kernel") == 0) {
+        dhcp_trace_enabled = DHCP_TRACE_COMPILED;
+        dhcp_trace_kernel_timestamps = DHCP_TRACE_COMPILED;
+    } else {
+        fprintf(stderr, "Advertencia: DHCP_TRACE '%s' no reconocido (off, on o kernel), se usa off.\n", mode);
+        return -1;
+    }
+    if (!DHCP_TRACE_COMPILED) {
+        fprintf(stderr, "Advertencia: El servidor se compiló sin trazas (TRACE=0), DHCP_TRACE no tiene efecto.\n");
+    }
+    return 0;
+}
+
+void dhcp_trace_enable_timestamps(int sockfd) {
+    int enable = 1;
+    if (dhcp_trace_kernel_timestamps && setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable)) < 0) {
+        perror("Error al activar SO_TIMESTAMPNS");
+    }
+}
+
+uint32_t dhcp_trace_kernel_delay(const struct msghdr* msg, uint64_t realtime_ns) {
+    for (struct cmsghdr* cmsg = CMSG_FIRSTHDR((struct msghdr*)msg); cmsg != NULL;
+         cmsg = CMSG_NXTHDR((struct msghdr*)msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec stamp;
+            memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+            uint64_t arrived = (uint64_t)stamp.tv_sec * 1000000000ULL + (uint64_t)stamp.tv_nsec;
+            // Un ajuste del reloj puede dejar la marca en el futuro (cuenta 1 ns); más de 4 s se recorta
+            if (arrived >= realtime_ns) return 1;
+            uint64_t delay = realtime_ns - arrived;
+            return delay > UINT32_MAX ? UINT32_MAX : (uint32_t)delay;
+        }
+    }
+    return 0;
+}
+
+uint32_t dhcp_trace_bucket(uint64_t ns) {
+    if (ns < DHCP_TRACE_SUB_BUCKETS) {
+        return (uint32_t)ns;
+    }
+    int exponent = 63 - __builtin_clzll(ns);
+    if (exponent > DHCP_TRACE_MAX_EXPONENT) {
+        return DHCP_TRACE_BUCKETS - 1;
+    }
+    uint32_t sub = (uint32_t)(ns >> (exponent - DHCP_TRACE_SUB_BITS)) & (DHCP_TRACE_SUB_BUCKETS - 1);
+    return (uint32_t)(exponent - DHCP_TRACE_SUB_BITS + 1) * DHCP_TRACE_SUB_BUCKETS + sub;
+}
+
+uint64_t dhcp_trace_bucket_limit(uint32_t bucket) {
+    if (bucket < DHCP_TRACE_SUB_BUCKETS) {
+        return bucket;
+    }
+    int shift = (int)(bucket / DHCP_TRACE_SUB_BUCKETS) - 1;
+    uint64_t sub = bucket % DHCP_TRACE_SUB_BUCKETS;
+    return ((DHCP_TRACE_SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+// Reservar los histogramas del hilo la primera vez que mide (NULL si no hay lugar)
+static dhcp_trace_thread_t* trace_attach() {
+    if (trace_thread_failed) {
+        return NULL;
+    }
+    uint32_t index = __atomic_fetch_add(&trace_thread_count, 1, __ATOMIC_RELAXED);
+    dhcp_trace_thread_t* thread = index < DHCP_TRACE_MAX_THREADS ? calloc(1, sizeof(dhcp_trace_thread_t)) : NULL;
+    if (!thread) {
+        fprintf(stderr, "Advertencia: Sin histogramas de latencia para este hilo.\n");
+        trace_thread_failed = 1;
+        return NULL;
+    }
+    __atomic_store_n(&trace_threads[index], thread, __ATOMIC_RELEASE);
+    trace_thread = thread;
+    return thread;
+}
+
+void dhcp_trace_record(dhcp_trace_stage_t stage, dhcp_trace_type_t type, uint64_t ns) {
+    dhcp_trace_thread_t* thread = trace_thread ? trace_thread : trace_attach();
+    if (thread) {
+        uint32_t* count = &thread->counts[type][stage][dhcp_trace_bucket(ns)];
+        __atomic_store_n(count, *count + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&thread->sum_ns[type][stage], thread->sum_ns[type][stage] + ns, __ATOMIC_RELAXED);
+        if (ns > thread->max_ns[type][stage]) {
+            __atomic_store_n(&thread->max_ns[type][stage], ns, __ATOMIC_RELAXED);
+        }
+    }
+    DHCP_PROBE4(stage, stage, type, dhcp_trace_packet.xid, ns);
+}
+
+void dhcp_trace_classify(uint8_t message_type, uint32_t xid) {
+    switch (message_type) {
+        case 1: dhcp_trace_packet.type = DHCP_TRACE_DISCOVER; break;
+        case 3: dhcp_trace_packet.type = DHCP_TRACE_REQUEST; break;
+        case 4: dhcp_trace_packet.type = DHCP_TRACE_DECLINE; break;
+        case 7: dhcp_trace_packet.type = DHCP_TRACE_RELEASE; break;
+        default: dhcp_trace_packet.type = DHCP_TRACE_OTHER; break;
+    }
+    dhcp_trace_packet.xid = xid;
+
+    dhcp_trace_type_t type = (dhcp_trace_type_t)dhcp_trace_packet.type;
+    if (dhcp_trace_packet.kernel_ns) {
+        dhcp_trace_record(DHCP_TRACE_KERNEL, type, dhcp_trace_packet.kernel_ns);
+    }
+    if (dhcp_trace_packet.rx_ns && dhcp_trace_packet.start_ns > dhcp_trace_packet.rx_ns) {
+        dhcp_trace_record(DHCP_TRACE_QUEUE, type, dhcp_trace_packet.start_ns - dhcp_trace_packet.rx_ns);
+    }
+}
+
+void dhcp_trace_finish_packet() {
+    dhcp_trace_packet_t* packet = &dhcp_trace_packet;
+    uint64_t from = packet->rx_ns && packet->rx_ns < packet->start_ns ? packet->rx_ns : packet->start_ns;
+    uint64_t total = dhcp_trace_clock() - from + packet->kernel_ns;
+    dhcp_trace_record(DHCP_TRACE_TOTAL, (dhcp_trace_type_t)packet->type, total);
+    DHCP_PROBE4(packet, packet->type, packet->xid, total, packet->kernel_ns);
+
+    // La próxima lectura vuelve a anotar su instante (o no, si la traza se apagó)
+    packet->rx_ns = 0;
+    packet->kernel_ns = 0;
+    packet->start_ns = 0;
+}
+
+// Valor del percentil `p` (0-1) de un histograma con `total` muestras
+static uint64_t percentile(const uint64_t* counts, uint64_t total, double p) {
+    uint64_t rank = (uint64_t)(p * total);
+    if (rank >= total) rank = total - 1;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < DHCP_TRACE_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen > rank) return dhcp_trace_bucket_limit(i);
+    }
+    return dhcp_trace_bucket_limit(DHCP_TRACE_BUCKETS - 1);
+}
+
+uint64_t dhcp_trace_summarize(dhcp_trace_type_t type, dhcp_trace_stage_t stage, dhcp_trace_summary_t* summary) {
+    uint32_t threads = __atomic_load_n(&trace_thread_count, __ATOMIC_RELAXED);
+    if (threads > DHCP_TRACE_MAX_THREADS) threads = DHCP_TRACE_MAX_THREADS;
+
+    uint64_t counts[DHCP_TRACE_BUCKETS];
+    uint64_t total = 0, sum = 0, max = 0;
+    memset(counts, 0, sizeof(counts));
+    memset(summary, 0, sizeof(*summary));
+    for (uint32_t t = 0; t < threads; t++) {
+        dhcp_trace_thread_t* thread = __atomic_load_n(&trace_threads[t], __ATOMIC_ACQUIRE);
+        if (!thread) continue;
+        for (uint32_t i = 0; i < DHCP_TRACE_BUCKETS; i++) {
+            uint32_t count = __atomic_load_n(&thread->counts[type][stage][i], __ATOMIC_RELAXED);
+            counts[i] += count;
+            total += count;
+        }
+        sum += __atomic_load_n(&thread->sum_ns[type][stage], __ATOMIC_RELAXED);
+        uint64_t thread_max = __atomic_load_n(&thread->max_ns[type][stage], __ATOMIC_RELAXED);
+        if (thread_max > max) max = thread_max;
+    }
+    if (total == 0) {
+        return 0;
+    }
+
+    summary->count = total;
+    summary->mean = sum / total;
+    summary->p50 = percentile(counts, total, 0.50);
+    summary->p90 = percentile(counts, total, 0.90);
+    summary->p99 = percentile(counts, total, 0.99);
+    summary->p999 = percentile(counts, total, 0.999);
+    summary->max = max;
+
+    // El límite del bucket puede pasar el máximo real
+    uint64_t* percentiles[] = { &summary->p50, &summary->p90, &summary->p99, &summary->p999 };
+    for (int i = 0; i < 4; i++) {
+        if (*percentiles[i] > max) *percentiles[i] = max;
+    }
+    return total;
+}
+
+void dhcp_trace_dump(FILE* out) {
+    fprintf(out, "Latencia por etapa (us; percentiles con error < 6.25%%)\n");
+    fprintf(out, "%-9s %-12s %10s %9s %9s %9s %9s %9s %10s\n",
+            "tipo", "etapa", "muestras", "media", "p50", "p90", "p99", "p99.9", "máx");
+    for (int type = 0; type < DHCP_TRACE_TYPE_COUNT; type++) {
+        for (int stage = 0; stage < DHCP_TRACE_STAGE_COUNT; stage++) {
+            dhcp_trace_summary_t summary;
+            if (dhcp_trace_summarize((dhcp_trace_type_t)type, (dhcp_trace_stage_t)stage, &summary) == 0) {
+                continue;
+            }
+
+            // El nombre se alinea por caracteres, no por bytes (acentos)
+            int width = 12;
+            for (const char* c = stage_names[stage]; *c; c++) {
+                width += ((unsigned char)*c & 0xc0) == 0x80;
+            }
+            fprintf(out, "%-9s %-*s %10llu %9.2f %9.2f %9.2f %9.2f %9.2f %10.2f\n",
+                    type_names[type], width, stage_names[stage], (unsigned long long)summary.count,
+                    summary.mean / 1e3, summary.p50 / 1e3, summary.p90 / 1e3, summary.p99 / 1e3,
+                    summary.p999 / 1e3, summary.max / 1e3);
+        }
+    }
+    fflush(out);
+}
+
+void dhcp_trace_reset() {
+    uint32_t threads = __atomic_load_n(&trace_thread_count, __ATOMIC_RELAXED);
+    if (threads > DHCP_TRACE_MAX_THREADS) threads = DHCP_TRACE_MAX_THREADS;
+    for (uint32_t t = 0; t < threads; t++) {
+        dhcp_trace_thread_t* thread = __atomic_load_n(&trace_threads[t], __ATOMIC_ACQUIRE);
+        if (thread) {
+            memset(thread, 0, sizeof(*thread));
+        }
+    }
+}
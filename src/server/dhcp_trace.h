@@ -0,0 +1,162 @@
+#ifndef DHCP_TRACE_H
+#define DHCP_TRACE_H
+
+// Trazas de latencia por etapa del camino de un paquete (DHCP_TRACE).
+//
+// Cada etapa mide su duración con CLOCK_MONOTONIC y la suma a un histograma log-lineal
+// (estilo HDR: 16 sub-buckets por potencia de 2, error relativo < 6.25%) del hilo que
+// atiende el paquete, separado por tipo de mensaje. Cada hilo escribe solo en sus
+// histogramas, así que registrar una muestra no toma locks. SIGUSR2 imprime el resumen.
+//
+// Además hay dos probes USDT (dhcp:stage y dhcp:packet) para bpftrace o perf. Cada uno
+// tiene su semáforo: al engancharse un lector las mediciones se activan solas, sin
+// reiniciar el servidor. Apagado, el costo por etapa es leer tres enteros y un salto.
+// Se quita del todo compilando con -DDHCP_TRACE_COMPILED=0 (make TRACE=0).
+
+#include <stdint.h>     // Para uint32_t, uint64_t
+#include <stdio.h>      // Para FILE
+#include <time.h>       // Para clock_gettime
+#include <sys/socket.h> // Para msghdr
+
+#ifndef DHCP_TRACE_COMPILED
+#define DHCP_TRACE_COMPILED 1
+#endif
+
+#define DHCP_TRACE_SUB_BITS 4                                  // 16 sub-buckets por potencia de 2
+#define DHCP_TRACE_SUB_BUCKETS (1 << DHCP_TRACE_SUB_BITS)
+#define DHCP_TRACE_MAX_EXPONENT 36                             // 2^36 ns (~69 s); lo mayor cae en el último
+#define DHCP_TRACE_BUCKETS ((DHCP_TRACE_MAX_EXPONENT - DHCP_TRACE_SUB_BITS + 2) * DHCP_TRACE_SUB_BUCKETS)
+#define DHCP_TRACE_MAX_THREADS 256                             // Hilos con histogramas propios
+
+// Etapas del camino de un paquete
+typedef enum {
+    DHCP_TRACE_KERNEL,   // Del kernel (SO_TIMESTAMPNS) hasta que el servidor lee el datagrama
+    DHCP_TRACE_QUEUE,    // Desde que se leyó del socket hasta que el worker empieza a atenderlo
+    DHCP_TRACE_PARSE,    // Validar el encabezado e indexar las opciones
+    DHCP_TRACE_LOOKUP,   // Buscar o crear la transacción (MAC, xid)
+    DHCP_TRACE_ALLOC,    // Elegir, verificar o liberar la dirección (incluye esperar el lock del shard)
+    DHCP_TRACE_ENCODE,   // Armar la respuesta y sus opciones
+    DHCP_TRACE_SEND,     // Entregar la respuesta: sendto o encolarla en el lote
+    DHCP_TRACE_FLUSH,    // Vaciar un lote de respuestas (espera del journal y sendmmsg), una vez por lote
+    DHCP_TRACE_TOTAL,    // Desde la recepción hasta terminar de atender el paquete
+    DHCP_TRACE_STAGE_COUNT
+} dhcp_trace_stage_t;
+
+// Tipos de mensaje con histogramas propios
+typedef enum {
+    DHCP_TRACE_DISCOVER,
+    DHCP_TRACE_REQUEST,
+    DHCP_TRACE_DECLINE,
+    DHCP_TRACE_RELEASE,
+    DHCP_TRACE_OTHER,    // Otros tipos y paquetes inválidos
+    DHCP_TRACE_BATCH,    // Lotes de respuestas (solo DHCP_TRACE_FLUSH)
+    DHCP_TRACE_TYPE_COUNT
+} dhcp_trace_type_t;
+
+// Resumen de un histograma (suma de todos los hilos), en ns
+typedef struct {
+    uint64_t count;
+    uint64_t mean;
+    uint64_t p50, p90, p99, p999;
+    uint64_t max;
+} dhcp_trace_summary_t;
+
+// Paquete que atiende el hilo actual
+typedef struct {
+    uint64_t rx_ns;       // Lectura del socket (CLOCK_MONOTONIC), 0 si no se conoce
+    uint64_t start_ns;    // Inicio de la atención; 0 = paquete sin traza
+    uint32_t kernel_ns;   // Espera en el kernel antes de la lectura, 0 si no se midió
+    uint32_t xid;         // En orden de host, para los probes
+    int type;             // DHCP_TRACE_* del mensaje
+} dhcp_trace_packet_t;
+
+extern int dhcp_trace_enabled;                    // DHCP_TRACE=on o kernel
+extern int dhcp_trace_kernel_timestamps;          // DHCP_TRACE=kernel (SO_TIMESTAMPNS en los sockets)
+extern __thread dhcp_trace_packet_t dhcp_trace_packet;
+
+// Semáforos de los probes USDT (los incrementa bpftrace/perf al engancharse)
+extern volatile unsigned short dhcp_stage_semaphore;
+extern volatile unsigned short dhcp_packet_semaphore;
+
+// Función para leer el modo de DHCP_TRACE ("off", "on" o "kernel"). Retorna -1 si no lo reconoce.
+int dhcp_trace_configure(const char* mode);
+
+// Función para pedir SO_TIMESTAMPNS en un socket si DHCP_TRACE=kernel
+void dhcp_trace_enable_timestamps(int sockfd);
+
+// Función para leer la espera en el kernel de un datagrama recibido con SO_TIMESTAMPNS.
+// `realtime_ns` es CLOCK_REALTIME al volver de la lectura. Retorna 0 si no hay marca.
+uint32_t dhcp_trace_kernel_delay(const struct msghdr* msg, uint64_t realtime_ns);
+
+// Función para sumar una muestra al histograma del hilo actual y disparar el probe dhcp:stage
+void dhcp_trace_record(dhcp_trace_stage_t stage, dhcp_trace_type_t type, uint64_t ns);
+
+// Función para clasificar el paquete actual por su tipo DHCP (registra KERNEL y QUEUE)
+void dhcp_trace_classify(uint8_t message_type, uint32_t xid);
+
+// Función para cerrar el paquete actual (registra TOTAL y dispara el probe dhcp:packet)
+void dhcp_trace_finish_packet();
+
+// Función para resumir el histograma de un tipo y una etapa. Retorna las muestras.
+uint64_t dhcp_trace_summarize(dhcp_trace_type_t type, dhcp_trace_stage_t stage, dhcp_trace_summary_t* summary);
+
+// Función para imprimir los percentiles de cada tipo y etapa con muestras
+void dhcp_trace_dump(FILE* out);
+
+// Función para vaciar todos los histogramas (con los hilos que atienden detenidos)
+void dhcp_trace_reset();
+
+// Función para leer el índice del bucket de un valor y el mayor valor que cae en un bucket
+uint32_t dhcp_trace_bucket(uint64_t ns);
+uint64_t dhcp_trace_bucket_limit(uint32_t bucket);
+
+static inline uint64_t dhcp_trace_clock() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Hay alguien midiendo: DHCP_TRACE o un probe enganchado
+static inline int dhcp_trace_active() {
+#if DHCP_TRACE_COMPILED
+    return __builtin_expect(dhcp_trace_enabled | dhcp_stage_semaphore | dhcp_packet_semaphore, 0);
+#else
+    return 0;
+#endif
+}
+
+// Función para marcar el inicio de una etapa (0 si no se mide)
+static inline uint64_t dhcp_trace_start() {
+    return dhcp_trace_active() ? dhcp_trace_clock() : 0;
+}
+
+// Función para registrar una etapa del paquete actual iniciada en `start`
+static inline void dhcp_trace_end(dhcp_trace_stage_t stage, uint64_t start) {
+    if (__builtin_expect(start != 0, 0)) {
+        dhcp_trace_record(stage, (dhcp_trace_type_t)dhcp_trace_packet.type, dhcp_trace_clock() - start);
+    }
+}
+
+// Función para anotar cuándo se leyó el paquete que el hilo va a atender
+static inline void dhcp_trace_received(uint64_t rx_ns, uint32_t kernel_ns) {
+    if (dhcp_trace_active()) {
+        dhcp_trace_packet.rx_ns = rx_ns;
+        dhcp_trace_packet.kernel_ns = kernel_ns;
+    }
+}
+
+// Función para empezar a atender un paquete. Retorna el inicio de la etapa PARSE (0 si no se mide).
+static inline uint64_t dhcp_trace_begin_packet() {
+    uint64_t start = dhcp_trace_start();
+    dhcp_trace_packet.start_ns = start;
+    dhcp_trace_packet.type = DHCP_TRACE_OTHER;
+    return start;
+}
+
+static inline void dhcp_trace_end_packet() {
+    if (__builtin_expect(dhcp_trace_packet.start_ns != 0, 0)) {
+        dhcp_trace_finish_packet();
+    }
+}
+
+#endif // DHCP_TRACE_H
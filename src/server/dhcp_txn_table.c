@@ -0,0 +1,213 @@
+#include "dhcp_txn_table.h"
+#include <stdlib.h> // Para calloc, free
+#include <string.h> // Para memcmp, memcpy, memset
+#include <time.h>   // Para clock_gettime
+
+// Finalizador de MurmurHash3: mezcla todos los bits de la entrada
+static inline uint64_t mix64(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ULL;
+    key ^= key >> 33;
+    return key;
+}
+
+// Empaquetar los 6 bytes de la MAC en un entero de 48 bits
+static inline uint64_t mac_to_u64(const uint8_t* mac) {
+    return ((uint64_t)mac[0] << 40) | ((uint64_t)mac[1] << 32) | ((uint64_t)mac[2] << 24) |
+           ((uint64_t)mac[3] << 16) | ((uint64_t)mac[4] << 8) | (uint64_t)mac[5];
+}
+
+unsigned int hash_mac(const uint8_t* mac) {
+    return (unsigned int)mix64(mac_to_u64(mac));
+}
+
+// Hash de la clave completa (chaddr, xid)
+static inline uint32_t hash_key(const uint8_t* chaddr, uint32_t xid) {
+    return (uint32_t)mix64(mac_to_u64(chaddr) ^ ((uint64_t)xid * 0x9e3779b97f4a7c15ULL));
+}
+
+static inline int is_expired(const client_transaction_t* entry, uint32_t now) {
+    return (int32_t)(now - entry->expires) >= 0;
+}
+
+uint32_t txn_clock_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint32_t)ts.tv_sec;
+}
+
+int txn_table_init(txn_table_t* table, uint32_t capacity) {
+    uint32_t size = TXN_TABLE_MIN_CAPACITY;
+    while (size < capacity) {
+        size <<= 1;
+    }
+
+    table->slots = (client_transaction_t*)calloc(size, sizeof(client_transaction_t));
+    if (!table->slots) {
+        return -1;
+    }
+    if (timer_wheel_init(&table->timers, size, txn_clock_now()) < 0) {
+        free(table->slots);
+        table->slots = NULL;
+        return -1;
+    }
+    table->capacity = size;
+    table->reserved = size;
+    table->count = 0;
+    return 0;
+}
+
+void txn_table_free(txn_table_t* table) {
+    timer_wheel_free(&table->timers);
+    free(table->slots);
+    table->slots = NULL;
+    table->capacity = 0;
+    table->count = 0;
+}
+
+// Reubicar todas las entradas en un arreglo de `capacity` ranuras
+static int txn_table_resize(txn_table_t* table, uint32_t capacity) {
+    client_transaction_t* slots = (client_transaction_t*)calloc(capacity, sizeof(client_transaction_t));
+    if (!slots) {
+        return -1;
+    }
+    timer_wheel_t timers;
+    if (timer_wheel_init(&timers, capacity, table->timers.now) < 0) {
+        free(slots);
+        return -1;
+    }
+
+    uint32_t mask = capacity - 1;
+    for (uint32_t i = 0; i < table->capacity; i++) {
+        client_transaction_t* entry = &table->slots[i];
+        if (entry->state == TXN_EMPTY) continue;
+
+        uint32_t pos = entry->hash & mask;
+        while (slots[pos].state != TXN_EMPTY) {
+            pos = (pos + 1) & mask;
+        }
+        slots[pos] = *entry;
+        timer_wheel_schedule(&timers, pos, entry->expires);
+    }
+
+    timer_wheel_free(&table->timers);
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+    table->timers = timers;
+    return 0;
+}
+
+// Eliminar la ranura `pos` desplazando hacia atrás las entradas siguientes (sin lápidas)
+static void txn_table_delete_slot(txn_table_t* table, uint32_t pos) {
+    uint32_t mask = table->capacity - 1;
+    uint32_t hole = pos;
+    uint32_t next = pos;
+
+    timer_wheel_cancel(&table->timers, pos);
+    while (1) {
+        next = (next + 1) & mask;
+        client_transaction_t* entry = &table->slots[next];
+        if (entry->state == TXN_EMPTY) break;
+
+        // Solo se mueve si su posición ideal no cae entre el hueco y su posición actual
+        uint32_t home = entry->hash & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            table->slots[hole] = *entry;
+            timer_wheel_cancel(&table->timers, next);
+            timer_wheel_schedule(&table->timers, hole, entry->expires);
+            hole = next;
+        }
+    }
+
+    memset(&table->slots[hole], 0, sizeof(client_transaction_t));
+    table->count--;
+}
+
+client_transaction_t* txn_table_find(txn_table_t* table, const uint8_t* chaddr, uint32_t xid, uint32_t now) {
+    uint32_t mask = table->capacity - 1;
+    uint32_t hash = hash_key(chaddr, xid);
+    uint32_t pos = hash & mask;
+
+    while (table->slots[pos].state != TXN_EMPTY) {
+        client_transaction_t* entry = &table->slots[pos];
+        if (entry->hash == hash && entry->xid == xid && memcmp(entry->chaddr, chaddr, 6) == 0) {
+            if (is_expired(entry, now)) {
+                txn_table_delete_slot(table, pos);
+                return NULL;
+            }
+            return entry;
+        }
+        pos = (pos + 1) & mask;
+    }
+    return NULL;
+}
+
+client_transaction_t* txn_table_insert(txn_table_t* table, const uint8_t* chaddr, uint32_t xid, uint32_t now) {
+    // Mantener el factor de carga por debajo de 3/4
+    if ((uint64_t)(table->count + 1) * 4 > (uint64_t)table->capacity * 3) {
+        if (txn_table_resize(table, table->capacity * 2) < 0) {
+            return NULL;
+        }
+    }
+
+    uint32_t mask = table->capacity - 1;
+    uint32_t hash = hash_key(chaddr, xid);
+    uint32_t pos = hash & mask;
+
+    while (table->slots[pos].state != TXN_EMPTY) {
+        client_transaction_t* entry = &table->slots[pos];
+        if (entry->hash == hash && entry->xid == xid && memcmp(entry->chaddr, chaddr, 6) == 0) {
+            if (is_expired(entry, now)) {
+                // Reutilizar la ranura como si fuera una transacción nueva
+                entry->state = TXN_SELECTING;
+                entry->offered_ip = 0;
+                entry->client_id = 0;
+            }
+            txn_table_touch(table, entry, now);
+            return entry;
+        }
+        pos = (pos + 1) & mask;
+    }
+
+    client_transaction_t* entry = &table->slots[pos];
+    memcpy(entry->chaddr, chaddr, 6);
+    entry->state = TXN_SELECTING;
+    entry->xid = xid;
+    entry->hash = hash;
+    entry->offered_ip = 0;
+    entry->client_id = 0;
+    table->count++;
+    txn_table_touch(table, entry, now);
+    return entry;
+}
+
+void txn_table_remove(txn_table_t* table, client_transaction_t* entry) {
+    // La memoria no se devuelve aquí: un RELEASE no debe costar un redimensionado
+    txn_table_delete_slot(table, (uint32_t)(entry - table->slots));
+}
+
+void txn_table_touch(txn_table_t* table, client_transaction_t* entry, uint32_t now) {
+    entry->expires = now + TRANSACTION_TIMEOUT;
+    timer_wheel_schedule(&table->timers, (uint32_t)(entry - table->slots), entry->expires);
+}
+
+uint32_t txn_table_expire(txn_table_t* table, uint32_t now, uint32_t budget) {
+    uint32_t removed = 0;
+
+    // La rueda entrega solo las ranuras vencidas; las demás entradas no se visitan
+    while (removed < budget) {
+        uint32_t pos = timer_wheel_expire_next(&table->timers, now);
+        if (pos == TIMER_NONE) break;
+        txn_table_delete_slot(table, pos);
+        removed++;
+    }
+
+    // Devolver memoria cuando los vencimientos dejan la tabla casi vacía
+    if (removed > 0 && table->capacity > table->reserved && table->count * 8 < table->capacity) {
+        txn_table_resize(table, table->capacity / 2);
+    }
+    return removed;
+}
@@ -0,0 +1,71 @@
+#ifndef DHCP_TXN_TABLE_H
+#define DHCP_TXN_TABLE_H
+
+#include <stdint.h> // Para uint8_t, uint32_t
+#include <stddef.h> // Para size_t
+#include "timer_wheel.h" // Rueda de timers para los vencimientos
+
+#define TXN_TABLE_MIN_CAPACITY 64   // Capacidad mínima (potencia de 2)
+#define TXN_TABLE_PREALLOC_MAX 16384 // Ranuras que un hilo reserva de antemano como máximo
+#define TRANSACTION_TIMEOUT 60      // Segundos que vive una transacción sin actividad
+
+// Estados de la transacción de un cliente, vistos desde el servidor
+typedef enum {
+    TXN_EMPTY = 0,      // Ranura libre de la tabla
+    TXN_SELECTING,      // OFFER enviado, el cliente está eligiendo entre ofertas
+    TXN_REQUESTING,     // REQUEST recibido, pendiente de confirmar con ACK o NAK
+    TXN_BOUND           // ACK enviado, la IP quedó vinculada al cliente
+} dhcp_txn_state_t;
+
+// Entrada compacta de la tabla (28 bytes, sin punteros)
+typedef struct {
+    uint8_t chaddr[6];      // Dirección MAC del cliente (parte de la clave)
+    uint8_t state;          // dhcp_txn_state_t (TXN_EMPTY si la ranura está libre)
+    uint8_t reserved;
+    uint32_t xid;           // ID de transacción (parte de la clave)
+    uint32_t hash;          // Hash de la clave, cacheado para sondeo y redimensionado
+    uint32_t offered_ip;    // IP ofrecida en el último OFFER
+    uint32_t client_id;     // Identificador del cliente (para los logs)
+    uint32_t expires;       // Segundo monotónico en que expira la transacción
+} client_transaction_t;
+
+// Tabla de direccionamiento abierto con sondeo lineal, indexada por (chaddr, xid).
+// Cada ranura ocupada tiene un timer (en segundos) con el mismo índice en `timers`.
+typedef struct {
+    client_transaction_t* slots;  // Arreglo de ranuras
+    uint32_t capacity;            // Número de ranuras (potencia de 2)
+    uint32_t count;               // Entradas ocupadas (incluye expiradas aún no reclamadas)
+    uint32_t reserved;            // Capacidad inicial: la tabla no se achica por debajo
+    timer_wheel_t timers;         // Vencimientos de las entradas, indexados por ranura
+} txn_table_t;
+
+// Función para inicializar una tabla con al menos `capacity` ranuras. Mientras las entradas
+// entren en esa capacidad la tabla no vuelve a reservar memoria.
+int txn_table_init(txn_table_t* table, uint32_t capacity);
+
+// Función para liberar la memoria de una tabla
+void txn_table_free(txn_table_t* table);
+
+// Función para buscar una transacción vigente; retorna NULL si no existe o expiró
+client_transaction_t* txn_table_find(txn_table_t* table, const uint8_t* chaddr, uint32_t xid, uint32_t now);
+
+// Función para obtener la transacción de (chaddr, xid), creándola si no existe.
+// Los punteros a entradas dejan de ser válidos tras otra inserción o eliminación.
+client_transaction_t* txn_table_insert(txn_table_t* table, const uint8_t* chaddr, uint32_t xid, uint32_t now);
+
+// Función para eliminar una entrada de la tabla
+void txn_table_remove(txn_table_t* table, client_transaction_t* entry);
+
+// Función para extender la vida de una transacción hasta now + TRANSACTION_TIMEOUT
+void txn_table_touch(txn_table_t* table, client_transaction_t* entry, uint32_t now);
+
+// Función para eliminar hasta `budget` transacciones expiradas (costo proporcional a las expiradas)
+uint32_t txn_table_expire(txn_table_t* table, uint32_t now, uint32_t budget);
+
+// Función para obtener los segundos del reloj monotónico de baja resolución
+uint32_t txn_clock_now();
+
+// Función hash de la MAC (mezcla completa de los 48 bits)
+unsigned int hash_mac(const uint8_t* mac);
+
+#endif // DHCP_TXN_TABLE_H
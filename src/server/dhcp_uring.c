@@ -0,0 +1,392 @@
+#include "dhcp_server.h"
+
+// Backend io_uring del servidor (DHCP_IO_MODE=uring). Se compila si el sistema tiene
+// <linux/io_uring.h> y no se definió DHCP_NO_URING; en tiempo de ejecución, si el kernel
+// no soporta io_uring (o la recepción multishot), run_uring_server retorna -1 y el
+// servidor sigue con el bucle de sockets.
+#if !defined(DHCP_NO_URING) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define DHCP_HAVE_URING 1
+#endif
+#endif
+
+#ifdef DHCP_HAVE_URING
+
+#include <linux/io_uring.h>  // Para io_uring_params, io_uring_sqe, io_uring_cqe
+#include <sys/syscall.h>     // Para __NR_io_uring_setup, __NR_io_uring_enter
+#include <sys/mman.h>        // Para mmap
+#include <poll.h>            // Para POLLIN
+
+// Etiquetas de user_data para distinguir las completions
+#define URING_TAG_RECV   1ULL
+#define URING_TAG_SEND   2ULL
+#define URING_TAG_EVENTS 3ULL
+
+// Anillo de io_uring con sus colas mapeadas (sin liburing)
+typedef struct {
+    int fd;
+    int sqpoll;                       // El kernel consume la SQ con su propio hilo
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_flags, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    unsigned sq_entries;
+    unsigned sq_local_tail;           // SQEs preparadas (publicadas al enviar)
+    unsigned sq_submitted;            // SQEs ya entregadas al kernel
+    void* sq_ring;
+    size_t sq_ring_size;
+    void* cq_ring;
+    size_t cq_ring_size;
+    size_t sqes_size;
+    struct io_uring_buf_ring* buf_ring;  // Anillo de buffers provistos para la recepción
+    unsigned buf_tail;
+    uint8_t* buffers;                 // URING_BUFFERS buffers de URING_BUFFER_SIZE bytes
+} dhcp_uring_t;
+
+// Datagrama recibido pendiente de procesar (buffer prestado por el anillo)
+typedef struct {
+    uint16_t bid;
+    uint32_t length;
+} uring_rx_t;
+
+static int uring_setup(dhcp_uring_t* ring, unsigned entries, int sqpoll) {
+    struct io_uring_params params;
+    memset(ring, 0, sizeof(*ring));
+    memset(&params, 0, sizeof(params));
+    if (sqpoll) {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = URING_SQPOLL_IDLE_MS;
+    }
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0) {
+        return -1;
+    }
+    ring->sqpoll = sqpoll;
+    ring->sq_entries = params.sq_entries;
+
+    // Mapear la SQ, la CQ (un solo mapeo si el kernel lo permite) y el arreglo de SQEs
+    ring->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (ring->cq_ring_size > ring->sq_ring_size) ring->sq_ring_size = ring->cq_ring_size;
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        close(ring->fd);
+        return -1;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                             ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            munmap(ring->sq_ring, ring->sq_ring_size);
+            close(ring->fd);
+            return -1;
+        }
+    }
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+        munmap(ring->sq_ring, ring->sq_ring_size);
+        close(ring->fd);
+        return -1;
+    }
+
+    uint8_t* sq = (uint8_t*)ring->sq_ring;
+    uint8_t* cq = (uint8_t*)ring->cq_ring;
+    ring->sq_head = (unsigned*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned*)(sq + params.sq_off.ring_mask);
+    ring->sq_flags = (unsigned*)(sq + params.sq_off.flags);
+    ring->sq_array = (unsigned*)(sq + params.sq_off.array);
+    ring->cq_head = (unsigned*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+    ring->sq_local_tail = *ring->sq_tail;
+    ring->sq_submitted = ring->sq_local_tail;
+    return 0;
+}
+
+static void uring_free(dhcp_uring_t* ring) {
+    // Cerrar el anillo cancela la recepción multishot antes de liberar los buffers
+    close(ring->fd);
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_size);
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    if (ring->buf_ring) munmap(ring->buf_ring, URING_BUFFERS * sizeof(struct io_uring_buf));
+    free(ring->buffers);
+    memset(ring, 0, sizeof(*ring));
+}
+
+// Entregar las SQEs preparadas y, si wait_nr > 0, esperar completions (una sola syscall)
+static int uring_enter(dhcp_uring_t* ring, unsigned wait_nr) {
+    unsigned to_submit = ring->sq_local_tail - ring->sq_submitted;
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+    ring->sq_submitted = ring->sq_local_tail;
+
+    unsigned flags = wait_nr ? IORING_ENTER_GETEVENTS : 0;
+    if (ring->sqpoll) {
+        // Con SQPOLL solo hace falta entrar para esperar o para despertar al hilo del kernel
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(ring->sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) {
+            flags |= IORING_ENTER_SQ_WAKEUP;
+        } else if (!wait_nr) {
+            return 0;
+        }
+    } else if (!to_submit && !wait_nr) {
+        return 0;
+    }
+
+    __atomic_fetch_add(&io_stats.ring_enters, 1, __ATOMIC_RELAXED);
+    if (syscall(__NR_io_uring_enter, ring->fd, to_submit, wait_nr, flags, NULL, 0) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+static struct io_uring_sqe* uring_get_sqe(dhcp_uring_t* ring) {
+    // Si la SQ está llena, entregar lo preparado para hacer lugar
+    while (ring->sq_local_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries) {
+        if (uring_enter(ring, 0) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            return NULL;
+        }
+    }
+    unsigned index = ring->sq_local_tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    ring->sq_local_tail++;
+    return sqe;
+}
+
+// Devolver un buffer al anillo de buffers provistos (se publica con uring_publish_buffers)
+static void uring_recycle_buffer(dhcp_uring_t* ring, uint16_t bid) {
+    struct io_uring_buf* buf = &ring->buf_ring->bufs[ring->buf_tail & (URING_BUFFERS - 1)];
+    buf->addr = (uint64_t)(uintptr_t)(ring->buffers + (size_t)bid * URING_BUFFER_SIZE);
+    buf->len = URING_BUFFER_SIZE;
+    buf->bid = bid;
+    ring->buf_tail++;
+}
+
+static void uring_publish_buffers(dhcp_uring_t* ring) {
+    __atomic_store_n(&ring->buf_ring->tail, (uint16_t)ring->buf_tail, __ATOMIC_RELEASE);
+}
+
+static int uring_register_buffers(dhcp_uring_t* ring) {
+    ring->buf_ring = mmap(NULL, URING_BUFFERS * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->buf_ring == MAP_FAILED) {
+        ring->buf_ring = NULL;
+        return -1;
+    }
+    ring->buffers = (uint8_t*)calloc(URING_BUFFERS, URING_BUFFER_SIZE);
+    if (!ring->buffers) {
+        return -1;
+    }
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring->buf_ring;
+    reg.ring_entries = URING_BUFFERS;
+    reg.bgid = URING_BUFFER_GROUP;
+    if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        return -1;
+    }
+
+    for (unsigned i = 0; i < URING_BUFFERS; i++) {
+        uring_recycle_buffer(ring, (uint16_t)i);
+    }
+    uring_publish_buffers(ring);
+    return 0;
+}
+
+// Encabezado de la recepción multishot: solo se pide la dirección de origen
+static struct msghdr recv_template = { .msg_namelen = sizeof(struct sockaddr_in) };
+
+static int uring_arm_recv(dhcp_uring_t* ring, int sockfd) {
+    struct io_uring_sqe* sqe = uring_get_sqe(ring);
+    if (!sqe) return -1;
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = sockfd;
+    sqe->addr = (uint64_t)(uintptr_t)&recv_template;
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = URING_TAG_RECV;
+    return 0;
+}
+
+static int uring_arm_events(dhcp_uring_t* ring) {
+    // El epoll del bucle de eventos (timerfd, signalfd, eventfd) se vigila desde el anillo
+    struct io_uring_sqe* sqe = uring_get_sqe(ring);
+    if (!sqe) return -1;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = event_loop_fd();
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->user_data = URING_TAG_EVENTS;
+    return 0;
+}
+
+// Publicar las respuestas acumuladas como SENDMSG (se entregan juntas en el próximo enter)
+static int uring_queue_replies(dhcp_uring_t* ring, dhcp_msg_batch_t* tx) {
+    for (int i = 0; i < tx->count; i++) {
+        struct io_uring_sqe* sqe = uring_get_sqe(ring);
+        if (!sqe) return i;
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = tx->sockfd;
+        sqe->addr = (uint64_t)(uintptr_t)&tx->msgs[i].msg_hdr;
+        sqe->len = 1;
+        sqe->user_data = URING_TAG_SEND;
+    }
+    return tx->count;
+}
+
+int run_uring_server(int sockfd, int sqpoll) {
+    dhcp_uring_t ring;
+    if (uring_setup(&ring, URING_ENTRIES, sqpoll) < 0) {
+        perror("io_uring no disponible");
+        return -1;
+    }
+    if (uring_register_buffers(&ring) < 0) {
+        perror("No se pudo registrar el anillo de buffers de io_uring");
+        uring_free(&ring);
+        return -1;
+    }
+
+    // Contexto de procesamiento: una tabla de transacciones y un lote de respuestas
+    dhcp_worker_t context;
+    memset(&context, 0, sizeof(context));
+    context.sockfd = sockfd;
+    uring_rx_t* pending = (uring_rx_t*)malloc(URING_BUFFERS * sizeof(uring_rx_t));
+    if (!pending || txn_table_init(&context.transactions, transaction_capacity(1)) < 0 ||
+        dhcp_batch_init(&context.tx, io_batch_size) < 0 || event_loop_init(-1) < 0) {
+        perror("Error al preparar el backend io_uring");
+        free(pending);
+        txn_table_free(&context.transactions);
+        dhcp_batch_free(&context.tx);
+        uring_free(&ring);
+        return -1;
+    }
+    dhcp_tx_attach(&context.tx, sockfd);
+
+    uring_arm_recv(&ring, sockfd);
+    uring_arm_events(&ring);
+    printf("Servidor DHCP iniciado en el puerto %d con io_uring%s (lotes de %d paquetes)\n",
+           DHCP_SERVER_PORT, sqpoll ? " y SQPOLL" : "", io_batch_size);
+
+    unsigned pending_head = 0, pending_count = 0;  // Cola circular de datagramas recibidos
+    int pending_sends = 0;                         // SENDMSG en vuelo (usan el lote de respuestas)
+    int received_any = 0;
+    int result = 0;
+    int running = 1;
+
+    while (running) {
+        // Esperar solo si no hay completions listas; con SQPOLL casi nunca se entra al kernel
+        unsigned ready = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE) - *ring.cq_head;
+        if (uring_enter(&ring, ready ? 0 : 1) < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+            perror("Error en io_uring_enter");
+            break;
+        }
+
+        unsigned head = *ring.cq_head;
+        unsigned tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            struct io_uring_cqe* cqe = &ring.cqes[head & *ring.cq_mask];
+
+            if (cqe->user_data == URING_TAG_RECV) {
+                if (cqe->res >= 0 && (cqe->flags & IORING_CQE_F_BUFFER)) {
+                    uring_rx_t* rx = &pending[(pending_head + pending_count++) & (URING_BUFFERS - 1)];
+                    rx->bid = (uint16_t)(cqe->flags >> IORING_CQE_BUFFER_SHIFT);
+                    rx->length = (uint32_t)cqe->res;
+                    received_any = 1;
+                } else if (cqe->res == -EINVAL && !received_any) {
+                    // Kernel sin recepción multishot: volver al bucle de sockets
+                    fprintf(stderr, "Advertencia: El kernel no soporta recvmsg multishot en io_uring.\n");
+                    result = -1;
+                    running = 0;
+                    break;
+                } else if (cqe->res < 0 && cqe->res != -ENOBUFS) {
+                    errno = -cqe->res;
+                    perror("Error al recibir datos del cliente");
+                }
+                // La recepción multishot termina si se quedó sin buffers o falló: volver a armarla
+                if (!(cqe->flags & IORING_CQE_F_MORE)) {
+                    uring_arm_recv(&ring, sockfd);
+                }
+            } else if (cqe->user_data == URING_TAG_SEND) {
+                pending_sends--;
+                if (cqe->res >= 0) {
+                    __atomic_fetch_add(&io_stats.tx_packets, 1, __ATOMIC_RELAXED);
+                }
+            } else if (cqe->user_data == URING_TAG_EVENTS) {
+                if (event_loop_dispatch(-1, NULL, 0) < 0) {
+                    running = 0;
+                }
+                if (!(cqe->flags & IORING_CQE_F_MORE)) {
+                    uring_arm_events(&ring);
+                }
+            }
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+
+        // El lote de respuestas se reutiliza solo cuando el kernel terminó de enviar el anterior
+        if (!running || pending_sends > 0 || pending_count == 0) {
+            continue;
+        }
+
+        int budget = context.tx.capacity;
+        while (pending_count > 0 && budget-- > 0) {
+            uring_rx_t* rx = &pending[pending_head++ & (URING_BUFFERS - 1)];
+            pending_count--;
+
+            // Formato del buffer: io_uring_recvmsg_out, dirección de origen y el datagrama
+            uint8_t* base = ring.buffers + (size_t)rx->bid * URING_BUFFER_SIZE;
+            struct io_uring_recvmsg_out* out = (struct io_uring_recvmsg_out*)base;
+            struct sockaddr_in* client_addr = (struct sockaddr_in*)(out + 1);
+            uint8_t* payload = (uint8_t*)(out + 1) + recv_template.msg_namelen;
+            size_t length = out->payloadlen < BUFFER_SIZE ? out->payloadlen : BUFFER_SIZE;
+            __atomic_fetch_add(&io_stats.rx_packets, 1, __ATOMIC_RELAXED);
+
+            // El parser respeta `length`: no hace falta limpiar el resto del buffer
+            process_dhcp_packet(&context, client_addr, (struct dhcp_packet*)payload, length);
+            context.processed++;
+            uring_recycle_buffer(&ring, rx->bid);
+        }
+        uring_publish_buffers(&ring);
+
+        if (context.tx.count > 0) {
+            lease_journal_wait_for(context.tx.journal_seq);  // Las respuestas salen con sus leases ya en disco
+        }
+        pending_sends = uring_queue_replies(&ring, &context.tx);
+        context.tx.count = 0;
+    }
+
+    dhcp_tx_attach(NULL, -1);
+    event_loop_free();
+    uring_free(&ring);
+    txn_table_free(&context.transactions);
+    dhcp_batch_free(&context.tx);
+    free(pending);
+    return result;
+}
+
+#else
+
+int run_uring_server(int sockfd, int sqpoll) {
+    (void)sockfd;
+    (void)sqpoll;
+    fprintf(stderr, "Advertencia: El servidor se compiló sin soporte para io_uring.\n");
+    return -1;
+}
+
+#endif // DHCP_HAVE_URING
@@ -0,0 +1,512 @@
+#include "dhcp_server.h"
+
+// Definicion del pool de workers
+dhcp_worker_t* workers = NULL;     // Arreglo de workers del pool
+int num_workers = 0;               // Número de workers del pool
+packet_ring_t worker_packet_ring;  // Buffers de los paquetes recibidos para los workers
+
+static const char* colors[] = {
+    "\033[31m", // Rojo
+    "\033[32m", // Verde
+    "\033[33m", // Amarillo
+    "\033[34m", // Azul
+    "\033[35m", // Magenta
+    "\033[36m", // Cian
+};
+
+static const char* reset_color = "\033[0m";  // Restablecer el color de la consola
+
+// Slots tomados por el hilo que recibe y todavía sin datagrama (se usan en la próxima recepción)
+static uint32_t rx_slots[DHCP_MAX_BATCH];
+static uint8_t* rx_buffers[DHCP_MAX_BATCH];
+static int rx_claimed = 0;
+
+static uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Reservar los lotes de respuestas que se retienen hasta el commit de sus leases
+static int init_held_batches(dhcp_worker_t* worker) {
+    worker->held_first = worker->held_count = 0;
+    for (int i = 0; i < WORKER_HELD_BATCHES; i++) {
+        if (dhcp_batch_init(&worker->held[i], io_batch_size) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void free_held_batches(dhcp_worker_t* worker) {
+    for (int i = 0; i < WORKER_HELD_BATCHES; i++) {
+        dhcp_batch_free(&worker->held[i]);
+    }
+}
+
+// Con el journal, cada commit despierta a los workers que duermen con lotes retenidos.
+// Las mismas barreras que al encolar: el worker anota que espera y después mira el commit.
+static void wake_committed_workers() {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (int i = 0; i < num_workers; i++) {
+        if (__atomic_load_n(&workers[i].awaiting_commit, __ATOMIC_RELAXED)) {
+            dhcp_mutex_lock(&workers[i].queue_mutex);
+            pthread_cond_signal(&workers[i].queue_cond);
+            dhcp_mutex_unlock(&workers[i].queue_mutex);
+        }
+    }
+}
+
+int start_worker_pool(int sockfd, int count) {
+    // Usar un worker por núcleo si no se indicó un tamaño válido
+    if (count <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        count = cores > 0 ? (int)cores : 1;
+    }
+
+    // Anillo para el máximo en vuelo: colas llenas, un lote en proceso por worker
+    // y el lote que está recibiendo el hilo principal. Así nunca se agota.
+    rx_claimed = 0;
+    dhcp_trace_enable_timestamps(sockfd);
+    if (packet_ring_init(&worker_packet_ring, (uint32_t)count * (WORKER_QUEUE_SIZE + io_batch_size) + io_batch_size) < 0) {
+        perror("Error al asignar memoria para el anillo de paquetes");
+        return -1;
+    }
+
+    workers = (dhcp_worker_t*)calloc(count, sizeof(dhcp_worker_t));
+    if (!workers) {
+        perror("Error al asignar memoria para el pool de workers");
+        packet_ring_free(&worker_packet_ring);
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++) {
+        dhcp_worker_t* worker = &workers[i];
+        worker->id = i;
+        worker->sockfd = sockfd;
+        worker->running = 1;
+        worker->busy = 1;  // Hasta que el hilo vea su cola vacía por primera vez
+        dhcp_mutex_init(&worker->queue_mutex, "worker->queue_mutex");
+
+        // La espera de trabajo vence con el reloj monotónico, igual que las transacciones
+        pthread_condattr_t cond_attr;
+        pthread_condattr_init(&cond_attr);
+        pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&worker->queue_cond, &cond_attr);
+        pthread_condattr_destroy(&cond_attr);
+        pthread_cond_init(&worker->idle_cond, NULL);
+
+        if (txn_table_init(&worker->transactions, transaction_capacity(count)) < 0) {
+            perror("Error al asignar memoria para la tabla de transacciones del worker");
+            num_workers = i;
+            stop_worker_pool();
+            return -1;
+        }
+
+        worker->batch = (dhcp_packet_desc_t*)malloc(io_batch_size * sizeof(dhcp_packet_desc_t));
+        if (packet_queue_init(&worker->queue, WORKER_QUEUE_SIZE) < 0 || !worker->batch ||
+            dhcp_batch_init(&worker->tx, io_batch_size) < 0 ||
+            (lease_journal_enabled && init_held_batches(worker) < 0)) {
+            perror("Error al asignar memoria para la cola del worker");
+            packet_queue_free(&worker->queue);
+            free(worker->batch);
+            dhcp_batch_free(&worker->tx);
+            free_held_batches(worker);
+            txn_table_free(&worker->transactions);
+            num_workers = i;
+            stop_worker_pool();
+            return -1;
+        }
+
+        if (pthread_create(&worker->thread_id, NULL, worker_loop, worker) != 0) {
+            perror("Error al crear el hilo del worker");
+            packet_queue_free(&worker->queue);
+            free(worker->batch);
+            dhcp_batch_free(&worker->tx);
+            free_held_batches(worker);
+            txn_table_free(&worker->transactions);
+            num_workers = i;
+            stop_worker_pool();
+            return -1;
+        }
+    }
+
+    num_workers = count;
+    if (lease_journal_enabled) {
+        lease_journal_set_commit_hook(wake_committed_workers);
+    }
+    return 0;
+}
+
+void stop_worker_pool() {
+    if (!workers) return;
+    if (lease_journal_enabled) {
+        lease_journal_set_commit_hook(NULL);
+    }
+
+    // Pedir a cada worker que termine y esperar su salida
+    for (int i = 0; i < num_workers; i++) {
+        dhcp_mutex_lock(&workers[i].queue_mutex);
+        workers[i].running = 0;
+        pthread_cond_signal(&workers[i].queue_cond);
+        dhcp_mutex_unlock(&workers[i].queue_mutex);
+    }
+
+    for (int i = 0; i < num_workers; i++) {
+        dhcp_worker_t* worker = &workers[i];
+        pthread_join(worker->thread_id, NULL);
+
+        // Liberar las transacciones que quedaron en vuelo
+        txn_table_free(&worker->transactions);
+        packet_queue_free(&worker->queue);
+        free(worker->batch);
+        dhcp_batch_free(&worker->tx);
+        free_held_batches(worker);
+        dhcp_mutex_destroy(&worker->queue_mutex);
+        pthread_cond_destroy(&worker->queue_cond);
+        pthread_cond_destroy(&worker->idle_cond);
+    }
+
+    free(workers);
+    workers = NULL;
+    num_workers = 0;
+
+    // Ningún worker sigue leyendo slots
+    packet_ring_free(&worker_packet_ring);
+    rx_claimed = 0;
+}
+
+void drain_worker_pool() {
+    for (int i = 0; i < num_workers; i++) {
+        dhcp_mutex_lock(&workers[i].queue_mutex);
+        while (packet_queue_count(&workers[i].queue) > 0 || workers[i].busy) {
+            dhcp_cond_wait(&workers[i].idle_cond, &workers[i].queue_mutex);
+        }
+        dhcp_mutex_unlock(&workers[i].queue_mutex);
+    }
+}
+
+int enqueue_dhcp_packet(const dhcp_packet_desc_t* desc) {
+    const struct dhcp_packet* packet = (const struct dhcp_packet*)desc->data;
+
+    // Todos los paquetes de una MAC van al mismo worker, que es dueño de su transacción
+    dhcp_worker_t* worker = &workers[hash_mac(packet->chaddr) % num_workers];
+
+    if (packet_queue_push(&worker->queue, desc) < 0) {
+        worker->dropped++;
+        dhcp_stat_inc(DHCP_STAT_DROP_QUEUE_FULL);
+        return -1;
+    }
+
+    // El worker anota que duerme y después mira la cola; aquí se encola y después se mira
+    // si duerme. Con las dos barreras al menos uno de los dos ve lo que hizo el otro.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&worker->sleeping, __ATOMIC_RELAXED)) {
+        dhcp_mutex_lock(&worker->queue_mutex);
+        pthread_cond_signal(&worker->queue_cond);
+        dhcp_mutex_unlock(&worker->queue_mutex);
+    }
+    return 0;
+}
+
+int dispatch_dhcp_packet(struct sockaddr_in* client_addr, const uint8_t* buffer, size_t length) {
+    int slot = packet_ring_acquire(&worker_packet_ring);
+    if (slot < 0) {
+        return -1;
+    }
+
+    dhcp_packet_desc_t desc;
+    desc.slot = (uint32_t)slot;
+    desc.data = packet_ring_data(&worker_packet_ring, desc.slot);
+    desc.length = length > BUFFER_SIZE ? BUFFER_SIZE : (uint32_t)length;
+    desc.client_addr = *client_addr;
+    desc.rx_ns = monotonic_ns();
+    desc.kernel_ns = 0;
+    memcpy(desc.data, buffer, desc.length);
+    __atomic_fetch_add(&io_stats.rx_copies, 1, __ATOMIC_RELAXED);
+
+    if (enqueue_dhcp_packet(&desc) < 0) {
+        packet_ring_release(&worker_packet_ring, desc.slot);
+        return -1;
+    }
+    return 0;
+}
+
+int receive_dhcp_packets(int sockfd, dhcp_msg_batch_t* batch, int flags) {
+    // Completar los slots del próximo lote; los que no se llenen quedan para la siguiente vez
+    while (rx_claimed < batch->capacity) {
+        int slot = packet_ring_acquire(&worker_packet_ring);
+        if (slot < 0) break;
+        rx_slots[rx_claimed] = (uint32_t)slot;
+        rx_buffers[rx_claimed] = packet_ring_data(&worker_packet_ring, (uint32_t)slot);
+        rx_claimed++;
+    }
+    if (rx_claimed == 0) {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    int received = receive_dhcp_into(sockfd, batch, rx_buffers, rx_claimed, flags);
+    if (received <= 0) {
+        return received;
+    }
+
+    uint64_t now = monotonic_ns();
+    uint64_t realtime = 0;
+    if (dhcp_trace_kernel_timestamps) {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        realtime = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    }
+    for (int i = 0; i < received; i++) {
+        dhcp_packet_desc_t desc;
+        desc.data = rx_buffers[i];
+        desc.length = batch->msgs[i].msg_len;
+        desc.slot = rx_slots[i];
+        desc.client_addr = batch->addrs[i];
+        desc.rx_ns = now;
+        desc.kernel_ns = realtime ? dhcp_batch_kernel_delay(batch, i, realtime) : 0;
+        // La referencia del slot pasa al worker (o se suelta si el paquete se descarta)
+        process_received_packet(&desc);
+    }
+
+    // Correr los slots sin usar al principio
+    rx_claimed -= received;
+    memmove(rx_slots, rx_slots + received, rx_claimed * sizeof(rx_slots[0]));
+    memmove(rx_buffers, rx_buffers + received, rx_claimed * sizeof(rx_buffers[0]));
+    return received;
+}
+
+// Enviar los lotes retenidos más viejos hasta que queden `keep` (esperando su commit si hace
+// falta) y además los que ya están en disco. Siempre en orden: ninguna respuesta se adelanta.
+static void flush_held_batches(dhcp_worker_t* worker, int keep) {
+    while (worker->held_count > 0) {
+        dhcp_msg_batch_t* oldest = &worker->held[worker->held_first];
+        if (worker->held_count <= keep && !lease_journal_committed(oldest->journal_seq)) {
+            break;
+        }
+        dhcp_tx_flush(oldest);
+        worker->held_first = (worker->held_first + 1) % WORKER_HELD_BATCHES;
+        worker->held_count--;
+    }
+}
+
+// El lote retenido más viejo ya puede enviarse
+static int held_batch_ready(dhcp_worker_t* worker) {
+    return worker->held_count > 0 && lease_journal_committed(worker->held[worker->held_first].journal_seq);
+}
+
+void* worker_loop(void* arg) {
+    dhcp_worker_t* worker = (dhcp_worker_t*)arg;
+
+    // Las respuestas de este worker se acumulan y se envían con un sendmmsg por lote
+    dhcp_tx_attach(&worker->tx, worker->sockfd);
+    for (int i = 0; i < WORKER_HELD_BATCHES; i++) {
+        worker->held[i].sockfd = worker->sockfd;
+    }
+
+    // Los workers comparten el shard del pool: cada uno reserva direcciones de a lotes
+    address_cache_attach(address_cache_size);
+
+    while (1) {
+        // Tomar hasta un lote completo de descriptores sin bloquear
+        int taken = packet_queue_pop(&worker->queue, worker->batch, worker->tx.capacity);
+        dhcp_stat_set(DHCP_STAT_QUEUE_DEPTH, packet_queue_count(&worker->queue));
+        if (taken == 0) {
+            // Sin paquetes: los lotes retenidos que ya están en disco salen y el msync del
+            // resto empieza ya. El worker no los espera despierto: si llegan paquetes mientras
+            // tanto los procesa, y si no, el hilo de commit lo despierta al terminar.
+            flush_held_batches(worker, WORKER_HELD_BATCHES);
+            if (worker->held_count > 0) {
+                lease_journal_commit_now();
+            }
+
+            dhcp_mutex_lock(&worker->queue_mutex);
+            worker->busy = 0;
+            pthread_cond_broadcast(&worker->idle_cond);
+
+            // Dormir mientras no haya paquetes (sin espera activa), despertando solo
+            // cuando vence la próxima transacción en vuelo o se commitea un lote retenido
+            __atomic_store_n(&worker->sleeping, 1, __ATOMIC_RELAXED);
+            __atomic_store_n(&worker->awaiting_commit, worker->held_count > 0, __ATOMIC_RELAXED);
+            __atomic_thread_fence(__ATOMIC_SEQ_CST);
+            // Si la inactividad se prolonga, las direcciones reservadas vuelven al pool
+            struct timespec release_at;
+            clock_gettime(CLOCK_MONOTONIC, &release_at);
+            release_at.tv_sec += ADDR_CACHE_IDLE_S;
+            while (packet_queue_count(&worker->queue) == 0 && worker->running && !held_batch_ready(worker)) {
+                uint64_t deadline = timer_wheel_next_deadline(&worker->transactions.timers);
+                int release = address_cache_count() > 0 && (uint64_t)release_at.tv_sec < deadline;
+                if (deadline == UINT64_MAX && !release) {
+                    dhcp_cond_wait(&worker->queue_cond, &worker->queue_mutex);
+                    continue;
+                }
+
+                struct timespec until = { .tv_sec = (time_t)deadline, .tv_nsec = 0 };
+                if (release) {
+                    until = release_at;
+                }
+                if (dhcp_cond_timedwait(&worker->queue_cond, &worker->queue_mutex, &until) == ETIMEDOUT) {
+                    // La tabla es solo de este worker: se vence sin el mutex
+                    struct timespec now;
+                    clock_gettime(CLOCK_MONOTONIC, &now);
+                    dhcp_mutex_unlock(&worker->queue_mutex);
+                    txn_table_expire(&worker->transactions, (uint32_t)now.tv_sec, TXN_EXPIRE_BATCH);
+                    if (release && (now.tv_sec > release_at.tv_sec ||
+                                    (now.tv_sec == release_at.tv_sec && now.tv_nsec >= release_at.tv_nsec))) {
+                        address_cache_release();
+                    }
+                    dhcp_mutex_lock(&worker->queue_mutex);
+                }
+            }
+            __atomic_store_n(&worker->sleeping, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&worker->awaiting_commit, 0, __ATOMIC_RELAXED);
+
+            if (packet_queue_count(&worker->queue) == 0 && !worker->running) {
+                dhcp_mutex_unlock(&worker->queue_mutex);
+                break;
+            }
+            worker->busy = 1;
+            dhcp_mutex_unlock(&worker->queue_mutex);
+            continue;
+        }
+
+        // Cada paquete se procesa en su slot y el slot se suelta al terminar
+        for (int i = 0; i < taken; i++) {
+            dhcp_packet_desc_t* desc = &worker->batch[i];
+            dhcp_trace_received(desc->rx_ns, desc->kernel_ns);
+            process_dhcp_packet(worker, &desc->client_addr, (struct dhcp_packet*)desc->data, desc->length);
+            packet_ring_release(&worker_packet_ring, desc->slot);
+        }
+        // Con el journal, un lote cuyo commit no terminó queda retenido mientras se procesan
+        // los siguientes: el worker no se detiene esperando al disco y el orden se mantiene
+        // (detrás de un lote retenido también se retienen los que no esperan nada).
+        // Con la mitad de los lotes retenidos se pide el msync, que cubre a todos y termina
+        // mientras se procesa la otra mitad.
+        if (worker->held[0].capacity > 0) {
+            flush_held_batches(worker, WORKER_HELD_BATCHES - 1);
+        }
+        if (worker->held[0].capacity > 0 && worker->tx.count > 0 &&
+            (worker->held_count > 0 || !lease_journal_committed(worker->tx.journal_seq))) {
+            dhcp_msg_batch_t* slot = &worker->held[(worker->held_first + worker->held_count) % WORKER_HELD_BATCHES];
+            dhcp_msg_batch_t waiting = worker->tx;
+            worker->tx = *slot;
+            *slot = waiting;
+            if (++worker->held_count == WORKER_HELD_BATCHES / 2) {
+                lease_journal_commit_now();
+            }
+        } else {
+            dhcp_tx_flush(&worker->tx);
+        }
+        worker->processed += taken;
+    }
+
+    flush_held_batches(worker, 0);
+    address_cache_attach(0);  // Devolver las reservas antes de que se libere el pool
+    dhcp_tx_attach(NULL, -1);
+    return NULL;
+}
+
+void process_dhcp_packet(dhcp_worker_t* worker, struct sockaddr_in* client_addr, struct dhcp_packet* request, size_t length) {
+    int sockfd = worker->sockfd;
+    uint32_t now = txn_clock_now();
+
+    // Reclamar en lote las transacciones vencidas (la rueda solo entrega las expiradas)
+    txn_table_expire(&worker->transactions, now, TXN_EXPIRE_BATCH);
+
+    // Indexar las opciones una sola vez: los manejadores las consultan en O(1)
+    uint64_t traced = dhcp_trace_begin_packet();
+    dhcp_option_index_t options;
+    uint8_t message_type;
+    if (!validate_dhcp_packet(request, length, &options) || !dhcp_get_message_type(&options, &message_type)) {
+        dhcp_log_warn("Error: Paquete DHCP inválido de " DHCP_IP_FMT ".\n", DHCP_IP_ARGS(ntohl(client_addr->sin_addr.s_addr)));
+        dhcp_stat_inc(DHCP_STAT_RX_INVALID);
+        dhcp_trace_end(DHCP_TRACE_PARSE, traced);
+        dhcp_trace_end_packet();
+        return;
+    }
+    if (traced) {
+        dhcp_trace_classify(message_type, ntohl(request->xid));
+    }
+    dhcp_trace_end(DHCP_TRACE_PARSE, traced);
+
+    // Buscar la transacción en curso por (MAC, xid); en un DISCOVER nuevo la etapa incluye crearla
+    uint64_t lookup = dhcp_trace_start();
+    client_transaction_t* txn = txn_table_find(&worker->transactions, request->chaddr, request->xid, now);
+    if (txn != NULL || message_type != DHCP_DISCOVER) {
+        dhcp_trace_end(DHCP_TRACE_LOOKUP, lookup);
+    }
+
+    switch (message_type) {
+        case DHCP_DISCOVER:
+            dhcp_stat_inc(DHCP_STAT_RX_DISCOVER);
+            if (txn == NULL) {
+                dhcp_log_debug("Solicitud DHCP DISCOVER recibida de " DHCP_IP_FMT "\n", DHCP_IP_ARGS(ntohl(client_addr->sin_addr.s_addr)));
+                txn = txn_table_insert(&worker->transactions, request->chaddr, request->xid, now);
+                if (!txn) {
+                    dhcp_log_error("Error al asignar memoria para la nueva transacción de cliente\n");
+                    dhcp_trace_end_packet();
+                    return;
+                }
+                dhcp_trace_end(DHCP_TRACE_LOOKUP, lookup);
+                dhcp_mutex_lock(&client_id_mutex);
+                txn->client_id = client_id_counter++;
+                dhcp_mutex_unlock(&client_id_mutex);
+                dhcp_log_debug("%sWorker %d asignado al cliente %u\n%s", colors[txn->client_id % 6], worker->id, txn->client_id, reset_color);
+            }
+
+            // Un DISCOVER (nuevo o retransmitido) siempre deja la transacción en SELECTING
+            txn->offered_ip = handle_dhcp_discover(sockfd, client_addr, request, &options);
+            txn->state = TXN_SELECTING;
+            txn_table_touch(&worker->transactions, txn, now);
+            break;
+
+        case DHCP_REQUEST:
+            dhcp_stat_inc(DHCP_STAT_RX_REQUEST);
+            if (txn == NULL || txn->state == TXN_BOUND) {
+                // Renovación, INIT-REBOOT o REQUEST retransmitido: se atiende sin transacción
+                dhcp_log_debug("Solicitud DHCP REQUEST fuera de una selección. Verificando lease.\n");
+                if (handle_dhcp_request(sockfd, client_addr, request, &options)) {
+                    dhcp_stat_inc(DHCP_STAT_LEASES_RENEWED);
+                }
+                break;
+            }
+
+            dhcp_log_debug("Solicitud DHCP REQUEST recibida.\n");
+            txn->state = TXN_REQUESTING;
+            if (handle_dhcp_request(sockfd, client_addr, request, &options)) {
+                // Se conserva un tiempo para reconocer retransmisiones del mismo REQUEST
+                txn->state = TXN_BOUND;
+                txn_table_touch(&worker->transactions, txn, now);
+            } else {
+                // Tras un NAK el cliente vuelve a empezar con un DISCOVER
+                dhcp_log_info("%sCliente %u rechazado. Transacción cerrada.\n%s", colors[txn->client_id % 6], txn->client_id, reset_color);
+                txn_table_remove(&worker->transactions, txn);
+            }
+            break;
+
+        case DHCP_DECLINE:
+            dhcp_stat_inc(DHCP_STAT_RX_DECLINE);
+            dhcp_log_debug("Solicitud DHCP DECLINE recibida.\n");
+            handle_dhcp_decline(sockfd, client_addr, request);
+            if (txn) {
+                txn_table_remove(&worker->transactions, txn);
+            }
+            break;
+
+        case DHCP_RELEASE:
+            dhcp_stat_inc(DHCP_STAT_RX_RELEASE);
+            dhcp_log_debug("Solicitud DHCP RELEASE recibida.\n");
+            handle_dhcp_release(sockfd, client_addr, request);
+            if (txn) {
+                txn_table_remove(&worker->transactions, txn);
+            }
+            break;
+
+        default:
+            dhcp_stat_inc(DHCP_STAT_RX_OTHER);
+            dhcp_log_info("Solicitud DHCP no reconocida.\n");
+            break;
+    }
+    dhcp_trace_end_packet();
+}
@@ -0,0 +1,131 @@
+// dhcptop: vista en vivo del segmento de estadísticas del servidor DHCP (tasas por segundo).
+// Uso: ./dhcptop [intervalo_s] [pantallas]   (por defecto cada 1 s, sin fin; 0 pantallas = sin fin)
+// DHCP_STATS_SHM elige el segmento. Si la salida no es una terminal no se borra la pantalla.
+
+#include "dhcp_stats.h"
+#include <stdio.h>      // Para printf
+#include <stdlib.h>     // Para getenv, strtod
+#include <string.h>     // Para memset
+#include <time.h>       // Para nanosleep, clock_gettime
+#include <unistd.h>     // Para isatty
+
+static double wall_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Tasa de un contador entre dos lecturas (un reinicio del servidor vuelve el contador a 0)
+static double rate(const dhcp_stats_snapshot_t* now, const dhcp_stats_snapshot_t* before, int stat, double seconds) {
+    uint64_t current = now->values[stat];
+    uint64_t previous = before->values[stat];
+    return seconds > 0 && current >= previous ? (current - previous) / seconds : 0.0;
+}
+
+// Imprimir una fila alineando el nombre por caracteres (no por bytes, para los acentos)
+static void print_row(const char* name, double per_second, uint64_t total) {
+    int width = 20;
+    for (const char* c = name; *c; c++) {
+        width += ((unsigned char)*c & 0xc0) == 0x80;
+    }
+    printf("  %-*s %12.0f %14llu\n", width, name, per_second, (unsigned long long)total);
+}
+
+static void print_screen(const dhcp_stats_snapshot_t* now, const dhcp_stats_snapshot_t* before, double seconds) {
+    const uint64_t* v = now->values;
+    uint64_t size = now->header.pool_size;
+    uint64_t used = now->pool_used < size ? now->pool_used : size;
+    uint64_t quarantined = now->pool_quarantined < size - used ? now->pool_quarantined : size - used;
+    long uptime = (long)(time(NULL) - (time_t)now->header.start_time);
+
+    printf("dhcptop - servidor %d, activo hace %ldd %02ld:%02ld:%02ld, %u hilos publicando\n",
+           now->header.pid, uptime / 86400, uptime / 3600 % 24, uptime / 60 % 60, uptime % 60,
+           now->header.slots_used);
+    printf("Pool: %llu direcciones, %llu en uso (%.1f%%), %llu en cuarentena, %llu libres | OFFER pendientes: %llu | cola de workers: %llu\n\n",
+           (unsigned long long)size, (unsigned long long)used, size ? 100.0 * used / size : 0.0,
+           (unsigned long long)quarantined, (unsigned long long)(size - used - quarantined),
+           (unsigned long long)v[DHCP_STAT_OFFERS_PENDING],
+           (unsigned long long)v[DHCP_STAT_QUEUE_DEPTH]);
+
+    printf("%-22s %12s %14s\n", "Recibidos", "por seg", "total");
+    const char* rx_names[] = {"DISCOVER", "REQUEST", "DECLINE", "RELEASE", "otros", "inválidos"};
+    for (int i = 0; i <= DHCP_STAT_RX_INVALID - DHCP_STAT_RX_DISCOVER; i++) {
+        int stat = DHCP_STAT_RX_DISCOVER + i;
+        print_row(rx_names[i], rate(now, before, stat, seconds), v[stat]);
+    }
+
+    printf("%-22s %12s %14s\n", "Enviados", "por seg", "total");
+    const char* tx_names[] = {"OFFER", "ACK", "NAK"};
+    for (int i = 0; i <= DHCP_STAT_TX_NAK - DHCP_STAT_TX_OFFER; i++) {
+        int stat = DHCP_STAT_TX_OFFER + i;
+        print_row(tx_names[i], rate(now, before, stat, seconds), v[stat]);
+    }
+
+    printf("%-22s %12s %14s\n", "NAK por motivo", "por seg", "total");
+    const char* nak_names[] = {"pool agotado", "sin IP pedida", "fuera del pool", "IP de otra MAC", "error del almacén"};
+    for (int i = 0; i <= DHCP_STAT_NAK_STORE_ERROR - DHCP_STAT_NAK_POOL_EXHAUSTED; i++) {
+        int stat = DHCP_STAT_NAK_POOL_EXHAUSTED + i;
+        print_row(nak_names[i], rate(now, before, stat, seconds), v[stat]);
+    }
+
+    printf("%-22s %12s %14s\n", "Leases", "por seg", "total");
+    const char* lease_names[] = {"asignados", "renovados", "liberados", "rechazados", "vencidos",
+                                 "misma IP (activo)", "misma IP (terminado)"};
+    for (int i = 0; i <= DHCP_STAT_RETURN_GHOST - DHCP_STAT_LEASES_GRANTED; i++) {
+        int stat = DHCP_STAT_LEASES_GRANTED + i;
+        print_row(lease_names[i], rate(now, before, stat, seconds), v[stat]);
+    }
+
+    printf("%-22s %12s %14s\n", "Ofertas sin lease", "por seg", "total");
+    print_row("vencidas", rate(now, before, DHCP_STAT_OFFERS_EXPIRED, seconds), v[DHCP_STAT_OFFERS_EXPIRED]);
+    print_row("otra IP elegida", rate(now, before, DHCP_STAT_OFFERS_WITHDRAWN, seconds), v[DHCP_STAT_OFFERS_WITHDRAWN]);
+
+    printf("%-22s %12s %14s\n", "Cuarentena (DECLINE)", "por seg", "total");
+    print_row("entradas", rate(now, before, DHCP_STAT_QUARANTINE_STARTED, seconds), v[DHCP_STAT_QUARANTINE_STARTED]);
+    print_row("salidas", rate(now, before, DHCP_STAT_QUARANTINE_ENDED, seconds), v[DHCP_STAT_QUARANTINE_ENDED]);
+
+    printf("%-22s %12s %14s\n", "Descartados", "por seg", "total");
+    print_row("cola llena", rate(now, before, DHCP_STAT_DROP_QUEUE_FULL, seconds), v[DHCP_STAT_DROP_QUEUE_FULL]);
+    print_row("MAC de otro hilo", rate(now, before, DHCP_STAT_DROP_NOT_OWNER, seconds), v[DHCP_STAT_DROP_NOT_OWNER]);
+}
+
+int main(int argc, char* argv[]) {
+    double interval = argc > 1 ? strtod(argv[1], NULL) : 1.0;
+    long screens = argc > 2 ? strtol(argv[2], NULL, 10) : 0;
+    const char* stats_name = getenv("DHCP_STATS_SHM");
+    int terminal = isatty(STDOUT_FILENO);
+    if (interval <= 0) interval = 1.0;
+
+    dhcp_stats_snapshot_t before, now;
+    memset(&before, 0, sizeof(before));
+    double before_at = wall_seconds();
+    int have_before = dhcp_stats_read(stats_name, &before) == 0;
+
+    for (long shown = 0; screens <= 0 || shown < screens; shown++) {
+        struct timespec pause = { .tv_sec = (time_t)interval, .tv_nsec = (long)((interval - (time_t)interval) * 1e9) };
+        nanosleep(&pause, NULL);
+
+        double now_at = wall_seconds();
+        if (terminal) {
+            printf("\033[H\033[2J");
+        }
+        if (dhcp_stats_read(stats_name, &now) < 0) {
+            printf("Esperando el segmento de estadísticas del servidor DHCP...\n");
+            have_before = 0;
+        } else {
+            // Otro proceso (reinicio o relevo): las tasas empiezan de nuevo
+            if (!have_before || now.header.pid != before.header.pid) {
+                before = now;
+            }
+            print_screen(&now, &before, now_at - before_at);
+            before = now;
+            have_before = 1;
+        }
+        if (!terminal) {
+            printf("\n");
+        }
+        fflush(stdout);
+        before_at = now_at;
+    }
+    return 0;
+}
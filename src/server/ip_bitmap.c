@@ -0,0 +1,121 @@
+#include "ip_bitmap.h"
+#include <stdlib.h> // Para calloc, free
+#include <string.h> // Para memset
+
+int ip_bitmap_init(ip_bitmap_t* bitmap, uint32_t size) {
+    memset(bitmap, 0, sizeof(*bitmap));
+    if (size == 0) {
+        return -1;
+    }
+
+    // Calcular las palabras de cada nivel hasta que el nivel superior quepa en una
+    uint64_t entries = size;
+    do {
+        uint32_t words = (uint32_t)((entries + 63) / 64);
+        bitmap->bits[bitmap->levels] = (uint64_t*)calloc(words, sizeof(uint64_t));
+        if (!bitmap->bits[bitmap->levels]) {
+            ip_bitmap_free(bitmap);
+            return -1;
+        }
+        bitmap->words[bitmap->levels] = words;
+        bitmap->levels++;
+        entries = words;
+    } while (entries > 1);
+
+    // Marcar todo como libre; los bits sobrantes de la última palabra quedan en 0
+    entries = size;
+    for (int level = 0; level < bitmap->levels; level++) {
+        uint64_t* bits = bitmap->bits[level];
+        uint32_t full_words = (uint32_t)(entries / 64);
+        memset(bits, 0xff, full_words * sizeof(uint64_t));
+        if (entries % 64) {
+            bits[full_words] = (1ULL << (entries % 64)) - 1;
+        }
+        entries = bitmap->words[level];
+    }
+
+    bitmap->size = size;
+    bitmap->free_count = size;
+    return 0;
+}
+
+void ip_bitmap_free(ip_bitmap_t* bitmap) {
+    for (int level = 0; level < IP_BITMAP_MAX_LEVELS; level++) {
+        free(bitmap->bits[level]);
+        bitmap->bits[level] = NULL;
+    }
+    bitmap->levels = 0;
+    bitmap->size = 0;
+    bitmap->free_count = 0;
+}
+
+int ip_bitmap_is_free(const ip_bitmap_t* bitmap, uint32_t index) {
+    if (index >= bitmap->size) return 0;
+    return (bitmap->bits[0][index >> 6] >> (index & 63)) & 1;
+}
+
+void ip_bitmap_set_used(ip_bitmap_t* bitmap, uint32_t index) {
+    if (!ip_bitmap_is_free(bitmap, index)) return;
+    bitmap->free_count--;
+
+    // Limpiar el bit y propagar hacia arriba mientras la palabra quede vacía
+    for (int level = 0; level < bitmap->levels; level++) {
+        uint64_t* word = &bitmap->bits[level][index >> 6];
+        *word &= ~(1ULL << (index & 63));
+        if (*word != 0) break;
+        index >>= 6;
+    }
+}
+
+void ip_bitmap_set_free(ip_bitmap_t* bitmap, uint32_t index) {
+    if (index >= bitmap->size || ip_bitmap_is_free(bitmap, index)) return;
+    bitmap->free_count++;
+
+    // Activar el bit y propagar hacia arriba mientras la palabra estuviera vacía
+    for (int level = 0; level < bitmap->levels; level++) {
+        uint64_t* word = &bitmap->bits[level][index >> 6];
+        int was_empty = (*word == 0);
+        *word |= 1ULL << (index & 63);
+        if (!was_empty) break;
+        index >>= 6;
+    }
+}
+
+// Primer bit activo con posición >= pos en el nivel indicado, o IP_BITMAP_NONE
+static uint32_t find_set_from(const ip_bitmap_t* bitmap, int level, uint64_t pos) {
+    uint64_t word_index = pos >> 6;
+    if (word_index >= bitmap->words[level]) {
+        return IP_BITMAP_NONE;
+    }
+
+    // Revisar el resto de la palabra actual (palabra a palabra, con ctz)
+    uint64_t word = bitmap->bits[level][word_index] & (~0ULL << (pos & 63));
+    if (word) {
+        return (uint32_t)((word_index << 6) + __builtin_ctzll(word));
+    }
+    if (level + 1 == bitmap->levels) {
+        return IP_BITMAP_NONE;
+    }
+
+    // El nivel superior indica cuál es la siguiente palabra con bits libres
+    uint32_t next = find_set_from(bitmap, level + 1, word_index + 1);
+    if (next == IP_BITMAP_NONE) {
+        return IP_BITMAP_NONE;
+    }
+    return (uint32_t)(((uint64_t)next << 6) + __builtin_ctzll(bitmap->bits[level][next]));
+}
+
+uint32_t ip_bitmap_find_free(const ip_bitmap_t* bitmap, uint32_t from) {
+    if (bitmap->free_count == 0) {
+        return IP_BITMAP_NONE;
+    }
+    if (from >= bitmap->size) {
+        from = 0;
+    }
+
+    uint32_t index = find_set_from(bitmap, 0, from);
+    if (index == IP_BITMAP_NONE && from > 0) {
+        index = find_set_from(bitmap, 0, 0);  // Dar la vuelta al inicio del pool
+    }
+    return index;
+}
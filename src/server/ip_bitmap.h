@@ -0,0 +1,39 @@
+#ifndef IP_BITMAP_H
+#define IP_BITMAP_H
+
+#include <stdint.h> // Para uint32_t, uint64_t
+
+#define IP_BITMAP_MAX_LEVELS 6          // Suficiente para 2^32 direcciones
+#define IP_BITMAP_NONE UINT32_MAX       // No hay direcciones libres
+
+// Bitmap jerárquico de direcciones libres de un pool.
+// En el nivel 0 cada bit es una dirección (1 = libre). En el nivel k cada bit
+// indica si la palabra correspondiente del nivel k-1 tiene algún bit libre, y el
+// último nivel ocupa una sola palabra.
+typedef struct {
+    uint32_t size;                               // Número de direcciones del pool
+    uint32_t free_count;                         // Direcciones libres
+    int levels;                                  // Niveles usados
+    uint32_t words[IP_BITMAP_MAX_LEVELS];        // Palabras de 64 bits por nivel
+    uint64_t* bits[IP_BITMAP_MAX_LEVELS];        // Palabras de cada nivel
+} ip_bitmap_t;
+
+// Función para inicializar un bitmap de `size` direcciones, todas libres
+int ip_bitmap_init(ip_bitmap_t* bitmap, uint32_t size);
+
+// Función para liberar la memoria de un bitmap
+void ip_bitmap_free(ip_bitmap_t* bitmap);
+
+// Función para saber si una dirección (índice dentro del pool) está libre
+int ip_bitmap_is_free(const ip_bitmap_t* bitmap, uint32_t index);
+
+// Función para marcar una dirección como ocupada
+void ip_bitmap_set_used(ip_bitmap_t* bitmap, uint32_t index);
+
+// Función para marcar una dirección como libre
+void ip_bitmap_set_free(ip_bitmap_t* bitmap, uint32_t index);
+
+// Función para buscar la primera dirección libre a partir de `from`, dando la vuelta al final
+uint32_t ip_bitmap_find_free(const ip_bitmap_t* bitmap, uint32_t from);
+
+#endif // IP_BITMAP_H
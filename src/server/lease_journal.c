@@ -0,0 +1,743 @@
+#include "lease_journal.h"
+#include "dhcp_log.h"
+#include "dhcp_lock.h"
+#include <dirent.h>   // Para opendir, readdir
+#include <errno.h>    // Para errno
+#include <fcntl.h>    // Para open
+#include <limits.h>   // Para PATH_MAX
+#include <pthread.h>  // Para hilos, mutex y condiciones
+#include <stddef.h>   // Para offsetof
+#include <stdlib.h>   // Para calloc, free, strtoull
+#include <string.h>   // Para memcpy, memset, strncmp
+#include <sys/mman.h> // Para mmap, msync
+#include <sys/stat.h> // Para fstat
+#include <time.h>     // Para clock_gettime, nanosleep
+#include <unistd.h>   // Para close, fsync, unlink
+
+#define SNAPSHOT_MAGIC 0x4c534e50   // "LSNP"
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_NAME "leases.snap"
+#define JOURNAL_PREFIX "journal."
+#define SNAPSHOT_BUFFER (1 << 20)   // Buffer de escritura del snapshot
+
+// Encabezado del snapshot; le siguen `count` registros
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t journal_gen;   // Primer segmento que se reaplica encima del snapshot
+    uint64_t seq;           // Último registro que el snapshot ya refleja
+    uint64_t count;         // Leases en el snapshot
+    uint64_t hash;          // Verificación de los registros
+    uint8_t reserved[24];   // Los registros empiezan alineados a 64 bytes
+} snapshot_header_t;
+
+// Segmento del journal proyectado en memoria
+typedef struct journal_segment {
+    struct journal_segment* next;    // Siguiente en la lista de segmentos retirados
+    uint64_t gen;                    // Generación (número en el nombre del archivo)
+    int fd;
+    lease_journal_record_t* records;
+    uint32_t used;                   // Registros escritos
+    uint32_t synced;                 // Registros en disco (solo el hilo de commit)
+} journal_segment_t;
+
+int lease_journal_enabled = 0;
+
+static lease_journal_config_t config;
+static char dir_path[PATH_MAX - 64];  // Deja lugar para el nombre de cada archivo
+
+static dhcp_mutex_t journal_lock = DHCP_MUTEX_INITIALIZER("journal_lock");  // Protege todo lo que sigue
+static pthread_cond_t work_cond;                                  // Despierta al hilo de commit
+static pthread_cond_t commit_cond = PTHREAD_COND_INITIALIZER;     // Avisa de un commit terminado
+static pthread_cond_t snapshot_cond;                              // Despierta al hilo de snapshots
+static journal_segment_t* current = NULL;    // Segmento en el que se agrega
+static journal_segment_t* retired = NULL;    // Segmentos llenos pendientes de sync y cierre
+static journal_segment_t* spare = NULL;      // Segmento siguiente ya reservado en disco
+static int spare_busy = 0;                   // Un hilo está reservando el segmento siguiente
+static int spare_wanted = 0;                 // Pedido al hilo de snapshots de reservar el siguiente
+static pthread_cond_t spare_cond = PTHREAD_COND_INITIALIZER;      // Avisa que terminó una reserva
+static uint64_t next_seq = 1;
+static uint64_t written_seq = 0;             // Último registro escrito en memoria
+static uint64_t committed_seq = 0;           // Último registro en disco
+static int running = 0;
+static int commit_idle = 0;                  // El hilo de commit espera trabajo
+static int commit_gathering = 0;             // El hilo de commit junta registros antes del msync
+static int commit_waiters = 0;               // Hilos esperando un commit: ya no tiene sentido juntar más
+static int commit_requested = 0;             // Un worker retuvo un lote: el msync empieza ya
+static lease_commit_fn commit_hook = NULL;   // Se llama después de cada commit
+static int snapshot_requested = 0;
+static lease_journal_stats_t stats;
+static pthread_t commit_thread;
+static pthread_t snapshot_thread;
+
+// Serializa los snapshots; también protege oldest_gen y los campos de escritura
+static dhcp_mutex_t snapshot_mutex = DHCP_MUTEX_INITIALIZER("snapshot_mutex");
+static uint64_t oldest_gen = 0;      // Primer segmento que todavía no cubre un snapshot
+static FILE* snapshot_file = NULL;   // Snapshot en escritura (dentro de collect)
+static uint64_t snapshot_count;
+static uint64_t snapshot_hash;
+
+static __thread uint64_t thread_last_seq = 0;  // Último registro agregado por este hilo
+
+static double monotonic_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// FNV-1a sobre los bytes anteriores al checksum; un registro en cero nunca es válido
+static uint32_t record_checksum(const lease_journal_record_t* record) {
+    const uint8_t* bytes = (const uint8_t*)record;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < offsetof(lease_journal_record_t, checksum); i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Verificación del snapshot, de a palabras de 64 bits
+static uint64_t hash_record(uint64_t hash, const lease_journal_record_t* record) {
+    uint64_t words[sizeof(*record) / 8];
+    memcpy(words, record, sizeof(words));
+    for (size_t i = 0; i < sizeof(words) / 8; i++) {
+        hash = (hash ^ words[i]) * 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static void journal_path(char* path, uint64_t gen) {
+    snprintf(path, PATH_MAX, "%s/" JOURNAL_PREFIX "%llu", dir_path, (unsigned long long)gen);
+}
+
+// Llevar a disco la entrada del directorio (archivos creados, renombrados o borrados)
+static void sync_dir() {
+    int fd = open(dir_path, O_RDONLY | O_DIRECTORY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+// Crear y proyectar el segmento `gen`, con todo su espacio reservado de antemano
+static journal_segment_t* open_segment(uint64_t gen) {
+    char path[PATH_MAX];
+    journal_path(path, gen);
+    size_t bytes = (size_t)LEASE_JOURNAL_SEGMENT_RECORDS * sizeof(lease_journal_record_t);
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        perror("Error al crear un segmento del journal de leases");
+        return NULL;
+    }
+    // El segmento se llena de ceros y se lleva a disco de entrada: con los bloques ya
+    // escritos, cada commit solo lleva datos (un espacio reservado con fallocate queda
+    // marcado sin escribir y cada msync tendría que actualizar también los metadatos)
+    static const uint8_t zeros[1 << 16];
+    for (size_t offset = 0; offset < bytes; offset += sizeof(zeros)) {
+        if (write(fd, zeros, sizeof(zeros)) != (ssize_t)sizeof(zeros)) {
+            perror("Error al reservar un segmento del journal de leases");
+            close(fd);
+            unlink(path);
+            return NULL;
+        }
+    }
+    fdatasync(fd);
+    // Las páginas se proyectan ya: el primer registro de cada una no paga la falla completa
+    void* map = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    journal_segment_t* segment = (journal_segment_t*)calloc(1, sizeof(journal_segment_t));
+    if (map == MAP_FAILED || !segment) {
+        perror("Error al proyectar un segmento del journal de leases");
+        if (map != MAP_FAILED) munmap(map, bytes);
+        free(segment);
+        close(fd);
+        return NULL;
+    }
+    sync_dir();
+
+    segment->gen = gen;
+    segment->fd = fd;
+    segment->records = (lease_journal_record_t*)map;
+    return segment;
+}
+
+static void close_segment(journal_segment_t* segment) {
+    munmap(segment->records, (size_t)LEASE_JOURNAL_SEGMENT_RECORDS * sizeof(lease_journal_record_t));
+    close(segment->fd);
+    free(segment);
+}
+
+// Llevar a disco los registros [from, to) de un segmento
+static void sync_records(journal_segment_t* segment, uint32_t from, uint32_t to) {
+    if (to <= from) return;
+    uintptr_t page = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t start = (uintptr_t)(segment->records + from) & ~(page - 1);
+    uintptr_t end = (uintptr_t)(segment->records + to);
+    if (msync((void*)start, end - start, MS_SYNC) < 0) {
+        perror("Error al llevar a disco el journal de leases");
+    }
+}
+
+// Reservar en disco el segmento que sigue al actual, sin journal_lock tomado mientras se
+// escriben los ceros y corre el fdatasync: los hilos que agregan registros (con el lock de su
+// shard tomado) no esperan al disco. Retorna -1 si no se pudo crear.
+static int prepare_spare() {
+    dhcp_mutex_lock(&journal_lock);
+    while (spare_busy) {
+        dhcp_cond_wait(&spare_cond, &journal_lock);
+    }
+    if (spare) {
+        dhcp_mutex_unlock(&journal_lock);
+        return 0;
+    }
+    // Mientras tanto el actual no cambia: solo se rota hacia un segmento ya reservado
+    spare_busy = 1;
+    uint64_t gen = current->gen + 1;
+    dhcp_mutex_unlock(&journal_lock);
+
+    journal_segment_t* segment = open_segment(gen);
+
+    dhcp_mutex_lock(&journal_lock);
+    spare = segment;
+    spare_busy = 0;
+    pthread_cond_broadcast(&spare_cond);
+    dhcp_mutex_unlock(&journal_lock);
+    return segment ? 0 : -1;
+}
+
+// Pasar al segmento siguiente ya reservado (con journal_lock tomado); el anterior lo cierra el
+// hilo de commit. Retorna -1 si no hay segmento reservado.
+static int rotate_locked() {
+    if (!spare) {
+        return -1;
+    }
+    current->next = retired;
+    retired = current;
+    current = spare;
+    spare = NULL;
+    pthread_cond_signal(&work_cond);
+    return 0;
+}
+
+int lease_journal_append(int type, uint32_t ip, const uint8_t* mac, uint32_t lease_start, uint32_t lease_time) {
+    if (!lease_journal_enabled) return 0;
+
+    lease_journal_record_t record;
+    record.ip = ip;
+    memcpy(record.mac, mac, 6);
+    record.type = (uint8_t)type;
+    record.reserved = 0;
+    record.lease_start = lease_start;
+    record.lease_time = lease_time;
+
+    dhcp_mutex_lock(&journal_lock);
+    if (current->used == LEASE_JOURNAL_SEGMENT_RECORDS) {
+        // El siguiente se pidió a mitad del actual. Si el hilo de snapshots lo está creando se
+        // lo espera (solo usa journal_lock). Si no está, el segmento no se crea aquí, con el lock
+        // del shard tomado: se vuelve a pedir y el cambio falla (el cliente recibe NAK y reintenta).
+        while (spare_busy) {
+            dhcp_cond_wait(&spare_cond, &journal_lock);
+        }
+        if (rotate_locked() < 0) {
+            spare_wanted = 1;
+            pthread_cond_signal(&snapshot_cond);
+            dhcp_mutex_unlock(&journal_lock);
+            dhcp_log_error("Error: Journal de leases lleno, no se registró el cambio de " DHCP_IP_FMT "\n",
+                           DHCP_IP_ARGS(ip));
+            return -1;
+        }
+        // Un segmento lleno pide un snapshot que permita borrar los anteriores
+        snapshot_requested = 1;
+        pthread_cond_signal(&snapshot_cond);
+    } else if (current->used == LEASE_JOURNAL_SEGMENT_RECORDS / 2 && !spare && !spare_busy) {
+        // A mitad del segmento, el hilo de snapshots reserva el siguiente
+        spare_wanted = 1;
+        pthread_cond_signal(&snapshot_cond);
+    }
+    record.seq = next_seq++;
+    record.checksum = record_checksum(&record);
+    current->records[current->used++] = record;
+    written_seq = record.seq;
+    stats.appended++;
+    if (commit_idle) {
+        pthread_cond_signal(&work_cond);
+    }
+    dhcp_mutex_unlock(&journal_lock);
+
+    thread_last_seq = record.seq;
+    return 0;
+}
+
+void lease_journal_wait() {
+    lease_journal_wait_for(thread_last_seq);
+}
+
+uint64_t lease_journal_thread_seq() {
+    return thread_last_seq;
+}
+
+int lease_journal_committed(uint64_t seq) {
+    return !lease_journal_enabled || !config.wait_for_commit || seq == 0 ||
+           __atomic_load_n(&committed_seq, __ATOMIC_ACQUIRE) >= seq;
+}
+
+void lease_journal_wait_for(uint64_t seq) {
+    if (lease_journal_committed(seq)) return;
+
+    dhcp_mutex_lock(&journal_lock);
+    stats.waits++;
+    commit_waiters++;
+    if (commit_gathering) {
+        pthread_cond_signal(&work_cond);
+    }
+    while (committed_seq < seq && running) {
+        dhcp_cond_wait(&commit_cond, &journal_lock);
+    }
+    commit_waiters--;
+    dhcp_mutex_unlock(&journal_lock);
+}
+
+// Group commit: un msync lleva a disco todos los registros escritos desde el anterior
+void lease_journal_commit_now() {
+    if (!lease_journal_enabled) return;
+    dhcp_mutex_lock(&journal_lock);
+    if (committed_seq < written_seq) {
+        commit_requested = 1;
+        if (commit_gathering) {
+            pthread_cond_signal(&work_cond);
+        }
+    }
+    dhcp_mutex_unlock(&journal_lock);
+}
+
+void lease_journal_set_commit_hook(lease_commit_fn hook) {
+    dhcp_mutex_lock(&journal_lock);
+    commit_hook = hook;
+    dhcp_mutex_unlock(&journal_lock);
+}
+
+static void* commit_loop(void* arg) {
+    (void)arg;
+    dhcp_mutex_lock(&journal_lock);
+    while (1) {
+        while (running && written_seq == committed_seq && !retired) {
+            commit_idle = 1;
+            dhcp_cond_wait(&work_cond, &journal_lock);
+            commit_idle = 0;
+        }
+        if (!running && written_seq == committed_seq && !retired) break;
+
+        // Dar tiempo a que lleguen más registros al mismo commit, hasta que alguien necesite
+        // los suyos en disco: con la respuesta esperando, juntar más solo agrega latencia (los
+        // registros que lleguen durante el msync van al siguiente)
+        if (config.commit_us > 0 && running && commit_waiters == 0 && !commit_requested) {
+            struct timespec until;
+            clock_gettime(CLOCK_MONOTONIC, &until);
+            uint64_t ns = (uint64_t)until.tv_nsec + (uint64_t)config.commit_us * 1000;
+            until.tv_sec += (time_t)(ns / 1000000000ULL);
+            until.tv_nsec = (long)(ns % 1000000000ULL);
+            commit_gathering = 1;
+            while (running && commit_waiters == 0 && !commit_requested) {
+                if (dhcp_cond_timedwait(&work_cond, &journal_lock, &until) == ETIMEDOUT) break;
+            }
+            commit_gathering = 0;
+        }
+
+        uint64_t target = written_seq;
+        commit_requested = 0;
+        journal_segment_t* segment = current;
+        uint32_t from = segment->synced;
+        uint32_t to = segment->used;
+        journal_segment_t* old = retired;
+        retired = NULL;
+        dhcp_mutex_unlock(&journal_lock);
+
+        // Los segmentos retirados se terminan de escribir y se cierran
+        while (old) {
+            journal_segment_t* next = old->next;
+            sync_records(old, old->synced, old->used);
+            close_segment(old);
+            old = next;
+        }
+        sync_records(segment, from, to);
+
+        dhcp_mutex_lock(&journal_lock);
+        segment->synced = to;
+        __atomic_store_n(&committed_seq, target, __ATOMIC_RELEASE);
+        stats.commits++;
+        pthread_cond_broadcast(&commit_cond);
+        if (commit_hook) {
+            commit_hook();
+        }
+    }
+    dhcp_mutex_unlock(&journal_lock);
+    return NULL;
+}
+
+void lease_snapshot_add(uint32_t ip, const uint8_t* mac, uint32_t lease_start, uint32_t lease_time) {
+    lease_journal_record_t record;
+    memset(&record, 0, sizeof(record));
+    record.ip = ip;
+    memcpy(record.mac, mac, 6);
+    record.type = LEASE_JOURNAL_GRANT;
+    record.lease_start = lease_start;
+    record.lease_time = lease_time;
+
+    fwrite(&record, sizeof(record), 1, snapshot_file);
+    snapshot_hash = hash_record(snapshot_hash, &record);
+    snapshot_count++;
+}
+
+int lease_journal_snapshot() {
+    if (!lease_journal_enabled) return -1;
+    dhcp_mutex_lock(&snapshot_mutex);
+    double start = monotonic_seconds();
+
+    // Segmento nuevo: todo lo agregado antes ya está en el estado que se copia a continuación
+    // (si el actual sigue vacío ya cumple ese papel). Se reserva antes de tomar journal_lock.
+    dhcp_mutex_lock(&journal_lock);
+    uint64_t gen = current->gen;
+    int rotate = current->used > 0;
+    dhcp_mutex_unlock(&journal_lock);
+    if (rotate && prepare_spare() < 0) {
+        dhcp_mutex_unlock(&snapshot_mutex);
+        return -1;
+    }
+    dhcp_mutex_lock(&journal_lock);
+    // Si un segmento lleno rotó mientras tanto, el nuevo ya cumple ese papel
+    if (rotate && current->gen == gen && rotate_locked() < 0) {
+        dhcp_mutex_unlock(&journal_lock);
+        dhcp_mutex_unlock(&snapshot_mutex);
+        return -1;
+    }
+    gen = current->gen;
+    uint64_t seq = written_seq;
+    dhcp_mutex_unlock(&journal_lock);
+
+    char path[PATH_MAX], tmp_path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/" SNAPSHOT_NAME, dir_path);
+    snprintf(tmp_path, sizeof(tmp_path), "%s/" SNAPSHOT_NAME ".tmp", dir_path);
+    snapshot_file = fopen(tmp_path, "w");
+    if (!snapshot_file) {
+        perror("Error al crear el snapshot de leases");
+        dhcp_mutex_unlock(&snapshot_mutex);
+        return -1;
+    }
+    setvbuf(snapshot_file, NULL, _IOFBF, SNAPSHOT_BUFFER);
+
+    snapshot_header_t header;
+    memset(&header, 0, sizeof(header));
+    fwrite(&header, sizeof(header), 1, snapshot_file);  // Se completa al final
+    snapshot_count = 0;
+    snapshot_hash = 0xcbf29ce484222325ULL;
+    config.collect(config.ctx);
+
+    header.magic = SNAPSHOT_MAGIC;
+    header.version = SNAPSHOT_VERSION;
+    header.journal_gen = gen;
+    header.seq = seq;
+    header.count = snapshot_count;
+    header.hash = snapshot_hash;
+    int failed = fseek(snapshot_file, 0, SEEK_SET) < 0 ||
+                 fwrite(&header, sizeof(header), 1, snapshot_file) != 1 ||
+                 fflush(snapshot_file) != 0 || fsync(fileno(snapshot_file)) < 0;
+    failed |= fclose(snapshot_file) != 0;
+    snapshot_file = NULL;
+    if (failed || rename(tmp_path, path) < 0) {
+        perror("Error al escribir el snapshot de leases");
+        unlink(tmp_path);
+        dhcp_mutex_unlock(&snapshot_mutex);
+        return -1;
+    }
+    sync_dir();
+
+    // Los segmentos anteriores ya están reflejados en el snapshot
+    for (uint64_t old = oldest_gen; old < gen; old++) {
+        journal_path(path, old);
+        unlink(path);
+    }
+    oldest_gen = gen;
+
+    dhcp_mutex_lock(&journal_lock);
+    stats.snapshots++;
+    stats.last_snapshot_seconds = monotonic_seconds() - start;
+    dhcp_mutex_unlock(&journal_lock);
+    dhcp_mutex_unlock(&snapshot_mutex);
+    return 0;
+}
+
+static void* snapshot_loop(void* arg) {
+    (void)arg;
+    uint32_t interval = config.snapshot_s ? config.snapshot_s : LEASE_JOURNAL_SNAPSHOT_S;
+
+    dhcp_mutex_lock(&journal_lock);
+    struct timespec until;
+    clock_gettime(CLOCK_MONOTONIC, &until);
+    until.tv_sec += interval;
+    while (running) {
+        int timed_out = 0;
+        while (running && !snapshot_requested && !spare_wanted && !timed_out) {
+            timed_out = dhcp_cond_timedwait(&snapshot_cond, &journal_lock, &until) == ETIMEDOUT;
+        }
+        if (!running) break;
+
+        // Reservar el segmento siguiente antes de que el actual se llene
+        if (spare_wanted) {
+            spare_wanted = 0;
+            dhcp_mutex_unlock(&journal_lock);
+            prepare_spare();
+            dhcp_mutex_lock(&journal_lock);
+            continue;
+        }
+        snapshot_requested = 0;
+        dhcp_mutex_unlock(&journal_lock);
+        lease_journal_snapshot();
+        dhcp_mutex_lock(&journal_lock);
+        clock_gettime(CLOCK_MONOTONIC, &until);
+        until.tv_sec += interval;
+    }
+    dhcp_mutex_unlock(&journal_lock);
+    return NULL;
+}
+
+// Proyectar el snapshot y aplicar sus leases. Retorna 0 si no hay snapshot, 1 si se
+// cargó y -1 si está dañado.
+static int load_snapshot(uint64_t* gen, uint64_t* seq) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/" SNAPSHOT_NAME, dir_path);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        if (errno == ENOENT) return 0;
+        perror("Error al abrir el snapshot de leases");
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(snapshot_header_t)) {
+        fprintf(stderr, "Error: El snapshot de leases %s está incompleto.\n", path);
+        close(fd);
+        return -1;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror("Error al proyectar el snapshot de leases");
+        return -1;
+    }
+
+    const snapshot_header_t* header = (const snapshot_header_t*)map;
+    const lease_journal_record_t* records = (const lease_journal_record_t*)(header + 1);
+    int valid = header->magic == SNAPSHOT_MAGIC && header->version == SNAPSHOT_VERSION &&
+                (uint64_t)st.st_size == sizeof(*header) + header->count * sizeof(lease_journal_record_t);
+    if (valid && config.apply) {
+        uint64_t hash = 0xcbf29ce484222325ULL;
+        for (uint64_t i = 0; i < header->count; i++) {
+            hash = hash_record(hash, &records[i]);
+        }
+        valid = hash == header->hash;
+    }
+    if (!valid) {
+        fprintf(stderr, "Error: El snapshot de leases %s está dañado.\n", path);
+        munmap(map, st.st_size);
+        return -1;
+    }
+
+    for (uint64_t i = 0; config.apply && i < header->count; i++) {
+        config.apply(&records[i], config.ctx);
+    }
+    stats.restored_snapshot = config.apply ? header->count : 0;
+    *gen = header->journal_gen;
+    *seq = header->seq;
+    munmap(map, st.st_size);
+    return 1;
+}
+
+// Reaplicar un segmento hasta su primer registro inválido (el final de lo escrito o un
+// registro a medias). Retorna el último seq aplicado.
+static uint64_t replay_segment(uint64_t gen, uint64_t last_seq) {
+    char path[PATH_MAX];
+    journal_path(path, gen);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return last_seq;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size == 0) {
+        close(fd);
+        return last_seq;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return last_seq;
+
+    const lease_journal_record_t* records = (const lease_journal_record_t*)map;
+    size_t count = st.st_size / sizeof(lease_journal_record_t);
+    for (size_t i = 0; i < count; i++) {
+        const lease_journal_record_t* record = &records[i];
+        if (record->type < LEASE_JOURNAL_GRANT || record->type > LEASE_JOURNAL_EXPIRE ||
+            record->checksum != record_checksum(record)) {
+            break;
+        }
+        if (record->seq <= last_seq) continue;  // Ya reflejado en el snapshot
+        if (record->seq != last_seq + 1) break;  // Falta un registro: lo posterior no se aplica
+        if (config.apply) {
+            config.apply(record, config.ctx);
+            stats.restored_journal++;
+        }
+        last_seq = record->seq;
+    }
+    munmap(map, st.st_size);
+    return last_seq;
+}
+
+// Buscar las generaciones de segmentos presentes en el directorio
+static int scan_segments(uint64_t* min_gen, uint64_t* max_gen) {
+    DIR* dir = opendir(dir_path);
+    if (!dir) return 0;
+    int found = 0;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, JOURNAL_PREFIX, strlen(JOURNAL_PREFIX)) != 0) continue;
+        char* end;
+        uint64_t gen = strtoull(entry->d_name + strlen(JOURNAL_PREFIX), &end, 10);
+        if (*end != '\0') continue;
+        if (!found || gen < *min_gen) *min_gen = gen;
+        if (!found || gen > *max_gen) *max_gen = gen;
+        found = 1;
+    }
+    closedir(dir);
+    return found;
+}
+
+int lease_journal_open(const lease_journal_config_t* cfg) {
+    config = *cfg;
+    if (strlen(cfg->dir) >= sizeof(dir_path)) {
+        fprintf(stderr, "Error: El directorio de leases %s es demasiado largo.\n", cfg->dir);
+        return -1;
+    }
+    snprintf(dir_path, sizeof(dir_path), "%s", cfg->dir);
+    if (mkdir(dir_path, 0755) < 0 && errno != EEXIST) {
+        perror("Error al crear el directorio de leases");
+        return -1;
+    }
+    memset(&stats, 0, sizeof(stats));
+    double start = monotonic_seconds();
+
+    // Snapshot y luego los segmentos que lo siguen
+    uint64_t first_gen = 0, last_seq = 0;
+    int loaded = load_snapshot(&first_gen, &last_seq);
+    if (loaded < 0) {
+        return -1;
+    }
+    uint64_t min_gen = 0, max_gen = 0;
+    int have_segments = scan_segments(&min_gen, &max_gen);
+    if (!loaded && have_segments) {
+        first_gen = min_gen;
+    }
+    uint64_t next_gen = first_gen;
+    if (have_segments) {
+        for (uint64_t gen = min_gen; gen < first_gen; gen++) {
+            char path[PATH_MAX];
+            journal_path(path, gen);
+            unlink(path);  // Quedaron de un snapshot interrumpido antes de borrarlos
+        }
+        for (uint64_t gen = first_gen; gen <= max_gen; gen++) {
+            last_seq = replay_segment(gen, last_seq);
+        }
+        if (max_gen + 1 > next_gen) next_gen = max_gen + 1;
+    }
+    stats.restore_seconds = monotonic_seconds() - start;
+
+    current = open_segment(next_gen);
+    if (!current) {
+        return -1;
+    }
+    retired = NULL;
+    spare = NULL;
+    spare_busy = spare_wanted = 0;
+    next_seq = last_seq + 1;
+    written_seq = committed_seq = last_seq;
+    oldest_gen = first_gen;
+    // Compactar pronto lo reaplicado para no acumular segmentos entre reinicios
+    snapshot_requested = stats.restored_journal > 0;
+
+    pthread_condattr_t cond_attr;
+    pthread_condattr_init(&cond_attr);
+    pthread_condattr_setclock(&cond_attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&snapshot_cond, &cond_attr);
+    pthread_cond_init(&work_cond, &cond_attr);
+    pthread_condattr_destroy(&cond_attr);
+
+    running = 1;
+    if (pthread_create(&commit_thread, NULL, commit_loop, NULL) != 0) {
+        perror("Error al crear el hilo de commit del journal de leases");
+        running = 0;
+        close_segment(current);
+        current = NULL;
+        return -1;
+    }
+    if (pthread_create(&snapshot_thread, NULL, snapshot_loop, NULL) != 0) {
+        perror("Error al crear el hilo de snapshots del journal de leases");
+        dhcp_mutex_lock(&journal_lock);
+        running = 0;
+        pthread_cond_signal(&work_cond);
+        dhcp_mutex_unlock(&journal_lock);
+        pthread_join(commit_thread, NULL);
+        close_segment(current);
+        current = NULL;
+        return -1;
+    }
+    lease_journal_enabled = 1;
+    return 0;
+}
+
+void lease_journal_close() {
+    if (!lease_journal_enabled) return;
+
+    dhcp_mutex_lock(&journal_lock);
+    running = 0;
+    pthread_cond_signal(&work_cond);
+    pthread_cond_signal(&snapshot_cond);
+    pthread_cond_broadcast(&commit_cond);
+    dhcp_mutex_unlock(&journal_lock);
+    pthread_join(snapshot_thread, NULL);
+    pthread_join(commit_thread, NULL);
+
+    // Snapshot final: al reiniciar no hay segmentos que reaplicar
+    lease_journal_snapshot();
+
+    // El hilo de commit ya no corre: cerrar aquí lo que quede
+    while (retired) {
+        journal_segment_t* next = retired->next;
+        sync_records(retired, retired->synced, retired->used);
+        close_segment(retired);
+        retired = next;
+    }
+    sync_records(current, current->synced, current->used);
+    close_segment(current);
+    current = NULL;
+
+    // El segmento reservado quedó sin usar
+    if (spare) {
+        char path[PATH_MAX];
+        journal_path(path, spare->gen);
+        close_segment(spare);
+        unlink(path);
+        spare = NULL;
+    }
+    lease_journal_enabled = 0;
+}
+
+void lease_journal_get_stats(lease_journal_stats_t* out) {
+    dhcp_mutex_lock(&journal_lock);
+    *out = stats;
+    dhcp_mutex_unlock(&journal_lock);
+}
+
+void lease_journal_print_stats(FILE* out) {
+    lease_journal_stats_t snapshot;
+    lease_journal_get_stats(&snapshot);
+    fprintf(out, "Journal de leases: %llu registros, %llu commits (%.1f registros/commit), %llu esperas, %llu snapshots\n",
+            (unsigned long long)snapshot.appended, (unsigned long long)snapshot.commits,
+            snapshot.commits ? (double)snapshot.appended / snapshot.commits : 0.0,
+            (unsigned long long)snapshot.waits, (unsigned long long)snapshot.snapshots);
+}
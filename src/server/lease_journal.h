@@ -0,0 +1,124 @@
+#ifndef LEASE_JOURNAL_H
+#define LEASE_JOURNAL_H
+
+// Persistencia de las asignaciones: journal binario de solo agregado más snapshots.
+//
+// Cada cambio de un lease se agrega como un registro de 32 bytes a un segmento del
+// journal proyectado en memoria (archivos journal.<generación> preasignados; el hilo de
+// snapshots reserva el siguiente cuando el actual va por la mitad). Un hilo
+// de commit los lleva a disco agrupando todos los pendientes en un solo msync (group
+// commit); con `wait_for_commit` cada hilo espera, antes de enviar su lote de respuestas,
+// solo hasta que sus propios registros estén en disco. Un hilo de snapshots escribe
+// periódicamente el estado completo (leases.snap) y borra los segmentos que ya cubre.
+// Al arrancar se proyecta el snapshot y se reaplican los segmentos posteriores.
+//
+// Los registros describen el estado completo del lease, así que aplicarlos dos veces
+// da el mismo resultado: el snapshot se toma sin detener a nadie y lo que cambie
+// mientras se copia queda en el segmento nuevo, que se reaplica encima.
+
+#include <stdint.h> // Para uint8_t, uint32_t, uint64_t
+#include <stdio.h>  // Para FILE
+
+// Tipos de registro
+#define LEASE_JOURNAL_GRANT   1   // IP asignada a una MAC (OFFER o REQUEST aceptado)
+#define LEASE_JOURNAL_RENEW   2   // Concesión reiniciada por un REQUEST del mismo cliente
+#define LEASE_JOURNAL_RELEASE 3   // IP liberada por el cliente
+#define LEASE_JOURNAL_DECLINE 4   // IP rechazada por el cliente
+#define LEASE_JOURNAL_EXPIRE  5   // Concesión vencida
+
+#define LEASE_JOURNAL_SEGMENT_RECORDS (1u << 20)  // Registros por segmento (32 MB)
+#define LEASE_JOURNAL_SNAPSHOT_S 300              // Segundos entre snapshots por defecto
+#define LEASE_JOURNAL_COMMIT_US 1000              // Espera máxima del group commit por defecto
+
+// Registro del journal (y entrada del snapshot, siempre de tipo GRANT)
+typedef struct {
+    uint64_t seq;          // Número de secuencia, crece en todo el historial
+    uint32_t ip;           // IP (orden de host)
+    uint8_t mac[6];        // MAC del cliente
+    uint8_t type;          // LEASE_JOURNAL_*
+    uint8_t reserved;
+    uint32_t lease_start;  // Inicio de la concesión (segundos Unix)
+    uint32_t lease_time;   // Duración de la concesión (segundos)
+    uint32_t checksum;     // Detecta registros escritos a medias al reaplicar
+} lease_journal_record_t;
+
+// Aplica un registro al estado del servidor (al arrancar)
+typedef void (*lease_apply_fn)(const lease_journal_record_t* record, void* ctx);
+
+// Recorre el estado del servidor llamando a lease_snapshot_add por cada lease activo
+typedef void (*lease_collect_fn)(void* ctx);
+
+// Avisa que terminó un commit (con el lock del journal tomado: no debe agregar registros)
+typedef void (*lease_commit_fn)();
+
+typedef struct {
+    const char* dir;           // Directorio de los archivos (DHCP_LEASE_DIR)
+    uint32_t commit_us;        // Espera del hilo de commit para juntar más registros
+    int wait_for_commit;       // Las respuestas esperan a que sus registros estén en disco
+    uint32_t snapshot_s;       // Segundos entre snapshots (0 = LEASE_JOURNAL_SNAPSHOT_S)
+    lease_apply_fn apply;      // NULL: el estado ya está en memoria, solo se continúa la secuencia
+    lease_collect_fn collect;
+    void* ctx;                 // Se pasa a apply y collect
+} lease_journal_config_t;
+
+// Estadísticas de la persistencia
+typedef struct {
+    uint64_t restored_snapshot;   // Leases leídos del snapshot al arrancar
+    uint64_t restored_journal;    // Registros reaplicados de los segmentos
+    double restore_seconds;       // Duración de la restauración
+    uint64_t appended;            // Registros agregados desde el arranque
+    uint64_t commits;             // msync del hilo de commit
+    uint64_t waits;               // Veces que un hilo esperó un commit
+    uint64_t snapshots;           // Snapshots escritos
+    double last_snapshot_seconds; // Duración del último snapshot
+} lease_journal_stats_t;
+
+extern int lease_journal_enabled;  // Hay journal abierto
+
+// Función para restaurar el estado y abrir el journal. Retorna -1 si el directorio no se
+// puede usar o el snapshot está dañado (el servidor no debe arrancar sin sus leases).
+int lease_journal_open(const lease_journal_config_t* config);
+
+// Función para llevar a disco lo pendiente, escribir un snapshot final y cerrar el journal.
+// Se llama con los hilos que atienden paquetes ya detenidos.
+void lease_journal_close();
+
+// Función para agregar un cambio de lease (con el lock del shard tomado). Retorna -1 si no se
+// pudo registrar (no hay segmento siguiente en disco): el cambio no debe confirmarse al cliente.
+int lease_journal_append(int type, uint32_t ip, const uint8_t* mac, uint32_t lease_start, uint32_t lease_time);
+
+// Función para esperar a que los registros agregados por este hilo estén en disco
+// (no hace nada sin journal o con wait_for_commit en 0)
+void lease_journal_wait();
+
+// Función para que el hilo de commit no espere más registros y empiece el msync: el que llama
+// retuvo lotes de respuestas y sigue trabajando mientras tanto
+void lease_journal_commit_now();
+
+// Función para registrar a quién avisar después de cada commit (NULL deja de avisar). Al
+// volver, el aviso anterior ya no se está ejecutando.
+void lease_journal_set_commit_hook(lease_commit_fn hook);
+
+// Función para obtener el último registro agregado por este hilo
+uint64_t lease_journal_thread_seq();
+
+// Función para saber si el registro `seq` ya está en disco (1 también sin journal o sin
+// wait_for_commit: nada obliga a esperarlo)
+int lease_journal_committed(uint64_t seq);
+
+// Función para esperar a que el registro `seq` esté en disco (como lease_journal_wait)
+void lease_journal_wait_for(uint64_t seq);
+
+// Función para escribir un snapshot ahora, desde el hilo que llama. Retorna -1 si falla.
+int lease_journal_snapshot();
+
+// Función para agregar un lease al snapshot en curso (solo desde lease_collect_fn)
+void lease_snapshot_add(uint32_t ip, const uint8_t* mac, uint32_t lease_start, uint32_t lease_time);
+
+// Función para leer las estadísticas
+void lease_journal_get_stats(lease_journal_stats_t* stats);
+
+// Función para imprimir las estadísticas
+void lease_journal_print_stats(FILE* out);
+
+#endif // LEASE_JOURNAL_H
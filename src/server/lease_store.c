@@ -0,0 +1,134 @@
+#include "lease_store.h"
+#include <string.h>   // Para memcpy, memset
+#include <sys/mman.h> // Para mmap, munmap, memfd_create
+#include <sys/stat.h> // Para fstat
+#include <unistd.h>   // Para ftruncate, close
+
+int lease_store_shareable = 0;
+
+int lease_store_init(lease_store_t* store, uint32_t start_ip, uint32_t size) {
+    memset(store, 0, sizeof(*store));
+    store->fd = -1;
+    if (size == 0) {
+        return -1;
+    }
+
+    // Reservar sin respaldo: las páginas se materializan al escribirlas (llenas de ceros = LEASE_FREE).
+    // Sin memfd (no pedido o kernel antiguo) se usa memoria anónima y el arreglo no se puede entregar.
+    size_t bytes = (size_t)size * sizeof(ip_assignment_t);
+    int fd = lease_store_shareable ? memfd_create("dhcp_leases", MFD_CLOEXEC) : -1;
+    if (fd >= 0 && ftruncate(fd, (off_t)bytes) < 0) {
+        close(fd);
+        fd = -1;
+    }
+    void* leases = fd >= 0 ? mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                           : mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (leases == MAP_FAILED) {
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+
+    store->start_ip = start_ip;
+    store->size = size;
+    store->fd = fd;
+    store->mapped_bytes = bytes;
+    store->leases = (ip_assignment_t*)leases;
+    return 0;
+}
+
+int lease_store_attach(lease_store_t* store, int fd, uint32_t start_ip, uint32_t size) {
+    memset(store, 0, sizeof(*store));
+    store->fd = -1;
+    size_t bytes = (size_t)size * sizeof(ip_assignment_t);
+    struct stat st;
+    if (size == 0 || fstat(fd, &st) < 0 || (size_t)st.st_size != bytes) {
+        return -1;
+    }
+    void* leases = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (leases == MAP_FAILED) {
+        return -1;
+    }
+
+    store->start_ip = start_ip;
+    store->size = size;
+    store->fd = fd;
+    store->mapped_bytes = bytes;
+    store->leases = (ip_assignment_t*)leases;
+
+    // El contador no viaja con el arreglo: se recalcula
+    uint32_t end;
+    for (uint32_t index = lease_store_next_written(store, 0, &end); index < size;
+         index = lease_store_next_written(store, end, &end)) {
+        for (; index < end; index++) {
+            store->count += store->leases[index].state != LEASE_FREE;
+        }
+    }
+    return 0;
+}
+
+void lease_store_free(lease_store_t* store) {
+    if (store->leases) {
+        munmap(store->leases, store->mapped_bytes);
+    }
+    if (store->fd >= 0) {
+        close(store->fd);
+    }
+    memset(store, 0, sizeof(*store));
+    store->fd = -1;
+}
+
+ip_assignment_t* lease_store_find(lease_store_t* store, uint32_t ip) {
+    uint32_t index = ip - store->start_ip;  // Con aritmética sin signo, IPs menores quedan fuera
+    if (index >= store->size || store->leases[index].state == LEASE_FREE) {
+        return NULL;
+    }
+    return &store->leases[index];
+}
+
+ip_assignment_t* lease_store_insert(lease_store_t* store, uint32_t ip, const uint8_t* mac, uint32_t lease_time, uint32_t now) {
+    uint32_t index = ip - store->start_ip;
+    if (index >= store->size || store->leases[index].state != LEASE_FREE) {
+        return NULL;
+    }
+
+    ip_assignment_t* assignment = &store->leases[index];
+    memcpy(assignment->mac, mac, 6);
+    assignment->state = LEASE_ACTIVE;
+    assignment->flags = 0;
+    assignment->lease_start = now;
+    assignment->lease_time = lease_time;
+    store->count++;
+    return assignment;
+}
+
+int lease_store_delete(lease_store_t* store, uint32_t ip) {
+    uint32_t index = ip - store->start_ip;
+    if (index >= store->size || store->leases[index].state == LEASE_FREE) {
+        return 0;
+    }
+
+    memset(&store->leases[index], 0, sizeof(ip_assignment_t));
+    store->count--;
+    return 1;
+}
+
+uint32_t lease_store_next_written(const lease_store_t* store, uint32_t from, uint32_t* end) {
+    *end = store->size;
+    if (from >= store->size || store->fd < 0) {
+        return from < store->size ? from : store->size;
+    }
+    off_t data = lseek(store->fd, (off_t)from * sizeof(ip_assignment_t), SEEK_DATA);
+    if (data < 0) {
+        return store->size;  // Sin más datos (ENXIO)
+    }
+    off_t hole = lseek(store->fd, data, SEEK_HOLE);
+    uint32_t first = (uint32_t)(data / sizeof(ip_assignment_t));
+    if (hole >= 0 && (uint64_t)hole < (uint64_t)store->size * sizeof(ip_assignment_t)) {
+        *end = (uint32_t)((hole + sizeof(ip_assignment_t) - 1) / sizeof(ip_assignment_t));
+    }
+    return first > from ? first : from;
+}
+
+uint32_t lease_store_ip(const lease_store_t* store, const ip_assignment_t* assignment) {
+    return store->start_ip + (uint32_t)(assignment - store->leases);
+}
@@ -0,0 +1,68 @@
+#ifndef LEASE_STORE_H
+#define LEASE_STORE_H
+
+#include <stdint.h> // Para uint8_t, uint32_t
+#include <stddef.h> // Para size_t
+
+// Estados de un registro de asignación
+typedef enum {
+    LEASE_FREE = 0,   // La IP no está asignada
+    LEASE_ACTIVE,     // La IP está asignada a una MAC
+    LEASE_OFFERED,    // Oferta pendiente que pasa a otro proceso en un relevo (lease_time = ms que le quedan)
+    LEASE_QUARANTINED // IP en cuarentena por un DECLINE que pasa a otro proceso en un relevo (ídem)
+} lease_state_t;
+
+// Registro compacto de asignación de una IP (16 bytes, sin punteros).
+// La IP no se guarda: es start_ip + posición del registro en el arreglo.
+typedef struct {
+    uint8_t mac[6];        // Dirección MAC del cliente
+    uint8_t state;         // lease_state_t
+    uint8_t flags;         // Reservado para marcas del servidor
+    uint32_t lease_start;  // Momento en que comenzó la concesión (segundos Unix)
+    uint32_t lease_time;   // Tiempo de concesión para esta IP (en segundos)
+} ip_assignment_t;
+
+// Almacén de asignaciones indexado directamente por (ip - start_ip).
+// El arreglo se reserva con mmap: el kernel solo respalda con memoria las páginas
+// que se llegan a escribir, así que un pool grande y poco usado no ocupa RAM.
+// Con lease_store_shareable el arreglo vive en un memfd y otro proceso puede proyectar
+// el mismo arreglo recibiendo el descriptor.
+typedef struct {
+    uint32_t start_ip;        // Primera IP del pool
+    uint32_t size;            // Número de registros (IPs del pool)
+    uint32_t count;           // Registros activos
+    int fd;                   // memfd del arreglo (-1 si es memoria anónima)
+    size_t mapped_bytes;      // Bytes reservados para el arreglo
+    ip_assignment_t* leases;  // Arreglo denso de registros
+} lease_store_t;
+
+extern int lease_store_shareable;  // Reservar los arreglos nuevos en un memfd (para un relevo)
+
+// Función para inicializar el almacén de un pool de `size` IPs a partir de `start_ip`
+int lease_store_init(lease_store_t* store, uint32_t start_ip, uint32_t size);
+
+// Función para proyectar el arreglo que otro proceso dejó en el memfd `fd` (el almacén
+// se queda con el descriptor). Retorna -1 si el tamaño no corresponde a `size` IPs.
+int lease_store_attach(lease_store_t* store, int fd, uint32_t start_ip, uint32_t size);
+
+// Función para liberar la memoria del almacén
+void lease_store_free(lease_store_t* store);
+
+// Función para buscar la asignación activa de una IP (NULL si está libre o fuera del pool)
+ip_assignment_t* lease_store_find(lease_store_t* store, uint32_t ip);
+
+// Función para registrar una asignación (NULL si la IP está fuera del pool o ya asignada)
+ip_assignment_t* lease_store_insert(lease_store_t* store, uint32_t ip, const uint8_t* mac, uint32_t lease_time, uint32_t now);
+
+// Función para eliminar una asignación (retorna 1 si existía)
+int lease_store_delete(lease_store_t* store, uint32_t ip);
+
+// Función para recorrer solo las partes escritas del arreglo: retorna el primer índice
+// desde `from` que puede tener registros y deja en `end` el fin de ese tramo (`size` si no
+// quedan). En un memfd los huecos se saltan sin leerlos, porque leerlos los materializa.
+uint32_t lease_store_next_written(const lease_store_t* store, uint32_t from, uint32_t* end);
+
+// Función para obtener la IP que corresponde a un registro del almacén
+uint32_t lease_store_ip(const lease_store_t* store, const ip_assignment_t* assignment);
+
+#endif // LEASE_STORE_H
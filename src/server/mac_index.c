@@ -0,0 +1,229 @@
+#include "mac_index.h"
+#include "dhcp_txn_table.h" // Para hash_mac
+#include <stdlib.h> // Para calloc, free
+#include <string.h> // Para memcmp, memcpy, memset
+
+int mac_index_init(mac_index_t* index, uint32_t ghost_capacity) {
+    memset(index, 0, sizeof(*index));
+    index->slots = (mac_index_entry_t*)calloc(MAC_INDEX_MIN_CAPACITY, sizeof(mac_index_entry_t));
+    if (!index->slots) {
+        return -1;
+    }
+    // calloc de un arreglo grande viene de mmap: las páginas de fantasmas que nunca se usan no ocupan RAM
+    if (ghost_capacity > 0) {
+        index->ghosts = (mac_ghost_t*)calloc(ghost_capacity, sizeof(mac_ghost_t));
+        if (!index->ghosts) {
+            free(index->slots);
+            index->slots = NULL;
+            return -1;
+        }
+    }
+    index->capacity = MAC_INDEX_MIN_CAPACITY;
+    index->ghost_capacity = ghost_capacity;
+    index->ghost_free = MAC_INDEX_NONE;
+    index->newest = MAC_INDEX_NONE;
+    index->oldest = MAC_INDEX_NONE;
+    return 0;
+}
+
+void mac_index_free(mac_index_t* index) {
+    free(index->slots);
+    free(index->ghosts);
+    memset(index, 0, sizeof(*index));
+}
+
+// Posición de la entrada de una MAC (MAC_INDEX_NONE si no tiene)
+static uint32_t find_slot(const mac_index_t* index, const uint8_t* mac, uint32_t hash) {
+    uint32_t mask = index->capacity - 1;
+    uint32_t pos = hash & mask;
+    while (index->slots[pos].used) {
+        const mac_index_entry_t* entry = &index->slots[pos];
+        if (entry->hash == hash && memcmp(entry->mac, mac, 6) == 0) {
+            return pos;
+        }
+        pos = (pos + 1) & mask;
+    }
+    return MAC_INDEX_NONE;
+}
+
+// Reubicar todas las entradas en un arreglo de `capacity` ranuras (los fantasmas no se mueven)
+static int resize(mac_index_t* index, uint32_t capacity) {
+    mac_index_entry_t* slots = (mac_index_entry_t*)calloc(capacity, sizeof(mac_index_entry_t));
+    if (!slots) {
+        return -1;
+    }
+    uint32_t mask = capacity - 1;
+    for (uint32_t i = 0; i < index->capacity; i++) {
+        if (!index->slots[i].used) continue;
+        uint32_t pos = index->slots[i].hash & mask;
+        while (slots[pos].used) {
+            pos = (pos + 1) & mask;
+        }
+        slots[pos] = index->slots[i];
+    }
+    free(index->slots);
+    index->slots = slots;
+    index->capacity = capacity;
+    return 0;
+}
+
+// Ocupar una ranura nueva para la MAC (que no debe estar en la tabla)
+static mac_index_entry_t* insert_slot(mac_index_t* index, const uint8_t* mac, uint32_t hash) {
+    // Mantener el factor de carga por debajo de 3/4
+    if ((uint64_t)(index->count + 1) * 4 > (uint64_t)index->capacity * 3) {
+        if (resize(index, index->capacity * 2) < 0) {
+            return NULL;
+        }
+    }
+    uint32_t mask = index->capacity - 1;
+    uint32_t pos = hash & mask;
+    while (index->slots[pos].used) {
+        pos = (pos + 1) & mask;
+    }
+    mac_index_entry_t* entry = &index->slots[pos];
+    memcpy(entry->mac, mac, 6);
+    entry->used = 1;
+    entry->hash = hash;
+    index->count++;
+    return entry;
+}
+
+// Eliminar la ranura `pos` desplazando hacia atrás las entradas siguientes (sin lápidas)
+static void delete_slot(mac_index_t* index, uint32_t pos) {
+    uint32_t mask = index->capacity - 1;
+    uint32_t hole = pos;
+    uint32_t next = pos;
+    while (1) {
+        next = (next + 1) & mask;
+        mac_index_entry_t* entry = &index->slots[next];
+        if (!entry->used) break;
+
+        // Solo se mueve si su posición ideal no cae entre el hueco y su posición actual
+        uint32_t home = entry->hash & mask;
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            index->slots[hole] = *entry;
+            hole = next;
+        }
+    }
+    memset(&index->slots[hole], 0, sizeof(mac_index_entry_t));
+    index->count--;
+}
+
+// Sacar un fantasma de la lista LRU y devolver su ranura
+static void unlink_ghost(mac_index_t* index, uint32_t slot) {
+    mac_ghost_t* ghost = &index->ghosts[slot];
+    if (ghost->newer != MAC_INDEX_NONE) index->ghosts[ghost->newer].older = ghost->older;
+    else index->newest = ghost->older;
+    if (ghost->older != MAC_INDEX_NONE) index->ghosts[ghost->older].newer = ghost->newer;
+    else index->oldest = ghost->newer;
+    ghost->older = index->ghost_free;
+    index->ghost_free = slot;
+    index->ghost_count--;
+}
+
+// Poner un fantasma en la cabeza de la lista LRU
+static void link_ghost(mac_index_t* index, uint32_t slot) {
+    mac_ghost_t* ghost = &index->ghosts[slot];
+    ghost->newer = MAC_INDEX_NONE;
+    ghost->older = index->newest;
+    if (index->newest != MAC_INDEX_NONE) index->ghosts[index->newest].newer = slot;
+    else index->oldest = slot;
+    index->newest = slot;
+    index->ghost_count++;
+}
+
+// Tomar una ranura de fantasma para la MAC, olvidando el más antiguo si no queda lugar.
+// Puede mover entradas de la tabla: las posiciones obtenidas antes dejan de valer.
+static uint32_t take_ghost(mac_index_t* index, const uint8_t* mac, uint32_t record) {
+    uint32_t slot;
+    if (index->ghost_free != MAC_INDEX_NONE) {
+        slot = index->ghost_free;
+        index->ghost_free = index->ghosts[slot].older;
+    } else if (index->ghost_used < index->ghost_capacity) {
+        slot = index->ghost_used++;
+    } else {
+        slot = index->oldest;
+        mac_ghost_t* evicted = &index->ghosts[slot];
+        delete_slot(index, find_slot(index, evicted->mac, hash_mac(evicted->mac)));
+        unlink_ghost(index, slot);
+        index->ghost_free = index->ghosts[slot].older;
+        index->evicted++;
+    }
+    mac_ghost_t* ghost = &index->ghosts[slot];
+    memcpy(ghost->mac, mac, 6);
+    ghost->index = record;
+    link_ghost(index, slot);
+    return slot;
+}
+
+uint32_t mac_index_find(const mac_index_t* index, const uint8_t* mac, int* ghost) {
+    uint32_t pos = find_slot(index, mac, hash_mac(mac));
+    if (pos == MAC_INDEX_NONE) {
+        return MAC_INDEX_NONE;
+    }
+    const mac_index_entry_t* entry = &index->slots[pos];
+    *ghost = entry->ghost;
+    return entry->ghost ? index->ghosts[entry->index].index : entry->index;
+}
+
+int mac_index_set(mac_index_t* index, const uint8_t* mac, uint32_t record) {
+    uint32_t hash = hash_mac(mac);
+    uint32_t pos = find_slot(index, mac, hash);
+    mac_index_entry_t* entry;
+    if (pos != MAC_INDEX_NONE) {
+        entry = &index->slots[pos];
+        if (entry->ghost) {
+            unlink_ghost(index, entry->index);  // La MAC volvió a tener un lease activo
+        }
+    } else if ((entry = insert_slot(index, mac, hash)) == NULL) {
+        return -1;
+    }
+    entry->ghost = 0;
+    entry->index = record;
+    return 0;
+}
+
+void mac_index_remove(mac_index_t* index, const uint8_t* mac, uint32_t record) {
+    uint32_t pos = find_slot(index, mac, hash_mac(mac));
+    if (pos != MAC_INDEX_NONE && !index->slots[pos].ghost && index->slots[pos].index == record) {
+        delete_slot(index, pos);
+    }
+}
+
+void mac_index_retire(mac_index_t* index, const uint8_t* mac, uint32_t record) {
+    uint32_t hash = hash_mac(mac);
+    uint32_t pos = find_slot(index, mac, hash);
+    mac_index_entry_t* entry = pos != MAC_INDEX_NONE ? &index->slots[pos] : NULL;
+    if (entry && !entry->ghost && entry->index != record) {
+        return;  // La MAC sigue con otro lease activo
+    }
+    if (index->ghost_capacity == 0) {
+        if (entry && !entry->ghost) delete_slot(index, pos);
+        return;
+    }
+    if (entry && entry->ghost) {
+        // Ya tenía un fantasma: recordar el lease más reciente y pasarlo a la cabeza
+        unlink_ghost(index, entry->index);
+        entry->index = take_ghost(index, mac, record);
+        return;
+    }
+
+    // Con la ranura del fantasma tomada (puede haber olvidado otro), ubicar la entrada otra vez
+    uint32_t slot = take_ghost(index, mac, record);
+    pos = find_slot(index, mac, hash);
+    entry = pos != MAC_INDEX_NONE ? &index->slots[pos] : insert_slot(index, mac, hash);
+    if (entry == NULL) {
+        unlink_ghost(index, slot);
+        return;
+    }
+    entry->ghost = 1;
+    entry->index = slot;
+}
+
+void mac_index_forget(mac_index_t* index, const uint8_t* mac) {
+    uint32_t pos = find_slot(index, mac, hash_mac(mac));
+    if (pos != MAC_INDEX_NONE && index->slots[pos].ghost) {
+        unlink_ghost(index, index->slots[pos].index);
+        delete_slot(index, pos);
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef MAC_INDEX_H
+#define MAC_INDEX_H
+
+#include <stdint.h> // Para uint8_t, uint32_t, uint64_t
+
+#define MAC_INDEX_MIN_CAPACITY 64   // Capacidad mínima de la tabla (potencia de 2)
+#define MAC_INDEX_NONE UINT32_MAX   // La MAC no tiene lease activo ni vencido
+
+// Entrada de la tabla (16 bytes): la MAC va en la entrada, así una búsqueda toca una sola línea
+typedef struct {
+    uint8_t mac[6];     // Dirección MAC del cliente (clave)
+    uint8_t used;       // 0 = ranura libre
+    uint8_t ghost;      // 1 si `index` es la ranura de un fantasma y no un registro del almacén
+    uint32_t hash;      // hash_mac de la clave, cacheado para sondeo y redimensionado
+    uint32_t index;     // Registro del almacén (ip - start_ip) o ranura en `ghosts`
+} mac_index_entry_t;
+
+// Lease vencido o liberado que se recuerda para devolverle la IP a su MAC si vuelve
+typedef struct {
+    uint32_t index;     // Registro del almacén que tuvo la MAC
+    uint32_t newer;     // Fantasma más reciente (MAC_INDEX_NONE si es la cabeza)
+    uint32_t older;     // Fantasma más antiguo (MAC_INDEX_NONE si es la cola)
+    uint8_t mac[6];
+} mac_ghost_t;
+
+// Índice secundario MAC -> lease de un rango, sobre el almacén indexado por IP. Es una tabla
+// de direccionamiento abierto con sondeo lineal que tiene una entrada por MAC: la de su último
+// lease activo o, si ya no tiene ninguno, la de su último lease terminado ("fantasma"). Los
+// fantasmas forman una lista LRU acotada: al llenarse se olvida el más antiguo. Un fantasma
+// puede quedar viejo (otra MAC tomó la IP); quien lo usa lo verifica contra el almacén.
+typedef struct {
+    mac_index_entry_t* slots;   // Arreglo de ranuras
+    uint32_t capacity;          // Número de ranuras (potencia de 2)
+    uint32_t count;             // Entradas ocupadas (activas y fantasmas)
+    mac_ghost_t* ghosts;        // Fantasmas (se tocan solo las ranuras que se llegan a usar)
+    uint32_t ghost_capacity;    // Fantasmas como máximo (0 = no se recuerdan)
+    uint32_t ghost_count;       // Fantasmas en la lista
+    uint32_t ghost_used;        // Ranuras de `ghosts` usadas alguna vez
+    uint32_t ghost_free;        // Lista de ranuras liberadas (enlazadas por `older`)
+    uint32_t newest;            // Cabeza de la lista LRU
+    uint32_t oldest;            // Cola de la lista LRU (la próxima en olvidarse)
+    uint64_t evicted;           // Fantasmas olvidados por falta de lugar
+} mac_index_t;
+
+// Función para inicializar un índice que recuerda hasta `ghost_capacity` leases terminados
+int mac_index_init(mac_index_t* index, uint32_t ghost_capacity);
+
+// Función para liberar la memoria de un índice
+void mac_index_free(mac_index_t* index);
+
+// Función para buscar el lease de una MAC. Retorna el registro del almacén (MAC_INDEX_NONE si
+// no tiene) y deja en `ghost` si es un lease terminado.
+uint32_t mac_index_find(const mac_index_t* index, const uint8_t* mac, int* ghost);
+
+// Función para registrar el lease activo `record` de una MAC (reemplaza lo que tuviera).
+// Retorna -1 si no se pudo agrandar la tabla.
+int mac_index_set(mac_index_t* index, const uint8_t* mac, uint32_t record);
+
+// Función para quitar el lease activo `record` de una MAC (sin recordarlo)
+void mac_index_remove(mac_index_t* index, const uint8_t* mac, uint32_t record);
+
+// Función para pasar el lease `record` de una MAC a la lista de fantasmas al terminar. Si la MAC
+// tiene otro lease activo no hace nada; si ya tenía un fantasma, lo reemplaza.
+void mac_index_retire(mac_index_t* index, const uint8_t* mac, uint32_t record);
+
+// Función para olvidar el fantasma de una MAC (su IP ya es de otro cliente)
+void mac_index_forget(mac_index_t* index, const uint8_t* mac);
+
+#endif // MAC_INDEX_H
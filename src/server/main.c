@@ -1,9 +1,8 @@
 #include "dhcp_server.h"
 
 int main() {
-    // Configurar el manejo de señales
-    signal(SIGINT, handle_signal);
-    signal(SIGTERM, handle_signal);
+    // Bloquear SIGINT/SIGTERM/SIGUSR2 antes de crear hilos: el bucle de eventos los lee por signalfd
+    block_server_signals();
     
     // Leer rango de IPs desde variables de entorno
     const char *start_ip = getenv("START_IP");
@@ -13,9 +12,35 @@ int main() {
         return 1;
     }
 
+    // Con relevo los leases van en memfd, para poder entregarlos a un proceso nuevo
+    lease_store_shareable = getenv("DHCP_HANDOFF_SOCKET") != NULL;
+
+    // Leases terminados que recuerda cada shard (DHCP_LEASE_GHOSTS) y si un DISCOVER de una MAC
+    // conocida recibe su IP de antes (DHCP_STICKY_LEASES=off lo desactiva)
+    const char *ghosts_env = getenv("DHCP_LEASE_GHOSTS");
+    const char *sticky_env = getenv("DHCP_STICKY_LEASES");
+    if (ghosts_env) {
+        lease_ghost_limit = (uint32_t)strtoul(ghosts_env, NULL, 10);
+    }
+    sticky_leases = !(sticky_env && strcmp(sticky_env, "off") == 0);
+
+    // Vida de una oferta sin REQUEST (DHCP_OFFER_TTL_MS); 0 registra el lease ya en el OFFER
+    const char *offer_ttl_env = getenv("DHCP_OFFER_TTL_MS");
+    if (offer_ttl_env) {
+        offer_ttl_ms = (uint32_t)strtoul(offer_ttl_env, NULL, 10);
+    }
+
+    // Segundos que una IP rechazada con DECLINE queda fuera del pool (DHCP_DECLINE_QUARANTINE_S); 0 la devuelve enseguida
+    const char *quarantine_env = getenv("DHCP_DECLINE_QUARANTINE_S");
+    if (quarantine_env) {
+        decline_quarantine_s = (uint32_t)strtoul(quarantine_env, NULL, 10);
+    }
+
     // Configurar el rango de IPs
     ip_range_t range;
     initialize_ip_pool(&range, start_ip, end_ip, 1);
+    range.policy = parse_alloc_policy(getenv("IP_ALLOC_POLICY"));
+    range.hash_key = parse_hash_key(getenv("IP_ALLOC_HASH_KEY"));
 
     // Inicializar el servidor DHCP
     init_dhcp_server(&range);
@@ -0,0 +1,140 @@
+#include "offer_table.h"
+#include <stdlib.h> // Para calloc, free
+#include <string.h> // Para memcmp, memcpy, memset
+
+#define OFFER_POSITION_MASK 0x7fffffffu  // El índice por MAC guarda 31 bits (MAC_INDEX_NONE queda libre)
+
+int offer_table_init(offer_table_t* table, uint32_t size) {
+    memset(table, 0, sizeof(*table));
+    table->ring = (pending_offer_t*)calloc(OFFER_TABLE_MIN_CAPACITY, sizeof(pending_offer_t));
+    // calloc de un arreglo grande viene de mmap: solo ocupan RAM las palabras que se llegan a tocar
+    table->offered = (uint64_t*)calloc(((uint64_t)size + 63) / 64, sizeof(uint64_t));
+    if (!table->ring || !table->offered || mac_index_init(&table->by_mac, 0) < 0) {
+        free(table->ring);
+        free(table->offered);
+        table->ring = NULL;
+        table->offered = NULL;
+        return -1;
+    }
+    table->capacity = OFFER_TABLE_MIN_CAPACITY;
+    table->size = size;
+    return 0;
+}
+
+void offer_table_free(offer_table_t* table) {
+    free(table->ring);
+    free(table->offered);
+    mac_index_free(&table->by_mac);
+    memset(table, 0, sizeof(*table));
+}
+
+static inline pending_offer_t* offer_at(const offer_table_t* table, uint32_t position) {
+    return &table->ring[position & (table->capacity - 1)];
+}
+
+// Marcar muerta una oferta vigente y soltar su dirección y su entrada del índice. Si era la
+// cabeza, las muertas que la siguen salen con ella: la cabeza siempre es una oferta vigente
+// (o el anillo está vacío), así el próximo vencimiento se lee sin recorrer nada.
+static void kill_offer(offer_table_t* table, pending_offer_t* offer, uint32_t position) {
+    mac_index_remove(&table->by_mac, offer->mac, position & OFFER_POSITION_MASK);
+    table->offered[offer->index >> 6] &= ~(1ULL << (offer->index & 63));
+    offer->live = 0;
+    table->live--;
+    if (table->live == 0) {
+        table->head = table->tail;  // Todas muertas: el anillo queda vacío de una vez
+    }
+    while (table->head != table->tail && !offer_at(table, table->head)->live) {
+        table->head++;
+    }
+}
+
+// Hacer lugar para una oferta más: si el anillo está lleno se duplica
+static int make_room(offer_table_t* table) {
+    if (table->tail - table->head < table->capacity) {
+        return 0;
+    }
+    if (table->capacity > OFFER_POSITION_MASK / 2) {
+        return -1;
+    }
+
+    // Cada posición va a (posición & nueva máscara): el índice por MAC sigue valiendo
+    uint32_t capacity = table->capacity * 2;
+    pending_offer_t* ring = (pending_offer_t*)calloc(capacity, sizeof(pending_offer_t));
+    if (!ring) {
+        return -1;
+    }
+    for (uint32_t position = table->head; position != table->tail; position++) {
+        ring[position & (capacity - 1)] = *offer_at(table, position);
+    }
+    free(table->ring);
+    table->ring = ring;
+    table->capacity = capacity;
+    return 0;
+}
+
+uint32_t offer_table_find(const offer_table_t* table, const uint8_t* mac) {
+    int ghost;
+    uint32_t position = mac_index_find(&table->by_mac, mac, &ghost);
+    return position == MAC_INDEX_NONE ? OFFER_NONE : offer_at(table, position)->index;
+}
+
+int offer_table_add(offer_table_t* table, const uint8_t* mac, uint32_t index, uint64_t expires_ms) {
+    // Una oferta repetida (DISCOVER retransmitido) se renueva: la anterior queda muerta
+    int ghost;
+    uint32_t previous = mac_index_find(&table->by_mac, mac, &ghost);
+    if (previous != MAC_INDEX_NONE) {
+        kill_offer(table, offer_at(table, previous), previous);
+    }
+    if (make_room(table) < 0) {
+        return -1;
+    }
+    uint32_t position = table->tail;
+    if (mac_index_set(&table->by_mac, mac, position & OFFER_POSITION_MASK) < 0) {
+        return -1;
+    }
+    pending_offer_t* offer = offer_at(table, position);
+    memcpy(offer->mac, mac, 6);
+    offer->live = 1;
+    offer->index = index;
+    offer->expires = (uint32_t)expires_ms;
+    table->offered[index >> 6] |= 1ULL << (index & 63);
+    table->live++;
+    table->tail++;
+    return 0;
+}
+
+int offer_table_take(offer_table_t* table, const uint8_t* mac, uint32_t index) {
+    int ghost;
+    uint32_t position = mac_index_find(&table->by_mac, mac, &ghost);
+    if (position == MAC_INDEX_NONE) {
+        return 0;
+    }
+    pending_offer_t* offer = offer_at(table, position);
+    if (offer->index != index) {
+        return 0;
+    }
+    kill_offer(table, offer, position);
+    return 1;
+}
+
+uint32_t offer_table_expire_next(offer_table_t* table, uint64_t now_ms) {
+    if (table->head == table->tail) {
+        return OFFER_NONE;
+    }
+    // Diferencia con signo: el vencimiento de 32 bits sigue valiendo al dar la vuelta
+    pending_offer_t* offer = offer_at(table, table->head);
+    if ((int32_t)(offer->expires - (uint32_t)now_ms) > 0) {
+        return OFFER_NONE;
+    }
+    uint32_t index = offer->index;
+    kill_offer(table, offer, table->head);
+    return index;
+}
+
+uint64_t offer_table_next_deadline(const offer_table_t* table, uint64_t now_ms) {
+    if (table->head == table->tail) {
+        return UINT64_MAX;
+    }
+    int32_t remaining = (int32_t)(offer_at(table, table->head)->expires - (uint32_t)now_ms);
+    return now_ms + (remaining > 0 ? (uint64_t)remaining : 0);
+}
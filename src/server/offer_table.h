@@ -0,0 +1,74 @@
+#ifndef OFFER_TABLE_H
+#define OFFER_TABLE_H
+
+#include <stdint.h> // Para uint8_t, uint32_t, uint64_t
+#include "mac_index.h" // Índice MAC -> posición de la oferta
+
+#define OFFER_TABLE_MIN_CAPACITY 64   // Capacidad mínima del anillo (potencia de 2)
+#define OFFER_NONE UINT32_MAX         // La MAC no tiene oferta pendiente / no venció ninguna
+
+// Oferta pendiente (16 bytes): una dirección reservada para una MAC hasta que llegue su
+// REQUEST o venza
+typedef struct {
+    uint8_t mac[6];     // MAC a la que se ofreció
+    uint8_t live;       // 0 si ya se confirmó, se retiró o se reemplazó
+    uint8_t reserved;
+    uint32_t index;     // Dirección ofrecida (ip - start_ip)
+    uint32_t expires;   // Vencimiento en ms del reloj de timers (32 bits bajos)
+} pending_offer_t;
+
+// Ofertas pendientes de un rango, separadas del almacén de leases: no se escriben en el
+// journal ni ocupan el lease completo. Como todas viven lo mismo, el orden de creación es el
+// de vencimiento y basta un anillo: las vencidas se reclaman de a lote desde la cabeza. Una
+// oferta confirmada o reemplazada solo se marca muerta y sale del anillo al llegar a la
+// cabeza, que siempre es una oferta vigente (el próximo vencimiento se lee sin recorrer).
+// Un índice por MAC da la oferta de un cliente y un bit por dirección dice si está
+// ofrecida (para no entregársela a otra MAC).
+typedef struct {
+    pending_offer_t* ring;      // Ofertas en orden de vencimiento
+    uint32_t capacity;          // Posiciones del anillo (potencia de 2)
+    uint32_t head;              // Posición de la más antigua (contador libre, se toma módulo capacity)
+    uint32_t tail;              // Posición de la próxima
+    uint32_t live;              // Ofertas pendientes
+    mac_index_t by_mac;         // MAC -> posición en el anillo (31 bits bajos)
+    uint64_t* offered;          // Un bit por dirección del rango (1 = ofrecida)
+    uint32_t size;              // Direcciones del rango
+} offer_table_t;
+
+// Función para inicializar la tabla de un rango de `size` direcciones
+int offer_table_init(offer_table_t* table, uint32_t size);
+
+// Función para liberar la memoria de una tabla
+void offer_table_free(offer_table_t* table);
+
+// Función para buscar la oferta pendiente de una MAC (OFFER_NONE si no tiene)
+uint32_t offer_table_find(const offer_table_t* table, const uint8_t* mac);
+
+// Función para saber si una dirección está ofrecida a alguna MAC
+static inline int offer_table_is_offered(const offer_table_t* table, uint32_t index) {
+    return (table->offered[index >> 6] >> (index & 63)) & 1;
+}
+
+// Función para obtener la oferta de una posición entre `head` y `tail` (para recorrerlas;
+// las que tienen `live` en 0 ya no cuentan)
+static inline const pending_offer_t* offer_table_entry(const offer_table_t* table, uint32_t position) {
+    return &table->ring[position & (table->capacity - 1)];
+}
+
+// Función para registrar la oferta de `index` a una MAC hasta `expires_ms`. Si la MAC ya
+// tenía una oferta se reemplaza (si era de otra dirección, el llamador la libera).
+// Retorna -1 sin memoria.
+int offer_table_add(offer_table_t* table, const uint8_t* mac, uint32_t index, uint64_t expires_ms);
+
+// Función para quitar la oferta de `index` a una MAC (al confirmarla o retirarla).
+// Retorna 1 si la MAC tenía esa oferta.
+int offer_table_take(offer_table_t* table, const uint8_t* mac, uint32_t index);
+
+// Función para quitar la próxima oferta vencida en `now_ms`. Retorna su dirección, o
+// OFFER_NONE si no queda ninguna vencida.
+uint32_t offer_table_expire_next(offer_table_t* table, uint64_t now_ms);
+
+// Función para obtener el vencimiento más próximo, el de la cabeza (UINT64_MAX si no hay ofertas)
+uint64_t offer_table_next_deadline(const offer_table_t* table, uint64_t now_ms);
+
+#endif // OFFER_TABLE_H
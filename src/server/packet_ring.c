@@ -0,0 +1,64 @@
+#include "packet_ring.h"
+#include <stdlib.h> // Para calloc, aligned_alloc, free
+#include <string.h> // Para memset
+
+// Redondear hacia arriba a la siguiente potencia de 2
+static uint32_t round_pow2(uint32_t value) {
+    uint32_t size = 1;
+    while (size < value) {
+        size <<= 1;
+    }
+    return size;
+}
+
+int packet_ring_init(packet_ring_t* ring, uint32_t size) {
+    memset(ring, 0, sizeof(*ring));
+    size = round_pow2(size < 1 ? 1 : size);
+
+    ring->refs = (uint32_t*)calloc(size, sizeof(uint32_t));
+    ring->buffers = (uint8_t*)aligned_alloc(64, (size_t)size * PACKET_RING_SLOT_SIZE);
+    if (!ring->refs || !ring->buffers) {
+        packet_ring_free(ring);
+        return -1;
+    }
+    ring->size = size;
+    return 0;
+}
+
+void packet_ring_free(packet_ring_t* ring) {
+    free(ring->refs);
+    free(ring->buffers);
+    memset(ring, 0, sizeof(*ring));
+}
+
+int packet_ring_acquire(packet_ring_t* ring) {
+    for (uint32_t i = 0; i < ring->size; i++) {
+        uint32_t slot = (ring->cursor + i) & (ring->size - 1);
+        // El acquire empareja con el release de quien soltó el slot: su lectura terminó
+        if (__atomic_load_n(&ring->refs[slot], __ATOMIC_ACQUIRE) == 0) {
+            __atomic_store_n(&ring->refs[slot], 1, __ATOMIC_RELAXED);
+            ring->cursor = slot + 1;
+            return (int)slot;
+        }
+    }
+    ring->exhausted++;
+    return -1;
+}
+
+int packet_queue_init(packet_queue_t* queue, uint32_t capacity) {
+    memset(queue, 0, sizeof(*queue));
+    capacity = round_pow2(capacity < 1 ? 1 : capacity);
+
+    queue->items = (dhcp_packet_desc_t*)calloc(capacity, sizeof(dhcp_packet_desc_t));
+    if (!queue->items) {
+        return -1;
+    }
+    queue->capacity = capacity;
+    return 0;
+}
+
+void packet_queue_free(packet_queue_t* queue) {
+    free(queue->items);
+    queue->items = NULL;
+    queue->capacity = 0;
+}
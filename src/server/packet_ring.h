@@ -0,0 +1,100 @@
+#ifndef PACKET_RING_H
+#define PACKET_RING_H
+
+#include <netinet/in.h> // Para sockaddr_in
+#include <stdint.h>     // Para uint8_t, uint32_t, uint64_t
+
+#define PACKET_RING_SLOT_SIZE 576   // Bytes por slot: un datagrama DHCP (548) redondeado a líneas de caché
+
+// Descriptor de un paquete recibido. Es lo único que viaja del hilo que recibe al
+// worker: el datagrama queda en su slot del anillo hasta que el worker lo libera.
+typedef struct {
+    uint8_t* data;                   // Datagrama dentro de su slot
+    uint32_t length;                 // Bytes recibidos
+    uint32_t slot;                   // Slot del anillo que lo contiene
+    struct sockaddr_in client_addr;  // Dirección de origen
+    uint64_t rx_ns;                  // Instante de recepción (CLOCK_MONOTONIC, ns)
+    uint32_t kernel_ns;              // Espera en el kernel antes de la lectura (DHCP_TRACE=kernel)
+} dhcp_packet_desc_t;
+
+// Anillo de buffers de tamaño fijo, reservado al iniciar. Un solo hilo toma slots
+// (el que recibe) y cualquiera los suelta: cada slot tiene un contador de referencias
+// y se reutiliza cuando llega a 0. La búsqueda sigue un cursor circular, así que con
+// el anillo dimensionado para el máximo en vuelo casi siempre encuentra libre el siguiente.
+typedef struct {
+    uint32_t size;                   // Slots del anillo (potencia de 2)
+    uint32_t cursor;                 // Próximo slot a revisar (solo el hilo que toma)
+    uint32_t* refs;                  // Referencias de cada slot (0 = libre)
+    uint8_t* buffers;                // size * PACKET_RING_SLOT_SIZE bytes
+    unsigned long exhausted;         // Veces que no quedaba ningún slot libre
+} packet_ring_t;
+
+// Cola sin locks de un productor y un consumidor (el hilo que recibe y un worker).
+// head y tail van en líneas de caché distintas para que los dos hilos no se pisen.
+typedef struct {
+    uint32_t capacity;                                // Descriptores (potencia de 2)
+    dhcp_packet_desc_t* items;                        // Buffer circular
+    uint32_t head __attribute__((aligned(64)));       // Próximo a leer (solo el consumidor)
+    uint32_t tail __attribute__((aligned(64)));       // Próximo a escribir (solo el productor)
+} packet_queue_t;
+
+// Función para reservar un anillo de al menos `size` slots (se redondea a potencia de 2)
+int packet_ring_init(packet_ring_t* ring, uint32_t size);
+
+// Función para liberar la memoria de un anillo
+void packet_ring_free(packet_ring_t* ring);
+
+// Función para tomar un slot libre con una referencia. Retorna su índice o -1 si el
+// anillo está agotado. Solo puede llamarla un hilo (el que recibe).
+int packet_ring_acquire(packet_ring_t* ring);
+
+// Función para obtener el buffer de un slot
+static inline uint8_t* packet_ring_data(packet_ring_t* ring, uint32_t slot) {
+    return ring->buffers + (size_t)slot * PACKET_RING_SLOT_SIZE;
+}
+
+// Función para sumar una referencia a un slot (otro dueño que lo suelta por su cuenta)
+static inline void packet_ring_ref(packet_ring_t* ring, uint32_t slot) {
+    __atomic_add_fetch(&ring->refs[slot], 1, __ATOMIC_RELAXED);
+}
+
+// Función para soltar una referencia; con la última el slot vuelve a estar libre
+static inline void packet_ring_release(packet_ring_t* ring, uint32_t slot) {
+    __atomic_sub_fetch(&ring->refs[slot], 1, __ATOMIC_RELEASE);
+}
+
+// Función para reservar una cola de al menos `capacity` descriptores (potencia de 2)
+int packet_queue_init(packet_queue_t* queue, uint32_t capacity);
+
+// Función para liberar la memoria de una cola
+void packet_queue_free(packet_queue_t* queue);
+
+// Función para encolar un descriptor (productor). Retorna -1 si la cola está llena.
+static inline int packet_queue_push(packet_queue_t* queue, const dhcp_packet_desc_t* desc) {
+    uint32_t tail = queue->tail;
+    if (tail - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE) == queue->capacity) {
+        return -1;
+    }
+    queue->items[tail & (queue->capacity - 1)] = *desc;
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+// Función para desencolar hasta `max` descriptores en `out` (consumidor). Retorna cuántos.
+static inline int packet_queue_pop(packet_queue_t* queue, dhcp_packet_desc_t* out, int max) {
+    uint32_t head = queue->head;
+    uint32_t available = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) - head;
+    int count = available < (uint32_t)max ? (int)available : max;
+    for (int i = 0; i < count; i++) {
+        out[i] = queue->items[(head + i) & (queue->capacity - 1)];
+    }
+    __atomic_store_n(&queue->head, head + count, __ATOMIC_RELEASE);
+    return count;
+}
+
+// Función para saber cuántos descriptores hay en la cola (valor aproximado desde otro hilo)
+static inline uint32_t packet_queue_count(packet_queue_t* queue) {
+    return __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE) - __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+}
+
+#endif // PACKET_RING_H
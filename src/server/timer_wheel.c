@@ -0,0 +1,174 @@
+#include "timer_wheel.h"
+#include <stdlib.h> // Para calloc, free
+#include <string.h> // Para memset
+#include <time.h>   // Para clock_gettime
+
+uint64_t timer_clock_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+int timer_wheel_init(timer_wheel_t* wheel, uint32_t capacity, uint64_t now) {
+    memset(wheel, 0, sizeof(*wheel));
+    memset(wheel->heads, 0xff, sizeof(wheel->heads));  // Todas las ranuras vacías (TIMER_NONE)
+    wheel->now = now;
+
+    if (capacity > 0) {
+        wheel->nodes = (timer_node_t*)calloc(capacity, sizeof(timer_node_t));
+        if (!wheel->nodes) {
+            return -1;
+        }
+    }
+    wheel->capacity = capacity;
+    return 0;
+}
+
+void timer_wheel_free(timer_wheel_t* wheel) {
+    free(wheel->nodes);
+    wheel->nodes = NULL;
+    wheel->capacity = 0;
+    wheel->count = 0;
+}
+
+// Quitar un nodo de la lista de su ranura
+static void unlink_node(timer_wheel_t* wheel, uint32_t id) {
+    timer_node_t* node = &wheel->nodes[id];
+    int level = (node->slot - 1) / TIMER_WHEEL_SLOTS;
+    int slot = (node->slot - 1) % TIMER_WHEEL_SLOTS;
+
+    if (node->prev != TIMER_NONE) {
+        wheel->nodes[node->prev].next = node->next;
+    } else {
+        wheel->heads[level][slot] = node->next;
+        if (node->next == TIMER_NONE) {
+            wheel->occupied[level] &= ~(1ULL << slot);
+        }
+    }
+    if (node->next != TIMER_NONE) {
+        wheel->nodes[node->next].prev = node->prev;
+    }
+    node->slot = 0;
+}
+
+// Colocar un nodo en la ranura que le corresponde respecto de `now`
+static void place_node(timer_wheel_t* wheel, uint32_t id) {
+    timer_node_t* node = &wheel->nodes[id];
+    uint64_t when = node->expires;
+    if (when < wheel->now) {
+        when = wheel->now;  // Vencido: se procesa en el tick actual
+    }
+    if (when - wheel->now > TIMER_WHEEL_HORIZON) {
+        when = wheel->now + TIMER_WHEEL_HORIZON;  // Se recoloca al llegar al horizonte
+    }
+
+    // El nivel lo da el bit más alto en que difieren el vencimiento y el tick actual
+    uint64_t masked = (when ^ wheel->now) | (TIMER_WHEEL_SLOTS - 1);
+    int level = (63 - __builtin_clzll(masked)) / 6;
+    if (level >= TIMER_WHEEL_LEVELS) {
+        level = TIMER_WHEEL_LEVELS - 1;  // El último nivel es circular
+    }
+    int slot = (int)((when >> (6 * level)) & (TIMER_WHEEL_SLOTS - 1));
+
+    node->slot = (uint16_t)(level * TIMER_WHEEL_SLOTS + slot + 1);
+    node->prev = TIMER_NONE;
+    node->next = wheel->heads[level][slot];
+    if (node->next != TIMER_NONE) {
+        wheel->nodes[node->next].prev = id;
+    }
+    wheel->heads[level][slot] = id;
+    wheel->occupied[level] |= 1ULL << slot;
+}
+
+void timer_wheel_schedule(timer_wheel_t* wheel, uint32_t id, uint64_t expires) {
+    if (id >= wheel->capacity) return;
+
+    if (wheel->nodes[id].slot != 0) {
+        unlink_node(wheel, id);
+    } else {
+        wheel->count++;
+    }
+    wheel->nodes[id].expires = expires;
+    place_node(wheel, id);
+}
+
+void timer_wheel_cancel(timer_wheel_t* wheel, uint32_t id) {
+    if (id >= wheel->capacity || wheel->nodes[id].slot == 0) return;
+    unlink_node(wheel, id);
+    wheel->count--;
+}
+
+// Próxima ranura ocupada de un nivel a partir del tick actual (-1 si el nivel está vacío)
+static int next_slot(const timer_wheel_t* wheel, int level, uint64_t* deadline) {
+    uint64_t occupied = wheel->occupied[level];
+    if (!occupied) {
+        return -1;
+    }
+
+    int shift = 6 * level;
+    int now_slot = (int)((wheel->now >> shift) & (TIMER_WHEEL_SLOTS - 1));
+    uint64_t rotated = now_slot ? (occupied >> now_slot) | (occupied << (64 - now_slot)) : occupied;
+    int slot = (__builtin_ctzll(rotated) + now_slot) & (TIMER_WHEEL_SLOTS - 1);
+
+    uint64_t slot_range = 1ULL << shift;
+    uint64_t level_range = slot_range << 6;
+    *deadline = (wheel->now & ~(level_range - 1)) + (uint64_t)slot * slot_range;
+    if (slot < now_slot) {
+        *deadline += level_range;  // Solo ocurre en el último nivel, al dar la vuelta
+    }
+    return slot;
+}
+
+uint32_t timer_wheel_expire_next(timer_wheel_t* wheel, uint64_t now) {
+    while (1) {
+        // El nivel más bajo con ranuras ocupadas tiene siempre el vencimiento más próximo
+        uint64_t deadline = 0;
+        int level;
+        int slot = -1;
+        for (level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+            slot = next_slot(wheel, level, &deadline);
+            if (slot >= 0) break;
+        }
+
+        if (slot < 0 || deadline > now) {
+            if (now > wheel->now) {
+                wheel->now = now;
+            }
+            return TIMER_NONE;
+        }
+        if (deadline > wheel->now) {
+            wheel->now = deadline;
+        }
+
+        if (level == 0) {
+            uint32_t id = wheel->heads[0][slot];
+            unlink_node(wheel, id);
+            if (wheel->nodes[id].expires > wheel->now) {
+                place_node(wheel, id);  // Estaba más allá del horizonte: recolocarlo
+                continue;
+            }
+            wheel->count--;
+            return id;
+        }
+
+        // Cascada: repartir la ranura entre los niveles inferiores
+        uint32_t id = wheel->heads[level][slot];
+        wheel->heads[level][slot] = TIMER_NONE;
+        wheel->occupied[level] &= ~(1ULL << slot);
+        while (id != TIMER_NONE) {
+            uint32_t next = wheel->nodes[id].next;
+            place_node(wheel, id);
+            id = next;
+        }
+    }
+}
+
+uint64_t timer_wheel_next_deadline(const timer_wheel_t* wheel) {
+    uint64_t deadline;
+    for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+        if (next_slot(wheel, level, &deadline) >= 0) {
+            return deadline;
+        }
+    }
+    return UINT64_MAX;
+}
@@ -0,0 +1,55 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h> // Para uint16_t, uint32_t, uint64_t
+
+#define TIMER_WHEEL_LEVELS 6              // Niveles de la rueda (64^6 ticks)
+#define TIMER_WHEEL_SLOTS 64              // Ranuras por nivel
+#define TIMER_WHEEL_HORIZON (1ULL << 35)  // Vencimientos más lejanos se reprograman al llegar aquí
+#define TIMER_NONE UINT32_MAX             // Fin de lista / no hay timers vencidos
+
+// Timer de la rueda. Se identifica por su índice en el arreglo de nodos, que el
+// dueño de la rueda hace coincidir con su propio registro (p. ej. ip - start_ip).
+typedef struct {
+    uint64_t expires;   // Tick de vencimiento real
+    uint32_t next;      // Siguiente timer de la misma ranura
+    uint32_t prev;      // Timer anterior de la misma ranura
+    uint16_t slot;      // nivel * 64 + ranura + 1 (0 = no programado)
+} timer_node_t;
+
+// Rueda jerárquica de timers. El nivel k tiene 64 ranuras de 64^k ticks; un timer
+// se guarda en el nivel del bit más alto en que su vencimiento difiere de `now` y
+// baja de nivel (cascada) cuando `now` llega a su ranura. Un bitmap por nivel indica
+// las ranuras ocupadas, así avanzar cuesta lo mismo con 10 o con 1M timers activos.
+typedef struct {
+    uint64_t now;                                          // Tick actual de la rueda
+    uint32_t capacity;                                     // Número de nodos
+    uint32_t count;                                        // Timers programados
+    uint64_t occupied[TIMER_WHEEL_LEVELS];                 // Ranuras no vacías por nivel
+    uint32_t heads[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS]; // Primer timer de cada ranura
+    timer_node_t* nodes;                                   // Nodos, indexados por id
+} timer_wheel_t;
+
+// Función para inicializar una rueda con `capacity` timers, comenzando en el tick `now`
+int timer_wheel_init(timer_wheel_t* wheel, uint32_t capacity, uint64_t now);
+
+// Función para liberar la memoria de una rueda
+void timer_wheel_free(timer_wheel_t* wheel);
+
+// Función para programar (o reprogramar) el timer `id` para el tick `expires`
+void timer_wheel_schedule(timer_wheel_t* wheel, uint32_t id, uint64_t expires);
+
+// Función para cancelar el timer `id` (no hace nada si no estaba programado)
+void timer_wheel_cancel(timer_wheel_t* wheel, uint32_t id);
+
+// Función para avanzar la rueda hasta `now` y sacar el siguiente timer vencido.
+// Retorna su id (ya desprogramado) o TIMER_NONE si no queda ninguno vencido.
+uint32_t timer_wheel_expire_next(timer_wheel_t* wheel, uint64_t now);
+
+// Función para obtener el próximo tick en que la rueda tiene trabajo (UINT64_MAX si está vacía)
+uint64_t timer_wheel_next_deadline(const timer_wheel_t* wheel);
+
+// Función para obtener los milisegundos del reloj monotónico de baja resolución
+uint64_t timer_clock_ms();
+
+#endif // TIMER_WHEEL_H
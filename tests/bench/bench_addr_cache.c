@@ -0,0 +1,291 @@
+// Benchmark de las reservas de direcciones por worker (DHCP_ADDR_CACHE)
+//
+// 1. Escalado: de 1 a 16 hilos asignan direcciones de un mismo shard con assign_ip_address,
+//    sin reservas y con reservas de 32 direcciones por hilo. Se reportan las asignaciones por
+//    segundo, cuánto rinden las reservas respecto de no usarlas y la eficiencia respecto del
+//    ideal (1 hilo por el número de hilos). Con menos de 16 núcleos las filas con más hilos
+//    que núcleos no se pueden verificar y se marcan así. Con el perfil de locks se compara la
+//    retención del lock del shard con 16 hilos.
+// 2. Pool bajo: 16 hilos con reservas agotan un pool chico. Deben asignarse todas las
+//    direcciones (las reservas vuelven al pool cuando queda poco).
+// 3. Inactividad: un pool de workers atiende DISCOVER y queda sin paquetes; pasado
+//    ADDR_CACHE_IDLE_S las reservas de los workers deben volver al bitmap.
+// Uso: ./bench_addr_cache [asignaciones] [rondas]   (por defecto 131072 y 3)
+// Retorna 1 si alguna verificación falla o la eficiencia con reservas baja de 70%, y 2 si todo
+// pasa pero hay menos de 16 núcleos: el escalado hasta 16 hilos queda sin verificar.
+
+#include "dhcp_server.h"
+
+#define SCALING_POOL (1u << 18)
+#define LOW_POOL 4096
+#define MAX_THREADS 16
+#define IDLE_CHECK_MACS 1000
+
+static FILE* out;  // Salida de resultados (stdout real, el servidor escribe en /dev/null)
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void make_mac(uint8_t* mac, uint32_t index) {
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = (index >> 24) & 0xff;
+    mac[3] = (index >> 16) & 0xff;
+    mac[4] = (index >> 8) & 0xff;
+    mac[5] = index & 0xff;
+}
+
+static void configure_server() {
+    server_ip = ntohl(inet_addr("127.0.0.1"));
+    subnet_mask = inet_addr("255.0.0.0");
+    gateway_ip = inet_addr("127.0.0.1");
+    dns_server_ip = inet_addr("127.0.0.1");
+    default_lease_time = 3600;
+}
+
+//================================================
+// Hilos que asignan del mismo shard
+
+typedef struct {
+    pthread_t thread;
+    ip_range_t* range;
+    uint32_t first_mac;
+    uint32_t limit;       // Asignaciones a intentar (0 = hasta que el pool se agote)
+    uint32_t cache;
+    uint32_t assigned;
+} alloc_thread_t;
+
+static pthread_barrier_t start_barrier;
+
+static void* alloc_thread(void* arg) {
+    alloc_thread_t* self = (alloc_thread_t*)arg;
+    struct dhcp_packet request;
+    memset(&request, 0, sizeof(request));
+    address_cache_attach(self->cache);
+    pthread_barrier_wait(&start_barrier);
+    for (uint32_t i = 0; self->limit == 0 || i < self->limit; i++) {
+        make_mac(request.chaddr, self->first_mac + i);
+        if (assign_ip_address(self->range, &request, NULL) == 0) {
+            if (self->limit == 0) break;
+            continue;
+        }
+        self->assigned++;
+    }
+    address_cache_attach(0);
+    return NULL;
+}
+
+// Lanza `threads` hilos sobre un pool nuevo de `pool` direcciones. Retorna asignaciones por segundo
+// y deja en `assigned` el total; falla si el bitmap no coincide con el almacén al terminar.
+static double run_threads(int threads, uint32_t pool, uint32_t total, uint32_t cache, uint32_t* assigned, int* failed) {
+    ip_range_t range;
+    init_ip_range(&range, 10u << 24, (10u << 24) + pool - 1, 1);
+    alloc_thread_t workers_state[MAX_THREADS];
+    pthread_barrier_init(&start_barrier, NULL, (unsigned)threads + 1);
+    for (int t = 0; t < threads; t++) {
+        workers_state[t] = (alloc_thread_t){ .range = &range, .first_mac = (uint32_t)t << 24,
+                                             .limit = total ? total / threads : 0, .cache = cache };
+        pthread_create(&workers_state[t].thread, NULL, alloc_thread, &workers_state[t]);
+    }
+    uint64_t start = now_ns();
+    pthread_barrier_wait(&start_barrier);
+    *assigned = 0;
+    for (int t = 0; t < threads; t++) {
+        pthread_join(workers_state[t].thread, NULL);
+        *assigned += workers_state[t].assigned;
+    }
+    double seconds = (now_ns() - start) / 1e9;
+    pthread_barrier_destroy(&start_barrier);
+
+    // Sin reservas colgadas: todo lo ocupado en el bitmap tiene su oferta (o su lease sin DHCP_OFFER_TTL_MS)
+    uint32_t given = range.leases.count + range.offers.live;
+    if (given != *assigned || range.free_map.free_count != pool - *assigned) {
+        fprintf(out, "  %d hilos: %u asignadas, %u ofertas y leases, %u libres de %u\n", threads, *assigned,
+                given, range.free_map.free_count, pool);
+        *failed = 1;
+    }
+    free_ip_range(&range);
+    return *assigned / seconds;
+}
+
+// Retorna 1 si falla, 2 si las filas con más hilos que núcleos quedaron sin verificar
+static int check_scaling(uint32_t total, int rounds) {
+    int failed = 0, unverified = 0;
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1) cores = 1;
+    fprintf(out, "Asignaciones por segundo en un shard (%u por ronda, mejor de %d, %ld núcleos):\n", total, rounds, cores);
+    fprintf(out, "  %6s %14s %14s %9s %12s\n", "hilos", "sin reservas", "con reservas", "con/sin", "eficiencia");
+
+    double single = 0, overhead = 0;
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        double best[2] = { 0, 0 };
+        for (int r = 0; r < rounds; r++) {
+            for (int cached = 0; cached < 2; cached++) {
+                uint32_t assigned;
+                double rate = run_threads(threads, SCALING_POOL, total, cached ? ADDR_CACHE_DEFAULT : 0, &assigned, &failed);
+                if (assigned != total - total % threads) {
+                    fprintf(out, "  %d hilos: %u de %u asignaciones\n", threads, assigned, total);
+                    failed = 1;
+                }
+                if (rate > best[cached]) best[cached] = rate;
+            }
+        }
+        if (threads == 1) {
+            single = best[1];
+            overhead = 1 - best[1] / best[0];
+        }
+
+        // Con más hilos que núcleos los hilos se turnan la CPU y el ideal no es alcanzable: la
+        // fila no prueba nada, ni a favor ni en contra
+        double efficiency = best[1] / (single * threads);
+        if (threads > cores) {
+            fprintf(out, "  %6d %14.0f %14.0f %8.2fx %12s\n", threads, best[0], best[1], best[1] / best[0],
+                    "no verificado");
+            unverified = 1;
+            continue;
+        }
+        fprintf(out, "  %6d %14.0f %14.0f %8.2fx %11.0f%%\n", threads, best[0], best[1], best[1] / best[0],
+                efficiency * 100);
+        if (efficiency < 0.7) {
+            fprintf(out, "FALLO: con reservas, %d hilos rinden menos de 70%% del ideal\n", threads);
+            failed = 1;
+        }
+    }
+
+    if (unverified) {
+        fprintf(out, "  NO VERIFICADO: el escalado hasta %d hilos necesita %d núcleos y hay %ld\n", MAX_THREADS,
+                MAX_THREADS, cores);
+    }
+
+    // Sin contención las reservas no ahorran ningún lock y su manejo es costo puro
+    fprintf(out, "  Costo de las reservas con 1 hilo: %.1f%% menos asignaciones por segundo que sin reservas\n",
+            overhead * 100);
+
+    // Retención del lock del shard con 16 hilos (el perfil agrega su propio costo)
+    for (int cached = 0; cached < 2; cached++) {
+        uint32_t assigned;
+        dhcp_lock_reset();
+        dhcp_lock_configure("on");
+        run_threads(MAX_THREADS, SCALING_POOL, total, cached ? ADDR_CACHE_DEFAULT : 0, &assigned, &failed);
+        dhcp_lock_configure("off");
+        dhcp_lock_stats_t stats;
+        dhcp_lock_stats("shard->lock", &stats);
+        fprintf(out, "  Lock del shard con %d hilos %s: %llu tomas, %.2f%% contendidas, retención media %.0f ns, p99 %.0f ns\n",
+                MAX_THREADS, cached ? "con reservas" : "sin reservas", (unsigned long long)stats.acquisitions,
+                stats.acquisitions ? 100.0 * stats.contended / stats.acquisitions : 0.0,
+                (double)stats.hold.mean, (double)stats.hold.p99);
+    }
+    return failed ? 1 : unverified ? 2 : 0;
+}
+
+//================================================
+// Pool bajo: nada queda atrapado en las reservas
+
+static int check_low_pool() {
+    int failed = 0;
+    uint32_t assigned;
+    run_threads(MAX_THREADS, LOW_POOL, 0, ADDR_CACHE_DEFAULT, &assigned, &failed);
+    fprintf(out, "Pool de %u direcciones con %d hilos y reservas: %u asignadas\n", LOW_POOL, MAX_THREADS, assigned);
+    if (assigned != LOW_POOL) {
+        fprintf(out, "FALLO: quedaron direcciones reservadas sin asignar\n");
+        failed = 1;
+    }
+    return failed;
+}
+
+//================================================
+// Inactividad: los workers devuelven sus reservas
+
+static size_t build_discover(struct dhcp_packet* packet, const uint8_t* mac, uint32_t xid) {
+    memset(packet, 0, sizeof(*packet));
+    packet->op = 1;
+    packet->htype = 1;
+    packet->hlen = 6;
+    packet->xid = htonl(xid);
+    memcpy(packet->chaddr, mac, 6);
+    packet->options[0] = 53;
+    packet->options[1] = 1;
+    packet->options[2] = DHCP_DISCOVER;
+    packet->options[3] = 255;
+    return sizeof(*packet) - sizeof(packet->options) + 4;
+}
+
+static int check_idle_release() {
+    struct sockaddr_in sink;
+    int sink_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    socklen_t sink_length = sizeof(sink);
+    memset(&sink, 0, sizeof(sink));
+    sink.sin_family = AF_INET;
+    sink.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(sink_fd, (struct sockaddr*)&sink, sizeof(sink));
+    getsockname(sink_fd, (struct sockaddr*)&sink, &sink_length);
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    init_ip_range(&global_ip_range, 12u << 24, (12u << 24) + SCALING_POOL - 1, 1);
+    split_ip_pool(&global_ip_range, 1);
+    start_worker_pool(sockfd, 4);
+
+    struct dhcp_packet packet;
+    uint8_t mac[6];
+    for (uint32_t i = 0; i < IDLE_CHECK_MACS; i++) {
+        make_mac(mac, i);
+        while (dispatch_dhcp_packet(&sink, (uint8_t*)&packet, build_discover(&packet, mac, i + 1)) < 0) {
+            drain_worker_pool();
+        }
+    }
+    drain_worker_pool();
+
+    ip_range_t* shard = &ip_shards[0];
+    dhcp_mutex_lock(&shard->lock);
+    uint32_t reserved = SCALING_POOL - shard->free_map.free_count - shard->leases.count - shard->offers.live;
+    dhcp_mutex_unlock(&shard->lock);
+
+    // Esperar algo más que ADDR_CACHE_IDLE_S con los workers dormidos
+    struct timespec pause = { .tv_sec = ADDR_CACHE_IDLE_S, .tv_nsec = 300000000 };
+    nanosleep(&pause, NULL);
+    dhcp_mutex_lock(&shard->lock);
+    uint32_t offers = shard->leases.count + shard->offers.live;
+    uint32_t left = SCALING_POOL - shard->free_map.free_count - offers;
+    dhcp_mutex_unlock(&shard->lock);
+
+    stop_worker_pool();
+    free_ip_range(shard);
+    close(sockfd);
+    close(sink_fd);
+
+    fprintf(out, "4 workers tras %u DISCOVER: %u ofertas, %u reservas al vaciarse la cola, %u tras %.1f s sin paquetes\n",
+            IDLE_CHECK_MACS, offers, reserved, left, ADDR_CACHE_IDLE_S + 0.3);
+    if (offers != IDLE_CHECK_MACS || reserved == 0 || left != 0) {
+        fprintf(out, "FALLO: las reservas no volvieron al pool con los workers inactivos\n");
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    configure_server();
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(out, NULL, _IOLBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+
+    uint32_t total = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 131072;
+    int rounds = argc > 2 ? atoi(argv[2]) : 3;
+    if (total == 0 || total > SCALING_POOL) total = SCALING_POOL / 2;
+    if (rounds < 1) rounds = 1;
+
+    int scaling = check_scaling(total, rounds);
+    int failed = scaling == 1;
+    failed |= check_low_pool();
+    failed |= check_idle_release();
+    if (failed) {
+        fprintf(out, "FALLO\n");
+        return 1;
+    }
+    fprintf(out, "%s\n", scaling == 2 ? "NO VERIFICADO" : "OK");
+    return scaling;
+}
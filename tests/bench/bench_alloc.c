@@ -0,0 +1,256 @@
+// Verificación de que el camino de un paquete no reserva memoria
+//
+// El benchmark reemplaza malloc, calloc, realloc y las variantes alineadas por versiones
+// que cuentan las llamadas de todos los hilos y luego llaman a las de glibc. Levanta el
+// camino real del servidor (recvmmsg al anillo de paquetes, workers, respuestas por
+// loopback) y hace pasar a cada cliente por DISCOVER, REQUEST, RENEW (REQUEST con ciaddr)
+// y RELEASE. La primera ronda calienta las estructuras (anillos de log, plantillas de
+// opciones, tablas de transacciones); en las siguientes se cuentan las reservas.
+// Se mide con el log en INFO y en DEBUG, ambos con el hilo de log en marcha.
+// Uso: ./bench_alloc [clientes] [rondas]   (por defecto 2000 y 5)
+// Retorna 1 si hubo alguna reserva después del calentamiento.
+
+#include "dhcp_server.h"
+#include <execinfo.h>  // Para backtrace_symbols_fd
+
+#define CHUNK 128          // Paquetes que el generador envía antes de que el servidor los lea
+#define MAX_CALLERS 8      // Direcciones de las primeras reservas contadas, para ubicarlas
+
+// Reservas de glibc que quedan detrás de las nuestras
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t count, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void* __libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void* ptr);
+
+static int counting;                       // Se cuentan las reservas
+static unsigned long allocations;          // Reservas contadas
+static void* callers[MAX_CALLERS];         // Quién hizo las primeras
+
+static void count_allocation(void* caller) {
+    if (!__atomic_load_n(&counting, __ATOMIC_RELAXED)) return;
+    unsigned long n = __atomic_fetch_add(&allocations, 1, __ATOMIC_RELAXED);
+    if (n < MAX_CALLERS) callers[n] = caller;
+}
+
+void* malloc(size_t size) {
+    count_allocation(__builtin_return_address(0));
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    count_allocation(__builtin_return_address(0));
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+    count_allocation(__builtin_return_address(0));
+    return __libc_realloc(ptr, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    count_allocation(__builtin_return_address(0));
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+    count_allocation(__builtin_return_address(0));
+    *ptr = __libc_memalign(alignment, size);
+    return *ptr ? 0 : ENOMEM;
+}
+
+void free(void* ptr) {
+    __libc_free(ptr);
+}
+
+static FILE* out;  // Salida de resultados (stdout real, el log va a /dev/null)
+
+static int bind_loopback(struct sockaddr_in* addr) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    socklen_t len = sizeof(*addr);
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (struct sockaddr*)addr, sizeof(*addr));
+    getsockname(fd, (struct sockaddr*)addr, &len);
+    int rcvbuf = 4 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    return fd;
+}
+
+// Paquete del cliente `index`; `requested_ip` va en la opción 50 y `ciaddr` en el encabezado
+static size_t build_packet(struct dhcp_packet* packet, uint32_t index, uint8_t type,
+                           uint32_t requested_ip, uint32_t ciaddr) {
+    memset(packet, 0, sizeof(*packet));
+    packet->op = 1;
+    packet->htype = 1;
+    packet->hlen = 6;
+    packet->xid = htonl(0x5000 + index);
+    packet->ciaddr = htonl(ciaddr);
+    packet->chaddr[0] = 0x02;
+    packet->chaddr[3] = (index >> 16) & 0xff;
+    packet->chaddr[4] = (index >> 8) & 0xff;
+    packet->chaddr[5] = index & 0xff;
+
+    uint8_t* option = packet->options;
+    *option++ = 53;
+    *option++ = 1;
+    *option++ = type;
+    if (requested_ip) {
+        uint32_t value = htonl(requested_ip);
+        *option++ = 50;
+        *option++ = 4;
+        memcpy(option, &value, 4);
+        option += 4;
+    }
+    *option++ = 255;
+    return sizeof(*packet) - sizeof(packet->options) + (option - packet->options);
+}
+
+static int server_fd, client_fd;
+static struct sockaddr_in server_addr;
+static uint32_t* offered;  // IP ofrecida a cada cliente
+static unsigned long replies;
+
+// Leer las respuestas pendientes, anotando la IP de cada OFFER
+static void read_replies(uint32_t clients) {
+    struct dhcp_packet packets[CHUNK];
+    struct iovec iov[CHUNK];
+    struct mmsghdr msgs[CHUNK];
+    int received;
+    do {
+        for (int i = 0; i < CHUNK; i++) {
+            iov[i].iov_base = &packets[i];
+            iov[i].iov_len = sizeof(packets[i]);
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        received = recvmmsg(client_fd, msgs, CHUNK, MSG_DONTWAIT, NULL);
+        for (int i = 0; i < received; i++) {
+            uint32_t index = ntohl(packets[i].xid) - 0x5000;
+            if (index < clients && packets[i].yiaddr) {
+                offered[index] = ntohl(packets[i].yiaddr);
+            }
+            replies++;
+        }
+    } while (received > 0);
+}
+
+// Enviar a todos los clientes el mensaje de una fase y esperar a que el servidor lo procese
+static void run_phase(uint32_t clients, dhcp_msg_batch_t* rx, uint8_t type, int use_option, int use_ciaddr) {
+    struct dhcp_packet requests[CHUNK];
+    struct iovec iov[CHUNK];
+    struct mmsghdr msgs[CHUNK];
+
+    for (uint32_t sent = 0; sent < clients; ) {
+        int chunk = clients - sent < CHUNK ? (int)(clients - sent) : CHUNK;
+        for (int i = 0; i < chunk; i++) {
+            uint32_t index = sent + i;
+            iov[i].iov_base = &requests[i];
+            iov[i].iov_len = build_packet(&requests[i], index, type,
+                                          use_option ? offered[index] : 0,
+                                          use_ciaddr ? offered[index] : 0);
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = &server_addr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(server_addr);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int queued = sendmmsg(client_fd, msgs, chunk, 0);
+        sent += queued > 0 ? queued : chunk;
+
+        while (receive_dhcp_packets(server_fd, rx, MSG_DONTWAIT) > 0) {
+        }
+        drain_worker_pool();
+        read_replies(clients);
+    }
+}
+
+// Ciclo completo de todos los clientes
+static void run_round(uint32_t clients, dhcp_msg_batch_t* rx) {
+    run_phase(clients, rx, DHCP_DISCOVER, 0, 0);
+    run_phase(clients, rx, DHCP_REQUEST, 1, 0);
+    run_phase(clients, rx, DHCP_REQUEST, 0, 1);
+    run_phase(clients, rx, DHCP_RELEASE, 0, 1);
+}
+
+// Reservas por paquete después del calentamiento con el nivel de log indicado
+static unsigned long measure_level(uint32_t clients, int rounds, int level, const char* name) {
+    struct sockaddr_in client_addr;
+    server_fd = bind_loopback(&server_addr);
+    client_fd = bind_loopback(&client_addr);
+
+    init_ip_range(&global_ip_range, 0x0a000001, 0x0a000001 + clients * 2, 0);
+    split_ip_pool(&global_ip_range, 1);
+
+    dhcp_log_level = level;
+    dhcp_log_start();
+    memset(&io_stats, 0, sizeof(io_stats));
+    start_worker_pool(server_fd, 0);
+
+    dhcp_msg_batch_t rx;
+    dhcp_batch_init(&rx, io_batch_size);
+
+    // Calentamiento: primera ronda sin contar
+    run_round(clients, &rx);
+
+    uint64_t packets_before = io_stats.rx_packets;
+    replies = 0;
+    allocations = 0;
+    __atomic_store_n(&counting, 1, __ATOMIC_SEQ_CST);
+    for (int r = 0; r < rounds; r++) {
+        run_round(clients, &rx);
+    }
+    // Dar tiempo al hilo de log para vaciar lo que quedó en los anillos
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = 3 * DHCP_LOG_FLUSH_MS * 1000000L };
+    nanosleep(&pause, NULL);
+    __atomic_store_n(&counting, 0, __ATOMIC_SEQ_CST);
+
+    uint64_t packets = io_stats.rx_packets - packets_before;
+    unsigned long counted = allocations;
+    fprintf(out, "  %-6s %8lu paquetes, %6lu respuestas, %lu reservas (%.4f por paquete)\n",
+            name, (unsigned long)packets, replies, counted, packets ? (double)counted / packets : 0.0);
+    if (counted > 0) {
+        fflush(out);
+        int shown = counted < MAX_CALLERS ? (int)counted : MAX_CALLERS;
+        fprintf(out, "  Primeras reservas desde:\n");
+        fflush(out);
+        backtrace_symbols_fd(callers, shown, fileno(out));
+    }
+
+    stop_worker_pool();
+    dhcp_log_stop();
+    dhcp_batch_free(&rx);
+    free_ip_range(&global_ip_range);
+    close(server_fd);
+    close(client_fd);
+    return counted;
+}
+
+int main(int argc, char* argv[]) {
+    // Resultados por el stdout real; el log del servidor se descarta
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(out, NULL, _IOLBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+
+    server_ip = ntohl(inet_addr("127.0.0.1"));
+    subnet_mask = inet_addr("255.0.0.0");
+    gateway_ip = inet_addr("127.0.0.1");
+    dns_server_ip = inet_addr("127.0.0.1");
+    default_lease_time = 3600;
+
+    uint32_t clients = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 2000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+    offered = (uint32_t*)calloc(clients, sizeof(uint32_t));
+
+    fprintf(out, "Reservas de memoria después del calentamiento (%u clientes, %d rondas de DISCOVER/REQUEST/RENEW/RELEASE):\n",
+            clients, rounds);
+    unsigned long total = measure_level(clients, rounds, DHCP_LOG_INFO, "INFO");
+    total += measure_level(clients, rounds, DHCP_LOG_DEBUG, "DEBUG");
+
+    free(offered);
+    return total == 0 ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+// Benchmark de recepción y envío en lotes (recvmmsg/sendmmsg)
+//
+// Un socket generador envía DISCOVERs de MACs distintas al socket del servidor por
+// loopback; el servidor los recibe con receive_dhcp_packets directo en el anillo de
+// paquetes, reparte los descriptores al pool de workers y éstos responden con OFFERs en
+// lotes. Se repite con varios tamaños de lote y se reportan paquetes/s, CPU por paquete,
+// syscalls por paquete recibido y enviado y copias por paquete recibido (deben ser 0).
+// Uso: ./bench_batch_io [paquetes] [lotes...]   (por defecto 200000 paquetes, lotes 1 8 32 64)
+// Retorna 1 si algún paquete recibido se copió antes de procesarse.
+
+#include "dhcp_server.h"
+#include <sys/resource.h>
+
+#define CHUNK 128  // Paquetes que el generador envía antes de que el servidor los lea
+
+static FILE* out;  // Salida de resultados (stdout real, el servidor escribe en /dev/null)
+static int copied = 0;  // Alguna ronda copió paquetes recibidos
+
+static double cpu_seconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static double wall_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t build_discover(struct dhcp_packet* packet, uint32_t index) {
+    memset(packet, 0, sizeof(*packet));
+    packet->op = 1;
+    packet->htype = 1;
+    packet->hlen = 6;
+    packet->xid = htonl(0x2000 + index);
+    packet->chaddr[0] = 0x02;
+    packet->chaddr[2] = (index >> 24) & 0xff;
+    packet->chaddr[3] = (index >> 16) & 0xff;
+    packet->chaddr[4] = (index >> 8) & 0xff;
+    packet->chaddr[5] = index & 0xff;
+    packet->options[0] = 53;
+    packet->options[1] = 1;
+    packet->options[2] = DHCP_DISCOVER;
+    packet->options[3] = 255;
+    return sizeof(*packet) - sizeof(packet->options) + 4;
+}
+
+static int bind_loopback(struct sockaddr_in* addr) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    socklen_t len = sizeof(*addr);
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (struct sockaddr*)addr, sizeof(*addr));
+    getsockname(fd, (struct sockaddr*)addr, &len);
+    int rcvbuf = 4 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    return fd;
+}
+
+static void run(uint32_t packets, int batch_size, int round) {
+    struct sockaddr_in server_addr, client_addr;
+    int server_fd = bind_loopback(&server_addr);
+    int client_fd = bind_loopback(&client_addr);
+
+    // Pool nuevo por ronda, con espacio para todas las MACs
+    uint32_t start_ip = (uint32_t)(10 + round) << 24;
+    init_ip_range(&global_ip_range, start_ip, start_ip + packets + 1, round);
+    split_ip_pool(&global_ip_range, 1);
+
+    io_batch_size = batch_size;
+    memset(&io_stats, 0, sizeof(io_stats));
+    start_worker_pool(server_fd, 0);
+
+    dhcp_msg_batch_t rx;
+    dhcp_batch_init(&rx, batch_size);
+
+    // Lote del generador, fuera de los contadores del servidor
+    struct dhcp_packet requests[CHUNK];
+    struct iovec iov[CHUNK];
+    struct mmsghdr msgs[CHUNK];
+
+    double cpu_start = cpu_seconds();
+    double wall_start = wall_seconds();
+    for (uint32_t sent = 0; sent < packets; ) {
+        int chunk = packets - sent < CHUNK ? (int)(packets - sent) : CHUNK;
+        for (int i = 0; i < chunk; i++) {
+            iov[i].iov_base = &requests[i];
+            iov[i].iov_len = build_discover(&requests[i], sent + i);
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = &server_addr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(server_addr);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int queued = sendmmsg(client_fd, msgs, chunk, 0);
+        sent += queued > 0 ? queued : chunk;
+
+        // El servidor vacía el socket en lotes y los workers responden
+        while (receive_dhcp_packets(server_fd, &rx, MSG_DONTWAIT) > 0) {
+        }
+        drain_worker_pool();
+    }
+    double cpu = cpu_seconds() - cpu_start;
+    double wall = wall_seconds() - wall_start;
+
+    fprintf(out, "lote %4d: %7lu recibidos, %8.0f paquetes/s, CPU %.2f us/paquete, "
+                 "recepción %.3f syscalls/paquete, envío %.3f syscalls/paquete (%lu respuestas), "
+                 "%.3f copias/paquete\n",
+            batch_size, io_stats.rx_packets, io_stats.rx_packets / wall,
+            io_stats.rx_packets ? cpu * 1e6 / io_stats.rx_packets : 0.0,
+            io_stats.rx_packets ? (double)io_stats.rx_syscalls / io_stats.rx_packets : 0.0,
+            io_stats.tx_packets ? (double)io_stats.tx_syscalls / io_stats.tx_packets : 0.0,
+            io_stats.tx_packets, io_stats.rx_packets ? (double)io_stats.rx_copies / io_stats.rx_packets : 0.0);
+    copied |= io_stats.rx_copies > 0;
+
+    stop_worker_pool();
+    dhcp_batch_free(&rx);
+    free_ip_range(&global_ip_range);
+    close(server_fd);
+    close(client_fd);
+}
+
+int main(int argc, char* argv[]) {
+    // Resultados por el stdout real; los logs del servidor se descartan
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(out, NULL, _IOLBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+
+    server_ip = ntohl(inet_addr("127.0.0.1"));
+    subnet_mask = inet_addr("255.0.0.0");
+    gateway_ip = inet_addr("127.0.0.1");
+    dns_server_ip = inet_addr("127.0.0.1");
+    default_lease_time = 3600;
+
+    uint32_t packets = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 200000;
+    int defaults[] = {1, 8, 32, 64};
+    int rounds = argc > 2 ? argc - 2 : 4;
+    for (int r = 0; r < rounds; r++) {
+        run(packets, argc > 2 ? atoi(argv[r + 2]) : defaults[r], r);
+    }
+    return copied ? 1 : 0;
+}
@@ -0,0 +1,302 @@
+// Benchmark de la cuarentena de direcciones rechazadas (DHCP_DECLINE_QUARANTINE_S)
+//
+// 1. Repetición de conflictos: en un pool de 1024 direcciones, 64 las usan equipos con IP fija
+//    (una de cada 16). Llegan clientes que hacen DORA y comprueban la IP recibida: si está en
+//    conflicto envían DECLINE y vuelven a empezar, hasta 8 intentos. Para que el pool rote, los
+//    clientes liberan su IP cuando hay más de 768 activos. Se cuentan los intercambios DORA
+//    perdidos en un DECLINE y los clientes que se quedan sin IP, con las tres políticas de
+//    asignación, sin cuarentena (DHCP_DECLINE_QUARANTINE_S=0) y con ella.
+// 2. Ciclo de una cuarentena: DECLINE de una IP ofrecida (como lo hace dhcp_client) y de una IP
+//    con lease, REQUEST de una IP en cuarentena, fin de la cuarentena y otro DECLINE que la
+//    extiende.
+// Uso: ./bench_decline_quarantine [clientes]   (por defecto 4000)
+// Retorna 1 si alguna verificación falla.
+
+#include "dhcp_server.h"
+
+#define REPLAY_POOL 1024
+#define CONFLICT_STRIDE 16        // Una dirección en conflicto de cada 16
+#define CONFLICT_OFFSET 5
+#define ACTIVE_LIMIT 768          // Clientes activos antes de empezar a liberar
+#define MAX_ATTEMPTS 8            // DORA por cliente antes de rendirse
+
+static FILE* out;  // Salida de resultados (stdout real, el servidor escribe en /dev/null)
+
+static void make_mac(uint8_t* mac, uint32_t index) {
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = (index >> 24) & 0xff;
+    mac[3] = (index >> 16) & 0xff;
+    mac[4] = (index >> 8) & 0xff;
+    mac[5] = index & 0xff;
+}
+
+static void configure_server() {
+    server_ip = ntohl(inet_addr("127.0.0.1"));
+    subnet_mask = inet_addr("255.0.0.0");
+    gateway_ip = inet_addr("127.0.0.1");
+    dns_server_ip = inet_addr("127.0.0.1");
+    default_lease_time = 3600;
+}
+
+//================================================
+// Clientes contra los handlers (sin workers)
+
+typedef struct {
+    int sockfd;
+    struct sockaddr_in sink;   // Las respuestas van a un socket que nadie lee
+    uint32_t xid;
+} client_ctx_t;
+
+static size_t build_packet(struct dhcp_packet* packet, const uint8_t* mac, uint32_t xid, int type, uint32_t ip) {
+    memset(packet, 0, sizeof(*packet));
+    packet->op = 1;
+    packet->htype = 1;
+    packet->hlen = 6;
+    packet->xid = htonl(xid);
+    memcpy(packet->chaddr, mac, 6);
+    uint8_t* options = packet->options;
+    int length = 0;
+    options[length++] = 53;
+    options[length++] = 1;
+    options[length++] = (uint8_t)type;
+    if (type == DHCP_RELEASE) {
+        packet->ciaddr = htonl(ip);
+    } else if (type == DHCP_DECLINE) {
+        packet->yiaddr = htonl(ip);  // Como dhcp_client: la IP rechazada va en yiaddr
+    } else if (ip) {
+        uint32_t requested = htonl(ip);
+        options[length++] = 50;
+        options[length++] = 4;
+        memcpy(&options[length], &requested, 4);
+        length += 4;
+    }
+    options[length++] = 255;
+    return offsetof(struct dhcp_packet, options) + length;
+}
+
+// Retorna la IP ofrecida (0 con NAK)
+static uint32_t discover(client_ctx_t* ctx, const uint8_t* mac) {
+    struct dhcp_packet packet;
+    dhcp_option_index_t options;
+    size_t length = build_packet(&packet, mac, ++ctx->xid, DHCP_DISCOVER, 0);
+    validate_dhcp_packet(&packet, length, &options);
+    return handle_dhcp_discover(ctx->sockfd, &ctx->sink, &packet, &options);
+}
+
+// Retorna 1 con ACK
+static int request(client_ctx_t* ctx, const uint8_t* mac, uint32_t ip) {
+    struct dhcp_packet packet;
+    dhcp_option_index_t options;
+    size_t length = build_packet(&packet, mac, ctx->xid, DHCP_REQUEST, ip);
+    validate_dhcp_packet(&packet, length, &options);
+    return handle_dhcp_request(ctx->sockfd, &ctx->sink, &packet, &options);
+}
+
+static void decline(client_ctx_t* ctx, const uint8_t* mac, uint32_t ip) {
+    struct dhcp_packet packet;
+    dhcp_option_index_t options;
+    size_t length = build_packet(&packet, mac, ++ctx->xid, DHCP_DECLINE, ip);
+    validate_dhcp_packet(&packet, length, &options);
+    handle_dhcp_decline(ctx->sockfd, &ctx->sink, &packet);
+}
+
+static void release(client_ctx_t* ctx, const uint8_t* mac, uint32_t ip) {
+    struct dhcp_packet packet;
+    dhcp_option_index_t options;
+    size_t length = build_packet(&packet, mac, ++ctx->xid, DHCP_RELEASE, ip);
+    validate_dhcp_packet(&packet, length, &options);
+    handle_dhcp_release(ctx->sockfd, &ctx->sink, &packet);
+}
+
+static void open_client(client_ctx_t* ctx) {
+    socklen_t sink_length = sizeof(ctx->sink);
+    int sink_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(&ctx->sink, 0, sizeof(ctx->sink));
+    ctx->sink.sin_family = AF_INET;
+    ctx->sink.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(sink_fd, (struct sockaddr*)&ctx->sink, sizeof(ctx->sink));
+    getsockname(sink_fd, (struct sockaddr*)&ctx->sink, &sink_length);
+    ctx->sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    ctx->xid = (uint32_t)sink_fd << 20;
+}
+
+static void start_pool(uint32_t first_ip, uint32_t size, ip_alloc_policy_t policy) {
+    init_ip_range(&global_ip_range, first_ip, first_ip + size - 1, 1);
+    split_ip_pool(&global_ip_range, 1);
+    ip_shards[0].policy = policy;
+    ip_shards[0].hash_key = parse_hash_key("bench");
+}
+
+//================================================
+// Repetición de conflictos
+
+typedef struct {
+    uint32_t dora;          // Intercambios DORA completos
+    uint32_t declined;      // Intercambios perdidos en un DECLINE
+    uint32_t gave_up;       // Clientes sin IP tras MAX_ATTEMPTS
+    uint32_t quarantined;   // Direcciones en cuarentena al terminar
+} replay_result_t;
+
+static int in_conflict(uint32_t ip, uint32_t first_ip) {
+    return (ip - first_ip) % CONFLICT_STRIDE == CONFLICT_OFFSET;
+}
+
+static void run_replay(client_ctx_t* ctx, ip_alloc_policy_t policy, uint32_t quarantine_s, uint32_t clients,
+                       replay_result_t* result) {
+    const uint32_t first_ip = 15u << 24;
+    decline_quarantine_s = quarantine_s;
+    start_pool(first_ip, REPLAY_POOL, policy);
+    memset(result, 0, sizeof(*result));
+
+    // Clientes activos en orden de llegada (el más antiguo libera primero)
+    uint32_t active_mac[ACTIVE_LIMIT + 1];
+    uint32_t active_ip[ACTIVE_LIMIT + 1];
+    uint32_t head = 0, count = 0;
+    uint8_t mac[6];
+    for (uint32_t client = 0; client < clients; client++) {
+        make_mac(mac, client);
+        int bound = 0;
+        for (int attempt = 0; attempt < MAX_ATTEMPTS && !bound; attempt++) {
+            uint32_t offered = discover(ctx, mac);
+            if (offered == 0 || !request(ctx, mac, offered)) {
+                continue;
+            }
+            result->dora++;
+            // El cliente prueba la IP con ARP: si otro equipo responde, la rechaza
+            if (in_conflict(offered, first_ip)) {
+                decline(ctx, mac, offered);
+                result->declined++;
+                continue;
+            }
+            bound = 1;
+            uint32_t slot = (head + count) % (ACTIVE_LIMIT + 1);
+            active_mac[slot] = client;
+            active_ip[slot] = offered;
+            count++;
+        }
+        result->gave_up += !bound;
+
+        if (count > ACTIVE_LIMIT) {
+            make_mac(mac, active_mac[head]);
+            release(ctx, mac, active_ip[head]);
+            head = (head + 1) % (ACTIVE_LIMIT + 1);
+            count--;
+        }
+    }
+    result->quarantined = ip_shards[0].quarantined_count;
+    free_ip_range(&ip_shards[0]);
+}
+
+static int check_replay(uint32_t clients) {
+    int failed = 0;
+    client_ctx_t ctx;
+    open_client(&ctx);
+    uint32_t conflicts = REPLAY_POOL / CONFLICT_STRIDE;
+    fprintf(out, "Repetición de conflictos: pool de %u con %u IPs en uso por otros equipos, %u clientes "
+                 "(hasta %d intentos), %u activos como máximo\n", REPLAY_POOL, conflicts, clients, MAX_ATTEMPTS, ACTIVE_LIMIT);
+    fprintf(out, "  %-13s %-15s %10s %12s %14s %14s\n", "política", "cuarentena", "DORA", "con DECLINE",
+            "DORA/cliente", "sin IP");
+
+    const ip_alloc_policy_t policies[] = { IP_ALLOC_LOWEST, IP_ALLOC_ROUND_ROBIN, IP_ALLOC_HASH };
+    const char* policy_names[] = { "lowest", "round_robin", "hash" };
+    for (int p = 0; p < 3; p++) {
+        replay_result_t without, with;
+        run_replay(&ctx, policies[p], 0, clients, &without);
+        run_replay(&ctx, policies[p], DECLINE_QUARANTINE_DEFAULT_S, clients, &with);
+        const replay_result_t* results[] = { &without, &with };
+        for (int q = 0; q < 2; q++) {
+            char name[24];
+            snprintf(name, sizeof(name), q ? "%u s" : "no", DECLINE_QUARANTINE_DEFAULT_S);
+            fprintf(out, "  %-12s %-15s %10u %12u %14.3f %14u\n", policy_names[p], name, results[q]->dora,
+                    results[q]->declined, (double)results[q]->dora / clients, results[q]->gave_up);
+        }
+
+        // Con cuarentena cada IP en conflicto se rechaza una vez y ningún cliente se queda sin IP
+        if (with.declined > conflicts || with.gave_up != 0 || with.quarantined != with.declined ||
+            with.declined >= without.declined) {
+            fprintf(out, "FALLO: con cuarentena y política %s cada conflicto debe costar un solo DECLINE\n",
+                    policy_names[p]);
+            failed = 1;
+        }
+    }
+    decline_quarantine_s = DECLINE_QUARANTINE_DEFAULT_S;
+    return failed;
+}
+
+//================================================
+// Ciclo de una cuarentena
+
+static int expect(int condition, const char* what) {
+    fprintf(out, "  %-62s %s\n", what, condition ? "sí" : "NO");
+    return !condition;
+}
+
+static int check_cycle() {
+    int failed = 0;
+    client_ctx_t ctx;
+    open_client(&ctx);
+    decline_quarantine_s = 1;
+    start_pool(16u << 24, 64, IP_ALLOC_LOWEST);
+    ip_range_t* range = &ip_shards[0];
+    uint8_t first[6], second[6], third[6];
+    make_mac(first, 1);
+    make_mac(second, 2);
+    make_mac(third, 3);
+    fprintf(out, "Ciclo de una cuarentena (pool de 64, política lowest, cuarentena de %u s):\n", decline_quarantine_s);
+
+    // dhcp_client rechaza la IP ofrecida antes del REQUEST
+    uint32_t offered = discover(&ctx, first);
+    decline(&ctx, first, offered);
+    uint32_t next = discover(&ctx, first);
+    failed |= expect(range->offers.live == 1 && range->quarantined_count == 1 && next != offered,
+                     "DECLINE de una IP ofrecida: cuarentena y otra oferta");
+
+    failed |= expect(request(&ctx, first, next), "REQUEST de la nueva oferta: ACK");
+    decline(&ctx, first, next);
+    failed |= expect(range->leases.count == 0 && range->quarantined_count == 2 &&
+                     range->free_map.free_count == 62, "DECLINE de una IP con lease: cuarentena");
+
+    uint32_t other = discover(&ctx, second);
+    failed |= expect(other != offered && other != next && request(&ctx, second, other),
+                     "Otra MAC (política lowest): no recibe las IPs rechazadas");
+    failed |= expect(!request(&ctx, third, offered) && range->leases.count == 1,
+                     "REQUEST de una IP en cuarentena: NAK");
+
+    // A la mitad de la cuarentena de `next`, otro DECLINE la extiende
+    struct timespec half = { .tv_sec = 0, .tv_nsec = 600000000L };
+    nanosleep(&half, NULL);
+    decline(&ctx, third, next);
+    nanosleep(&half, NULL);
+    check_expired_leases(range);
+    failed |= expect(range->quarantined_count == 1 && !address_quarantined(range, offered - range->start_ip) &&
+                     address_quarantined(range, next - range->start_ip),
+                     "Fin de la cuarentena; otro DECLINE la extiende");
+    failed |= expect(discover(&ctx, third) == offered, "La IP liberada de la cuarentena se vuelve a ofrecer");
+
+    nanosleep(&half, NULL);
+    check_expired_leases(range);
+    failed |= expect(range->quarantined_count == 0 && range->free_map.free_count == 62,
+                     "Fin de la cuarentena extendida");
+
+    free_ip_range(range);
+    decline_quarantine_s = DECLINE_QUARANTINE_DEFAULT_S;
+    return failed;
+}
+
+int main(int argc, char* argv[]) {
+    configure_server();
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(out, NULL, _IOLBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+
+    uint32_t clients = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 4000;
+    if (clients < REPLAY_POOL) clients = REPLAY_POOL;
+
+    int failed = check_replay(clients);
+    failed |= check_cycle();
+    fprintf(out, "%s\n", failed ? "FALLO" : "OK");
+    return failed;
+}
@@ -0,0 +1,142 @@
+// Benchmark de la codificación de opciones de OFFER y ACK
+//
+// Compara la construcción original del bloque de opciones (memset de 312 bytes, strlen
+// de cadenas constantes e inet_addr por paquete) con las plantillas precompiladas de
+// dhcp_options.c: sin opción 55, con la lista del cliente del repositorio, rotando
+// entre varias listas distintas (aciertos de la caché) y con listas siempre nuevas.
+// Uso: ./bench_dhcp_options [iteraciones]   (por defecto 10000000)
+
+#include "dhcp_options.h"
+#include <arpa/inet.h>  // Para htonl, inet_addr
+#include <stdio.h>      // Para printf
+#include <stdlib.h>     // Para strtoul
+#include <string.h>     // Para memset, memcpy, strlen
+#include <time.h>       // Para clock_gettime
+
+#define LIST_VARIANTS 16  // Listas distintas en la prueba de aciertos de caché
+
+static const uint32_t server_ip = 0x7f000001;
+static const uint32_t subnet_mask = 0x00ffffff;
+static const uint32_t gateway_ip = 0x0100007f;
+static const uint32_t dns_server_ip = 0x0100007f;
+static const int lease_time = 3600;
+
+static double monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Copia de la función original send_dhcp_options (referencia)
+static size_t legacy_options(uint8_t* options, int message_type, uint32_t assigned_ip) {
+    memset(options, 0, DHCP_OPTIONS_SIZE);
+    options[0] = 53; options[1] = 1; options[2] = message_type;
+    options[3] = 54; options[4] = 4;
+    uint32_t net_server_ip = htonl(server_ip);
+    memcpy(&options[5], &net_server_ip, 4);
+    options[9] = 51; options[10] = 4;
+    uint32_t net_lease_time = htonl(lease_time);
+    memcpy(&options[11], &net_lease_time, 4);
+    options[15] = 1; options[16] = 4;
+    uint32_t net_subnet_mask = htonl(subnet_mask);
+    memcpy(&options[17], &net_subnet_mask, 4);
+    options[21] = 3; options[22] = 4;
+    uint32_t net_gateway_ip = htonl(gateway_ip);
+    memcpy(&options[23], &net_gateway_ip, 4);
+    options[27] = 6; options[28] = 4;
+    uint32_t net_dns_server_ip = htonl(dns_server_ip);
+    memcpy(&options[29], &net_dns_server_ip, 4);
+    const char* hostname = "DHCPClient";
+    options[33] = 12; options[34] = strlen(hostname);
+    memcpy(&options[35], hostname, strlen(hostname));
+    const char* domain_name = "example.com";
+    options[35 + strlen(hostname)] = 15;
+    options[36 + strlen(hostname)] = strlen(domain_name);
+    memcpy(&options[37 + strlen(hostname)], domain_name, strlen(domain_name));
+    uint8_t parameter_request_list[] = {1, 3, 6, 12, 15, 28, 42, 51, 54, 119};
+    int param_request_offset = 37 + strlen(hostname) + strlen(domain_name);
+    options[param_request_offset] = 55;
+    options[param_request_offset + 1] = sizeof(parameter_request_list);
+    memcpy(&options[param_request_offset + 2], parameter_request_list, sizeof(parameter_request_list));
+    uint32_t broadcast_addr = htonl((assigned_ip & subnet_mask) | ~subnet_mask);
+    int broadcast_offset = param_request_offset + 2 + sizeof(parameter_request_list);
+    options[broadcast_offset] = 28; options[broadcast_offset + 1] = 4;
+    memcpy(&options[broadcast_offset + 2], &broadcast_addr, 4);
+    uint32_t ntp_server = inet_addr("192.168.1.2");
+    options[broadcast_offset + 6] = 42; options[broadcast_offset + 7] = 4;
+    memcpy(&options[broadcast_offset + 8], &ntp_server, 4);
+    options[broadcast_offset + 12] = 255;
+    return DHCP_OPTIONS_SIZE;  // El original siempre enviaba el campo completo
+}
+
+static volatile uint8_t sink;  // Evita que el compilador descarte la codificación
+
+static void report(const char* name, double elapsed_ns, unsigned long iterations, size_t length) {
+    printf("%-28s %6.1f ns/respuesta, %3zu bytes de opciones\n", name, elapsed_ns / iterations, length);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : 10000000;
+    uint8_t out[DHCP_OPTIONS_SIZE];
+    size_t length = 0;
+
+    dhcp_options_config_t config = {
+        .server_ip = server_ip, .subnet_mask = subnet_mask, .gateway_ip = gateway_ip,
+        .dns_server_ip = dns_server_ip, .ntp_server_ip = inet_addr("192.168.1.2"),
+        .hostname = "DHCPClient", .domain_name = "example.com",
+    };
+    dhcp_options_compile(&config);
+
+    // Referencia: construcción original
+    double start = monotonic_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        length = legacy_options(out, 2 + (i & 1) * 3, 0x0a000000 + (uint32_t)i);
+        sink = out[length - 1];
+    }
+    report("original", monotonic_ns() - start, iterations, length);
+
+    // Plantilla sin opción 55 (todas las opciones)
+    start = monotonic_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        length = dhcp_options_encode(out, NULL, 0, 2 + (i & 1) * 3, 0x0a000000 + (uint32_t)i, lease_time);
+        sink = out[length - 1];
+    }
+    report("plantilla sin opción 55", monotonic_ns() - start, iterations, length);
+
+    // Lista que envía el cliente del repositorio (1, 3, 6)
+    const uint8_t client_list[] = {1, 3, 6};
+    start = monotonic_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        length = dhcp_options_encode(out, client_list, sizeof(client_list), 2 + (i & 1) * 3,
+                                     0x0a000000 + (uint32_t)i, lease_time);
+        sink = out[length - 1];
+    }
+    report("opción 55 = 1,3,6", monotonic_ns() - start, iterations, length);
+
+    // Varias listas distintas rotando (todas quedan en la caché del hilo)
+    uint8_t lists[LIST_VARIANTS][11];
+    for (int v = 0; v < LIST_VARIANTS; v++) {
+        const uint8_t list[] = {1, 3, 6, 15, 28, 42, 12, 119, 121, 252};
+        memcpy(lists[v], list, sizeof(list));
+        lists[v][10] = (uint8_t)(200 + v);  // Un código desconocido distinto por variante
+    }
+    start = monotonic_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        length = dhcp_options_encode(out, lists[i % LIST_VARIANTS], 11, 5, 0x0a000000 + (uint32_t)i, lease_time);
+        sink = out[length - 1];
+    }
+    report("16 listas rotando", monotonic_ns() - start, iterations, length);
+
+    // Listas siempre nuevas: mide armar la plantilla (fallo de caché)
+    unsigned long misses = iterations / 10;
+    uint8_t list[4] = {1, 3, 6, 0};
+    start = monotonic_ns();
+    for (unsigned long i = 0; i < misses; i++) {
+        list[3] = (uint8_t)(64 + (i % 128));
+        list[0] = (uint8_t)(i / 128);
+        length = dhcp_options_encode(out, list, sizeof(list), 2, 0x0a000000 + (uint32_t)i, lease_time);
+        sink = out[length - 1];
+    }
+    report("lista nueva en cada paquete", monotonic_ns() - start, misses, length);
+    return 0;
+}
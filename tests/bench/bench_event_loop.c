@@ -0,0 +1,125 @@
+// Benchmark del bucle de eventos (epoll + timerfd + signalfd + eventfd)
+//
+// Arranca el pool de workers y el bucle de eventos sobre un socket de loopback y mide:
+// el CPU que consume el servidor sin tráfico y la precisión del timerfd, como el retraso
+// entre el vencimiento teórico de cada lease y el momento en que su IP vuelve a estar libre.
+// Uso: ./bench_event_loop [leases] [segundos_inactivo]   (por defecto 50 leases y 2 s)
+
+#include "dhcp_server.h"
+#include <sys/resource.h>
+
+static FILE* out;  // Salida de resultados (stdout real, el servidor escribe en /dev/null)
+
+static double cpu_seconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static double monotonic_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static void sleep_ms(double ms) {
+    struct timespec delay = { .tv_sec = (time_t)(ms / 1000), .tv_nsec = (long)((ms - (long)(ms / 1000) * 1000) * 1e6) };
+    nanosleep(&delay, NULL);
+}
+
+static void* event_loop_thread(void* arg) {
+    handle_dhcp_protocol(*(int*)arg);
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    // Resultados por el stdout real; los logs del servidor se descartan
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(out, NULL, _IOLBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+
+    uint32_t leases = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 50;
+    double idle_seconds = argc > 2 ? atof(argv[2]) : 2.0;
+
+    server_ip = ntohl(inet_addr("127.0.0.1"));
+    subnet_mask = inet_addr("255.0.0.0");
+    gateway_ip = inet_addr("127.0.0.1");
+    dns_server_ip = inet_addr("127.0.0.1");
+
+    uint32_t start_ip = 10u << 24;
+    init_ip_range(&global_ip_range, start_ip, start_ip + leases + 1, 1);
+    split_ip_pool(&global_ip_range, 1);
+
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(sockfd, (struct sockaddr*)&addr, sizeof(addr));
+
+    // Igual que main.c: las señales se bloquean antes de crear cualquier hilo
+    block_server_signals();
+    start_worker_pool(sockfd, 0);
+    pthread_t loop;
+    pthread_create(&loop, NULL, event_loop_thread, &sockfd);
+    sleep_ms(100);
+
+    // CPU sin tráfico: workers y bucle deben estar dormidos
+    double cpu_start = cpu_seconds();
+    sleep_ms(idle_seconds * 1000);
+    double idle_cpu = cpu_seconds() - cpu_start;
+    fprintf(out, "Inactivo %.1f s: CPU %.3f ms (%.4f%% de un núcleo)\n",
+            idle_seconds, idle_cpu * 1e3, 100.0 * idle_cpu / idle_seconds);
+
+    // Leases de 1 s creados en momentos escalonados (no alineados al segundo)
+    double* expected = (double*)calloc(leases, sizeof(double));
+    double* lateness = (double*)calloc(leases, sizeof(double));
+    uint8_t* freed = (uint8_t*)calloc(leases, 1);
+    ip_range_t* shard = &ip_shards[0];
+    for (uint32_t i = 0; i < leases; i++) {
+        uint8_t mac[6] = {0x02, 0, 0, 0, (i >> 8) & 0xff, i & 0xff};
+        dhcp_mutex_lock(&shard->lock);
+        expected[i] = monotonic_ms() + 1000;
+        insert_ip_assignment(shard, start_ip + i, mac, 1);
+        dhcp_mutex_unlock(&shard->lock);
+        sleep_ms(7.3);
+    }
+
+    // Observar cada 0.1 ms cuándo vuelve a quedar libre cada IP
+    uint32_t pending = leases;
+    while (pending > 0) {
+        double now = monotonic_ms();
+        dhcp_mutex_lock(&shard->lock);
+        for (uint32_t i = 0; i < leases; i++) {
+            if (!freed[i] && find_ip_assignment(shard, start_ip + i) == NULL) {
+                lateness[i] = now - expected[i];
+                freed[i] = 1;
+                pending--;
+            }
+        }
+        dhcp_mutex_unlock(&shard->lock);
+        sleep_ms(0.1);
+    }
+
+    double sum = 0, worst = -1e9, best = 1e9;
+    for (uint32_t i = 0; i < leases; i++) {
+        sum += lateness[i];
+        if (lateness[i] > worst) worst = lateness[i];
+        if (lateness[i] < best) best = lateness[i];
+    }
+    fprintf(out, "%u leases de 1 s: retraso del vencimiento promedio %.2f ms, mínimo %.2f ms, máximo %.2f ms\n",
+            leases, sum / leases, best, worst);
+
+    event_loop_wakeup(DHCP_WAKE_STOP);
+    pthread_join(loop, NULL);
+    stop_worker_pool();
+    free_ip_range(&global_ip_range);
+    free(expected);
+    free(lateness);
+    free(freed);
+    close(sockfd);
+    return 0;
+}
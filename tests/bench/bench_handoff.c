@@ -0,0 +1,244 @@
+// Benchmark del relevo sin cortes: un proceso nuevo toma el puerto 67 y los leases en plena carga
+//
+// Levanta el servidor real (init_dhcp_server, como main) en un proceso hijo con
+// DHCP_HANDOFF_SOCKET y un generador le envía por loopback ventanas de DISCOVER y REQUEST sin
+// retransmitir. A mitad de la carga arranca un segundo servidor con la misma configuración,
+// que pide el relevo al primero. Una solicitud sin respuesta cuenta como perdida. Al final
+// los REQUEST de renovación de las IPs que entregó el primer servidor deben recibir ACK
+// del segundo (los leases pasaron intactos).
+// Uso: ./bench_handoff [macs] [modos...]   (por defecto al menos 20000 MACs, modos workers y reuseport)
+// Necesita permisos para el puerto 67. Con DHCP_LEASE_DIR el journal también pasa de un proceso al otro.
+
+#include "dhcp_server.h"
+#include <sys/wait.h>
+
+#define WINDOW 64          // Solicitudes en vuelo del generador
+#define REPLY_TIMEOUT_MS 3000  // Sin respuesta en este tiempo la solicitud se da por perdida
+
+static FILE* out;  // Salida de resultados (stdout real, los servidores escriben en /dev/null)
+
+static double wall_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void make_mac(uint8_t* mac, uint32_t index) {
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = (index >> 24) & 0xff;
+    mac[3] = (index >> 16) & 0xff;
+    mac[4] = (index >> 8) & 0xff;
+    mac[5] = index & 0xff;
+}
+
+static uint32_t mac_index(const uint8_t* mac) {
+    return (uint32_t)mac[2] << 24 | (uint32_t)mac[3] << 16 | (uint32_t)mac[4] << 8 | mac[5];
+}
+
+static size_t build_packet(struct dhcp_packet* packet, uint32_t index, uint8_t type, uint32_t requested_ip) {
+    memset(packet, 0, sizeof(*packet));
+    packet->op = 1;
+    packet->htype = 1;
+    packet->hlen = 6;
+    packet->xid = htonl(0x5000 + index);
+    make_mac(packet->chaddr, index);
+
+    int i = 0;
+    packet->options[i++] = 53;
+    packet->options[i++] = 1;
+    packet->options[i++] = type;
+    if (requested_ip) {
+        uint32_t net_ip = htonl(requested_ip);
+        packet->options[i++] = 50;
+        packet->options[i++] = 4;
+        memcpy(&packet->options[i], &net_ip, 4);
+        i += 4;
+    }
+    packet->options[i++] = 255;
+    return sizeof(*packet) - sizeof(packet->options) + i;
+}
+
+// Proceso servidor: lo mismo que main con la configuración del entorno
+static pid_t spawn_server() {
+    pid_t pid = fork();
+    if (pid != 0) {
+        return pid;
+    }
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) {
+        _exit(1);
+    }
+    block_server_signals();
+    lease_store_shareable = 1;
+    ip_range_t range;
+    initialize_ip_pool(&range, getenv("START_IP"), getenv("END_IP"), 1);
+    init_dhcp_server(&range);
+    _exit(0);
+}
+
+// Esperar a que el servidor responda (el primero arranca sin relevo)
+static int wait_for_socket(const char* path, double seconds) {
+    double deadline = wall_seconds() + seconds;
+    while (access(path, F_OK) != 0) {
+        if (wall_seconds() > deadline) return -1;
+        usleep(10000);
+    }
+    return 0;
+}
+
+// Enviar una ventana de solicitudes y contar las respuestas del tipo esperado.
+// `worst` acumula la mayor espera por una respuesta.
+static uint32_t exchange(int fd, struct sockaddr_in* server, uint32_t first, int count, uint8_t type,
+                         uint32_t* offered, uint8_t expected, dhcp_msg_batch_t* rx, double* worst) {
+    struct dhcp_packet requests[WINDOW];
+    struct iovec iov[WINDOW];
+    struct mmsghdr msgs[WINDOW];
+
+    for (int i = 0; i < count; i++) {
+        uint32_t index = first + i;
+        iov[i].iov_base = &requests[i];
+        iov[i].iov_len = build_packet(&requests[i], index, type, type == DHCP_REQUEST ? offered[index] : 0);
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_name = server;
+        msgs[i].msg_hdr.msg_namelen = sizeof(*server);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    double sent_at = wall_seconds();
+    for (int sent = 0; sent < count; ) {
+        int queued = sendmmsg(fd, msgs + sent, count - sent, 0);
+        sent += queued > 0 ? queued : count - sent;
+    }
+
+    // Leer hasta tener todas las respuestas o hasta que venza el timeout del socket
+    uint32_t answered = 0;
+    while (answered < (uint32_t)count) {
+        int received = receive_dhcp_batch(fd, rx, MSG_WAITFORONE);
+        if (received <= 0) break;
+        double waited = wall_seconds() - sent_at;
+        if (waited > *worst) *worst = waited;
+        for (int i = 0; i < received; i++) {
+            struct dhcp_packet* reply = (struct dhcp_packet*)rx->buffers[i];
+            dhcp_option_index_t options;
+            uint8_t message_type;
+            if (dhcp_parse_options(&options, rx->buffers[i], rx->msgs[i].msg_len) < 0 ||
+                reply->op != 2 || !dhcp_get_message_type(&options, &message_type) ||
+                message_type != expected) continue;
+            if (expected == DHCP_OFFER) offered[mac_index(reply->chaddr)] = ntohl(reply->yiaddr);
+            answered++;
+        }
+    }
+    return answered;
+}
+
+static int run(uint32_t macs, const char* mode) {
+    const char* path = getenv("DHCP_HANDOFF_SOCKET");
+    setenv("DHCP_IO_MODE", mode, 1);
+    unlink(path);
+
+    pid_t first_server = spawn_server();
+    if (wait_for_socket(path, 10) < 0) {
+        fprintf(out, "%s: el primer servidor no arrancó\n", mode);
+        kill(first_server, SIGKILL);
+        waitpid(first_server, NULL, 0);
+        return 1;
+    }
+
+    // Socket del generador por loopback
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    int rcvbuf = 4 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    struct timeval timeout = { .tv_sec = REPLY_TIMEOUT_MS / 1000, .tv_usec = (REPLY_TIMEOUT_MS % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    struct sockaddr_in server;
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_port = htons(DHCP_SERVER_PORT);
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // La carga sigue hasta que el primer servidor terminó (como mucho hasta agotar el pool)
+    uint32_t limit = ip_to_int(getenv("END_IP")) - ip_to_int(getenv("START_IP"));
+    uint32_t* offered = (uint32_t*)calloc(limit, sizeof(uint32_t));
+    dhcp_msg_batch_t rx;
+    dhcp_batch_init(&rx, WINDOW);
+
+    // El segundo servidor arranca con la carga en marcha, al pasar por el 25% de las MACs
+    uint32_t handoff_at = macs / 4;
+    pid_t second_server = -1;
+    int first_status = -1;
+    double handoff_started = 0, handoff_seconds = -1;
+    uint32_t offers = 0, acks = 0, before_handoff = 0;
+    double worst = 0;
+    double wall_start = wall_seconds();
+    uint32_t first;
+    for (first = 0; first < limit && (first < macs || first_status < 0); first += WINDOW) {
+        int count = limit - first < WINDOW ? (int)(limit - first) : WINDOW;
+        if (second_server < 0 && first >= handoff_at) {
+            before_handoff = first;
+            handoff_started = wall_seconds();
+            second_server = spawn_server();
+        }
+        offers += exchange(fd, &server, first, count, DHCP_DISCOVER, offered, DHCP_OFFER, &rx, &worst);
+        acks += exchange(fd, &server, first, count, DHCP_REQUEST, offered, DHCP_ACK, &rx, &worst);
+
+        // El primer servidor termina solo cuando el segundo tomó el servicio
+        if (second_server > 0 && first_status < 0 && waitpid(first_server, &first_status, WNOHANG) == first_server) {
+            handoff_seconds = wall_seconds() - handoff_started;
+        }
+    }
+    double wall = wall_seconds() - wall_start;
+    macs = first;
+    if (first_status < 0) {
+        kill(first_server, SIGKILL);
+        waitpid(first_server, &first_status, 0);
+    }
+
+    // Renovar las IPs que entregó el primer servidor: el segundo debe conocer cada lease
+    double renew_worst = 0;
+    uint32_t renewed = 0;
+    for (uint32_t first = 0; first < before_handoff; first += WINDOW) {
+        int count = before_handoff - first < WINDOW ? (int)(before_handoff - first) : WINDOW;
+        renewed += exchange(fd, &server, first, count, DHCP_REQUEST, offered, DHCP_ACK, &rx, &renew_worst);
+    }
+
+    int first_ok = WIFEXITED(first_status) && WEXITSTATUS(first_status) == 0;
+    uint32_t lost = 2 * macs - offers - acks;
+    fprintf(out, "%s: %u/%u OFFER, %u/%u ACK, %u solicitudes perdidas, %.0f DORA/s, "
+                 "espera máxima %.0f ms, relevo en %.0f ms (primer servidor %s), "
+                 "%u/%u renovaciones de leases del primero con ACK\n",
+            mode, offers, macs, acks, macs, lost, acks / wall, worst * 1000, handoff_seconds * 1000,
+            first_ok ? "terminó con 0" : "no terminó bien", renewed, before_handoff);
+
+    kill(second_server, SIGTERM);
+    waitpid(second_server, NULL, 0);
+    dhcp_batch_free(&rx);
+    free(offered);
+    close(fd);
+    return lost == 0 && first_ok && renewed == before_handoff ? 0 : 1;
+}
+
+int main(int argc, char* argv[]) {
+    // Resultados por el stdout real
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(out, NULL, _IOLBF, 0);
+
+    // Configuración de los dos servidores (la misma, como en una actualización)
+    setenv("START_IP", "10.1.0.1", 0);
+    setenv("END_IP", "10.1.255.254", 0);
+    setenv("SUBNET_MASK", "255.255.0.0", 0);
+    setenv("GATEWAY_IP", "127.0.0.1", 0);
+    setenv("DNS_SERVER_IP", "127.0.0.1", 0);
+    setenv("DHCP_SERVER_IP", "127.0.0.1", 0);
+    setenv("DHCP_LOG_LEVEL", "error", 0);
+    setenv("DHCP_HANDOFF_SOCKET", "/tmp/bench_handoff.sock", 0);
+
+    uint32_t macs = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 20000;
+    const char* defaults[] = {"workers", "reuseport"};
+    int rounds = argc > 2 ? argc - 2 : 2;
+    int failed = 0;
+    for (int r = 0; r < rounds; r++) {
+        failed |= run(macs, argc > 2 ? argv[r + 2] : defaults[r]);
+    }
+    unlink(getenv("DHCP_HANDOFF_SOCKET"));
+    return failed;
+}
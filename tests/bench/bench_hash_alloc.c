@@ -0,0 +1,248 @@
+// Benchmark de la política de asignación por hash (IP_ALLOC_POLICY=hash)
+//
+// 1. Costo y profundidad: un pool se llena con asignaciones hasta 10%, 25%, 50%, 75%, 90% y 95%.
+//    En cada nivel se mide el costo de assign_ip_address con las políticas round_robin, lowest
+//    y hash (un lote del 1% del pool), y para la política hash cuántas posiciones se prueban
+//    hasta encontrar una libre (promedio, p99 y cuántas terminan buscando en el bitmap).
+// 2. Estabilidad: la mitad del pool recibe direcciones, el almacén se pierde y los mismos
+//    clientes vuelven en orden inverso. Se cuenta cuántos reciben la misma IP que antes.
+// 3. Client-id: dos paquetes con el mismo client-id (opción 61) y distinta MAC tienen el mismo
+//    hash, y una clave distinta cambia la IP preferida.
+// Uso: ./bench_hash_alloc [direcciones]   (por defecto 262144)
+// Retorna 1 si alguna verificación falla.
+
+#include "dhcp_server.h"
+
+#define DEPTH_SAMPLES 20000
+#define MAX_DEPTH (HASH_ALLOC_PROBES + 1)
+
+static FILE* out;  // Salida de resultados (stdout real, el servidor escribe en /dev/null)
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void make_mac(uint8_t* mac, uint32_t index) {
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = (index >> 24) & 0xff;
+    mac[3] = (index >> 16) & 0xff;
+    mac[4] = (index >> 8) & 0xff;
+    mac[5] = index & 0xff;
+}
+
+static void configure_server() {
+    server_ip = ntohl(inet_addr("127.0.0.1"));
+    subnet_mask = inet_addr("255.0.0.0");
+    gateway_ip = inet_addr("127.0.0.1");
+    dns_server_ip = inet_addr("127.0.0.1");
+    default_lease_time = 3600;
+}
+
+static void init_pool(ip_range_t* range, uint32_t size, ip_alloc_policy_t policy) {
+    init_ip_range(range, 10u << 24, (10u << 24) + size - 1, 1);
+    range->policy = policy;
+    range->hash_key = parse_hash_key("bench");
+}
+
+// Asignar direcciones a las MACs [first, first + count); retorna cuántas se asignaron
+static uint32_t fill(ip_range_t* range, uint32_t first, uint32_t count) {
+    struct dhcp_packet request;
+    memset(&request, 0, sizeof(request));
+    uint32_t assigned = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        make_mac(request.chaddr, first + i);
+        assigned += assign_ip_address(range, &request, NULL) != 0;
+    }
+    return assigned;
+}
+
+//================================================
+// Costo y profundidad de sondeo por utilización
+
+static int check_utilization(uint32_t size) {
+    int failed = 0;
+    const int levels[] = { 10, 25, 50, 75, 90, 95 };
+    const int level_count = sizeof(levels) / sizeof(levels[0]);
+    const ip_alloc_policy_t policies[] = { IP_ALLOC_ROUND_ROBIN, IP_ALLOC_LOWEST, IP_ALLOC_HASH };
+    uint32_t batch = size / 100;
+    ip_range_t ranges[3];
+    uint32_t filled[3] = { 0, 0, 0 };
+    for (int p = 0; p < 3; p++) init_pool(&ranges[p], size, policies[p]);
+
+    fprintf(out, "Asignación en un pool de %u direcciones (ns por asignación, lotes de %u):\n", size, batch);
+    fprintf(out, "  %5s %11s %11s %11s %15s %9s %9s\n", "uso", "round_robin", "lowest", "hash",
+            "sondeos (prom)", "p99", "bitmap");
+    double first_hash = 0;
+    for (int l = 0; l < level_count; l++) {
+        uint32_t target = (uint32_t)((uint64_t)size * levels[l] / 100);
+        double cost[3];
+        for (int p = 0; p < 3; p++) {
+            filled[p] += fill(&ranges[p], filled[p], target - filled[p]);
+            uint64_t start = now_ns();
+            uint32_t assigned = fill(&ranges[p], filled[p], batch);
+            cost[p] = (double)(now_ns() - start) / batch;
+            if (assigned != batch) {
+                fprintf(out, "FALLO: %u de %u asignaciones con %d%% de uso\n", assigned, batch, levels[l]);
+                failed = 1;
+            }
+            filled[p] += assigned;
+        }
+
+        // Profundidad con MACs que no están en el pool (sin asignarles nada)
+        ip_range_t* range = &ranges[2];
+        uint32_t histogram[MAX_DEPTH + 1] = { 0 };
+        uint64_t total = 0;
+        struct dhcp_packet request;
+        memset(&request, 0, sizeof(request));
+        for (uint32_t i = 0; i < DEPTH_SAMPLES; i++) {
+            make_mac(request.chaddr, 0x80000000u + i);
+            uint32_t probes;
+            dhcp_mutex_lock(&range->lock);
+            find_hashed_free(range, allocation_hash(range, &request, NULL), &probes);
+            dhcp_mutex_unlock(&range->lock);
+            histogram[probes]++;
+            total += probes;
+        }
+        uint32_t p99 = 0, seen = 0;
+        while (p99 < MAX_DEPTH && (seen += histogram[p99]) < DEPTH_SAMPLES * 99 / 100) p99++;
+        char p99_text[16];
+        snprintf(p99_text, sizeof(p99_text), p99 == MAX_DEPTH ? "bitmap" : "%u", p99);
+        fprintf(out, "  %4d%% %11.0f %11.0f %11.0f %15.2f %9s %8.1f%%\n", levels[l], cost[0], cost[1], cost[2],
+                (double)total / DEPTH_SAMPLES, p99_text, 100.0 * histogram[MAX_DEPTH] / DEPTH_SAMPLES);
+
+        // Con poco uso casi nunca hay que probar otra posición, y lleno el costo sigue acotado
+        if (l == 0) {
+            first_hash = cost[2];
+            if ((double)total / DEPTH_SAMPLES > 1.2) failed = 1;
+        }
+        if (l == level_count - 1 && cost[2] > 4 * first_hash) {
+            fprintf(out, "FALLO: con %d%% de uso la política hash cuesta más de 4 veces que con %d%%\n",
+                    levels[l], levels[0]);
+            failed = 1;
+        }
+    }
+    for (int p = 0; p < 3; p++) {
+        if (ranges[p].leases.count != filled[p] || ranges[p].free_map.free_count != size - filled[p]) {
+            fprintf(out, "FALLO: el pool %d quedó con %u leases y %u libres (esperado %u)\n", p,
+                    ranges[p].leases.count, ranges[p].free_map.free_count, filled[p]);
+            failed = 1;
+        }
+        free_ip_range(&ranges[p]);
+    }
+    return failed;
+}
+
+//================================================
+// Estabilidad tras perder el almacén
+
+static double stable_fraction(uint32_t size, ip_alloc_policy_t policy, int reverse) {
+    uint32_t clients = size / 2;
+    uint32_t* before = (uint32_t*)calloc(clients, sizeof(uint32_t));
+    struct dhcp_packet request;
+    memset(&request, 0, sizeof(request));
+    ip_range_t range;
+
+    init_pool(&range, size, policy);
+    for (uint32_t i = 0; i < clients; i++) {
+        make_mac(request.chaddr, i);
+        before[i] = assign_ip_address(&range, &request, NULL);
+    }
+    free_ip_range(&range);
+
+    // Almacén vacío y los mismos clientes, en el mismo orden o en el inverso
+    init_pool(&range, size, policy);
+    uint32_t same = 0;
+    for (uint32_t n = 0; n < clients; n++) {
+        uint32_t i = reverse ? clients - 1 - n : n;
+        make_mac(request.chaddr, i);
+        same += assign_ip_address(&range, &request, NULL) == before[i];
+    }
+    free_ip_range(&range);
+    free(before);
+    return (double)same / clients;
+}
+
+static int check_stability(uint32_t size) {
+    double hash_same = stable_fraction(size, IP_ALLOC_HASH, 0);
+    double hash = stable_fraction(size, IP_ALLOC_HASH, 1);
+    double round_robin = stable_fraction(size, IP_ALLOC_ROUND_ROBIN, 1);
+    fprintf(out, "Misma IP tras perder el almacén con 50%% de uso: hash %.1f%% (mismo orden), %.1f%% (orden inverso); "
+                 "round_robin %.1f%% (orden inverso)\n", hash_same * 100, hash * 100, round_robin * 100);
+    // En orden inverso cambian las colisiones: conservan su IP los que la tuvieron sin sondear
+    if (hash_same < 1.0 || hash < 0.5) {
+        fprintf(out, "FALLO: con la política hash la mayoría de los clientes debe recibir la misma IP\n");
+        return 1;
+    }
+    return 0;
+}
+
+//================================================
+// Client-id y clave
+
+static size_t build_with_client_id(struct dhcp_packet* packet, uint32_t mac_index, const char* client_id) {
+    memset(packet, 0, sizeof(*packet));
+    packet->op = 1;
+    packet->htype = 1;
+    packet->hlen = 6;
+    make_mac(packet->chaddr, mac_index);
+    uint8_t* options = packet->options;
+    size_t length = strlen(client_id);
+    int at = 0;
+    options[at++] = 53;
+    options[at++] = 1;
+    options[at++] = DHCP_DISCOVER;
+    options[at++] = 61;
+    options[at++] = (uint8_t)length;
+    memcpy(&options[at], client_id, length);
+    at += (int)length;
+    options[at++] = 255;
+    return offsetof(struct dhcp_packet, options) + at;
+}
+
+static int check_client_id() {
+    int failed = 0;
+    ip_range_t range;
+    init_pool(&range, 65536, IP_ALLOC_HASH);
+    struct dhcp_packet first, second;
+    dhcp_option_index_t first_options, second_options;
+    validate_dhcp_packet(&first, build_with_client_id(&first, 1, "\x01router-17"), &first_options);
+    validate_dhcp_packet(&second, build_with_client_id(&second, 2, "\x01router-17"), &second_options);
+
+    uint64_t by_id = allocation_hash(&range, &first, &first_options);
+    int same_id = by_id == allocation_hash(&range, &second, &second_options);
+    int mac_differs = allocation_hash(&range, &first, NULL) != allocation_hash(&range, &second, NULL);
+    range.hash_key = parse_hash_key("otra clave");
+    int key_differs = by_id != allocation_hash(&range, &first, &first_options);
+    free_ip_range(&range);
+
+    fprintf(out, "Client-id: mismo hash con otra MAC %s, otra clave cambia el hash %s\n",
+            same_id && mac_differs ? "sí" : "no", key_differs ? "sí" : "no");
+    if (!same_id || !mac_differs || !key_differs) {
+        fprintf(out, "FALLO: el hash debe depender del client-id y de la clave\n");
+        failed = 1;
+    }
+    return failed;
+}
+
+int main(int argc, char* argv[]) {
+    configure_server();
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(out, NULL, _IOLBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+
+    uint32_t size = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 262144;
+    if (size < 10000) size = 10000;
+    sticky_leases = 0;  // Cada MAC se asigna una sola vez; el índice no cambia el resultado
+    offer_ttl_ms = 0;   // Lease desde el OFFER: el pool se llena de leases y no de ofertas pendientes
+
+    int failed = check_utilization(size);
+    failed |= check_stability(size);
+    failed |= check_client_id();
+    fprintf(out, "%s\n", failed ? "FALLO" : "OK");
+    return failed;
+}
@@ -0,0 +1,94 @@
+// Benchmark del asignador de direcciones basado en bitmap jerárquico
+//
+// Llena un pool de 2^20 direcciones hasta la utilización indicada y mide pares
+// liberar + asignar en régimen estable con las dos políticas. Como referencia mide
+// el sondeo candidato a candidato que hacía assign_ip_address (aquí con una consulta
+// al bitmap por candidato, más barata que la búsqueda en el árbol que hacía antes).
+// Uso: ./bench_ip_bitmap [bits_del_pool]   (por defecto 20)
+
+#include "ip_bitmap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define OPERATIONS 200000
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint32_t next_random() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)rng_state;
+}
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Sondeo lineal desde el cursor, como el bucle original de assign_ip_address
+static uint32_t probe_linear(const ip_bitmap_t* bitmap, uint32_t from) {
+    uint32_t candidate = from % bitmap->size;
+    for (uint32_t attempts = 0; attempts < bitmap->size; attempts++) {
+        if (ip_bitmap_is_free(bitmap, candidate)) return candidate;
+        candidate = (candidate + 1) % bitmap->size;
+    }
+    return IP_BITMAP_NONE;
+}
+
+// 0 = round-robin, 1 = más baja, 2 = sondeo lineal
+static double measure(uint32_t size, double utilization, int mode) {
+    ip_bitmap_t bitmap;
+    ip_bitmap_init(&bitmap, size);
+
+    // Ocupar direcciones aleatorias hasta la utilización pedida
+    uint32_t target = (uint32_t)(size * utilization);
+    while (size - bitmap.free_count < target) {
+        ip_bitmap_set_used(&bitmap, next_random() % size);
+    }
+
+    uint32_t cursor = 0;
+    double start = now_ns();
+    for (int op = 0; op < OPERATIONS; op++) {
+        // Liberar una dirección ocupada al azar
+        uint32_t victim;
+        do {
+            victim = next_random() % size;
+        } while (ip_bitmap_is_free(&bitmap, victim));
+        ip_bitmap_set_free(&bitmap, victim);
+
+        // Asignar la siguiente según la política
+        uint32_t index;
+        if (mode == 0) {
+            index = ip_bitmap_find_free(&bitmap, cursor);
+        } else if (mode == 1) {
+            index = ip_bitmap_find_free(&bitmap, 0);
+        } else {
+            index = probe_linear(&bitmap, cursor);
+        }
+        ip_bitmap_set_used(&bitmap, index);
+        cursor = index + 1;
+    }
+    double elapsed = (now_ns() - start) / OPERATIONS;
+
+    ip_bitmap_free(&bitmap);
+    return elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    int bits = argc > 1 ? atoi(argv[1]) : 20;
+    uint32_t size = 1u << bits;
+    double utilizations[] = {0.50, 0.90, 0.99, 0.999};
+
+    printf("Pool de %u direcciones, %d pares liberar+asignar por medición\n", size, OPERATIONS);
+    for (int i = 0; i < 4; i++) {
+        printf("utilización %5.1f%% | round-robin %6.1f ns | más baja %6.1f ns | sondeo lineal %8.1f ns\n",
+               utilizations[i] * 100,
+               measure(size, utilizations[i], 0),
+               measure(size, utilizations[i], 1),
+               measure(size, utilizations[i], 2));
+    }
+    return 0;
+}
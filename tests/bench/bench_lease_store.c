@@ -0,0 +1,115 @@
+// Benchmark del almacén plano de asignaciones
+//
+// Inserta N asignaciones en un pool de N direcciones, las busca en orden aleatorio,
+// busca IPs libres y fuera del pool, y las elimina. Reporta el costo por operación
+// y la memoria residente (RSS) del proceso antes y después de llenar el almacén.
+// Uso: ./bench_lease_store [leases...]   (por defecto 1000000)
+
+#include "lease_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint32_t next_random() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)rng_state;
+}
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Memoria residente del proceso en KiB (segundo campo de /proc/self/statm)
+static long resident_kib() {
+    long pages = 0, resident = 0;
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (!statm) return -1;
+    if (fscanf(statm, "%ld %ld", &pages, &resident) != 2) resident = -1;
+    fclose(statm);
+    return resident < 0 ? -1 : resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void make_mac(uint8_t* mac, uint32_t i) {
+    mac[0] = 0x02; mac[1] = 0x00;
+    mac[2] = i >> 24; mac[3] = i >> 16; mac[4] = i >> 8; mac[5] = i;
+}
+
+static void measure(uint32_t leases) {
+    const uint32_t start_ip = 10u << 24;
+    uint8_t mac[6];
+    lease_store_t store;
+
+    // Orden aleatorio de las IPs para las búsquedas (antes de medir la RSS)
+    uint32_t* order = malloc((size_t)leases * sizeof(uint32_t));
+    for (uint32_t i = 0; i < leases; i++) order[i] = i;
+    for (uint32_t i = leases - 1; i > 0; i--) {
+        uint32_t j = next_random() % (i + 1);
+        uint32_t tmp = order[i]; order[i] = order[j]; order[j] = tmp;
+    }
+
+    long rss_before = resident_kib();
+    if (lease_store_init(&store, start_ip, leases) < 0) {
+        perror("Error al reservar el almacén");
+        free(order);
+        return;
+    }
+    long rss_empty = resident_kib();
+
+    // Inserción secuencial, como la política round-robin
+    double start = now_ns();
+    for (uint32_t i = 0; i < leases; i++) {
+        make_mac(mac, i);
+        lease_store_insert(&store, start_ip + i, mac, 3600, 1);
+    }
+    double insert_ns = (now_ns() - start) / leases;
+    long rss_full = resident_kib();
+
+    // Búsquedas con acierto en orden aleatorio
+    uint32_t found = 0;
+    start = now_ns();
+    for (uint32_t i = 0; i < leases; i++) {
+        ip_assignment_t* assignment = lease_store_find(&store, start_ip + order[i]);
+        found += assignment != NULL && assignment->mac[5] == (uint8_t)order[i];
+    }
+    double hit_ns = (now_ns() - start) / leases;
+
+    // Búsquedas fuera del pool (por debajo y por encima)
+    start = now_ns();
+    for (uint32_t i = 0; i < leases; i++) {
+        found += lease_store_find(&store, (i & 1) ? start_ip - 1 - i : start_ip + leases + i) != NULL;
+    }
+    double miss_ns = (now_ns() - start) / leases;
+
+    // Eliminación en orden aleatorio
+    start = now_ns();
+    for (uint32_t i = 0; i < leases; i++) {
+        lease_store_delete(&store, start_ip + order[i]);
+    }
+    double delete_ns = (now_ns() - start) / leases;
+
+    printf("%8u leases (%zu B por registro): inserción %5.1f ns | búsqueda %5.1f ns | "
+           "fuera del pool %5.1f ns | eliminación %5.1f ns | %u/%u encontradas\n",
+           leases, sizeof(ip_assignment_t), insert_ns, hit_ns, miss_ns, delete_ns, found, leases);
+    printf("         RSS: %ld KiB antes, %ld KiB con el almacén vacío, %ld KiB lleno (%.1f B por lease)\n",
+           rss_before, rss_empty, rss_full, (double)(rss_full - rss_empty) * 1024 / leases);
+
+    free(order);
+    lease_store_free(&store);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) measure((uint32_t)strtoul(argv[i], NULL, 10));
+    } else {
+        measure(1000000);
+    }
+    return 0;
+}
@@ -0,0 +1,306 @@
+// Benchmark del perfil de contención de locks (src/common/dhcp_lock.c)
+//
+// 1. Costo: tomar y soltar un lock sin contención con pthread_mutex directo, con
+//    dhcp_mutex y el perfil apagado, y con el perfil encendido (rondas alternadas, mediana).
+// 2. Contención: varios hilos comparten un lock que sueltan la CPU mientras lo tienen y
+//    cada uno usa además un lock propio. El compartido debe mostrar tomas contendidas con
+//    su espera, el propio ninguna, y el sitio con más espera debe ser el del compartido.
+// 3. Servidor: intercambios DORA por el pool de workers con el perfil encendido. Cada toma
+//    del lock del shard debe cerrar su retención (tomas == retenciones) y se imprime el volcado.
+// Uso: ./bench_locks [macs] [rondas]   (por defecto 20000 y 7)
+// Retorna 1 si el perfil apagado cuesta más de 2 ns por toma o falla alguna verificación.
+
+#include "dhcp_server.h"
+#include <sched.h>         // Para sched_yield
+#include <sys/resource.h>  // Para getrusage
+
+#define COST_ITERATIONS 5000000
+#define CONTENTION_THREADS 4
+#define CONTENTION_ITERATIONS 2000
+
+static FILE* out;  // Salida de resultados (stdout real, el servidor escribe en /dev/null)
+
+static uint64_t now_ns() {
+    return dhcp_lock_clock();
+}
+
+static double cpu_seconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double* values, int count) {
+    qsort(values, count, sizeof(double), compare_doubles);
+    return count % 2 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+//================================================
+// Costo sin contención
+
+static volatile uint64_t protected_counter = 0;
+
+static double cost_pthread() {
+    pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    uint64_t start = now_ns();
+    for (int i = 0; i < COST_ITERATIONS; i++) {
+        pthread_mutex_lock(&mutex);
+        protected_counter++;
+        pthread_mutex_unlock(&mutex);
+    }
+    return (double)(now_ns() - start) / COST_ITERATIONS;
+}
+
+static double cost_wrapper(int profiling) {
+    dhcp_mutex_t mutex;
+    dhcp_mutex_init(&mutex, "bench costo");
+    dhcp_lock_profiling = profiling;
+    uint64_t start = now_ns();
+    for (int i = 0; i < COST_ITERATIONS; i++) {
+        dhcp_mutex_lock(&mutex);
+        protected_counter++;
+        dhcp_mutex_unlock(&mutex);
+    }
+    double cost = (double)(now_ns() - start) / COST_ITERATIONS;
+    dhcp_lock_profiling = 0;
+    dhcp_mutex_destroy(&mutex);
+    return cost;
+}
+
+//================================================
+// Contención entre hilos
+
+static dhcp_mutex_t hot_lock = DHCP_MUTEX_INITIALIZER("bench compartido");
+
+static void hot_section() {
+    dhcp_mutex_lock(&hot_lock);
+    protected_counter++;
+    sched_yield();  // Soltar la CPU con el lock tomado: los demás hilos lo encuentran ocupado
+    dhcp_mutex_unlock(&hot_lock);
+}
+
+static void* contention_thread(void* arg) {
+    (void)arg;
+    dhcp_mutex_t own_lock;
+    dhcp_mutex_init(&own_lock, "bench propio");
+    for (int i = 0; i < CONTENTION_ITERATIONS; i++) {
+        hot_section();
+        dhcp_mutex_lock(&own_lock);
+        protected_counter++;
+        dhcp_mutex_unlock(&own_lock);
+    }
+    dhcp_mutex_destroy(&own_lock);
+    return NULL;
+}
+
+static int check_contention() {
+    int failed = 0;
+    dhcp_lock_reset();
+    dhcp_lock_configure("on");
+    pthread_t threads[CONTENTION_THREADS];
+    for (int i = 0; i < CONTENTION_THREADS; i++) {
+        pthread_create(&threads[i], NULL, contention_thread, NULL);
+    }
+    for (int i = 0; i < CONTENTION_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    dhcp_lock_configure("off");
+
+    dhcp_lock_stats_t hot, own;
+    dhcp_lock_stats("bench compartido", &hot);
+    dhcp_lock_stats("bench propio", &own);
+    uint64_t expected = (uint64_t)CONTENTION_THREADS * CONTENTION_ITERATIONS;
+    fprintf(out, "Contención con %d hilos: compartido %llu tomas, %llu contendidas (espera p50 %.2f us, p99 %.2f us); "
+                 "propio %llu tomas, %llu contendidas\n",
+            CONTENTION_THREADS, (unsigned long long)hot.acquisitions, (unsigned long long)hot.contended,
+            hot.wait.p50 / 1e3, hot.wait.p99 / 1e3, (unsigned long long)own.acquisitions,
+            (unsigned long long)own.contended);
+    if (hot.acquisitions != expected || own.acquisitions != expected) {
+        fprintf(out, "  Tomas contadas distintas de las hechas (%llu)\n", (unsigned long long)expected);
+        failed = 1;
+    }
+    if (hot.contended == 0 || hot.wait.count != hot.contended || hot.hold.count != hot.acquisitions) {
+        fprintf(out, "  El lock compartido no registró bien su contención o sus retenciones\n");
+        failed = 1;
+    }
+    if (own.contended != 0) {
+        fprintf(out, "  El lock propio de cada hilo aparece contendido\n");
+        failed = 1;
+    }
+
+    // El primer sitio del volcado debe ser hot_section
+    char* dump = NULL;
+    size_t dump_size = 0;
+    FILE* memory = open_memstream(&dump, &dump_size);
+    dhcp_lock_dump(memory);
+    fclose(memory);
+    const char* sites = strstr(dump, "Sitios con más espera:\n");
+    if (!sites || strncmp(sites + strlen("Sitios con más espera:\n"), "  hot_section (", 15) != 0) {
+        fprintf(out, "  El sitio con más espera no es hot_section\n");
+        failed = 1;
+    }
+    fputs(dump, out);
+    free(dump);
+    return failed;
+}
+
+//================================================
+// Locks del servidor en un intercambio DORA
+
+static void make_mac(uint8_t* mac, uint32_t index) {
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = (index >> 24) & 0xff;
+    mac[3] = (index >> 16) & 0xff;
+    mac[4] = (index >> 8) & 0xff;
+    mac[5] = index & 0xff;
+}
+
+static size_t build_packet(struct dhcp_packet* packet, const uint8_t* mac, uint32_t xid, uint8_t type, uint32_t requested_ip) {
+    memset(packet, 0, sizeof(*packet));
+    packet->op = 1;
+    packet->htype = 1;
+    packet->hlen = 6;
+    packet->xid = htonl(xid);
+    memcpy(packet->chaddr, mac, 6);
+
+    int i = 0;
+    packet->options[i++] = 53;
+    packet->options[i++] = 1;
+    packet->options[i++] = type;
+    if (requested_ip) {
+        uint32_t net_ip = htonl(requested_ip);
+        packet->options[i++] = 50;
+        packet->options[i++] = 4;
+        memcpy(&packet->options[i], &net_ip, 4);
+        i += 4;
+    }
+    packet->options[i++] = 255;
+    return sizeof(*packet) - sizeof(packet->options) + i;
+}
+
+static void dispatch_blocking(struct sockaddr_in* addr, struct dhcp_packet* packet, size_t length) {
+    while (dispatch_dhcp_packet(addr, (uint8_t*)packet, length) < 0) {
+        drain_worker_pool();
+    }
+}
+
+// Retorna la CPU por DORA en ns
+static double run_dora(uint32_t macs) {
+    struct sockaddr_in sink;
+    int sink_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    socklen_t sink_length = sizeof(sink);
+    memset(&sink, 0, sizeof(sink));
+    sink.sin_family = AF_INET;
+    sink.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(sink_fd, (struct sockaddr*)&sink, sizeof(sink));
+    getsockname(sink_fd, (struct sockaddr*)&sink, &sink_length);
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct dhcp_packet packet;
+    uint8_t mac[6];
+
+    init_ip_range(&global_ip_range, 10u << 24, (10u << 24) + macs + 1, 1);
+    split_ip_pool(&global_ip_range, 1);
+    start_worker_pool(sockfd, 1);
+
+    double cpu_start = cpu_seconds();
+    for (uint32_t i = 0; i < macs; i++) {
+        make_mac(mac, i);
+        dispatch_blocking(&sink, &packet, build_packet(&packet, mac, 0x1000, DHCP_DISCOVER, 0));
+    }
+    drain_worker_pool();
+    for (uint32_t i = 0; i < macs; i++) {
+        make_mac(mac, i);
+        client_transaction_t* txn = txn_table_find(&workers[0].transactions, mac, htonl(0x1000), txn_clock_now());
+        dispatch_blocking(&sink, &packet, build_packet(&packet, mac, 0x1000, DHCP_REQUEST, txn ? txn->offered_ip : 0));
+    }
+    drain_worker_pool();
+    double cpu = cpu_seconds() - cpu_start;
+
+    stop_worker_pool();
+    for (int i = 0; i < num_ip_shards; i++) {
+        free_ip_range(&ip_shards[i]);
+    }
+    close(sockfd);
+    close(sink_fd);
+    return cpu * 1e9 / macs;
+}
+
+static int check_server(uint32_t macs, int rounds) {
+    double off[64], on[64];
+    for (int r = 0; r < rounds; r++) {
+        dhcp_lock_configure("off");
+        off[r] = run_dora(macs);
+        dhcp_lock_reset();
+        dhcp_lock_configure("on");
+        on[r] = run_dora(macs);
+        dhcp_lock_configure("off");
+    }
+    double off_ns = median(off, rounds), on_ns = median(on, rounds);
+    fprintf(out, "CPU por DORA (%u MACs, mediana de %d rondas): perfil apagado %.0f ns, encendido %.0f ns (%+.2f%%)\n",
+            macs, rounds, off_ns, on_ns, (on_ns / off_ns - 1) * 100);
+
+    // Los contadores quedan de la última ronda encendida
+    int failed = 0;
+    dhcp_lock_stats_t shard;
+    if (dhcp_lock_stats("shard->lock", &shard) < 0 || shard.acquisitions < 2ULL * macs) {
+        fprintf(out, "  El lock del shard registró %llu tomas (se esperaban al menos %u)\n",
+                (unsigned long long)shard.acquisitions, 2 * macs);
+        failed = 1;
+    } else if (shard.hold.count != shard.acquisitions) {
+        fprintf(out, "  El lock del shard tiene %llu tomas y %llu retenciones\n",
+                (unsigned long long)shard.acquisitions, (unsigned long long)shard.hold.count);
+        failed = 1;
+    }
+    dhcp_lock_dump(out);
+    return failed;
+}
+
+static void configure_server() {
+    server_ip = ntohl(inet_addr("127.0.0.1"));
+    subnet_mask = inet_addr("255.0.0.0");
+    gateway_ip = inet_addr("127.0.0.1");
+    dns_server_ip = inet_addr("127.0.0.1");
+    default_lease_time = 3600;
+}
+
+int main(int argc, char* argv[]) {
+    configure_server();
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(out, NULL, _IOLBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+
+    uint32_t macs = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 20000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 7;
+    if (rounds < 1) rounds = 1;
+    if (rounds > 64) rounds = 64;
+
+    double raw[64], off[64], on[64];
+    for (int r = 0; r < rounds; r++) {
+        raw[r] = cost_pthread();
+        off[r] = cost_wrapper(0);
+        on[r] = cost_wrapper(1);
+    }
+    double raw_ns = median(raw, rounds), off_ns = median(off, rounds), on_ns = median(on, rounds);
+    fprintf(out, "Tomar y soltar sin contención (mediana de %d rondas): pthread %.2f ns, perfil apagado %.2f ns (%+.2f ns), "
+                 "encendido %.2f ns (%+.2f ns)\n",
+            rounds, raw_ns, off_ns, off_ns - raw_ns, on_ns, on_ns - raw_ns);
+    int failed = 0;
+    if (off_ns - raw_ns > 2.0) {
+        fprintf(out, "FALLO: el perfil apagado cuesta más de 2 ns por toma\n");
+        failed = 1;
+    }
+
+    failed |= check_contention();
+    failed |= check_server(macs, rounds);
+    fprintf(out, "%s\n", failed ? "FALLO" : "OK");
+    return failed;
+}
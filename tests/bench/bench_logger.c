@@ -0,0 +1,205 @@
+// Benchmark del log asíncrono (src/server/dhcp_log.c)
+//
+// 1. Costo por mensaje en el hilo que registra: printf a /dev/null (lo que hacía el
+//    servidor), mensaje DEBUG desactivado, formateo en el momento (sin hilo de log) y
+//    registro binario en el anillo del hilo con el hilo de log en marcha.
+// 2. Paquetes/s del camino real (recvmmsg al anillo de paquetes, workers, OFFERs por
+//    loopback) con el log apagado, en INFO y en DEBUG, y DEBUG sin hilo de log como
+//    referencia del comportamiento anterior. Cada nivel se mide varias veces alternando
+//    y se toma la mejor ronda.
+// Uso: ./bench_logger [paquetes] [rondas]   (por defecto 100000 y 3)
+// Retorna 1 si INFO queda más de un 3% por debajo del log apagado.
+
+#include "dhcp_server.h"
+
+#define CHUNK 128          // Paquetes que el generador envía antes de que el servidor los lea
+#define CALLS 200000       // Mensajes de la primera parte
+#define BURST 500          // Mensajes por ráfaga con el hilo de log (menos que DHCP_LOG_RING_SIZE)
+
+static FILE* out;  // Salida de resultados (stdout real, el log va a /dev/null)
+
+static double wall_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static size_t build_discover(struct dhcp_packet* packet, uint32_t index) {
+    memset(packet, 0, sizeof(*packet));
+    packet->op = 1;
+    packet->htype = 1;
+    packet->hlen = 6;
+    packet->xid = htonl(0x3000 + index);
+    packet->chaddr[0] = 0x02;
+    packet->chaddr[2] = (index >> 24) & 0xff;
+    packet->chaddr[3] = (index >> 16) & 0xff;
+    packet->chaddr[4] = (index >> 8) & 0xff;
+    packet->chaddr[5] = index & 0xff;
+    packet->options[0] = 53;
+    packet->options[1] = 1;
+    packet->options[2] = DHCP_DISCOVER;
+    packet->options[3] = 255;
+    return sizeof(*packet) - sizeof(packet->options) + 4;
+}
+
+static int bind_loopback(struct sockaddr_in* addr) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    socklen_t len = sizeof(*addr);
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (struct sockaddr*)addr, sizeof(*addr));
+    getsockname(fd, (struct sockaddr*)addr, &len);
+    int rcvbuf = 4 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    return fd;
+}
+
+// Mensaje típico del camino de un paquete: MAC e IP como enteros
+static const uint8_t sample_mac[6] = {0x02, 0x00, 0x12, 0x34, 0x56, 0x78};
+
+static void measure_calls() {
+    uint32_t ip = 0x0a000005;
+    double start;
+
+    start = wall_seconds();
+    for (int i = 0; i < CALLS; i++) {
+        printf("Dirección IP asignada a cliente con MAC %02x:%02x:%02x:%02x:%02x:%02x: %s\n",
+               DHCP_MAC_ARGS(sample_mac), "10.0.0.5");
+    }
+    fflush(stdout);
+    double printf_ns = (wall_seconds() - start) * 1e9 / CALLS;
+
+    dhcp_log_level = DHCP_LOG_INFO;
+    start = wall_seconds();
+    for (int i = 0; i < CALLS; i++) {
+        dhcp_log_debug("Dirección IP asignada a cliente con MAC " DHCP_MAC_FMT ": " DHCP_IP_FMT "\n",
+                       DHCP_MAC_ARGS(sample_mac), DHCP_IP_ARGS(ip + i));
+    }
+    double disabled_ns = (wall_seconds() - start) * 1e9 / CALLS;
+
+    dhcp_log_level = DHCP_LOG_DEBUG;
+    start = wall_seconds();
+    for (int i = 0; i < CALLS; i++) {
+        dhcp_log_debug("Dirección IP asignada a cliente con MAC " DHCP_MAC_FMT ": " DHCP_IP_FMT "\n",
+                       DHCP_MAC_ARGS(sample_mac), DHCP_IP_ARGS(ip + i));
+    }
+    double sync_ns = (wall_seconds() - start) * 1e9 / CALLS;
+
+    // Con el hilo de log: ráfagas que entran en el anillo, dejando que el hilo de log
+    // las vacíe entre una y otra; solo se mide el tiempo dentro de las ráfagas
+    dhcp_log_dropped = 0;
+    dhcp_log_start();
+    double async_seconds = 0;
+    for (int burst = 0; burst < CALLS / BURST; burst++) {
+        start = wall_seconds();
+        for (int i = 0; i < BURST; i++) {
+            dhcp_log_debug("Dirección IP asignada a cliente con MAC " DHCP_MAC_FMT ": " DHCP_IP_FMT "\n",
+                           DHCP_MAC_ARGS(sample_mac), DHCP_IP_ARGS(ip + i));
+        }
+        async_seconds += wall_seconds() - start;
+        struct timespec pause = { .tv_sec = 0, .tv_nsec = 2000000 };
+        nanosleep(&pause, NULL);
+    }
+    double async_ns = async_seconds * 1e9 / (CALLS / BURST * BURST);
+    dhcp_log_stop();
+
+    fprintf(out, "Costo por mensaje en el hilo que registra:\n");
+    fprintf(out, "  printf a /dev/null       %7.1f ns\n", printf_ns);
+    fprintf(out, "  DEBUG desactivado        %7.1f ns\n", disabled_ns);
+    fprintf(out, "  formateo en el momento   %7.1f ns\n", sync_ns);
+    fprintf(out, "  registro en el anillo    %7.1f ns (%lu descartados por anillo lleno)\n",
+            async_ns, dhcp_log_dropped);
+}
+
+// Paquetes/s del camino de recepción con el nivel indicado
+static double run_packets(uint32_t packets, int level, int async, int round) {
+    struct sockaddr_in server_addr, client_addr;
+    int server_fd = bind_loopback(&server_addr);
+    int client_fd = bind_loopback(&client_addr);
+
+    uint32_t start_ip = (uint32_t)(10 + round) << 24;
+    init_ip_range(&global_ip_range, start_ip, start_ip + packets + 1, round);
+    split_ip_pool(&global_ip_range, 1);
+
+    dhcp_log_level = level;
+    if (async) dhcp_log_start();
+    memset(&io_stats, 0, sizeof(io_stats));
+    start_worker_pool(server_fd, 0);
+
+    dhcp_msg_batch_t rx;
+    dhcp_batch_init(&rx, io_batch_size);
+    struct dhcp_packet requests[CHUNK];
+    struct iovec iov[CHUNK];
+    struct mmsghdr msgs[CHUNK];
+
+    double wall_start = wall_seconds();
+    for (uint32_t sent = 0; sent < packets; ) {
+        int chunk = packets - sent < CHUNK ? (int)(packets - sent) : CHUNK;
+        for (int i = 0; i < chunk; i++) {
+            iov[i].iov_base = &requests[i];
+            iov[i].iov_len = build_discover(&requests[i], sent + i);
+            memset(&msgs[i], 0, sizeof(msgs[i]));
+            msgs[i].msg_hdr.msg_name = &server_addr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(server_addr);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        int queued = sendmmsg(client_fd, msgs, chunk, 0);
+        sent += queued > 0 ? queued : chunk;
+
+        while (receive_dhcp_packets(server_fd, &rx, MSG_DONTWAIT) > 0) {
+        }
+        drain_worker_pool();
+    }
+    double wall = wall_seconds() - wall_start;
+    double rate = io_stats.rx_packets / wall;
+
+    stop_worker_pool();
+    if (async) dhcp_log_stop();
+    dhcp_batch_free(&rx);
+    free_ip_range(&global_ip_range);
+    close(server_fd);
+    close(client_fd);
+    return rate;
+}
+
+int main(int argc, char* argv[]) {
+    // Resultados por el stdout real; el log del servidor se descarta
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(out, NULL, _IOLBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+
+    server_ip = ntohl(inet_addr("127.0.0.1"));
+    subnet_mask = inet_addr("255.0.0.0");
+    gateway_ip = inet_addr("127.0.0.1");
+    dns_server_ip = inet_addr("127.0.0.1");
+    default_lease_time = 3600;
+
+    uint32_t packets = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 100000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 3;
+
+    measure_calls();
+
+    // Mejor ronda de cada configuración, alternando para repartir el ruido
+    const char* names[] = {"log apagado", "INFO", "DEBUG", "DEBUG sin hilo de log"};
+    int levels[] = {DHCP_LOG_OFF, DHCP_LOG_INFO, DHCP_LOG_DEBUG, DHCP_LOG_DEBUG};
+    int async[] = {1, 1, 1, 0};
+    double best[4] = {0};
+    int round = 0;
+    for (int r = 0; r < rounds; r++) {
+        for (int c = 0; c < 4; c++) {
+            double rate = run_packets(packets, levels[c], async[c], round++ % 200);
+            if (rate > best[c]) best[c] = rate;
+        }
+    }
+
+    fprintf(out, "Paquetes/s del camino de recepción (%u DISCOVERs, mejor de %d rondas):\n", packets, rounds);
+    for (int c = 0; c < 4; c++) {
+        fprintf(out, "  %-22s %9.0f paquetes/s (%+.1f%% respecto de apagado)\n",
+                names[c], best[c], (best[c] / best[0] - 1) * 100);
+    }
+    return best[1] >= best[0] * 0.97 ? 0 : 1;
+}
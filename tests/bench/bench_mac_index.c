@@ -0,0 +1,354 @@
+// Benchmark del índice MAC -> lease y de los fantasmas de leases terminados
+//
+// 1. Búsqueda: un índice con N leases activos y fantasmas; se mide el costo de buscar una MAC
+//    (acierto, fantasma y fallo) contra recorrer el almacén comparando MACs, que es lo único
+//    posible sin índice. También se mide un vencimiento con su regreso (retire + set).
+// 2. Tormenta de reinicios: la mitad del pool tiene lease y todos los clientes se reinician
+//    varias veces seguidas (DISCOVER con xid nuevo y REQUEST de la IP ofrecida). Sin índice
+//    cada reinicio gasta una dirección nueva; con índice cada MAC recibe la suya.
+// 3. Regreso tras vencer: los clientes desaparecen hasta que vencen sus leases, llegan clientes
+//    nuevos y los primeros vuelven. Se cuenta cuántos recuperan su IP con y sin fantasmas, y
+//    con menos fantasmas que clientes (la lista LRU olvida los más antiguos).
+// Uso: ./bench_mac_index [leases] [reinicios]   (por defecto 1000000 y 4)
+// Retorna 1 si alguna verificación falla.
+
+#include "dhcp_server.h"
+
+#define STORM_POOL 8192
+#define STORM_CLIENTS (STORM_POOL / 2)
+#define RETURN_POOL 8192
+#define RETURN_CLIENTS 2048
+#define SCAN_LOOKUPS 20
+
+static FILE* out;  // Salida de resultados (stdout real, el servidor escribe en /dev/null)
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void make_mac(uint8_t* mac, uint32_t index) {
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = (index >> 24) & 0xff;
+    mac[3] = (index >> 16) & 0xff;
+    mac[4] = (index >> 8) & 0xff;
+    mac[5] = index & 0xff;
+}
+
+static uint32_t next_random(uint32_t* state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static void configure_server() {
+    server_ip = ntohl(inet_addr("127.0.0.1"));
+    subnet_mask = inet_addr("255.0.0.0");
+    gateway_ip = inet_addr("127.0.0.1");
+    dns_server_ip = inet_addr("127.0.0.1");
+    default_lease_time = 3600;
+}
+
+//================================================
+// Costo de búsqueda
+
+// Recorrer el almacén buscando la MAC (lo que costaría encontrar un lease sin índice)
+static uint32_t scan_store(const lease_store_t* store, const uint8_t* mac) {
+    for (uint32_t i = 0; i < store->size; i++) {
+        const ip_assignment_t* assignment = &store->leases[i];
+        if (assignment->state == LEASE_ACTIVE && memcmp(assignment->mac, mac, 6) == 0) {
+            return i;
+        }
+    }
+    return MAC_INDEX_NONE;
+}
+
+static int check_lookup(uint32_t leases) {
+    int failed = 0;
+    uint32_t ghosts = leases / 4;
+    lease_store_t store;
+    mac_index_t index;
+    if (lease_store_init(&store, 10u << 24, leases + ghosts) < 0 || mac_index_init(&index, ghosts * 2) < 0) {
+        fprintf(out, "FALLO: no se pudo reservar el índice de %u leases\n", leases);
+        return 1;
+    }
+
+    // Un lease activo por registro del almacén; uno de cada 5 pasa a ser fantasma
+    uint8_t mac[6];
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < leases + ghosts; i++) {
+        make_mac(mac, i);
+        lease_store_insert(&store, store.start_ip + i, mac, 3600, 0);
+        mac_index_set(&index, mac, i);
+    }
+    double insert_ns = (double)(now_ns() - start) / (leases + ghosts);
+    for (uint32_t i = leases; i < leases + ghosts; i++) {
+        make_mac(mac, i);
+        mac_index_retire(&index, mac, i);
+        lease_store_delete(&store, store.start_ip + i);
+    }
+
+    // Aciertos, fantasmas y fallos en orden aleatorio
+    const char* names[] = { "activo", "fantasma", "sin lease" };
+    double lookup_ns[3];
+    uint32_t lookups = leases < 2000000 ? 2000000 : leases;
+    for (int kind = 0; kind < 3; kind++) {
+        uint32_t state = 12345 + kind;
+        uint32_t found = 0;
+        start = now_ns();
+        for (uint32_t i = 0; i < lookups; i++) {
+            uint32_t r = next_random(&state);
+            uint32_t id = kind == 0 ? r % leases : kind == 1 ? leases + r % ghosts : leases + ghosts + r % leases;
+            make_mac(mac, id);
+            int ghost;
+            uint32_t record = mac_index_find(&index, mac, &ghost);
+            found += kind == 2 ? record == MAC_INDEX_NONE : record == id && ghost == (kind == 1);
+        }
+        lookup_ns[kind] = (double)(now_ns() - start) / lookups;
+        if (found != lookups) {
+            fprintf(out, "FALLO: %u de %u búsquedas (%s) dieron el registro esperado\n", found, lookups, names[kind]);
+            failed = 1;
+        }
+    }
+
+    // Un vencimiento y el regreso de la misma MAC
+    uint32_t state = 999;
+    start = now_ns();
+    for (uint32_t i = 0; i < lookups; i++) {
+        uint32_t id = next_random(&state) % leases;
+        make_mac(mac, id);
+        mac_index_retire(&index, mac, id);
+        mac_index_set(&index, mac, id);
+    }
+    double churn_ns = (double)(now_ns() - start) / lookups;
+
+    // Sin índice: recorrer el almacén (solo unas pocas, cada una cuesta un recorrido completo)
+    state = 777;
+    start = now_ns();
+    for (uint32_t i = 0; i < SCAN_LOOKUPS; i++) {
+        uint32_t id = next_random(&state) % leases;
+        make_mac(mac, id);
+        if (scan_store(&store, mac) != id) failed = 1;
+    }
+    double scan_ns = (double)(now_ns() - start) / SCAN_LOOKUPS;
+
+    fprintf(out, "Índice con %u leases activos y %u fantasmas (%u ranuras, %.1f MB; inserción %.0f ns):\n",
+            leases, ghosts, index.capacity,
+            (index.capacity * sizeof(mac_index_entry_t) + ghosts * sizeof(mac_ghost_t)) / 1048576.0, insert_ns);
+    for (int kind = 0; kind < 3; kind++) {
+        fprintf(out, "  búsqueda (%s): %7.1f ns\n", names[kind], lookup_ns[kind]);
+    }
+    fprintf(out, "  vencer y volver: %7.1f ns\n", churn_ns);
+    fprintf(out, "  recorrer el almacén sin índice: %.0f ns (%.0fx la búsqueda)\n", scan_ns, scan_ns / lookup_ns[0]);
+    if (index.ghost_count != ghosts || index.count != leases + ghosts) {
+        fprintf(out, "FALLO: el índice quedó con %u entradas y %u fantasmas\n", index.count, index.ghost_count);
+        failed = 1;
+    }
+    mac_index_free(&index);
+    lease_store_free(&store);
+    return failed;
+}
+
+//================================================
+// Clientes que hacen DORA contra el servidor (sin workers: los handlers directamente)
+
+typedef struct {
+    int sockfd;
+    struct sockaddr_in sink;   // Las respuestas van a un socket que nadie lee
+    uint32_t xid;
+} client_ctx_t;
+
+static size_t build_packet(struct dhcp_packet* packet, const uint8_t* mac, uint32_t xid, int type, uint32_t requested_ip) {
+    memset(packet, 0, sizeof(*packet));
+    packet->op = 1;
+    packet->htype = 1;
+    packet->hlen = 6;
+    packet->xid = htonl(xid);
+    memcpy(packet->chaddr, mac, 6);
+    uint8_t* options = packet->options;
+    int length = 0;
+    options[length++] = 53;
+    options[length++] = 1;
+    options[length++] = (uint8_t)type;
+    if (requested_ip) {
+        uint32_t ip = htonl(requested_ip);
+        options[length++] = 50;
+        options[length++] = 4;
+        memcpy(&options[length], &ip, 4);
+        length += 4;
+    }
+    options[length++] = 255;
+    return offsetof(struct dhcp_packet, options) + length;
+}
+
+// DISCOVER y REQUEST de la IP ofrecida; retorna la IP con ACK (0 si hubo NAK)
+static uint32_t dora(client_ctx_t* ctx, const uint8_t* mac) {
+    struct dhcp_packet packet;
+    dhcp_option_index_t options;
+    uint32_t xid = ++ctx->xid;
+    size_t length = build_packet(&packet, mac, xid, DHCP_DISCOVER, 0);
+    validate_dhcp_packet(&packet, length, &options);
+    uint32_t offered = handle_dhcp_discover(ctx->sockfd, &ctx->sink, &packet, &options);
+    if (offered == 0) {
+        return 0;
+    }
+    length = build_packet(&packet, mac, xid, DHCP_REQUEST, offered);
+    validate_dhcp_packet(&packet, length, &options);
+    return handle_dhcp_request(ctx->sockfd, &ctx->sink, &packet, &options) ? offered : 0;
+}
+
+static void open_client(client_ctx_t* ctx) {
+    socklen_t sink_length = sizeof(ctx->sink);
+    int sink_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(&ctx->sink, 0, sizeof(ctx->sink));
+    ctx->sink.sin_family = AF_INET;
+    ctx->sink.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(sink_fd, (struct sockaddr*)&ctx->sink, sizeof(ctx->sink));
+    getsockname(sink_fd, (struct sockaddr*)&ctx->sink, &sink_length);
+    ctx->sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    ctx->xid = (uint32_t)sink_fd << 20;
+}
+
+static void start_pool(uint32_t first_ip, uint32_t size) {
+    init_ip_range(&global_ip_range, first_ip, first_ip + size - 1, 1);
+    split_ip_pool(&global_ip_range, 1);
+}
+
+//================================================
+// Tormenta de reinicios
+
+static int run_storm(client_ctx_t* ctx, int sticky, int reboots, int* failed) {
+    sticky_leases = sticky;
+    start_pool(11u << 24, STORM_POOL);
+    uint32_t* first = (uint32_t*)calloc(STORM_CLIENTS, sizeof(uint32_t));
+    uint8_t mac[6];
+    for (uint32_t i = 0; i < STORM_CLIENTS; i++) {
+        make_mac(mac, i);
+        first[i] = dora(ctx, mac);
+    }
+
+    fprintf(out, "  %s:\n", sticky ? "con índice" : "sin índice (DHCP_STICKY_LEASES=off)");
+    int exhausted_at = 0;
+    for (int round = 1; round <= reboots; round++) {
+        uint32_t naks = 0, same = 0;
+        uint64_t start = now_ns();
+        for (uint32_t i = 0; i < STORM_CLIENTS; i++) {
+            make_mac(mac, i);
+            uint32_t ip = dora(ctx, mac);
+            naks += ip == 0;
+            same += ip != 0 && ip == first[i];
+        }
+        double us = (now_ns() - start) / 1e3 / STORM_CLIENTS;
+        fprintf(out, "    reinicio %d: %5u leases en el pool de %u (%5.1f%%), %5u sin IP, %5u con la IP de antes, %.2f us por DORA\n",
+                round, ip_shards[0].leases.count, STORM_POOL, 100.0 * ip_shards[0].leases.count / STORM_POOL,
+                naks, same, us);
+        if (naks > 0 && exhausted_at == 0) exhausted_at = round;
+        if (sticky && (naks != 0 || same != STORM_CLIENTS || ip_shards[0].leases.count != STORM_CLIENTS)) {
+            *failed = 1;
+        }
+    }
+    free(first);
+    free_ip_range(&ip_shards[0]);
+    return exhausted_at;
+}
+
+static int check_storm(int reboots) {
+    int failed = 0;
+    client_ctx_t ctx;
+    open_client(&ctx);
+    fprintf(out, "Tormenta de reinicios: %u clientes en un pool de %u, %d reinicios seguidos\n",
+            STORM_CLIENTS, STORM_POOL, reboots);
+    int exhausted = run_storm(&ctx, 0, reboots, &failed);
+    run_storm(&ctx, 1, reboots, &failed);
+    if (reboots >= 2 && exhausted == 0) {
+        fprintf(out, "FALLO: sin índice el pool debía agotarse\n");
+        failed = 1;
+    }
+    if (failed) {
+        fprintf(out, "FALLO: con índice cada cliente debe conservar su IP sin gastar otra\n");
+    }
+    sticky_leases = 1;
+    return failed;
+}
+
+//================================================
+// Regreso tras vencer
+
+static uint32_t run_return(client_ctx_t* ctx, uint32_t ghosts) {
+    lease_ghost_limit = ghosts;
+    start_pool(12u << 24, RETURN_POOL);
+    uint32_t* first = (uint32_t*)calloc(RETURN_CLIENTS, sizeof(uint32_t));
+    uint8_t mac[6];
+
+    // Los primeros clientes toman leases de 1 s y desaparecen
+    default_lease_time = 1;
+    for (uint32_t i = 0; i < RETURN_CLIENTS; i++) {
+        make_mac(mac, i);
+        first[i] = dora(ctx, mac);
+    }
+    struct timespec pause = { .tv_sec = 1, .tv_nsec = 200000000 };
+    nanosleep(&pause, NULL);
+    check_expired_leases(&ip_shards[0]);
+
+    // Llegan otros tantos clientes nuevos y después vuelven los primeros
+    default_lease_time = 3600;
+    for (uint32_t i = 0; i < RETURN_CLIENTS; i++) {
+        make_mac(mac, 0x100000 + i);
+        dora(ctx, mac);
+    }
+    uint32_t same = 0;
+    for (uint32_t i = 0; i < RETURN_CLIENTS; i++) {
+        make_mac(mac, i);
+        same += dora(ctx, mac) == first[i];
+    }
+    free(first);
+    free_ip_range(&ip_shards[0]);
+    return same;
+}
+
+static int check_return() {
+    int failed = 0;
+    client_ctx_t ctx;
+    open_client(&ctx);
+    fprintf(out, "Regreso tras vencer: %u clientes con leases de 1 s, %u clientes nuevos, pool de %u\n",
+            RETURN_CLIENTS, RETURN_CLIENTS, RETURN_POOL);
+    uint32_t limits[] = { 0, RETURN_CLIENTS / 2, LEASE_GHOSTS_DEFAULT };
+    for (int i = 0; i < 3; i++) {
+        uint32_t same = run_return(&ctx, limits[i]);
+        fprintf(out, "  %5u fantasmas por shard: %4u de %u vuelven a su IP (%.1f%%)\n",
+                limits[i], same, RETURN_CLIENTS, 100.0 * same / RETURN_CLIENTS);
+        // La lista LRU recuerda los más recientes: con la mitad de lugar vuelve la mitad
+        uint32_t expected = limits[i] < RETURN_CLIENTS ? limits[i] : RETURN_CLIENTS;
+        if ((limits[i] == 0 && same > RETURN_CLIENTS / 100) || (limits[i] > 0 && same != expected)) {
+            failed = 1;
+        }
+    }
+    if (failed) {
+        fprintf(out, "FALLO: los clientes que vuelven no recuperan las IPs recordadas\n");
+    }
+    lease_ghost_limit = LEASE_GHOSTS_DEFAULT;
+    return failed;
+}
+
+int main(int argc, char* argv[]) {
+    configure_server();
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(out, NULL, _IOLBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+
+    uint32_t leases = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 1000000;
+    int reboots = argc > 2 ? atoi(argv[2]) : 4;
+    if (leases < 1000) leases = 1000;
+    if (reboots < 1) reboots = 1;
+
+    int failed = check_lookup(leases);
+    failed |= check_storm(reboots);
+    failed |= check_return();
+    fprintf(out, "%s\n", failed ? "FALLO" : "OK");
+    return failed;
+}
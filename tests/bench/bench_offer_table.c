@@ -0,0 +1,303 @@
+// Benchmark de las ofertas pendientes (DHCP_OFFER_TTL_MS)
+//
+// 1. Tormenta de DISCOVER: un pool chico recibe durante unos segundos un flujo constante de
+//    DISCOVER de MACs que nunca envían REQUEST (un ataque, o clientes que eligen la oferta de
+//    otro servidor) mientras llegan clientes legítimos que hacen DORA completo. Se compara el
+//    lease registrado en el OFFER (DHCP_OFFER_TTL_MS=0, el comportamiento anterior) con ofertas
+//    de 2000 ms y de 250 ms: cuántas direcciones quedan libres y cuántos clientes reciben IP.
+//    Los vencimientos se reclaman cada 10 ms, como lo haría el timerfd del bucle de eventos.
+// 2. Ciclo de una oferta: DISCOVER retransmitido, REQUEST de otra MAC, REQUEST de la MAC
+//    dueña, REQUEST de una IP de otro servidor, vencimiento y una MAC que vuelve a una IP que
+//    otra tiene ofrecida. Las ofertas muertas no quedan en la cabeza del anillo y el gauge de
+//    ofertas pendientes cuenta las vigentes de la tabla.
+// Uso: ./bench_offer_table [segundos]   (por defecto 5 segundos de tormenta)
+// Retorna 1 si alguna verificación falla.
+
+#include "dhcp_server.h"
+
+#define STORM_POOL 4096
+#define FLOOD_RATE 1000     // DISCOVER por segundo sin REQUEST
+#define CLIENT_RATE 250     // Clientes por segundo con DORA completo
+#define EXPIRE_TICK_MS 10   // Cada cuánto se reclaman las ofertas vencidas
+#define MAX_SAMPLES 16
+
+static FILE* out;  // Salida de resultados (stdout real, el servidor escribe en /dev/null)
+
+static uint64_t now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void make_mac(uint8_t* mac, uint32_t index) {
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = (index >> 24) & 0xff;
+    mac[3] = (index >> 16) & 0xff;
+    mac[4] = (index >> 8) & 0xff;
+    mac[5] = index & 0xff;
+}
+
+static void configure_server() {
+    server_ip = ntohl(inet_addr("127.0.0.1"));
+    subnet_mask = inet_addr("255.0.0.0");
+    gateway_ip = inet_addr("127.0.0.1");
+    dns_server_ip = inet_addr("127.0.0.1");
+    default_lease_time = 3600;
+}
+
+//================================================
+// Clientes contra los handlers (sin workers)
+
+typedef struct {
+    int sockfd;
+    struct sockaddr_in sink;   // Las respuestas van a un socket que nadie lee
+    uint32_t xid;
+} client_ctx_t;
+
+static size_t build_packet(struct dhcp_packet* packet, const uint8_t* mac, uint32_t xid, int type, uint32_t ip) {
+    memset(packet, 0, sizeof(*packet));
+    packet->op = 1;
+    packet->htype = 1;
+    packet->hlen = 6;
+    packet->xid = htonl(xid);
+    memcpy(packet->chaddr, mac, 6);
+    uint8_t* options = packet->options;
+    int length = 0;
+    options[length++] = 53;
+    options[length++] = 1;
+    options[length++] = (uint8_t)type;
+    if (type == DHCP_RELEASE) {
+        packet->ciaddr = htonl(ip);
+    } else if (ip) {
+        uint32_t requested = htonl(ip);
+        options[length++] = 50;
+        options[length++] = 4;
+        memcpy(&options[length], &requested, 4);
+        length += 4;
+    }
+    options[length++] = 255;
+    return offsetof(struct dhcp_packet, options) + length;
+}
+
+// Retorna la IP ofrecida (0 con NAK)
+static uint32_t discover(client_ctx_t* ctx, const uint8_t* mac) {
+    struct dhcp_packet packet;
+    dhcp_option_index_t options;
+    size_t length = build_packet(&packet, mac, ++ctx->xid, DHCP_DISCOVER, 0);
+    validate_dhcp_packet(&packet, length, &options);
+    return handle_dhcp_discover(ctx->sockfd, &ctx->sink, &packet, &options);
+}
+
+// Retorna 1 con ACK
+static int request(client_ctx_t* ctx, const uint8_t* mac, uint32_t ip) {
+    struct dhcp_packet packet;
+    dhcp_option_index_t options;
+    size_t length = build_packet(&packet, mac, ctx->xid, DHCP_REQUEST, ip);
+    validate_dhcp_packet(&packet, length, &options);
+    return handle_dhcp_request(ctx->sockfd, &ctx->sink, &packet, &options);
+}
+
+static void release(client_ctx_t* ctx, const uint8_t* mac, uint32_t ip) {
+    struct dhcp_packet packet;
+    dhcp_option_index_t options;
+    size_t length = build_packet(&packet, mac, ++ctx->xid, DHCP_RELEASE, ip);
+    validate_dhcp_packet(&packet, length, &options);
+    handle_dhcp_release(ctx->sockfd, &ctx->sink, &packet);
+}
+
+static void open_client(client_ctx_t* ctx) {
+    socklen_t sink_length = sizeof(ctx->sink);
+    int sink_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(&ctx->sink, 0, sizeof(ctx->sink));
+    ctx->sink.sin_family = AF_INET;
+    ctx->sink.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(sink_fd, (struct sockaddr*)&ctx->sink, sizeof(ctx->sink));
+    getsockname(sink_fd, (struct sockaddr*)&ctx->sink, &sink_length);
+    ctx->sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    ctx->xid = (uint32_t)sink_fd << 20;
+}
+
+static void start_pool(uint32_t first_ip, uint32_t size) {
+    init_ip_range(&global_ip_range, first_ip, first_ip + size - 1, 1);
+    split_ip_pool(&global_ip_range, 1);
+}
+
+//================================================
+// Tormenta de DISCOVER
+
+typedef struct {
+    uint32_t free_at[MAX_SAMPLES];   // Direcciones libres al final de cada segundo
+    uint32_t min_free;
+    uint32_t clients;                // Clientes legítimos que llegaron
+    uint32_t served;                 // Clientes legítimos con ACK
+    uint32_t pending;                // Ofertas pendientes al terminar
+    uint32_t expired;                // Ofertas de la tormenta que vencieron
+} storm_result_t;
+
+static void run_storm(client_ctx_t* ctx, uint32_t ttl_ms, int seconds, storm_result_t* result) {
+    offer_ttl_ms = ttl_ms;
+    start_pool(13u << 24, STORM_POOL);
+    memset(result, 0, sizeof(*result));
+    result->min_free = STORM_POOL;
+
+    uint8_t mac[6];
+    uint32_t flood = 0;
+    uint64_t start = now_ns();
+    uint64_t next_tick = 0;
+    int sample = 0;
+    while (sample < seconds) {
+        uint64_t elapsed_ms = (now_ns() - start) / 1000000;
+
+        // Lo que corresponde enviar hasta ahora de cada flujo
+        for (uint32_t due = (uint32_t)(elapsed_ms * FLOOD_RATE / 1000); flood < due; flood++) {
+            make_mac(mac, 0x800000 + flood);
+            discover(ctx, mac);
+        }
+        for (uint32_t due = (uint32_t)(elapsed_ms * CLIENT_RATE / 1000); result->clients < due; result->clients++) {
+            make_mac(mac, result->clients);
+            uint32_t offered = discover(ctx, mac);
+            result->served += offered != 0 && request(ctx, mac, offered);
+        }
+        if (elapsed_ms >= next_tick) {
+            check_expired_leases(&ip_shards[0]);
+            next_tick = elapsed_ms + EXPIRE_TICK_MS;
+        }
+
+        uint32_t free_now = ip_shards[0].free_map.free_count;
+        if (free_now < result->min_free) result->min_free = free_now;
+        if (elapsed_ms >= (uint64_t)(sample + 1) * 1000) {
+            result->free_at[sample++] = free_now;
+        }
+        struct timespec pause = { .tv_sec = 0, .tv_nsec = 200000 };
+        nanosleep(&pause, NULL);
+    }
+    result->pending = ip_shards[0].offers.live;
+    result->expired = ttl_ms ? flood - result->pending : 0;
+    free_ip_range(&ip_shards[0]);
+}
+
+static int check_storm(int seconds) {
+    int failed = 0;
+    client_ctx_t ctx;
+    open_client(&ctx);
+    fprintf(out, "Tormenta de DISCOVER: pool de %u, %u DISCOVER/s sin REQUEST y %u clientes/s con DORA durante %d s\n",
+            STORM_POOL, FLOOD_RATE, CLIENT_RATE, seconds);
+    fprintf(out, "  %-22s", "libres al final de");
+    for (int s = 0; s < seconds; s++) fprintf(out, " %5ds", s + 1);
+    fprintf(out, " %8s %16s %10s %10s\n", "mínimo", "clientes con IP", "pendientes", "vencidas");
+
+    const uint32_t ttls[] = { 0, 2000, 250 };
+    for (int i = 0; i < 3; i++) {
+        storm_result_t result;
+        run_storm(&ctx, ttls[i], seconds, &result);
+        char name[32];
+        snprintf(name, sizeof(name), ttls[i] ? "ofertas de %u ms" : "lease en el OFFER", ttls[i]);
+        fprintf(out, "  %-22s", name);
+        for (int s = 0; s < seconds; s++) fprintf(out, " %6u", result.free_at[s]);
+        fprintf(out, " %8u %9u de %4u %10u %10u\n", result.min_free, result.served, result.clients,
+                result.pending, result.expired);
+
+        if (ttls[i] == 0) {
+            // Sin tabla la tormenta agota el pool en cuanto los DISCOVER superan su tamaño
+            if ((uint64_t)FLOOD_RATE * seconds > STORM_POOL && result.served == result.clients) {
+                fprintf(out, "FALLO: sin ofertas pendientes la tormenta debía agotar el pool\n");
+                failed = 1;
+            }
+            continue;
+        }
+        // Con tabla la tormenta retiene a lo sumo lo que llega en un TTL (más un tick de reclamo)
+        uint32_t bound = (uint32_t)((uint64_t)FLOOD_RATE * (ttls[i] + 2 * EXPIRE_TICK_MS) / 1000) + 16;
+        if (result.served != result.clients || result.pending > bound ||
+            result.min_free + bound + result.clients < STORM_POOL) {
+            fprintf(out, "FALLO: con ofertas de %u ms la tormenta debe retener como mucho %u direcciones\n",
+                    ttls[i], bound);
+            failed = 1;
+        }
+    }
+    offer_ttl_ms = OFFER_TTL_DEFAULT_MS;
+    return failed;
+}
+
+//================================================
+// Ciclo de una oferta
+
+static int expect(int condition, const char* what) {
+    fprintf(out, "  %-62s %s\n", what, condition ? "sí" : "NO");
+    return !condition;
+}
+
+static int check_cycle() {
+    int failed = 0;
+    client_ctx_t ctx;
+    open_client(&ctx);
+    offer_ttl_ms = 200;
+    start_pool(14u << 24, 64);
+    ip_range_t* range = &ip_shards[0];
+    range->policy = IP_ALLOC_LOWEST;
+    uint8_t first[6], second[6], third[6], fourth[6];
+    make_mac(first, 1);
+    make_mac(second, 2);
+    make_mac(third, 3);
+    make_mac(fourth, 4);
+    fprintf(out, "Ciclo de una oferta (pool de 64, ofertas de %u ms):\n", offer_ttl_ms);
+
+    uint32_t offered = discover(&ctx, first);
+    uint32_t again = discover(&ctx, first);
+    failed |= expect(offered != 0 && again == offered && range->offers.live == 1 && range->leases.count == 0,
+                     "DISCOVER retransmitido: misma oferta, sin lease");
+    failed |= expect(!request(&ctx, second, offered) && range->offers.live == 1,
+                     "REQUEST de otra MAC por la IP ofrecida: NAK");
+    failed |= expect(request(&ctx, first, offered) && range->offers.live == 0 && range->leases.count == 1,
+                     "REQUEST de la MAC de la oferta: ACK y lease");
+
+    uint32_t free_before = range->free_map.free_count;
+    uint32_t withdrawn = discover(&ctx, third);
+    request(&ctx, third, (200u << 24) + 1);  // La IP de otro servidor (fuera del pool)
+    failed |= expect(withdrawn != 0 && range->offers.live == 0 && range->free_map.free_count == free_before,
+                     "REQUEST de una IP de otro servidor: la oferta vuelve al pool");
+
+    uint32_t expiring = discover(&ctx, fourth);
+    uint64_t now = timer_clock_ms();
+    uint64_t deadline = offer_table_next_deadline(&range->offers, now);
+    next_lease_deadline();  // Publica el gauge desde las tablas de los shards
+    failed |= expect(range->offers.tail - range->offers.head == 1 && deadline > now &&
+                     deadline <= now + offer_ttl_ms && dhcp_stats_attach()->values[DHCP_STAT_OFFERS_PENDING] == 1,
+                     "Ofertas muertas fuera del anillo y gauge de pendientes en 1");
+    struct timespec pause = { .tv_sec = 0, .tv_nsec = (offer_ttl_ms + 50) * 1000000L };
+    nanosleep(&pause, NULL);
+    check_expired_leases(range);
+    failed |= expect(range->offers.live == 0 && range->free_map.free_count == free_before,
+                     "Oferta sin REQUEST: vence y la IP vuelve al pool");
+    failed |= expect(request(&ctx, fourth, expiring) && range->leases.count == 2,
+                     "REQUEST por una oferta vencida que sigue libre: ACK");
+
+    // La primera MAC libera su IP; otra la recibe ofrecida antes de que la primera vuelva
+    release(&ctx, first, offered);
+    uint32_t taken = discover(&ctx, second);
+    uint32_t back = discover(&ctx, first);
+    failed |= expect(taken == offered && back != 0 && back != offered && request(&ctx, second, taken),
+                     "MAC que vuelve a una IP ofrecida a otra: recibe otra IP");
+
+    free_ip_range(range);
+    offer_ttl_ms = OFFER_TTL_DEFAULT_MS;
+    return failed;
+}
+
+int main(int argc, char* argv[]) {
+    configure_server();
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(out, NULL, _IOLBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+
+    int seconds = argc > 1 ? atoi(argv[1]) : 5;
+    if (seconds < 1) seconds = 1;
+    if (seconds > MAX_SAMPLES) seconds = MAX_SAMPLES;
+
+    int failed = check_storm(seconds);
+    failed |= check_cycle();
+    fprintf(out, "%s\n", failed ? "FALLO" : "OK");
+    return failed;
+}
@@ -0,0 +1,329 @@
+// Benchmark y prueba de corpus del índice de opciones (src/common/dhcp_protocol.c)
+//
+// 1. Corpus: paquetes semilla con el formato del cliente y del servidor, la magic cookie,
+//    relleno y la opción 52 (file y sname). Se verifican los valores esperados de cada uno.
+// 2. Mutaciones: cada semilla se altera al azar (bytes, longitudes y truncado) y el índice
+//    se compara con un decodificador de referencia escrito de forma directa. Cada paquete
+//    se copia justo antes de una página sin permisos: una lectura fuera de `length` aborta.
+// 3. Rendimiento: indexar un paquete y consultar 53, 50 y 55 frente a tres búsquedas
+//    lineales como las del antiguo find_dhcp_option.
+// Uso: ./bench_option_parser [mutaciones] [iteraciones]   (por defecto 1000000 y 10000000)
+// Retorna 1 si alguna verificación falla.
+
+#include "dhcp_protocol.h"
+#include <stdio.h>      // Para printf
+#include <stdlib.h>     // Para strtoul, rand_r
+#include <sys/mman.h>   // Para mmap, mprotect
+#include <time.h>       // Para clock_gettime
+#include <unistd.h>     // Para sysconf
+
+#define PACKET_MAX 576    // Datagrama DHCP más grande que se genera
+#define SEEDS_MAX 16
+
+typedef struct {
+    uint8_t bytes[PACKET_MAX];
+    size_t length;
+} packet_t;
+
+static packet_t seeds[SEEDS_MAX];
+static int seed_count = 0;
+static int failures = 0;
+
+static double monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void check(int condition, const char* what) {
+    if (!condition) {
+        printf("FALLO: %s\n", what);
+        failures++;
+    }
+}
+
+// Encabezado BOOTP de una solicitud y escritor posicionado en el campo de opciones
+static packet_t* new_seed(dhcp_option_writer_t* writer, int cookie) {
+    packet_t* packet = &seeds[seed_count++];
+    memset(packet, 0, sizeof(*packet));
+    packet->bytes[0] = 1;  // op
+    packet->bytes[1] = 1;  // htype
+    packet->bytes[2] = 6;  // hlen
+    size_t start = DHCP_HEADER_SIZE;
+    if (cookie) {
+        uint32_t magic = htonl(DHCP_MAGIC_COOKIE);
+        memcpy(packet->bytes + start, &magic, 4);
+        start += 4;
+    }
+    dhcp_writer_init(writer, packet->bytes + start, 312);
+    return packet;
+}
+
+static void finish_seed(packet_t* packet, dhcp_option_writer_t* writer) {
+    packet->length = (writer->buffer - packet->bytes) + dhcp_put_end(writer);
+}
+
+static void build_corpus() {
+    dhcp_option_writer_t writer;
+    const uint8_t list[] = {1, 3, 6};
+
+    // DISCOVER del cliente (sin cookie, como en el repositorio)
+    packet_t* packet = new_seed(&writer, 0);
+    dhcp_put_message_type(&writer, 1);
+    dhcp_put_parameter_list(&writer, list, sizeof(list));
+    finish_seed(packet, &writer);
+
+    // REQUEST del cliente
+    packet = new_seed(&writer, 0);
+    dhcp_put_message_type(&writer, 3);
+    dhcp_put_requested_ip(&writer, htonl(0x0a000005));
+    dhcp_put_server_id(&writer, htonl(0x0a000001));
+    dhcp_put_parameter_list(&writer, list, sizeof(list));
+    finish_seed(packet, &writer);
+
+    // ACK con todas las opciones del servidor y la magic cookie
+    packet = new_seed(&writer, 1);
+    dhcp_put_message_type(&writer, 5);
+    dhcp_put_server_id(&writer, htonl(0x0a000001));
+    dhcp_put_lease_time(&writer, 3600);
+    dhcp_put_subnet_mask(&writer, htonl(0xffffff00));
+    dhcp_put_router(&writer, htonl(0x0a000001));
+    dhcp_put_dns_server(&writer, htonl(0x08080808));
+    dhcp_put_hostname(&writer, "DHCPClient", 10);
+    dhcp_put_domain_name(&writer, "example.com", 11);
+    finish_seed(packet, &writer);
+
+    // Relleno entre opciones y sin opción 255 (termina con el paquete)
+    packet = new_seed(&writer, 0);
+    dhcp_put_message_type(&writer, 7);
+    writer.buffer[writer.length++] = 0;
+    writer.buffer[writer.length++] = 0;
+    dhcp_put_requested_ip(&writer, htonl(0x0a000009));
+    packet->length = DHCP_HEADER_SIZE + writer.length;
+
+    // Opción 52: el tipo de mensaje en file y el servidor en sname
+    packet = new_seed(&writer, 1);
+    dhcp_put_overload(&writer, DHCP_OVERLOAD_FILE | DHCP_OVERLOAD_SNAME);
+    finish_seed(packet, &writer);
+    dhcp_option_writer_t field;
+    dhcp_writer_init(&field, packet->bytes + DHCP_FILE_OFFSET, 128);
+    dhcp_put_message_type(&field, 4);
+    dhcp_put_end(&field);
+    dhcp_writer_init(&field, packet->bytes + DHCP_SNAME_OFFSET, 64);
+    dhcp_put_server_id(&field, htonl(0x0a000002));
+    dhcp_put_end(&field);
+
+    // Opción conocida con longitud inválida y un código repetido (vale el primero)
+    packet = new_seed(&writer, 0);
+    dhcp_put_message_type(&writer, 1);
+    dhcp_put_option(&writer, DHCP_OPTION_REQUESTED_IP, "\x0a\x00", 2);
+    dhcp_put_message_type(&writer, 3);
+    finish_seed(packet, &writer);
+}
+
+static void check_corpus() {
+    dhcp_option_index_t index;
+    uint8_t type;
+    uint32_t value;
+    const uint8_t* data;
+    uint8_t length;
+
+    check(dhcp_parse_options(&index, seeds[0].bytes, seeds[0].length) == 0, "DISCOVER se indexa");
+    check(dhcp_get_message_type(&index, &type) && type == 1, "DISCOVER: tipo 1");
+    check(dhcp_get_parameter_list(&index, &data, &length) && length == 3 && data[2] == 6, "DISCOVER: opción 55");
+
+    check(dhcp_parse_options(&index, seeds[1].bytes, seeds[1].length) == 0, "REQUEST se indexa");
+    check(dhcp_get_requested_ip(&index, &value) && value == htonl(0x0a000005), "REQUEST: opción 50");
+    check(dhcp_get_server_id(&index, &value) && value == htonl(0x0a000001), "REQUEST: opción 54");
+
+    check(dhcp_parse_options(&index, seeds[2].bytes, seeds[2].length) == 0 && index.has_cookie, "ACK con cookie");
+    check(dhcp_get_lease_time(&index, &value) && value == 3600, "ACK: opción 51 en orden de host");
+    check(dhcp_get_domain_name(&index, &data, &length) && length == 11 && memcmp(data, "example.com", 11) == 0,
+          "ACK: opción 15");
+
+    check(dhcp_parse_options(&index, seeds[3].bytes, seeds[3].length) == 0, "Relleno y sin opción 255");
+    check(dhcp_get_requested_ip(&index, &value) && value == htonl(0x0a000009), "Relleno: opción 50");
+    check(dhcp_parse_options(&index, seeds[3].bytes, seeds[3].length - 1) < 0, "Opción truncada se rechaza");
+
+    check(dhcp_parse_options(&index, seeds[4].bytes, seeds[4].length) == 0 && index.overload == 3, "Opción 52");
+    check(dhcp_get_message_type(&index, &type) && type == 4, "Opción 52: tipo en file");
+    check(dhcp_get_server_id(&index, &value) && value == htonl(0x0a000002), "Opción 52: servidor en sname");
+
+    check(dhcp_parse_options(&index, seeds[5].bytes, seeds[5].length) == 0, "Longitud inválida");
+    check(!dhcp_get_requested_ip(&index, &value), "Opción 50 de 2 bytes se ignora");
+    check(dhcp_get_message_type(&index, &type) && type == 1, "Código repetido: vale el primero");
+
+    check(dhcp_parse_options(&index, seeds[0].bytes, DHCP_HEADER_SIZE - 1) < 0, "Paquete más corto que el encabezado");
+}
+
+// Decodificador de referencia: lista de opciones de un campo, sin atajos
+typedef struct {
+    int count;
+    uint8_t code[PACKET_MAX];
+    uint16_t offset[PACKET_MAX];
+    uint8_t length[PACKET_MAX];
+} option_list_t;
+
+static int reference_field(option_list_t* list, const uint8_t* packet, size_t start, size_t end) {
+    size_t i = start;
+    while (i < end) {
+        if (packet[i] == 0) { i++; continue; }
+        if (packet[i] == 255) return 0;
+        if (i + 1 >= end || i + 2 + packet[i + 1] > end) return -1;
+        list->code[list->count] = packet[i];
+        list->offset[list->count] = (uint16_t)(i + 2);
+        list->length[list->count] = packet[i + 1];
+        list->count++;
+        i += 2 + packet[i + 1];
+    }
+    return 0;
+}
+
+static int reference_valid(uint8_t code, uint8_t length) {
+    const dhcp_option_def_t* def = &dhcp_option_defs[code];
+    return !def->name || (length >= def->min_length && length <= def->max_length);
+}
+
+static int reference_first(option_list_t* list, uint8_t code) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->code[i] == code && reference_valid(code, list->length[i])) return i;
+    }
+    return -1;
+}
+
+static int reference_parse(option_list_t* list, const uint8_t* packet, size_t length) {
+    list->count = 0;
+    if (length < DHCP_HEADER_SIZE) return -1;
+    size_t start = DHCP_HEADER_SIZE;
+    if (length >= start + 4 && packet[start] == 99 && packet[start + 1] == 130 &&
+        packet[start + 2] == 83 && packet[start + 3] == 99) {
+        start += 4;
+    }
+    if (reference_field(list, packet, start, length) < 0) return -1;
+    int overload = reference_first(list, DHCP_OPTION_OVERLOAD);
+    if (overload >= 0) {
+        uint8_t value = packet[list->offset[overload]];
+        if ((value & 1) && reference_field(list, packet, DHCP_FILE_OFFSET, DHCP_FILE_OFFSET + 128) < 0) return -1;
+        if ((value & 2) && reference_field(list, packet, DHCP_SNAME_OFFSET, DHCP_SNAME_OFFSET + 64) < 0) return -1;
+    }
+    return 0;
+}
+
+static void mutate(packet_t* packet, unsigned int* seed) {
+    int changes = 1 + rand_r(seed) % 4;
+    for (int c = 0; c < changes; c++) {
+        size_t position = DHCP_SNAME_OFFSET + rand_r(seed) % (PACKET_MAX - DHCP_SNAME_OFFSET);
+        switch (rand_r(seed) % 5) {
+            case 0: packet->bytes[position] = (uint8_t)rand_r(seed); break;           // Byte al azar
+            case 1: packet->bytes[position] = (uint8_t)(rand_r(seed) % 64); break;    // Longitud plausible
+            case 2: packet->bytes[position] = 255; break;                             // Fin prematuro
+            case 3: packet->length = DHCP_HEADER_SIZE + rand_r(seed) % (PACKET_MAX - DHCP_HEADER_SIZE); break;
+            case 4: packet->bytes[DHCP_HEADER_SIZE + rand_r(seed) % 8] = DHCP_OPTION_OVERLOAD; break;
+        }
+    }
+    if (rand_r(seed) % 16 == 0) packet->length = rand_r(seed) % DHCP_HEADER_SIZE;
+}
+
+static void run_mutations(unsigned long mutations) {
+    // Buffer de dos páginas con la segunda sin permisos
+    long page = sysconf(_SC_PAGESIZE);
+    uint8_t* area = mmap(NULL, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED || mprotect(area + page, page, PROT_NONE) < 0) {
+        perror("Error al preparar la página de guarda");
+        failures++;
+        return;
+    }
+
+    unsigned int seed = 12345;
+    unsigned long rejected = 0, differences = 0;
+    dhcp_option_index_t index;
+    option_list_t reference;
+    for (unsigned long m = 0; m < mutations; m++) {
+        packet_t packet = seeds[m % seed_count];
+        mutate(&packet, &seed);
+
+        // El paquete termina justo donde empieza la página de guarda
+        uint8_t* copy = area + page - packet.length;
+        memcpy(copy, packet.bytes, packet.length);
+
+        int result = dhcp_parse_options(&index, copy, packet.length);
+        int expected = reference_parse(&reference, copy, packet.length);
+        int same = (result < 0) == (expected < 0);
+        if (same && result == 0) {
+            for (int code = 1; code < 255 && same; code++) {
+                int first = reference_first(&reference, (uint8_t)code);
+                uint8_t length = 0;
+                const uint8_t* value = dhcp_option_get(&index, (uint8_t)code, &length);
+                if (first < 0) {
+                    same = value == NULL;
+                } else {
+                    same = value == copy + reference.offset[first] && length == reference.length[first];
+                }
+            }
+        }
+        if (result < 0) rejected++;
+        if (!same) {
+            differences++;
+            if (differences <= 5) printf("FALLO: la mutación %lu difiere de la referencia\n", m);
+        }
+    }
+    failures += differences > 0;
+    printf("Mutaciones: %lu paquetes, %lu rechazados por mal formados, %lu diferencias con la referencia\n",
+           mutations, rejected, differences);
+    munmap(area, 2 * page);
+}
+
+// Búsqueda lineal como la del antiguo find_dhcp_option (sin los printf)
+static const uint8_t* linear_find(const uint8_t* options, uint8_t code) {
+    int i = 0;
+    while (i < 312) {
+        if (options[i] == 255) break;
+        if (options[i] == code) return &options[i + 2];
+        i += 2 + options[i + 1];
+    }
+    return NULL;
+}
+
+static volatile uintptr_t sink;  // Evita que el compilador descarte las búsquedas
+
+static void run_benchmark(unsigned long iterations) {
+    packet_t packet = seeds[1];  // REQUEST del cliente
+    dhcp_option_index_t index;
+
+    double start = monotonic_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        const uint8_t* options = packet.bytes + DHCP_HEADER_SIZE;
+        sink = (uintptr_t)linear_find(options, 53) ^ (uintptr_t)linear_find(options, 50) ^
+               (uintptr_t)linear_find(options, 55);
+    }
+    double linear = (monotonic_ns() - start) / iterations;
+
+    start = monotonic_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        dhcp_parse_options(&index, packet.bytes, packet.length);
+        sink = (uintptr_t)dhcp_option_get(&index, 53, NULL) ^ (uintptr_t)dhcp_option_get(&index, 50, NULL) ^
+               (uintptr_t)dhcp_option_get(&index, 55, NULL);
+    }
+    double indexed = (monotonic_ns() - start) / iterations;
+
+    start = monotonic_ns();
+    for (unsigned long i = 0; i < iterations; i++) {
+        sink = (uintptr_t)dhcp_option_get(&index, (uint8_t)(i & 0xff), NULL);
+    }
+    double lookup = (monotonic_ns() - start) / iterations;
+
+    printf("REQUEST (%zu bytes): 3 búsquedas lineales %.1f ns, índice + 3 consultas %.1f ns, consulta sola %.2f ns\n",
+           packet.length, linear, indexed, lookup);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long mutations = argc > 1 ? strtoul(argv[1], NULL, 10) : 1000000;
+    unsigned long iterations = argc > 2 ? strtoul(argv[2], NULL, 10) : 10000000;
+
+    build_corpus();
+    check_corpus();
+    printf("Corpus: %d paquetes semilla, %s\n", seed_count, failures ? "con fallos" : "todas las verificaciones pasan");
+    run_mutations(mutations);
+    run_benchmark(iterations);
+    return failures ? 1 : 0;
+}
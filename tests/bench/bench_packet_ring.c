@@ -0,0 +1,184 @@
+// Benchmark del anillo de paquetes y las colas de descriptores (src/server/packet_ring.c)
+//
+// Un hilo productor simula al hilo que recibe y otro al worker. Se compara el reparto
+// anterior (cola protegida por mutex y condición, con el datagrama de 548 bytes copiado
+// al encolar y otra vez al desencolar) con el actual: el productor escribe el datagrama
+// en un slot del anillo, encola solo su descriptor sin locks y el consumidor lo lee en el
+// slot y lo suelta. Se reportan ns por paquete y las copias del datagrama por paquete.
+// Uso: ./bench_packet_ring [paquetes]   (por defecto 2000000)
+// Retorna 1 si el consumidor no recibió todos los paquetes intactos.
+
+#include "packet_ring.h"
+#include <pthread.h>  // Para hilos
+#include <sched.h>    // Para sched_yield
+#include <stdio.h>    // Para printf
+#include <stdlib.h>   // Para strtoul, malloc
+#include <string.h>   // Para memcpy
+#include <time.h>     // Para clock_gettime
+
+#define PACKET_SIZE 548   // Datagrama DHCP completo
+#define QUEUE_SIZE 1024   // Igual que WORKER_QUEUE_SIZE
+#define BATCH 32          // Descriptores que el consumidor toma por pasada
+
+static unsigned long packets;
+static unsigned long copies;  // Copias del datagrama fuera del "kernel" (el productor)
+
+static double monotonic_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// El contenido lleva el número de paquete para verificar que llega intacto
+static void fill_packet(uint8_t* data, unsigned long n) {
+    memcpy(data, &n, sizeof(n));
+    data[PACKET_SIZE - 1] = (uint8_t)n;
+}
+
+static int check_packet(const uint8_t* data, unsigned long n) {
+    unsigned long value;
+    memcpy(&value, data, sizeof(value));
+    return value == n && data[PACKET_SIZE - 1] == (uint8_t)n;
+}
+
+// Cola anterior: elementos con el datagrama completo y un mutex para todo
+typedef struct {
+    struct sockaddr_in client_addr;
+    size_t length;
+    uint8_t buffer[PACKET_SIZE];
+} copy_item_t;
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    copy_item_t* items;
+    unsigned int head, count;
+} copy_queue;
+
+static unsigned long copy_received, copy_corrupt;
+
+static void* copy_consumer(void* arg) {
+    (void)arg;
+    copy_item_t batch[BATCH];
+    while (copy_received < packets) {
+        pthread_mutex_lock(&copy_queue.mutex);
+        while (copy_queue.count == 0) {
+            pthread_cond_wait(&copy_queue.cond, &copy_queue.mutex);
+        }
+        int taken = 0;
+        while (copy_queue.count > 0 && taken < BATCH) {
+            batch[taken++] = copy_queue.items[copy_queue.head];  // Segunda copia
+            copy_queue.head = (copy_queue.head + 1) % QUEUE_SIZE;
+            copy_queue.count--;
+        }
+        copies += taken;
+        pthread_mutex_unlock(&copy_queue.mutex);
+        for (int i = 0; i < taken; i++) {
+            copy_corrupt += !check_packet(batch[i].buffer, copy_received++);
+        }
+    }
+    return NULL;
+}
+
+static double run_copy_queue() {
+    uint8_t rx_buffer[PACKET_SIZE] = {0};  // Buffer de recepción del hilo principal
+    struct sockaddr_in addr = {0};
+    pthread_mutex_init(&copy_queue.mutex, NULL);
+    pthread_cond_init(&copy_queue.cond, NULL);
+    copy_queue.items = malloc(QUEUE_SIZE * sizeof(copy_item_t));
+
+    pthread_t consumer;
+    double start = monotonic_seconds();
+    pthread_create(&consumer, NULL, copy_consumer, NULL);
+    for (unsigned long n = 0; n < packets; n++) {
+        fill_packet(rx_buffer, n);  // Lo que haría el kernel en recvmmsg
+        pthread_mutex_lock(&copy_queue.mutex);
+        while (copy_queue.count == QUEUE_SIZE) {
+            pthread_mutex_unlock(&copy_queue.mutex);
+            sched_yield();
+            pthread_mutex_lock(&copy_queue.mutex);
+        }
+        copy_item_t* item = &copy_queue.items[(copy_queue.head + copy_queue.count) % QUEUE_SIZE];
+        item->client_addr = addr;
+        item->length = PACKET_SIZE;
+        memcpy(item->buffer, rx_buffer, PACKET_SIZE);  // Primera copia
+        copies++;
+        copy_queue.count++;
+        pthread_cond_signal(&copy_queue.cond);
+        pthread_mutex_unlock(&copy_queue.mutex);
+    }
+    pthread_join(consumer, NULL);
+    double elapsed = monotonic_seconds() - start;
+    free(copy_queue.items);
+    return elapsed;
+}
+
+// Reparto actual: slots del anillo y descriptores por una cola sin locks
+static packet_ring_t ring;
+static packet_queue_t queue;
+static unsigned long ring_received, ring_corrupt;
+
+static void* ring_consumer(void* arg) {
+    (void)arg;
+    dhcp_packet_desc_t batch[BATCH];
+    while (ring_received < packets) {
+        int taken = packet_queue_pop(&queue, batch, BATCH);
+        if (taken == 0) {
+            sched_yield();
+            continue;
+        }
+        for (int i = 0; i < taken; i++) {
+            ring_corrupt += !check_packet(batch[i].data, ring_received++) || batch[i].length != PACKET_SIZE;
+            packet_ring_release(&ring, batch[i].slot);
+        }
+    }
+    return NULL;
+}
+
+static double run_packet_ring() {
+    packet_ring_init(&ring, 2 * QUEUE_SIZE + BATCH);
+    packet_queue_init(&queue, QUEUE_SIZE);
+    struct sockaddr_in addr = {0};
+
+    pthread_t consumer;
+    double start = monotonic_seconds();
+    pthread_create(&consumer, NULL, ring_consumer, NULL);
+    for (unsigned long n = 0; n < packets; n++) {
+        int slot;
+        while ((slot = packet_ring_acquire(&ring)) < 0) {
+            sched_yield();
+        }
+        dhcp_packet_desc_t desc;
+        desc.slot = (uint32_t)slot;
+        desc.data = packet_ring_data(&ring, desc.slot);
+        desc.length = PACKET_SIZE;
+        desc.client_addr = addr;
+        desc.rx_ns = 0;
+        fill_packet(desc.data, n);  // Lo que haría el kernel en recvmmsg, directo en el slot
+        while (packet_queue_push(&queue, &desc) < 0) {
+            sched_yield();
+        }
+    }
+    pthread_join(consumer, NULL);
+    double elapsed = monotonic_seconds() - start;
+    printf("  anillo de %u slots, agotado %lu veces\n", ring.size, ring.exhausted);
+    packet_queue_free(&queue);
+    packet_ring_free(&ring);
+    return elapsed;
+}
+
+int main(int argc, char* argv[]) {
+    packets = argc > 1 ? strtoul(argv[1], NULL, 10) : 2000000;
+
+    copies = 0;
+    double copy_seconds = run_copy_queue();
+    printf("Cola con mutex y copias:   %6.1f ns/paquete, %.2f copias/paquete, %lu recibidos, %lu dañados\n",
+           copy_seconds * 1e9 / packets, (double)copies / packets, copy_received, copy_corrupt);
+
+    copies = 0;
+    double ring_seconds = run_packet_ring();
+    printf("Anillo y descriptores:     %6.1f ns/paquete, %.2f copias/paquete, %lu recibidos, %lu dañados\n",
+           ring_seconds * 1e9 / packets, (double)copies / packets, ring_received, ring_corrupt);
+
+    return (copy_received == packets && ring_received == packets && !copy_corrupt && !ring_corrupt) ? 0 : 1;
+}
@@ -0,0 +1,215 @@
+// Benchmark del modo SO_REUSEPORT: DORA/s por loopback según el número de hilos
+//
+// Levanta el grupo de sockets SO_REUSEPORT en un puerto libre con el pool dividido en
+// un shard por hilo y un generador envía por loopback ventanas de DISCOVERs y luego los
+// REQUESTs de las IPs ofrecidas. Con el reparto por MAC (BPF) cada hilo descarta las
+// MACs ajenas, así que recibir un ACK por cada MAC confirma que el kernel entregó cada
+// paquete al hilo dueño de su chaddr.
+// Uso: ./bench_reuseport [macs] [hilos...]   (por defecto 50000 MACs, hilos 1 2 4)
+// DHCP_STEERING=kernel mide el reparto por 4-tupla del kernel en lugar del programa BPF.
+
+#include "dhcp_server.h"
+#include <sys/resource.h>
+
+#define WINDOW 64   // Solicitudes en vuelo del generador
+
+static FILE* out;  // Salida de resultados (stdout real, el servidor escribe en /dev/null)
+
+static double cpu_seconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static double wall_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void make_mac(uint8_t* mac, uint32_t index) {
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = (index >> 24) & 0xff;
+    mac[3] = (index >> 16) & 0xff;
+    mac[4] = (index >> 8) & 0xff;
+    mac[5] = index & 0xff;
+}
+
+static uint32_t mac_index(const uint8_t* mac) {
+    return (uint32_t)mac[2] << 24 | (uint32_t)mac[3] << 16 | (uint32_t)mac[4] << 8 | mac[5];
+}
+
+static size_t build_packet(struct dhcp_packet* packet, uint32_t index, uint8_t type, uint32_t requested_ip) {
+    memset(packet, 0, sizeof(*packet));
+    packet->op = 1;
+    packet->htype = 1;
+    packet->hlen = 6;
+    packet->xid = htonl(0x3000 + index);
+    make_mac(packet->chaddr, index);
+
+    int i = 0;
+    packet->options[i++] = 53;
+    packet->options[i++] = 1;
+    packet->options[i++] = type;
+    if (requested_ip) {
+        uint32_t net_ip = htonl(requested_ip);
+        packet->options[i++] = 50;
+        packet->options[i++] = 4;
+        memcpy(&packet->options[i], &net_ip, 4);
+        i += 4;
+    }
+    packet->options[i++] = 255;
+    return sizeof(*packet) - sizeof(packet->options) + i;
+}
+
+// Elegir un puerto UDP libre para el grupo SO_REUSEPORT
+static uint16_t free_port() {
+    struct sockaddr_in addr;
+    socklen_t len = sizeof(addr);
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    bind(fd, (struct sockaddr*)&addr, sizeof(addr));
+    getsockname(fd, (struct sockaddr*)&addr, &len);
+    close(fd);
+    return ntohs(addr.sin_port);
+}
+
+// Enviar una ventana de solicitudes y recoger las respuestas del tipo esperado
+static uint32_t exchange(int fd, struct sockaddr_in* server, uint32_t first, int count, uint8_t type,
+                         uint32_t* offered, uint8_t expected, dhcp_msg_batch_t* rx) {
+    struct dhcp_packet requests[WINDOW];
+    struct iovec iov[WINDOW];
+    struct mmsghdr msgs[WINDOW];
+
+    for (int i = 0; i < count; i++) {
+        uint32_t index = first + i;
+        iov[i].iov_base = &requests[i];
+        iov[i].iov_len = build_packet(&requests[i], index, type, type == DHCP_REQUEST ? offered[index] : 0);
+        memset(&msgs[i], 0, sizeof(msgs[i]));
+        msgs[i].msg_hdr.msg_name = server;
+        msgs[i].msg_hdr.msg_namelen = sizeof(*server);
+        msgs[i].msg_hdr.msg_iov = &iov[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    for (int sent = 0; sent < count; ) {
+        int queued = sendmmsg(fd, msgs + sent, count - sent, 0);
+        sent += queued > 0 ? queued : count - sent;
+    }
+
+    // Leer hasta tener todas las respuestas o hasta que venza el timeout del socket
+    uint32_t answered = 0;
+    while (answered < (uint32_t)count) {
+        int received = receive_dhcp_batch(fd, rx, MSG_WAITFORONE);
+        if (received <= 0) break;
+        for (int i = 0; i < received; i++) {
+            struct dhcp_packet* reply = (struct dhcp_packet*)rx->buffers[i];
+            dhcp_option_index_t options;
+            uint8_t message_type;
+            if (dhcp_parse_options(&options, rx->buffers[i], rx->msgs[i].msg_len) < 0 ||
+                reply->op != 2 || !dhcp_get_message_type(&options, &message_type)) continue;
+            if (message_type == expected) {
+                if (expected == DHCP_OFFER) offered[mac_index(reply->chaddr)] = ntohl(reply->yiaddr);
+                answered++;
+            } else {
+                answered++;  // NAK u otra respuesta: cuenta para no esperar el timeout
+            }
+        }
+    }
+    return answered;
+}
+
+static void run(uint32_t macs, int threads, int steer_by_chaddr, int round) {
+    uint16_t port = free_port();
+
+    // Un pool nuevo por ronda dividido en un shard por hilo
+    uint32_t start_ip = (uint32_t)(10 + round) << 24;
+    init_ip_range(&global_ip_range, start_ip, start_ip + macs + 1, round);
+    split_ip_pool(&global_ip_range, threads);
+    if (start_reuseport_workers(threads, port, steer_by_chaddr) < 0) {
+        fprintf(out, "%d hilos: no se pudo iniciar el grupo SO_REUSEPORT\n", threads);
+        return;
+    }
+
+    // Socket del generador por loopback
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    int rcvbuf = 4 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    struct sockaddr_in server;
+    memset(&server, 0, sizeof(server));
+    server.sin_family = AF_INET;
+    server.sin_port = htons(port);
+    server.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    uint32_t* offered = (uint32_t*)calloc(macs, sizeof(uint32_t));
+    dhcp_msg_batch_t rx;
+    dhcp_batch_init(&rx, WINDOW);
+
+    uint32_t offers = 0, acks = 0;
+    double cpu_start = cpu_seconds();
+    double wall_start = wall_seconds();
+    for (uint32_t first = 0; first < macs; first += WINDOW) {
+        int count = macs - first < WINDOW ? (int)(macs - first) : WINDOW;
+        offers += exchange(fd, &server, first, count, DHCP_DISCOVER, offered, DHCP_OFFER, &rx);
+        acks += exchange(fd, &server, first, count, DHCP_REQUEST, offered, DHCP_ACK, &rx);
+    }
+    double cpu = cpu_seconds() - cpu_start;
+    double wall = wall_seconds() - wall_start;
+
+    // Cada IP ofrecida debe salir del shard preferido de su MAC mientras el shard tenga libres
+    uint32_t home = 0;
+    for (uint32_t i = 0; i < macs; i++) {
+        uint8_t mac[6];
+        make_mac(mac, i);
+        if (offered[i] && shard_for_ip(offered[i]) == shard_for_mac(mac)) home++;
+    }
+
+    fprintf(out, "%2d hilos (%s): %u/%u OFFER, %u/%u ACK, %.0f DORA/s, CPU/DORA %.2f us, "
+                 "%.1f%% de IPs del shard propio\n",
+            threads, steer_by_chaddr ? "chaddr" : "kernel", offers, macs, acks, macs,
+            acks / wall, acks ? cpu * 1e6 / acks : 0.0, macs ? 100.0 * home / macs : 0.0);
+
+    stop_reuseport_workers();
+    dhcp_batch_free(&rx);
+    free(offered);
+    close(fd);
+    for (int i = 0; i < num_ip_shards; i++) {
+        free_ip_range(&ip_shards[i]);
+    }
+    if (ip_shards != &global_ip_range) {
+        free(ip_shards);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    // Resultados por el stdout real; los logs del servidor se descartan
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(out, NULL, _IOLBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+
+    server_ip = ntohl(inet_addr("127.0.0.1"));
+    subnet_mask = inet_addr("255.0.0.0");
+    gateway_ip = inet_addr("127.0.0.1");
+    dns_server_ip = inet_addr("127.0.0.1");
+    default_lease_time = 3600;
+
+    const char* steering = getenv("DHCP_STEERING");
+    int steer_by_chaddr = !steering || strcmp(steering, "kernel") != 0;
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    fprintf(out, "Núcleos disponibles: %ld\n", cores);
+
+    uint32_t macs = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 50000;
+    int defaults[] = {1, 2, 4};
+    int rounds = argc > 2 ? argc - 2 : 3;
+    for (int r = 0; r < rounds; r++) {
+        run(macs, argc > 2 ? atoi(argv[r + 2]) : defaults[r], steer_by_chaddr, r);
+    }
+    return 0;
+}
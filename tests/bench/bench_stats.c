@@ -0,0 +1,139 @@
+// Benchmark del segmento de estadísticas en memoria compartida (src/server/dhcp_stats.c)
+//
+// Mide el costo de publicar un contador (dhcp_stat_inc) contra un incremento atómico
+// compartido, y verifica que los lectores ven lecturas coherentes: cada hilo escritor
+// incrementa RX_DISCOVER y después TX_OFFER, así que en cualquier lectura consistente
+// DISCOVER - OFFER está entre 0 y la cantidad de hilos. Un lector copia el segmento sin
+// pausa mientras los escritores trabajan, y se compara el costo con y sin lector.
+// Uso: ./bench_stats [incrementos] [hilos]   (por defecto 20000000 y 4)
+// Retorna 1 si alguna lectura es incoherente o los totales finales no son exactos.
+
+#include "dhcp_stats.h"
+#include <pthread.h>  // Para hilos
+#include <stdint.h>   // Para uint64_t
+#include <stdio.h>    // Para printf
+#include <stdlib.h>   // Para strtoul
+#include <time.h>     // Para clock_gettime
+
+#define BENCH_STATS_NAME "/bench_dhcp_stats"
+#define MAX_THREADS 64
+
+static unsigned long increments_per_thread;
+static uint64_t shared_counter;
+static volatile int writers_running;
+
+static double monotonic_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void* publish_stats(void* arg) {
+    (void)arg;
+    for (unsigned long i = 0; i < increments_per_thread; i++) {
+        dhcp_stat_inc(DHCP_STAT_RX_DISCOVER);
+        dhcp_stat_inc(DHCP_STAT_TX_OFFER);
+    }
+    return NULL;
+}
+
+static void* publish_atomic(void* arg) {
+    (void)arg;
+    for (unsigned long i = 0; i < increments_per_thread; i++) {
+        __atomic_fetch_add(&shared_counter, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&shared_counter, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+typedef struct {
+    unsigned long reads;
+    unsigned long inconsistent;
+    int threads;
+} reader_result_t;
+
+static void* read_stats(void* arg) {
+    reader_result_t* result = (reader_result_t*)arg;
+    dhcp_stats_snapshot_t snapshot;
+    while (writers_running) {
+        if (dhcp_stats_read(BENCH_STATS_NAME, &snapshot) < 0) {
+            result->inconsistent++;
+            continue;
+        }
+        uint64_t discover = snapshot.values[DHCP_STAT_RX_DISCOVER];
+        uint64_t offer = snapshot.values[DHCP_STAT_TX_OFFER];
+        if (offer > discover || discover - offer > (uint64_t)result->threads) {
+            result->inconsistent++;
+        }
+        result->reads++;
+    }
+    return NULL;
+}
+
+// Lanzar `threads` escritores con `body` y, si se pide, un lector en paralelo. Retorna ns por incremento.
+static double run_writers(void* (*body)(void*), int threads, reader_result_t* reader) {
+    pthread_t writers[MAX_THREADS];
+    pthread_t reader_thread;
+
+    writers_running = 1;
+    if (reader) {
+        pthread_create(&reader_thread, NULL, read_stats, reader);
+    }
+    double start = monotonic_seconds();
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&writers[i], NULL, body, NULL);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(writers[i], NULL);
+    }
+    double elapsed = monotonic_seconds() - start;
+    writers_running = 0;
+    if (reader) {
+        pthread_join(reader_thread, NULL);
+    }
+    return elapsed * 1e9 / ((double)increments_per_thread * 2);
+}
+
+int main(int argc, char* argv[]) {
+    unsigned long increments = argc > 1 ? strtoul(argv[1], NULL, 10) : 20000000;
+    int threads = argc > 2 ? (int)strtoul(argv[2], NULL, 10) : 4;
+    if (threads < 1) threads = 1;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    increments_per_thread = increments / threads;
+
+    if (dhcp_stats_open(BENCH_STATS_NAME) < 0) {
+        fprintf(stderr, "No se pudo crear el segmento %s\n", BENCH_STATS_NAME);
+        return 1;
+    }
+
+    printf("Segmento de estadísticas: %lu incrementos por hilo, %d hilos\n", increments_per_thread, threads);
+    double atomic_ns = run_writers(publish_atomic, threads, NULL);
+    printf("  fetch_add compartido:          %6.2f ns por incremento (por hilo)\n", atomic_ns);
+
+    double alone_ns = run_writers(publish_stats, threads, NULL);
+    printf("  dhcp_stat_inc sin lector:      %6.2f ns por incremento (por hilo)\n", alone_ns);
+
+    reader_result_t reader = { 0, 0, threads };
+    double read_ns = run_writers(publish_stats, threads, &reader);
+    printf("  dhcp_stat_inc con lector:      %6.2f ns por incremento (por hilo)\n", read_ns);
+    printf("  Lecturas del segmento: %lu, incoherentes: %lu\n", reader.reads, reader.inconsistent);
+
+    // Cada ronda de dhcp_stat_inc usa hilos nuevos (ranuras nuevas); los totales se suman
+    dhcp_stats_snapshot_t snapshot;
+    int failed = reader.inconsistent > 0;
+    if (dhcp_stats_read(BENCH_STATS_NAME, &snapshot) < 0) {
+        failed = 1;
+    } else {
+        uint64_t expected = (uint64_t)increments_per_thread * threads * 2;   // Dos rondas
+        printf("  Totales: DISCOVER %llu, OFFER %llu (esperado %llu), ranuras usadas %u\n",
+               (unsigned long long)snapshot.values[DHCP_STAT_RX_DISCOVER],
+               (unsigned long long)snapshot.values[DHCP_STAT_TX_OFFER], (unsigned long long)expected,
+               snapshot.header.slots_used);
+        failed |= snapshot.values[DHCP_STAT_RX_DISCOVER] != expected ||
+                  snapshot.values[DHCP_STAT_TX_OFFER] != expected;
+    }
+    dhcp_stats_remove();
+
+    printf("%s\n", failed ? "FALLO: lecturas incoherentes o totales inexactos" : "OK");
+    return failed;
+}
@@ -0,0 +1,111 @@
+// Benchmark de la rueda jerárquica de timers para el vencimiento de leases
+//
+// Programa N timers (ticks de 1 ms) con vencimientos repartidos en una hora y mide:
+// programar, reprogramar (renovación), cancelar, un tick de vencimiento sin nada que
+// vencer y el costo por lease vencido al reclamar un lote. Como referencia mide el
+// recorrido completo de N leases que hacía check_expired_leases antes de cada paquete.
+// Uso: ./bench_timer_wheel [timers...]   (por defecto 1000000)
+
+#include "timer_wheel.h"
+#include "lease_store.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define HOUR_MS 3600000ULL
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint32_t next_random() {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)rng_state;
+}
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void measure(uint32_t timers) {
+    timer_wheel_t wheel;
+    uint64_t base = 1000000;  // Tick inicial arbitrario
+    if (timer_wheel_init(&wheel, timers, base) < 0) {
+        perror("Error al reservar la rueda");
+        return;
+    }
+
+    // Programar: vencimientos aleatorios dentro de la próxima hora
+    double start = now_ns();
+    for (uint32_t i = 0; i < timers; i++) {
+        timer_wheel_schedule(&wheel, i, base + 1000 + next_random() % HOUR_MS);
+    }
+    double schedule_ns = (now_ns() - start) / timers;
+
+    // Reprogramar: cada lease se renueva una vez
+    start = now_ns();
+    for (uint32_t i = 0; i < timers; i++) {
+        timer_wheel_schedule(&wheel, i, base + 1000 + next_random() % HOUR_MS);
+    }
+    double renew_ns = (now_ns() - start) / timers;
+
+    // Tick sin vencimientos: avanzar 1 ms cada vez durante el primer segundo
+    int ticks = 0;
+    uint32_t fired = 0;
+    start = now_ns();
+    for (uint64_t tick = base; tick < base + 1000; tick++, ticks++) {
+        while (timer_wheel_expire_next(&wheel, tick) != TIMER_NONE) fired++;
+    }
+    double idle_tick_ns = (now_ns() - start) / ticks;
+
+    // Referencia: recorrer todos los leases comparando tiempos, como el barrido original
+    lease_store_t store;
+    lease_store_init(&store, 0, timers);
+    uint8_t mac[6] = {0x02, 0, 0, 0, 0, 0};
+    for (uint32_t i = 0; i < timers; i++) {
+        lease_store_insert(&store, i, mac, 3600, 1);
+    }
+    uint32_t sweep_expired = 0;
+    time_t current_time = 2;
+    start = now_ns();
+    for (uint32_t i = 0; i < store.size; i++) {
+        ip_assignment_t* assignment = &store.leases[i];
+        if (assignment->state == LEASE_ACTIVE &&
+            current_time - (time_t)assignment->lease_start > (time_t)assignment->lease_time) {
+            sweep_expired++;
+        }
+    }
+    double sweep_ns = now_ns() - start;
+    lease_store_free(&store);
+
+    // Cancelar la mitad y reclamar la otra mitad en un solo lote
+    start = now_ns();
+    for (uint32_t i = 0; i < timers; i += 2) {
+        timer_wheel_cancel(&wheel, i);
+    }
+    double cancel_ns = (now_ns() - start) / ((timers + 1) / 2);
+
+    start = now_ns();
+    uint32_t expired = 0;
+    while (timer_wheel_expire_next(&wheel, base + 1000 + HOUR_MS) != TIMER_NONE) expired++;
+    double expire_ns = expired ? (now_ns() - start) / expired : 0;
+
+    printf("%8u timers (%zu B por timer): programar %5.1f ns | reprogramar %5.1f ns | cancelar %5.1f ns | "
+           "vencer %5.1f ns por lease (%u en lote)\n",
+           timers, sizeof(timer_node_t), schedule_ns, renew_ns, cancel_ns, expire_ns, expired);
+    printf("         tick sin vencimientos: %.1f ns (%u disparados) | barrido completo de referencia: %.0f ns (%u vencidos)\n",
+           idle_tick_ns, fired, sweep_ns, sweep_expired);
+
+    timer_wheel_free(&wheel);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) measure((uint32_t)strtoul(argv[i], NULL, 10));
+    } else {
+        measure(1000000);
+    }
+    return 0;
+}
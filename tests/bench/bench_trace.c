@@ -0,0 +1,330 @@
+// Benchmark de las trazas de latencia por etapa (src/server/dhcp_trace.c)
+//
+// 1. Costo: CPU por intercambio DORA a través del pool de workers con la traza apagada y
+//    activa, contra el mismo benchmark compilado sin trazas (bench_trace_notrace, que el
+//    Makefile arma desde este archivo con -DDHCP_TRACE_COMPILED=0). Cada ronda corre en un
+//    proceso nuevo, las variantes se alternan y se compara la mediana.
+// 2. Etapas: con DHCP_TRACE=kernel un cliente envía DISCOVER y REQUEST por loopback al
+//    socket del pool. Cada paquete debe dejar una muestra en cada etapa de su tipo, y con la
+//    traza apagada no se registra nada.
+// Uso: ./bench_trace [macs] [rondas]   (por defecto 50000 y 7)
+// Retorna 1 si la traza apagada cuesta más de 1% o falta alguna etapa.
+
+#include "dhcp_server.h"
+#include <sys/resource.h> // Para getrusage
+#include <sys/wait.h>     // Para waitpid
+
+#define STAGE_CHECK_MACS 2000
+#define STAGE_CHECK_WINDOW 64
+
+static FILE* out;  // Salida de resultados (stdout real, el servidor escribe en /dev/null)
+
+static double cpu_seconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static void make_mac(uint8_t* mac, uint32_t index) {
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = (index >> 24) & 0xff;
+    mac[3] = (index >> 16) & 0xff;
+    mac[4] = (index >> 8) & 0xff;
+    mac[5] = index & 0xff;
+}
+
+static size_t build_packet(struct dhcp_packet* packet, const uint8_t* mac, uint32_t xid, uint8_t type, uint32_t requested_ip) {
+    memset(packet, 0, sizeof(*packet));
+    packet->op = 1;
+    packet->htype = 1;
+    packet->hlen = 6;
+    packet->xid = htonl(xid);
+    memcpy(packet->chaddr, mac, 6);
+
+    int i = 0;
+    packet->options[i++] = 53;
+    packet->options[i++] = 1;
+    packet->options[i++] = type;
+    if (requested_ip) {
+        uint32_t net_ip = htonl(requested_ip);
+        packet->options[i++] = 50;
+        packet->options[i++] = 4;
+        memcpy(&packet->options[i], &net_ip, 4);
+        i += 4;
+    }
+    packet->options[i++] = 255;
+    return sizeof(*packet) - sizeof(packet->options) + i;
+}
+
+static void configure_server() {
+    server_ip = ntohl(inet_addr("127.0.0.1"));
+    subnet_mask = inet_addr("255.0.0.0");
+    gateway_ip = inet_addr("127.0.0.1");
+    dns_server_ip = inet_addr("127.0.0.1");
+    default_lease_time = 3600;
+}
+
+// Socket UDP en loopback con un puerto libre
+static int bind_loopback(struct sockaddr_in* addr) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    socklen_t length = sizeof(*addr);
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (struct sockaddr*)addr, sizeof(*addr));
+    getsockname(fd, (struct sockaddr*)addr, &length);
+    return fd;
+}
+
+//================================================
+// Costo: una ronda DORA en este proceso (modo --ronda)
+
+static void dispatch_blocking(struct sockaddr_in* addr, struct dhcp_packet* packet, size_t length) {
+    while (dispatch_dhcp_packet(addr, (uint8_t*)packet, length) < 0) {
+        drain_worker_pool();
+    }
+}
+
+// Retorna la CPU por DORA en ns
+static double measure_round(uint32_t macs) {
+    struct sockaddr_in sink;
+    int sink_fd = bind_loopback(&sink);
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct dhcp_packet packet;
+    uint8_t mac[6];
+
+    init_ip_range(&global_ip_range, 10u << 24, (10u << 24) + macs + 1, 1);
+    split_ip_pool(&global_ip_range, 1);
+    start_worker_pool(sockfd, 1);
+
+    double cpu_start = cpu_seconds();
+    for (uint32_t i = 0; i < macs; i++) {
+        make_mac(mac, i);
+        dispatch_blocking(&sink, &packet, build_packet(&packet, mac, 0x1000, DHCP_DISCOVER, 0));
+    }
+    drain_worker_pool();
+    for (uint32_t i = 0; i < macs; i++) {
+        make_mac(mac, i);
+        client_transaction_t* txn = txn_table_find(&workers[0].transactions, mac, htonl(0x1000), txn_clock_now());
+        dispatch_blocking(&sink, &packet, build_packet(&packet, mac, 0x1000, DHCP_REQUEST, txn ? txn->offered_ip : 0));
+    }
+    drain_worker_pool();
+    double cpu = cpu_seconds() - cpu_start;
+
+    stop_worker_pool();
+    close(sockfd);
+    close(sink_fd);
+    return cpu * 1e9 / macs;
+}
+
+// Ejecuta `program --ronda macs modo` y lee la CPU por DORA que imprime (-1 si falla)
+static double run_child(const char* program, uint32_t macs, const char* mode) {
+    int pipe_fds[2];
+    if (pipe(pipe_fds) < 0) return -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        dup2(pipe_fds[1], STDOUT_FILENO);
+        close(pipe_fds[0]);
+        char macs_arg[16];
+        snprintf(macs_arg, sizeof(macs_arg), "%u", macs);
+        execl(program, program, "--ronda", macs_arg, mode, (char*)NULL);
+        _exit(127);
+    }
+    close(pipe_fds[1]);
+    char line[64] = {0};
+    ssize_t length = read(pipe_fds[0], line, sizeof(line) - 1);
+    close(pipe_fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (length <= 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) return -1;
+    return strtod(line, NULL);
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double* values, int count) {
+    qsort(values, count, sizeof(double), compare_doubles);
+    return count % 2 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+//================================================
+// Etapas: DORA real por loopback con marcas del kernel
+
+// Envía un paquete por cada MAC de la ventana, los recibe como el bucle de eventos y lee las respuestas
+static int exchange_window(int client_fd, int server_fd, struct sockaddr_in* server, dhcp_msg_batch_t* batch,
+                           uint32_t first, uint32_t count, uint8_t type, uint32_t* offered) {
+    struct dhcp_packet packet;
+    uint8_t mac[6];
+    for (uint32_t i = first; i < first + count; i++) {
+        make_mac(mac, i);
+        size_t length = build_packet(&packet, mac, i + 1, type, type == DHCP_REQUEST ? offered[i] : 0);
+        sendto(client_fd, &packet, length, 0, (struct sockaddr*)server, sizeof(*server));
+    }
+
+    uint32_t received = 0;
+    for (int tries = 0; received < count && tries < 100000; tries++) {
+        int got = receive_dhcp_packets(server_fd, batch, MSG_DONTWAIT | MSG_WAITFORONE);
+        if (got > 0) received += (uint32_t)got;
+    }
+    drain_worker_pool();
+
+    // Respuestas: la IP ofrecida a cada xid
+    uint32_t replies = 0;
+    struct dhcp_packet reply;
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    while (replies < count && recv(client_fd, &reply, sizeof(reply), 0) > 0) {
+        uint32_t index = ntohl(reply.xid) - 1;
+        if (index < first + count && index >= first) {
+            offered[index] = ntohl(reply.yiaddr);
+            replies++;
+        }
+    }
+    return received == count && replies == count ? 0 : -1;
+}
+
+static int run_dora(uint32_t macs) {
+    struct sockaddr_in server, client;
+    int server_fd = bind_loopback(&server);
+    int client_fd = bind_loopback(&client);
+    int rcvbuf = 4 << 20;
+    setsockopt(server_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    init_ip_range(&global_ip_range, 11u << 24, (11u << 24) + macs + 1, 2);
+    split_ip_pool(&global_ip_range, 1);
+    start_worker_pool(server_fd, 1);  // Pide SO_TIMESTAMPNS si DHCP_TRACE=kernel
+
+    dhcp_msg_batch_t batch;
+    dhcp_batch_init(&batch, io_batch_size);
+    uint32_t* offered = calloc(macs, sizeof(uint32_t));
+    int failed = 0;
+    for (uint32_t first = 0; first < macs; first += STAGE_CHECK_WINDOW) {
+        uint32_t count = macs - first < STAGE_CHECK_WINDOW ? macs - first : STAGE_CHECK_WINDOW;
+        failed |= exchange_window(client_fd, server_fd, &server, &batch, first, count, DHCP_DISCOVER, offered);
+        failed |= exchange_window(client_fd, server_fd, &server, &batch, first, count, DHCP_REQUEST, offered);
+    }
+
+    stop_worker_pool();
+    free_ip_range(&global_ip_range);
+    dhcp_batch_free(&batch);
+    free(offered);
+    close(server_fd);
+    close(client_fd);
+    return failed;
+}
+
+static uint64_t total_samples() {
+    uint64_t total = 0;
+    dhcp_trace_summary_t summary;
+    for (int type = 0; type < DHCP_TRACE_TYPE_COUNT; type++) {
+        for (int stage = 0; stage < DHCP_TRACE_STAGE_COUNT; stage++) {
+            total += dhcp_trace_summarize((dhcp_trace_type_t)type, (dhcp_trace_stage_t)stage, &summary);
+        }
+    }
+    return total;
+}
+
+static int check_stages(uint32_t macs) {
+    int failed = 0;
+    dhcp_trace_reset();
+    dhcp_trace_configure("kernel");
+    if (run_dora(macs) < 0) {
+        fprintf(out, "  Faltaron paquetes o respuestas en el intercambio por loopback\n");
+        failed = 1;
+    }
+    dhcp_trace_dump(out);
+
+    // Cada DISCOVER y cada REQUEST pasa por todas las etapas menos el vaciado del lote
+    dhcp_trace_type_t types[] = { DHCP_TRACE_DISCOVER, DHCP_TRACE_REQUEST };
+    for (int t = 0; t < 2; t++) {
+        for (int stage = 0; stage < DHCP_TRACE_STAGE_COUNT; stage++) {
+            if (stage == DHCP_TRACE_FLUSH) continue;
+            dhcp_trace_summary_t summary;
+            uint64_t count = dhcp_trace_summarize(types[t], (dhcp_trace_stage_t)stage, &summary);
+            if (count != macs) {
+                fprintf(out, "  Etapa %d del tipo %d: %llu muestras (esperadas %u)\n",
+                        stage, (int)types[t], (unsigned long long)count, macs);
+                failed = 1;
+            }
+        }
+    }
+    dhcp_trace_summary_t flush;
+    if (dhcp_trace_summarize(DHCP_TRACE_BATCH, DHCP_TRACE_FLUSH, &flush) == 0) {
+        fprintf(out, "  Sin muestras de vaciado de lotes\n");
+        failed = 1;
+    }
+
+    // Apagada no se registra nada
+    uint64_t before = total_samples();
+    dhcp_trace_configure("off");
+    failed |= run_dora(macs / 4);
+    uint64_t after = total_samples();
+    fprintf(out, "Con DHCP_TRACE=off: %llu muestras nuevas\n", (unsigned long long)(after - before));
+    return failed || after != before;
+}
+
+int main(int argc, char* argv[]) {
+    configure_server();
+
+    // Una ronda de costo en un proceso nuevo: imprime la CPU por DORA y termina
+    if (argc > 3 && strcmp(argv[1], "--ronda") == 0) {
+        uint32_t macs = (uint32_t)strtoul(argv[2], NULL, 10);
+        dhcp_trace_configure(argv[3]);
+        out = fdopen(dup(STDOUT_FILENO), "w");
+        if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) {
+            return 1;
+        }
+        fprintf(out, "%.1f\n", measure_round(macs));
+        fclose(out);
+        return 0;
+    }
+
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(out, NULL, _IOLBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+
+    uint32_t macs = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 50000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 7;
+    if (rounds < 1) rounds = 1;
+    if (rounds > 64) rounds = 64;
+
+    // El binario sin trazas está junto a este
+    char self[512], notrace[600];
+    ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (length <= 0) return 1;
+    self[length] = '\0';
+    snprintf(notrace, sizeof(notrace), "%s_notrace", self);
+
+    double base[64], off[64], on[64];
+    int failed = 0;
+    for (int r = 0; r < rounds; r++) {
+        base[r] = run_child(notrace, macs, "off");
+        off[r] = run_child(self, macs, "off");
+        on[r] = run_child(self, macs, "on");
+        if (base[r] < 0 || off[r] < 0 || on[r] < 0) {
+            fprintf(out, "No se pudo ejecutar una ronda (¿falta %s?)\n", notrace);
+            return 1;
+        }
+    }
+    double base_ns = median(base, rounds), off_ns = median(off, rounds), on_ns = median(on, rounds);
+    double off_overhead = (off_ns / base_ns - 1) * 100;
+    fprintf(out, "CPU por DORA (%u MACs, mediana de %d rondas): sin trazas %.0f ns, compiladas y apagadas %.0f ns (%+.2f%%), "
+                 "activas %.0f ns (%+.2f%%)\n",
+            macs, rounds, base_ns, off_ns, off_overhead, on_ns, (on_ns / base_ns - 1) * 100);
+    if (off_overhead > 1.0) {
+        fprintf(out, "FALLO: la traza apagada cuesta más de 1%%\n");
+        failed = 1;
+    }
+
+    failed |= check_stages(STAGE_CHECK_MACS);
+    fprintf(out, "%s\n", failed ? "FALLO" : "OK");
+    return failed;
+}
@@ -0,0 +1,147 @@
+// Microbenchmark de la tabla de transacciones en vuelo
+//
+// Compara la tabla de direccionamiento abierto indexada por (chaddr, xid) contra la
+// tabla encadenada anterior (256 cubetas fijas con nodos reservados con malloc).
+// Uso: ./bench_txn_table [entradas...]   (por defecto 100, 10000, 100000 y 1000000)
+
+#include "dhcp_txn_table.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define CHAINED_TABLE_SIZE 256
+#define MAX_LOOKUPS 200000   // Búsquedas medidas por tamaño (las encadenadas son O(n))
+
+// Tabla encadenada equivalente a la anterior, conservada solo como referencia
+typedef struct chained_entry {
+    uint8_t chaddr[6];
+    int state;
+    uint32_t offered_ip;
+    int client_id;
+    struct chained_entry* next;
+} chained_entry_t;
+
+static chained_entry_t* chained_table[CHAINED_TABLE_SIZE];
+
+static unsigned int chained_hash(const uint8_t* mac) {
+    unsigned int hash = 0;
+    for (int i = 0; i < 6; ++i) {
+        hash = (hash * 31) + mac[i];
+    }
+    return hash % CHAINED_TABLE_SIZE;
+}
+
+static void chained_insert(const uint8_t* mac) {
+    chained_entry_t* entry = (chained_entry_t*)malloc(sizeof(chained_entry_t));
+    unsigned int bucket = chained_hash(mac);
+    memcpy(entry->chaddr, mac, 6);
+    entry->state = TXN_SELECTING;
+    entry->next = chained_table[bucket];
+    chained_table[bucket] = entry;
+}
+
+static chained_entry_t* chained_find(const uint8_t* mac) {
+    chained_entry_t* current = chained_table[chained_hash(mac)];
+    while (current != NULL) {
+        if (memcmp(current->chaddr, mac, 6) == 0) return current;
+        current = current->next;
+    }
+    return NULL;
+}
+
+static void chained_clear() {
+    for (int i = 0; i < CHAINED_TABLE_SIZE; i++) {
+        while (chained_table[i]) {
+            chained_entry_t* next = chained_table[i]->next;
+            free(chained_table[i]);
+            chained_table[i] = next;
+        }
+    }
+}
+
+static double now_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// MACs de un mismo fabricante (OUI fijo), como en una red real
+static void make_mac(uint8_t* mac, uint32_t index) {
+    mac[0] = 0x00;
+    mac[1] = 0x1a;
+    mac[2] = 0x2b;
+    mac[3] = (index >> 16) & 0xff;
+    mac[4] = (index >> 8) & 0xff;
+    mac[5] = index & 0xff;
+    // Más de 2^24 MACs no se usan, el byte alto solo desambigua
+    mac[2] ^= (index >> 24) & 0xff;
+}
+
+static void run(uint32_t entries) {
+    uint8_t mac[6];
+    uint32_t lookups = entries < MAX_LOOKUPS ? entries : MAX_LOOKUPS;
+    uint32_t now = txn_clock_now();
+    volatile uint32_t sink = 0;
+
+    // Tabla abierta: inserción, búsqueda con acierto y búsqueda fallida
+    txn_table_t table;
+    txn_table_init(&table, 0);
+    double start = now_ns();
+    for (uint32_t i = 0; i < entries; i++) {
+        make_mac(mac, i);
+        txn_table_insert(&table, mac, i * 2654435761u, now)->offered_ip = i;
+    }
+    double open_insert = (now_ns() - start) / entries;
+
+    start = now_ns();
+    for (uint32_t n = 0; n < lookups; n++) {
+        uint32_t i = (uint32_t)(((uint64_t)n * 2654435761u) % entries);
+        make_mac(mac, i);
+        sink += txn_table_find(&table, mac, i * 2654435761u, now)->offered_ip;
+    }
+    double open_hit = (now_ns() - start) / lookups;
+
+    start = now_ns();
+    for (uint32_t n = 0; n < lookups; n++) {
+        make_mac(mac, entries + n);
+        sink += txn_table_find(&table, mac, n, now) != NULL;
+    }
+    double open_miss = (now_ns() - start) / lookups;
+    // Incluye el timer de vencimiento que acompaña a cada ranura
+    double bytes = (double)table.capacity * (sizeof(client_transaction_t) + sizeof(timer_node_t)) / entries;
+    txn_table_free(&table);
+
+    // Tabla encadenada de referencia
+    start = now_ns();
+    for (uint32_t i = 0; i < entries; i++) {
+        make_mac(mac, i);
+        chained_insert(mac);
+    }
+    double chained_insert_ns = (now_ns() - start) / entries;
+
+    start = now_ns();
+    for (uint32_t n = 0; n < lookups; n++) {
+        uint32_t i = (uint32_t)(((uint64_t)n * 2654435761u) % entries);
+        make_mac(mac, i);
+        sink += chained_find(mac)->state;
+    }
+    double chained_hit = (now_ns() - start) / lookups;
+    chained_clear();
+
+    printf("%8u entradas | abierta: insertar %6.1f ns, buscar %6.1f ns, fallo %6.1f ns, %5.1f B/entrada "
+           "| encadenada: insertar %6.1f ns, buscar %9.1f ns\n",
+           entries, open_insert, open_hit, open_miss, bytes, chained_insert_ns, chained_hit);
+    (void)sink;
+}
+
+int main(int argc, char* argv[]) {
+    uint32_t defaults[] = {100, 10000, 100000, 1000000};
+    int rounds = argc > 1 ? argc - 1 : 4;
+
+    printf("Entrada de la tabla abierta: %zu bytes (+%zu del timer)\n", sizeof(client_transaction_t), sizeof(timer_node_t));
+    for (int r = 0; r < rounds; r++) {
+        run(argc > 1 ? (uint32_t)strtoul(argv[r + 1], NULL, 10) : defaults[r]);
+    }
+    return 0;
+}
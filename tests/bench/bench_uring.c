@@ -0,0 +1,173 @@
+// Benchmark de los backends de E/S del servidor: bucle de sockets frente a io_uring
+//
+// Para cada backend levanta el servidor sobre un socket de loopback en un hilo y un
+// generador envía ventanas de DISCOVERs de MACs distintas, anotando el instante de envío
+// de cada uno. Con los OFFERs recibidos calcula paquetes/s y la latencia de respuesta
+// (mediana y p99). Los backends son: "sockets" (epoll + pool de workers), "io_uring" y
+// "io_uring+sqpoll". Si el kernel no soporta io_uring, esas filas lo indican.
+// Uso: ./bench_uring [paquetes] [ventana]   (por defecto 100000 paquetes y ventana de 32)
+
+#include "dhcp_server.h"
+
+static FILE* out;  // Salida de resultados (stdout real, el servidor escribe en /dev/null)
+
+typedef enum { BACKEND_SOCKETS, BACKEND_URING, BACKEND_URING_SQPOLL } backend_t;
+
+typedef struct {
+    backend_t backend;
+    int sockfd;
+    int result;
+} server_args_t;
+
+static double monotonic_us() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static size_t build_discover(struct dhcp_packet* packet, uint32_t index) {
+    memset(packet, 0, sizeof(*packet));
+    packet->op = 1;
+    packet->htype = 1;
+    packet->hlen = 6;
+    packet->xid = htonl(index);
+    packet->chaddr[0] = 0x02;
+    packet->chaddr[2] = (index >> 24) & 0xff;
+    packet->chaddr[3] = (index >> 16) & 0xff;
+    packet->chaddr[4] = (index >> 8) & 0xff;
+    packet->chaddr[5] = index & 0xff;
+    packet->options[0] = 53;
+    packet->options[1] = 1;
+    packet->options[2] = DHCP_DISCOVER;
+    packet->options[3] = 255;
+    return sizeof(*packet) - sizeof(packet->options) + 4;
+}
+
+static int bind_loopback(struct sockaddr_in* addr) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    socklen_t len = sizeof(*addr);
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(fd, (struct sockaddr*)addr, sizeof(*addr));
+    getsockname(fd, (struct sockaddr*)addr, &len);
+    int rcvbuf = 4 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    return fd;
+}
+
+static void* server_thread(void* arg) {
+    server_args_t* args = (server_args_t*)arg;
+    if (args->backend == BACKEND_SOCKETS) {
+        start_worker_pool(args->sockfd, 0);
+        handle_dhcp_protocol(args->sockfd);
+        stop_worker_pool();
+        args->result = 0;
+    } else {
+        args->result = run_uring_server(args->sockfd, args->backend == BACKEND_URING_SQPOLL);
+    }
+    return NULL;
+}
+
+static void run(backend_t backend, const char* name, uint32_t packets, int window, int round) {
+    struct sockaddr_in server_addr, client_addr;
+    int server_fd = bind_loopback(&server_addr);
+    int client_fd = bind_loopback(&client_addr);
+    struct timeval timeout = { .tv_sec = 1, .tv_usec = 0 };
+    setsockopt(client_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    // Pool nuevo por ronda, con espacio para todas las MACs
+    uint32_t start_ip = (uint32_t)(10 + round) << 24;
+    init_ip_range(&global_ip_range, start_ip, start_ip + packets + 1, round);
+    split_ip_pool(&global_ip_range, 1);
+    memset(&io_stats, 0, sizeof(io_stats));
+
+    server_args_t args = { .backend = backend, .sockfd = server_fd, .result = 0 };
+    pthread_t thread;
+    pthread_create(&thread, NULL, server_thread, &args);
+
+    // Esperar a que el servidor tenga su bucle de eventos (o a que el backend falle)
+    double wait_start = monotonic_us();
+    while (event_loop_fd() < 0 && monotonic_us() - wait_start < 1e6) {
+        usleep(1000);
+    }
+    if (event_loop_fd() < 0) {
+        pthread_join(thread, NULL);
+        fprintf(out, "%-16s no disponible en este kernel\n", name);
+        free_ip_range(&global_ip_range);
+        close(server_fd);
+        close(client_fd);
+        return;
+    }
+
+    double* sent_at = (double*)calloc(packets, sizeof(double));
+    double* latency = (double*)malloc(packets * sizeof(double));
+    uint32_t replies = 0;
+    struct dhcp_packet request, reply;
+
+    double start = monotonic_us();
+    for (uint32_t first = 0; first < packets; first += window) {
+        uint32_t count = packets - first < (uint32_t)window ? packets - first : (uint32_t)window;
+        for (uint32_t i = 0; i < count; i++) {
+            size_t length = build_discover(&request, first + i);
+            sent_at[first + i] = monotonic_us();
+            sendto(client_fd, &request, length, 0, (struct sockaddr*)&server_addr, sizeof(server_addr));
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            if (recv(client_fd, &reply, sizeof(reply), 0) <= 0) break;
+            uint32_t index = ntohl(reply.xid);
+            if (index < packets) {
+                latency[replies++] = monotonic_us() - sent_at[index];
+            }
+        }
+    }
+    double elapsed = (monotonic_us() - start) / 1e6;
+
+    event_loop_wakeup(DHCP_WAKE_STOP);
+    pthread_join(thread, NULL);
+
+    qsort(latency, replies, sizeof(double), compare_double);
+    double median = replies ? latency[replies / 2] : 0;
+    double p99 = replies ? latency[(size_t)(replies * 0.99)] : 0;
+    unsigned long syscalls = io_stats.rx_syscalls + io_stats.tx_syscalls + io_stats.ring_enters;
+    fprintf(out, "%-16s %7u/%u respuestas, %8.0f paquetes/s, latencia mediana %6.1f us, p99 %7.1f us, "
+                 "%.3f syscalls/paquete\n",
+            name, replies, packets, replies / elapsed, median, p99,
+            io_stats.rx_packets ? (double)syscalls / io_stats.rx_packets : 0.0);
+
+    free(sent_at);
+    free(latency);
+    free_ip_range(&global_ip_range);
+    close(server_fd);
+    close(client_fd);
+}
+
+int main(int argc, char* argv[]) {
+    // Resultados por el stdout real; los logs del servidor se descartan
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(out, NULL, _IOLBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+
+    server_ip = ntohl(inet_addr("127.0.0.1"));
+    subnet_mask = inet_addr("255.0.0.0");
+    gateway_ip = inet_addr("127.0.0.1");
+    dns_server_ip = inet_addr("127.0.0.1");
+    default_lease_time = 3600;
+
+    uint32_t packets = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 100000;
+    int window = argc > 2 ? atoi(argv[2]) : 32;
+    if (window < 1) window = 1;
+
+    block_server_signals();
+    run(BACKEND_SOCKETS, "sockets", packets, window, 0);
+    run(BACKEND_URING, "io_uring", packets, window, 1);
+    run(BACKEND_URING_SQPOLL, "io_uring+sqpoll", packets, window, 2);
+    return 0;
+}
@@ -0,0 +1,171 @@
+// Benchmark del pool de workers: CPU por intercambio DORA y memoria por cliente en vuelo
+//
+// Uso: ./bench_workers [macs...]   (por defecto 10000 y 100000 MACs)
+// DHCP_WORKERS controla el tamaño del pool igual que en el servidor.
+// BENCH_ACTIVE_LEASES precarga ese número de leases activos en el pool antes de medir.
+
+#include "dhcp_server.h"
+#include <malloc.h>
+#include <sys/resource.h>
+
+static FILE* out;  // Salida de resultados (stdout real, el servidor escribe en /dev/null)
+
+static double cpu_seconds() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+           usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+static double wall_seconds() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void make_mac(uint8_t* mac, uint32_t index) {
+    mac[0] = 0x02;
+    mac[1] = 0x00;
+    mac[2] = (index >> 24) & 0xff;
+    mac[3] = (index >> 16) & 0xff;
+    mac[4] = (index >> 8) & 0xff;
+    mac[5] = index & 0xff;
+}
+
+static size_t build_packet(struct dhcp_packet* packet, const uint8_t* mac, uint8_t type, uint32_t requested_ip) {
+    memset(packet, 0, sizeof(*packet));
+    packet->op = 1;
+    packet->htype = 1;
+    packet->hlen = 6;
+    packet->xid = htonl(0x1000);
+    memcpy(packet->chaddr, mac, 6);
+
+    int i = 0;
+    packet->options[i++] = 53;
+    packet->options[i++] = 1;
+    packet->options[i++] = type;
+    if (requested_ip) {
+        uint32_t net_ip = htonl(requested_ip);
+        packet->options[i++] = 50;
+        packet->options[i++] = 4;
+        memcpy(&packet->options[i], &net_ip, 4);
+        i += 4;
+    }
+    packet->options[i++] = 255;
+    return sizeof(*packet) - sizeof(packet->options) + i;
+}
+
+// Encola un paquete y, si la cola del worker está llena, espera a que se vacíe
+static void dispatch_blocking(struct sockaddr_in* addr, struct dhcp_packet* packet, size_t length) {
+    while (dispatch_dhcp_packet(addr, (uint8_t*)packet, length) < 0) {
+        drain_worker_pool();
+    }
+}
+
+static size_t in_flight_transactions() {
+    size_t total = 0;
+    for (int i = 0; i < num_workers; i++) {
+        total += workers[i].transactions.count;
+    }
+    return total;
+}
+
+static void run(uint32_t macs, uint32_t active_leases, int round, int sockfd, struct sockaddr_in* sink) {
+    struct dhcp_packet packet;
+    uint8_t mac[6];
+
+    // Un rango nuevo por ronda, con espacio para los leases precargados al final
+    uint32_t size = macs + 2 + active_leases;
+    uint32_t start_ip = (uint32_t)(10 + round) << 24;
+    init_ip_range(&global_ip_range, start_ip, start_ip + size - 1, round);
+    split_ip_pool(&global_ip_range, 1);
+
+    // Leases de otros clientes que siguen vigentes mientras se mide
+    for (uint32_t i = 0; i < active_leases; i++) {
+        make_mac(mac, 0x80000000u | i);
+        insert_ip_assignment(&global_ip_range, global_ip_range.end_ip - i, mac, default_lease_time);
+    }
+
+    start_worker_pool(sockfd, 0);
+    struct mallinfo2 before = mallinfo2();
+    double cpu_start = cpu_seconds();
+    double wall_start = wall_seconds();
+
+    // DISCOVER -> OFFER
+    for (uint32_t i = 0; i < macs; i++) {
+        make_mac(mac, i);
+        size_t length = build_packet(&packet, mac, DHCP_DISCOVER, 0);
+        dispatch_blocking(sink, &packet, length);
+    }
+    drain_worker_pool();
+
+    struct mallinfo2 after = mallinfo2();
+    size_t in_flight = in_flight_transactions();
+
+    // REQUEST -> ACK usando la IP ofrecida a cada MAC
+    for (uint32_t i = 0; i < macs; i++) {
+        make_mac(mac, i);
+        dhcp_worker_t* worker = &workers[hash_mac(mac) % num_workers];
+        client_transaction_t* txn = txn_table_find(&worker->transactions, mac, htonl(0x1000), txn_clock_now());
+        size_t length = build_packet(&packet, mac, DHCP_REQUEST, txn ? txn->offered_ip : 0);
+        dispatch_blocking(sink, &packet, length);
+    }
+    drain_worker_pool();
+
+    double cpu = cpu_seconds() - cpu_start;
+    double wall = wall_seconds() - wall_start;
+    size_t bound = 0;
+    for (uint32_t i = 0; i < macs; i++) {
+        make_mac(mac, i);
+        dhcp_worker_t* worker = &workers[hash_mac(mac) % num_workers];
+        client_transaction_t* txn = txn_table_find(&worker->transactions, mac, htonl(0x1000), txn_clock_now());
+        if (txn && txn->state == TXN_BOUND) bound++;
+    }
+
+    fprintf(out, "%7u MACs, %d workers, %u leases activos: %zu/%u BOUND, CPU/DORA %.2f us, %.0f DORA/s, "
+                 "memoria por cliente en vuelo %.0f B (transacción %zu B, %zu en vuelo)\n",
+            macs, num_workers, active_leases, bound, macs, cpu * 1e6 / macs, macs / wall,
+            (double)(after.uordblks - before.uordblks) / macs, sizeof(client_transaction_t), in_flight);
+
+    stop_worker_pool();
+    free_ip_range(&global_ip_range);
+}
+
+int main(int argc, char* argv[]) {
+    // Resultados por el stdout real; los logs del servidor se descartan
+    out = fdopen(dup(STDOUT_FILENO), "w");
+    setvbuf(out, NULL, _IOLBF, 0);
+    if (!freopen("/dev/null", "w", stdout) || !freopen("/dev/null", "w", stderr)) {
+        return 1;
+    }
+
+    server_ip = ntohl(inet_addr("127.0.0.1"));
+    subnet_mask = inet_addr("255.0.0.0");
+    gateway_ip = inet_addr("127.0.0.1");
+    dns_server_ip = inet_addr("127.0.0.1");
+    default_lease_time = 3600;
+
+    // Las respuestas van a un socket local que nadie lee (el kernel descarta el exceso)
+    int sink_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    struct sockaddr_in sink;
+    socklen_t sink_len = sizeof(sink);
+    memset(&sink, 0, sizeof(sink));
+    sink.sin_family = AF_INET;
+    sink.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(sink_fd, (struct sockaddr*)&sink, sizeof(sink));
+    getsockname(sink_fd, (struct sockaddr*)&sink, &sink_len);
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+
+    const char* active_env = getenv("BENCH_ACTIVE_LEASES");
+    uint32_t active_leases = active_env ? (uint32_t)strtoul(active_env, NULL, 10) : 0;
+    uint32_t defaults[] = {10000, 100000};
+    int rounds = argc > 1 ? argc - 1 : 2;
+    for (int r = 0; r < rounds; r++) {
+        uint32_t macs = argc > 1 ? (uint32_t)strtoul(argv[r + 1], NULL, 10) : defaults[r];
+        run(macs, active_leases, r, sockfd, &sink);
+    }
+
+    close(sockfd);
+    close(sink_fd);
+    return 0;
+}